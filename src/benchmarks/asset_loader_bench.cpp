@@ -0,0 +1,168 @@
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "scene_generator.h"
+#include "web_gpu_app/asset_loader.h"
+#include "web_gpu_app/mapped_file.h"
+#include "web_gpu_app/mesh_cache.h"
+#include "web_gpu_app/mesh_file.h"
+#include "web_gpu_app/mesh_optimizer.h"
+#include "web_gpu_app/utils.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+// Number of quads of the meshes loaded by the multi-asset benchmarks, about 1 MB of OBJ each.
+constexpr size_t kAssetNumQuads = 10'000;
+
+std::filesystem::path GetBenchmarkDirectory() {
+  std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / "web_gpu_app_bench_assets";
+  std::filesystem::create_directories(directory);
+  return directory;
+}
+
+// Returns the path of a grid OBJ with "num_quads" quads, writing it on first use.
+std::string GetGridObj(size_t num_quads) {
+  std::filesystem::path path =
+      GetBenchmarkDirectory() / ("grid_" + std::to_string(num_quads) + ".obj");
+  if (!std::filesystem::exists(path)) WriteGridObj(num_quads, path.string());
+  return path.string();
+}
+
+PrimitiveGeometry LoadObjGeometry(const std::string& path) {
+  tinyobj::attrib_t attrib;
+  std::vector<tinyobj::shape_t> shapes;
+  std::vector<tinyobj::material_t> materials;
+  std::string warning;
+  std::string error;
+  if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warning, &error, path.c_str()) ||
+      shapes.empty()) {
+    return {};
+  }
+  return ConvertMesh(attrib, shapes[0].mesh);
+}
+
+// Returns the path of the grid OBJ of "num_quads" quads converted to a mesh file, as obj_to_mesh
+// does.
+std::string GetGridMeshFile(size_t num_quads) {
+  std::filesystem::path path =
+      GetBenchmarkDirectory() / ("grid_" + std::to_string(num_quads) + ".v" +
+                                 std::to_string(kMeshFileVersion) + ".wgmesh");
+  if (!std::filesystem::exists(path)) {
+    PrimitiveGeometry geometry = LoadObjGeometry(GetGridObj(num_quads));
+    OptimizeMesh(&geometry);
+    WriteMeshFile(path.string(), geometry);
+  }
+  return path.string();
+}
+
+// Size is the number of quads of the mesh in the file.
+void ReadObjToString(BenchmarkState& state) {
+  const std::string path = GetGridObj(state.size());
+  size_t num_bytes = 0;
+  while (state.KeepRunning()) {
+    std::string content = ReadFileToString(path);
+    num_bytes = content.size();
+    DoNotOptimize(content.data());
+  }
+  state.SetBytesProcessed(state.iterations() * num_bytes);
+}
+
+// Maps the file and touches every page so that the comparison with ReadObjToString is fair.
+void MapObjFile(BenchmarkState& state) {
+  const std::string path = GetGridObj(state.size());
+  size_t num_bytes = 0;
+  while (state.KeepRunning()) {
+    MappedFile file;
+    if (!file.Open(path)) {
+      state.SkipWithError("Cannot open " + path);
+      return;
+    }
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < file.GetSize(); i += 4096) checksum += file.GetData()[i];
+    DoNotOptimize(checksum);
+    num_bytes = file.GetSize();
+  }
+  state.SetBytesProcessed(state.iterations() * num_bytes);
+}
+
+// Parses the OBJ file into the geometry that is uploaded. Compare with LoadMeshFile.
+void LoadObjMesh(BenchmarkState& state) {
+  const std::string path = GetGridObj(state.size());
+  size_t num_vertices = 0;
+  while (state.KeepRunning()) {
+    PrimitiveGeometry geometry = LoadObjGeometry(path);
+    num_vertices = geometry.vertices.size();
+    DoNotOptimize(geometry.vertices.data());
+  }
+  if (num_vertices == 0) {
+    state.SkipWithError("Failed to load " + path);
+    return;
+  }
+  state.SetItemsProcessed(state.iterations() * num_vertices);
+  state.SetBytesProcessed(state.iterations() * std::filesystem::file_size(path));
+}
+
+// Maps and validates the mesh file, and reads all its pages. The data is then ready to upload.
+void LoadMeshFile(BenchmarkState& state) {
+  const std::string path = GetGridMeshFile(state.size());
+  size_t num_vertices = 0;
+  while (state.KeepRunning()) {
+    MeshFile file;
+    std::string error;
+    if (!file.Open(path, &error)) {
+      state.SkipWithError(error);
+      return;
+    }
+    file.Prefetch();
+    num_vertices = file.GetHeader().num_vertices;
+    DoNotOptimize(file.GetVertexData().data());
+  }
+  state.SetItemsProcessed(state.iterations() * num_vertices);
+  state.SetBytesProcessed(state.iterations() * std::filesystem::file_size(path));
+}
+
+// Size is the number of OBJ assets loaded per iteration.
+void LoadObjAssets(BenchmarkState& state, uint32_t num_threads) {
+  const std::string path = GetGridObj(kAssetNumQuads);
+  AssetLoader asset_loader(num_threads);
+  size_t num_failed = 0;
+  while (state.KeepRunning()) {
+    for (size_t i = 0; i < state.size(); ++i) {
+      asset_loader.Load(path, AssetType::kObj, [&](Asset& asset) {
+        if (asset.status != AssetStatus::kLoaded) ++num_failed;
+        DoNotOptimize(asset.obj.attrib.vertices.data());
+      });
+    }
+    asset_loader.WaitIdle();
+  }
+  if (num_failed > 0) {
+    state.SkipWithError("Failed to load " + path);
+    return;
+  }
+  AssetLoaderStats stats = asset_loader.GetStats();
+  state.SetItemsProcessed(stats.num_loaded);
+  state.SetBytesProcessed(stats.loaded_bytes);
+  state.SetCounter("threads", num_threads);
+}
+
+void LoadObjAssetsSingleThreaded(BenchmarkState& state) { LoadObjAssets(state, 0); }
+
+void LoadObjAssetsThreaded(BenchmarkState& state) {
+  LoadObjAssets(state, AssetLoader::GetDefaultNumThreads());
+}
+
+}  // namespace
+
+REGISTER_BENCHMARK(ReadObjToString, 1'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(MapObjFile, 1'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(LoadObjMesh, 1'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(LoadMeshFile, 1'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(LoadObjAssetsSingleThreaded, 1, 16, 64);
+REGISTER_BENCHMARK(LoadObjAssetsThreaded, 1, 16, 64);
+
+}  // namespace web_gpu_app
@@ -0,0 +1,129 @@
+#include "benchmark.h"
+
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "web_gpu_app/culling.h"
+#include "web_gpu_app/thread_pool.h"
+
+namespace web_gpu_app {
+
+BenchmarkState::BenchmarkState(size_t size, double min_time_seconds)
+    : size_(size), min_time_seconds_(min_time_seconds) {}
+
+bool BenchmarkState::KeepRunning() {
+  if (!error_.empty()) return false;
+  Clock::time_point now = Clock::now();
+  if (!started_) {
+    started_ = true;
+    start_time_ = now;
+    return true;
+  }
+
+  ++iterations_;
+  Clock::duration elapsed = elapsed_ + (now - start_time_);
+  if (std::chrono::duration<double>(elapsed).count() < min_time_seconds_) return true;
+  elapsed_ = elapsed;
+  return false;
+}
+
+void BenchmarkState::PauseTiming() {
+  if (paused_) return;
+  paused_ = true;
+  elapsed_ += Clock::now() - start_time_;
+}
+
+void BenchmarkState::ResumeTiming() {
+  if (!paused_) return;
+  paused_ = false;
+  start_time_ = Clock::now();
+}
+
+BenchmarkRunner& BenchmarkRunner::Get() {
+  static BenchmarkRunner runner;
+  return runner;
+}
+
+void BenchmarkRunner::Register(const char* name, BenchmarkFunction function,
+                               std::vector<size_t> sizes) {
+  benchmarks_.push_back({name, std::move(function), std::move(sizes)});
+}
+
+std::vector<BenchmarkResult> BenchmarkRunner::Run(const BenchmarkOptions& options) {
+  std::vector<BenchmarkResult> results;
+  std::fprintf(stderr, "%-40s %12s %14s %14s %14s\n", "Benchmark", "Iterations", "ns/iter",
+               "items/s", "MB/s");
+  for (const Benchmark& benchmark : benchmarks_) {
+    if (benchmark.name.find(options.filter) == std::string::npos) continue;
+    for (size_t size : benchmark.sizes) {
+      if (size > options.max_size) continue;
+
+      BenchmarkState state(size, options.min_time_seconds);
+      benchmark.function(state);
+
+      BenchmarkResult result;
+      result.name = benchmark.name;
+      result.size = size;
+      result.iterations = state.iterations_;
+      result.error = state.error_;
+      result.counters = state.counters_;
+      double seconds = std::chrono::duration<double>(state.elapsed_).count();
+      if (state.iterations_ > 0 && seconds > 0) {
+        result.ns_per_iteration = seconds * 1e9 / static_cast<double>(state.iterations_);
+        result.items_per_second = static_cast<double>(state.num_items_) / seconds;
+        result.bytes_per_second = static_cast<double>(state.num_bytes_) / seconds;
+      }
+
+      std::string label = result.name + "/" + std::to_string(size);
+      if (!result.error.empty()) {
+        std::fprintf(stderr, "%-40s ERROR: %s\n", label.c_str(), result.error.c_str());
+      } else {
+        std::fprintf(stderr, "%-40s %12llu %14.0f %14.4g %14.1f\n", label.c_str(),
+                     static_cast<unsigned long long>(result.iterations), result.ns_per_iteration,
+                     result.items_per_second, result.bytes_per_second / 1e6);
+        for (const auto& [name, value] : result.counters) {
+          std::fprintf(stderr, "%-40s   %s = %g\n", "", name.c_str(), value);
+        }
+      }
+      results.push_back(std::move(result));
+    }
+  }
+  return results;
+}
+
+std::string BenchmarkRunner::ToJson(const std::vector<BenchmarkResult>& results) {
+  std::ostringstream json;
+  json << std::setprecision(10);
+  json << "{\n  \"context\": {\"num_cpus\": " << std::thread::hardware_concurrency()
+#if defined(__EMSCRIPTEN__)
+       << ", \"platform\": \"wasm\""
+#else
+       << ", \"platform\": \"native\""
+#endif
+       << ", \"worker_threads\": " << ThreadPool::GetDefaultNumThreads() << ", \"simd\": \""
+       << GetCullingSimdName() << "\""
+       << "},\n  \"benchmarks\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchmarkResult& result = results[i];
+    json << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << result.name << "/" << result.size
+         << "\", \"benchmark\": \"" << result.name << "\", \"size\": " << result.size
+         << ", \"iterations\": " << result.iterations
+         << ", \"ns_per_iteration\": " << result.ns_per_iteration
+         << ", \"items_per_second\": " << result.items_per_second
+         << ", \"bytes_per_second\": " << result.bytes_per_second;
+    for (const auto& [name, value] : result.counters) {
+      json << ", \"" << name << "\": " << value;
+    }
+    if (!result.error.empty()) {
+      json << ", \"error\": \"" << result.error << "\"";
+    }
+    json << "}";
+  }
+  json << "\n  ]\n}\n";
+  return json.str();
+}
+
+}  // namespace web_gpu_app
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "web_gpu_app/profiler.h"
+
+// Registers "function" to run once for each of the scene sizes passed as extra arguments.
+#define REGISTER_BENCHMARK(function, ...)                                        \
+  static ::web_gpu_app::BenchmarkRegistration WEB_GPU_APP_CONCAT(registration_, \
+                                                                 __LINE__)(#function, function, \
+                                                                           {__VA_ARGS__})
+
+namespace web_gpu_app {
+
+// Timing state of one benchmark run. The benchmark performs its setup, then loops on
+// KeepRunning() around the code to measure.
+class BenchmarkState {
+ public:
+  BenchmarkState(size_t size, double min_time_seconds);
+
+  size_t size() const { return size_; }
+  uint64_t iterations() const { return iterations_; }
+
+  bool KeepRunning();
+  void PauseTiming();
+  void ResumeTiming();
+
+  void SetItemsProcessed(uint64_t num_items) { num_items_ = num_items; }
+  void SetBytesProcessed(uint64_t num_bytes) { num_bytes_ = num_bytes; }
+  void SetCounter(const std::string& name, double value) { counters_[name] = value; }
+  void SkipWithError(const std::string& error) { error_ = error; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+  friend class BenchmarkRunner;
+
+  size_t size_ = 0;
+  double min_time_seconds_ = 0;
+  uint64_t iterations_ = 0;
+  bool started_ = false;
+  bool paused_ = false;
+  Clock::time_point start_time_;
+  Clock::duration elapsed_{};
+  uint64_t num_items_ = 0;
+  uint64_t num_bytes_ = 0;
+  std::map<std::string, double> counters_;
+  std::string error_;
+};
+
+using BenchmarkFunction = std::function<void(BenchmarkState&)>;
+
+struct BenchmarkResult {
+  std::string name;
+  size_t size = 0;
+  uint64_t iterations = 0;
+  double ns_per_iteration = 0;
+  double items_per_second = 0;
+  double bytes_per_second = 0;
+  std::map<std::string, double> counters;
+  std::string error;
+};
+
+struct BenchmarkOptions {
+  std::string filter;
+  size_t max_size = ~size_t{0};
+  double min_time_seconds = 0.25;
+  std::string json_file;
+};
+
+class BenchmarkRunner {
+ public:
+  static BenchmarkRunner& Get();
+
+  void Register(const char* name, BenchmarkFunction function, std::vector<size_t> sizes);
+  std::vector<BenchmarkResult> Run(const BenchmarkOptions& options);
+  static std::string ToJson(const std::vector<BenchmarkResult>& results);
+
+ private:
+  struct Benchmark {
+    std::string name;
+    BenchmarkFunction function;
+    std::vector<size_t> sizes;
+  };
+
+  std::vector<Benchmark> benchmarks_;
+};
+
+struct BenchmarkRegistration {
+  BenchmarkRegistration(const char* name, BenchmarkFunction function, std::vector<size_t> sizes) {
+    BenchmarkRunner::Get().Register(name, std::move(function), std::move(sizes));
+  }
+};
+
+// Prevents the compiler from optimizing away the computation of "value".
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+#if defined(_MSC_VER)
+  static volatile const void* sink;
+  sink = &value;
+#else
+  asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+}  // namespace web_gpu_app
@@ -0,0 +1,104 @@
+#include <vector>
+
+#include "benchmark.h"
+#include "scene_generator.h"
+#include "web_gpu_app/culling.h"
+#include "web_gpu_app/thread_pool.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+Frustum GetSceneFrustum() {
+  Camera camera = GenerateCamera();
+  return ExtractFrustum(camera.projection * camera.view);
+}
+
+void GetCubeBounds(size_t num_cubes, BoundingSpheres* bounds) {
+  std::vector<Cube> cubes;
+  GenerateCubes(num_cubes, 100.f, 1, &cubes);
+  AppendBounds(cubes, bounds);
+}
+
+void SetCullingCounters(BenchmarkState& state, size_t num_visible) {
+  state.SetItemsProcessed(state.iterations() * state.size());
+  state.SetCounter("visible", static_cast<double>(num_visible));
+}
+
+void ExtractCubeBounds(BenchmarkState& state) {
+  std::vector<Cube> cubes;
+  GenerateCubes(state.size(), 100.f, 1, &cubes);
+  BoundingSpheres bounds;
+  while (state.KeepRunning()) {
+    bounds.clear();
+    AppendBounds(cubes, &bounds);
+    DoNotOptimize(bounds.radius.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.size());
+}
+
+void CullScalar(BenchmarkState& state) {
+  BoundingSpheres bounds;
+  GetCubeBounds(state.size(), &bounds);
+  const Frustum frustum = GetSceneFrustum();
+  std::vector<uint32_t> visible;
+  while (state.KeepRunning()) {
+    visible.clear();
+    CullSpheresScalar(frustum, bounds, 0, bounds.size(), &visible);
+    DoNotOptimize(visible.data());
+  }
+  SetCullingCounters(state, visible.size());
+}
+
+// Also checks that the SIMD path finds the same visible spheres as the scalar one.
+void CullSimd(BenchmarkState& state) {
+  BoundingSpheres bounds;
+  GetCubeBounds(state.size(), &bounds);
+  const Frustum frustum = GetSceneFrustum();
+  std::vector<uint32_t> expected;
+  CullSpheresScalar(frustum, bounds, 0, bounds.size(), &expected);
+  std::vector<uint32_t> visible;
+  CullSpheresSimd(frustum, bounds, 0, bounds.size(), &visible);
+  if (visible != expected) {
+    state.SkipWithError("SIMD culling differs from the scalar reference");
+    return;
+  }
+
+  while (state.KeepRunning()) {
+    visible.clear();
+    CullSpheresSimd(frustum, bounds, 0, bounds.size(), &visible);
+    DoNotOptimize(visible.data());
+  }
+  SetCullingCounters(state, visible.size());
+}
+
+void CullThreaded(BenchmarkState& state) {
+  BoundingSpheres bounds;
+  GetCubeBounds(state.size(), &bounds);
+  const Frustum frustum = GetSceneFrustum();
+  ThreadPool thread_pool;
+  std::vector<uint32_t> expected;
+  CullSpheresScalar(frustum, bounds, 0, bounds.size(), &expected);
+  std::vector<uint32_t> visible;
+  CullSpheres(frustum, bounds, &visible, &thread_pool);
+  if (visible != expected) {
+    state.SkipWithError("Threaded culling differs from the scalar reference");
+    return;
+  }
+
+  while (state.KeepRunning()) {
+    CullSpheres(frustum, bounds, &visible, &thread_pool);
+    DoNotOptimize(visible.data());
+  }
+  SetCullingCounters(state, visible.size());
+  state.SetCounter("threads", thread_pool.GetNumThreads() + 1);
+}
+
+}  // namespace
+
+REGISTER_BENCHMARK(ExtractCubeBounds, 1'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(CullScalar, 1'000, 10'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(CullSimd, 1'000, 10'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(CullThreaded, 10'000, 100'000, 1'000'000);
+
+}  // namespace web_gpu_app
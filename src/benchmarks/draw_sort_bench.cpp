@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "benchmark.h"
+#include "web_gpu_app/draw_sort.h"
+#include "web_gpu_app/thread_pool.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+// Translucent draws, out of 100.
+constexpr size_t kTranslucentPercent = 10;
+
+// Keys of a frame's draws with a few pipelines and textures, and many geometries and depths.
+std::vector<DrawItem> GenerateDrawItems(size_t num_items) {
+  std::mt19937 random(3);
+  std::uniform_int_distribution<uint32_t> pipeline(0, 9);
+  std::uniform_int_distribution<uint32_t> bind_group(0, 15);
+  std::uniform_int_distribution<uint32_t> geometry(0, 1023);
+  std::uniform_real_distribution<float> depth(0.1f, 1000.f);
+  std::vector<DrawItem> items(num_items);
+  for (size_t i = 0; i < num_items; ++i) {
+    const DrawState state{.pipeline = pipeline(random),
+                          .bind_group = bind_group(random),
+                          .geometry = geometry(random)};
+    items[i].key = random() % 100 < kTranslucentPercent
+                       ? MakeTranslucentDrawKey(0, state, depth(random))
+                       : MakeOpaqueDrawKey(0, state, depth(random));
+    items[i].index = static_cast<uint32_t>(i);
+  }
+  return items;
+}
+
+void StableSortByKey(std::vector<DrawItem>* items) {
+  std::stable_sort(items->begin(), items->end(),
+                   [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+}
+
+bool IsSameOrder(const std::vector<DrawItem>& items, const std::vector<DrawItem>& expected) {
+  return std::equal(items.begin(), items.end(), expected.begin(), expected.end(),
+                    [](const DrawItem& a, const DrawItem& b) {
+                      return a.key == b.key && a.index == b.index;
+                    });
+}
+
+void StdSortDrawItems(BenchmarkState& state) {
+  const std::vector<DrawItem> unsorted = GenerateDrawItems(state.size());
+  std::vector<DrawItem> items;
+  while (state.KeepRunning()) {
+    items = unsorted;
+    StableSortByKey(&items);
+    DoNotOptimize(items.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.size());
+}
+
+// Also checks that the radix sort keeps the order of equal keys like std::stable_sort.
+void RunRadixSortDrawItems(BenchmarkState& state, ThreadPool* thread_pool) {
+  const std::vector<DrawItem> unsorted = GenerateDrawItems(state.size());
+  std::vector<DrawItem> expected = unsorted;
+  StableSortByKey(&expected);
+  std::vector<DrawItem> items = unsorted;
+  std::vector<DrawItem> scratch;
+  RadixSortDrawItems(items, &scratch, thread_pool);
+  if (!IsSameOrder(items, expected)) {
+    state.SkipWithError("Radix sorted draws differ from std::stable_sort");
+    return;
+  }
+  while (state.KeepRunning()) {
+    items = unsorted;
+    RadixSortDrawItems(items, &scratch, thread_pool);
+    DoNotOptimize(items.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.size());
+}
+
+void RadixSortDrawItemsSerial(BenchmarkState& state) { RunRadixSortDrawItems(state, nullptr); }
+
+void RadixSortDrawItemsThreaded(BenchmarkState& state) {
+  ThreadPool thread_pool;
+  RunRadixSortDrawItems(state, &thread_pool);
+  state.SetCounter("threads", thread_pool.GetNumThreads());
+}
+
+}  // namespace
+
+REGISTER_BENCHMARK(StdSortDrawItems, 10'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(RadixSortDrawItemsSerial, 10'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(RadixSortDrawItemsThreaded, 10'000, 100'000, 1'000'000);
+
+}  // namespace web_gpu_app
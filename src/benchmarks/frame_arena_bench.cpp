@@ -0,0 +1,79 @@
+#include <span>
+#include <vector>
+
+#include "benchmark.h"
+#include "scene_generator.h"
+#include "web_gpu_app/frame_arena.h"
+#include "web_gpu_app/thread_pool.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+// Renderables built the way apps do without an arena: a vector per frame. Size is the number of
+// spheres.
+void BuildSpheresVector(BenchmarkState& state) {
+  std::vector<Sphere> source;
+  GenerateSpheres(state.size(), 100.f, 1, &source);
+  while (state.KeepRunning()) {
+    std::vector<Sphere> spheres;
+    for (const Sphere& sphere : source) spheres.push_back(sphere);
+    DoNotOptimize(spheres.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.size());
+}
+
+void BuildSpheresArena(BenchmarkState& state) {
+  std::vector<Sphere> source;
+  GenerateSpheres(state.size(), 100.f, 1, &source);
+  FrameArena arena;
+  while (state.KeepRunning()) {
+    arena.Reset();
+    std::span<Sphere> spheres = arena.Allocate<Sphere>(source.size());
+    for (size_t i = 0; i < source.size(); ++i) spheres[i] = source[i];
+    DoNotOptimize(spheres.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.size());
+  const FrameArenaStats stats = arena.GetStats();
+  state.SetCounter("high_water_mark", static_cast<double>(stats.high_water_mark));
+  state.SetCounter("overflows", static_cast<double>(stats.num_overflows));
+}
+
+// Keeps the spheres in front of the camera plane z = 0 in parallel, each chunk into its own
+// sub-arena, then concatenates them as a single array.
+void FilterSpheresArenaParallel(BenchmarkState& state) {
+  std::vector<Sphere> source;
+  GenerateSpheres(state.size(), 100.f, 1, &source);
+  ThreadPool thread_pool;
+  FrameArena arena;
+  std::vector<std::span<Sphere>> parts;
+  size_t num_kept = 0;
+  while (state.KeepRunning()) {
+    arena.Reset();
+    parts.assign(thread_pool.GetNumThreads() + 1, {});
+    const size_t num_chunks = thread_pool.ParallelFor(
+        source.size(), 1024, [&](size_t begin, size_t end, size_t chunk_index) {
+          FrameArena* sub_arena = arena.GetSubArena(chunk_index);
+          std::span<Sphere> kept = sub_arena->Allocate<Sphere>(end - begin);
+          size_t count = 0;
+          for (size_t i = begin; i < end; ++i) {
+            if (source[i].transform[3].z < 0.f) kept[count++] = source[i];
+          }
+          parts[chunk_index] = kept.first(count);
+        });
+    std::span<Sphere> spheres = arena.Concatenate<Sphere>(std::span(parts).first(num_chunks));
+    num_kept = spheres.size();
+    DoNotOptimize(spheres.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.size());
+  state.SetCounter("kept", static_cast<double>(num_kept));
+  state.SetCounter("overflows", static_cast<double>(arena.GetStats().num_overflows));
+}
+
+}  // namespace
+
+REGISTER_BENCHMARK(BuildSpheresVector, 1'000, 10'000, 100'000);
+REGISTER_BENCHMARK(BuildSpheresArena, 1'000, 10'000, 100'000);
+REGISTER_BENCHMARK(FilterSpheresArenaParallel, 1'000, 10'000, 100'000);
+
+}  // namespace web_gpu_app
@@ -0,0 +1,43 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+#include "benchmark.h"
+
+// Usage: web_gpu_app_bench [--filter=substring] [--max_size=N] [--min_time=seconds]
+//                          [--json=results.json]
+// Results are printed as a table on stderr and as JSON on stdout, or in the --json file.
+// Returns 1 if any benchmark reported an error, e.g. a failed validation.
+int main(int argc, char** argv) {
+  web_gpu_app::BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    std::string_view value = arg.substr(arg.find('=') + 1);
+    if (arg.starts_with("--filter=")) {
+      options.filter = value;
+    } else if (arg.starts_with("--max_size=")) {
+      options.max_size = std::strtoull(value.data(), nullptr, 10);
+    } else if (arg.starts_with("--min_time=")) {
+      options.min_time_seconds = std::atof(value.data());
+    } else if (arg.starts_with("--json=")) {
+      options.json_file = value;
+    } else {
+      std::cerr << "Unknown argument: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<web_gpu_app::BenchmarkResult> results =
+      web_gpu_app::BenchmarkRunner::Get().Run(options);
+  std::string json = web_gpu_app::BenchmarkRunner::ToJson(results);
+  if (options.json_file.empty()) {
+    std::cout << json;
+  } else {
+    std::ofstream(options.json_file) << json;
+  }
+  for (const web_gpu_app::BenchmarkResult& result : results) {
+    if (!result.error.empty()) return 1;
+  }
+  return 0;
+}
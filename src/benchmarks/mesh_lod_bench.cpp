@@ -0,0 +1,73 @@
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "scene_generator.h"
+#include "web_gpu_app/culling.h"
+#include "web_gpu_app/mesh_cache.h"
+#include "web_gpu_app/mesh_lod.h"
+#include "web_gpu_app/mesh_optimizer.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+// Size is the number of quads of the mesh.
+void GenerateGridLods(BenchmarkState& state) {
+  tinyobj::attrib_t attrib;
+  tinyobj::mesh_t mesh;
+  GenerateGridMesh(state.size(), &attrib, &mesh);
+  PrimitiveGeometry input = ConvertMesh(attrib, mesh);
+  OptimizeMesh(&input);
+  PrimitiveGeometry geometry;
+  std::vector<MeshLod> lods;
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    geometry = input;
+    state.ResumeTiming();
+    lods = GenerateLods(&geometry);
+    DoNotOptimize(lods.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.indices.size() / 3);
+  state.SetCounter("lods", lods.size());
+  for (size_t i = 1; i < lods.size(); ++i) {
+    state.SetCounter("lod" + std::to_string(i) + "_triangles", lods[i].num_indices / 3);
+    state.SetCounter("lod" + std::to_string(i) + "_error", lods[i].error);
+  }
+}
+
+// Per-frame LOD selection of the spheres of a scene drawn as a simplified mesh, as done by the
+// renderer for meshes. Size is the number of instances.
+void SelectSceneLods(BenchmarkState& state) {
+  PrimitiveGeometry geometry = CreateSphereGeometry(128, 64);
+  const std::vector<MeshLod> lods = GenerateLods(&geometry);
+  Scene scene = GenerateScene(state.size());
+  const LodSettings settings;
+  std::vector<uint32_t> selected_lods(scene.spheres.size(), 0);
+  uint64_t triangles = 0;
+  while (state.KeepRunning()) {
+    const LodProjection projection = ComputeLodProjection(scene.camera, 720);
+    triangles = 0;
+    for (size_t i = 0; i < scene.spheres.size(); ++i) {
+      const Sphere& sphere = scene.spheres[i];
+      const float scale = sphere.radius * GetMaxScale(sphere.transform);
+      const float pixels_per_unit =
+          scale * GetPixelsPerUnit(projection, Vec3(sphere.transform[3]), scale);
+      selected_lods[i] = SelectLod(lods, pixels_per_unit, selected_lods[i], settings.pixel_error,
+                                   settings.hysteresis);
+      triangles += lods[selected_lods[i]].num_indices / 3;
+    }
+    DoNotOptimize(triangles);
+  }
+  state.SetItemsProcessed(state.iterations() * scene.spheres.size());
+  state.SetCounter("triangles_per_frame", static_cast<double>(triangles));
+  state.SetCounter("full_detail_triangles_per_frame",
+                   static_cast<double>(uint64_t{lods[0].num_indices / 3} * scene.spheres.size()));
+}
+
+}  // namespace
+
+REGISTER_BENCHMARK(GenerateGridLods, 1'000, 10'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(SelectSceneLods, 1'000, 10'000, 100'000, 1'000'000);
+
+}  // namespace web_gpu_app
@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "benchmark.h"
+#include "scene_generator.h"
+#include "web_gpu_app/mesh_cache.h"
+#include "web_gpu_app/mesh_optimizer.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+// Grid mesh expanded by ConvertMesh, with its triangles shuffled as exporters tend to leave them
+// in no particular order.
+PrimitiveGeometry GenerateShuffledGridGeometry(size_t num_quads) {
+  tinyobj::attrib_t attrib;
+  tinyobj::mesh_t mesh;
+  GenerateGridMesh(num_quads, &attrib, &mesh);
+  PrimitiveGeometry geometry = ConvertMesh(attrib, mesh);
+
+  std::vector<uint32_t> triangles(geometry.indices.size() / 3);
+  for (uint32_t i = 0; i < triangles.size(); ++i) triangles[i] = i;
+  std::shuffle(triangles.begin(), triangles.end(), std::mt19937(1));
+  std::vector<uint32_t> indices;
+  indices.reserve(geometry.indices.size());
+  for (uint32_t triangle : triangles) {
+    indices.insert(indices.end(), &geometry.indices[3 * triangle],
+                   &geometry.indices[3 * triangle + 3]);
+  }
+  geometry.indices = std::move(indices);
+  return geometry;
+}
+
+void SetStatsCounters(const MeshStats& before, const MeshStats& after, BenchmarkState& state) {
+  state.SetCounter("vertices_before", before.num_vertices);
+  state.SetCounter("vertices_after", after.num_vertices);
+  state.SetCounter("acmr_before", before.acmr);
+  state.SetCounter("acmr_after", after.acmr);
+  state.SetCounter("bytes_per_vertex_before", before.bytes_per_vertex);
+  state.SetCounter("bytes_per_vertex_after", after.bytes_per_vertex);
+  state.SetCounter("mb_before", before.num_bytes / 1e6);
+  state.SetCounter("mb_after", after.num_bytes / 1e6);
+}
+
+// Size is the number of quads of the mesh.
+void OptimizeGridMesh(BenchmarkState& state) {
+  const PrimitiveGeometry input = GenerateShuffledGridGeometry(state.size());
+  PrimitiveGeometry geometry;
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    geometry = input;
+    state.ResumeTiming();
+    OptimizeMesh(&geometry);
+    DoNotOptimize(geometry.indices.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.indices.size() / 3);
+  SetStatsCounters(ComputeMeshStats(input), ComputeMeshStats(geometry), state);
+}
+
+void QuantizeGridMesh(BenchmarkState& state) {
+  PrimitiveGeometry geometry = GenerateShuffledGridGeometry(state.size());
+  OptimizeMesh(&geometry);
+  QuantizedGeometry quantized;
+  while (state.KeepRunning()) {
+    quantized = QuantizeGeometry(geometry);
+    DoNotOptimize(quantized.vertices.data());
+  }
+  state.SetItemsProcessed(state.iterations() * geometry.vertices.size());
+  SetStatsCounters(ComputeMeshStats(geometry), ComputeMeshStats(quantized), state);
+}
+
+}  // namespace
+
+REGISTER_BENCHMARK(OptimizeGridMesh, 1'000, 10'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(QuantizeGridMesh, 1'000, 10'000, 100'000, 1'000'000);
+
+}  // namespace web_gpu_app
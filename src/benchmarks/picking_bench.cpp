@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <cmath>
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "scene_generator.h"
+#include "web_gpu_app/picking.h"
+#include "web_gpu_app/profiler.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+constexpr CanvasSize kCanvasSize = {1280, 720};
+constexpr size_t kNumRays = 1024;
+// Rays checked against a linear scan of all the objects.
+constexpr size_t kNumCheckedRays = 64;
+
+std::vector<Ray> GenerateScreenRays(const Camera& camera, size_t num_rays) {
+  std::mt19937 random(1);
+  std::uniform_real_distribution<double> x(0., kCanvasSize.width);
+  std::uniform_real_distribution<double> y(0., kCanvasSize.height);
+  std::vector<Ray> rays(num_rays);
+  for (Ray& ray : rays) ray = ComputeScreenRay(camera, kCanvasSize, x(random), y(random));
+  return rays;
+}
+
+// Reference intersections, without any acceleration structure.
+float IntersectCubeLinear(const Ray& ray, const Cube& cube) {
+  Mat4 model = cube.transform;
+  for (int column = 0; column < 3; ++column) model[column] *= cube.size;
+  const Mat4 inverse = glm::inverse(model);
+  const Vec3 origin = Vec3(inverse * Vec4(ray.origin, 1.f));
+  const Vec3 direction = Vec3(inverse * Vec4(ray.direction, 0.f));
+  float enter = 0.f;
+  float exit = std::numeric_limits<float>::infinity();
+  for (int axis = 0; axis < 3; ++axis) {
+    float t0 = (-0.5f - origin[axis]) / direction[axis];
+    float t1 = (0.5f - origin[axis]) / direction[axis];
+    if (t0 > t1) std::swap(t0, t1);
+    enter = std::max(enter, t0);
+    exit = std::min(exit, t1);
+  }
+  return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+}
+
+// Spheres are rotated around their center: their world radius is "radius".
+float IntersectSphereLinear(const Ray& ray, const Sphere& sphere) {
+  const Vec3 center = Vec3(sphere.transform[3]);
+  const float closest_distance = glm::dot(center - ray.origin, ray.direction);
+  const Vec3 closest = ray.origin + closest_distance * ray.direction - center;
+  const float discriminant = sphere.radius * sphere.radius - glm::dot(closest, closest);
+  if (discriminant < 0.f) return std::numeric_limits<float>::infinity();
+  const float distance = closest_distance - std::sqrt(discriminant);
+  return distance >= 0.f ? distance : std::numeric_limits<float>::infinity();
+}
+
+bool CheckPick(const Scene& scene, const Ray& ray, const PickResult& result, std::string* error) {
+  float distance = std::numeric_limits<float>::infinity();
+  for (const Cube& cube : scene.cubes) {
+    distance = std::min(distance, IntersectCubeLinear(ray, cube));
+  }
+  for (const Sphere& sphere : scene.spheres) {
+    distance = std::min(distance, IntersectSphereLinear(ray, sphere));
+  }
+  if (std::isinf(distance) != std::isinf(result.distance) ||
+      std::abs(distance - result.distance) > 1e-3f * std::max(1.f, distance)) {
+    *error = "Picked at distance " + std::to_string(result.distance) + " instead of " +
+             std::to_string(distance);
+    return false;
+  }
+  return true;
+}
+
+// Same scene with every object moved by up to "offset".
+Scene MoveScene(const Scene& scene, float offset, uint32_t seed) {
+  std::mt19937 random(seed);
+  std::uniform_real_distribution<float> move(-offset, offset);
+  Scene moved = scene;
+  for (Cube& cube : moved.cubes) cube.transform[3] += Vec4(move(random), move(random), 0.f, 0.f);
+  for (Sphere& sphere : moved.spheres) {
+    sphere.transform[3] += Vec4(move(random), move(random), 0.f, 0.f);
+  }
+  return moved;
+}
+
+void SetPickerCounters(BenchmarkState& state, const Picker& picker) {
+  const PickerStats& stats = picker.GetStats();
+  state.SetCounter("builds", static_cast<double>(stats.num_builds));
+  state.SetCounter("refits", static_cast<double>(stats.num_refits));
+  state.SetCounter("nodes", static_cast<double>(picker.GetBvh().GetNumNodes()));
+  state.SetCounter("cost", picker.GetBvh().GetCost());
+}
+
+void BuildPickingBvh(BenchmarkState& state) {
+  Scene scene = GenerateScene(state.size());
+  Picker picker;
+  picker.Update(scene.GetRenderables());
+  while (state.KeepRunning()) {
+    picker.Rebuild();
+    DoNotOptimize(picker.GetBvh().GetNumNodes());
+  }
+  state.SetItemsProcessed(state.iterations() * state.size());
+  SetPickerCounters(state, picker);
+}
+
+// Every object moves every frame, as in a simulation: Update refits the BVH built for the first
+// frame instead of rebuilding it.
+void RefitPickingBvh(BenchmarkState& state) {
+  Scene scenes[2] = {GenerateScene(state.size()), {}};
+  scenes[1] = MoveScene(scenes[0], 0.5f, 2);
+  Picker picker;
+  picker.Update(scenes[0].GetRenderables());
+  uint32_t frame = 0;
+  while (state.KeepRunning()) {
+    picker.Update(scenes[++frame % 2].GetRenderables());
+  }
+  state.SetItemsProcessed(state.iterations() * state.size());
+  SetPickerCounters(state, picker);
+}
+
+// Also checks the picked distances against a linear scan of the scene.
+void PickScreenRays(BenchmarkState& state) {
+  Scene scene = GenerateScene(state.size());
+  Picker picker;
+  picker.Update(scene.GetRenderables());
+  const std::vector<Ray> rays = GenerateScreenRays(scene.camera, kNumRays);
+  std::string error;
+  size_t num_hits = 0;
+  for (size_t i = 0; i < rays.size(); ++i) {
+    const PickResult result = picker.Pick(rays[i]);
+    num_hits += result.kind != PickedKind::kNone;
+    if (i < kNumCheckedRays && !CheckPick(scene, rays[i], result, &error)) {
+      state.SkipWithError(error);
+      return;
+    }
+  }
+  size_t ray = 0;
+  while (state.KeepRunning()) {
+    DoNotOptimize(picker.Pick(rays[ray++ % rays.size()]).distance);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetCounter("hit_ratio", static_cast<double>(num_hits) / rays.size());
+  SetPickerCounters(state, picker);
+}
+
+// Size is the number of quads of a grid mesh, picked on its triangles with vertical rays.
+void PickMeshTriangles(BenchmarkState& state) {
+  tinyobj::attrib_t attrib;
+  std::vector<Mesh> meshes(1);
+  GenerateGridMesh(state.size(), &attrib, &meshes[0].mesh);
+  meshes[0].transform = Mat4(1.f);
+  meshes[0].attrib = &attrib;
+  Renderables renderables;
+  renderables.meshes = meshes;
+  Picker picker;
+  const uint64_t begin_ns = Profiler::NowNs();
+  picker.Update(renderables);
+  const uint64_t build_ns = Profiler::NowNs() - begin_ns;
+
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> position(0.f, 1.f);
+  std::vector<Ray> rays(kNumRays);
+  for (Ray& ray : rays) {
+    ray = {.origin = Vec3(position(random), 1.f, position(random)),
+           .direction = Vec3(0.f, -1.f, 0.f)};
+    // The triangles interpolate the height field between its vertices.
+    const PickResult result = picker.Pick(ray);
+    const float height = 0.1f * std::sin(10.f * ray.origin.x) * std::cos(10.f * ray.origin.z);
+    if (result.kind != PickedKind::kMesh || result.triangle == PickResult::kNoTriangle ||
+        std::abs(result.position.y - height) > 0.01f) {
+      state.SkipWithError("Missed the grid at height " + std::to_string(height));
+      return;
+    }
+  }
+  size_t ray = 0;
+  while (state.KeepRunning()) {
+    DoNotOptimize(picker.Pick(rays[ray++ % rays.size()]).triangle);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetCounter("triangle_bvh_build_ms", static_cast<double>(build_ns) * 1e-6);
+}
+
+}  // namespace
+
+REGISTER_BENCHMARK(BuildPickingBvh, 1'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(RefitPickingBvh, 1'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(PickScreenRays, 1'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(PickMeshTriangles, 1'000, 100'000, 1'000'000);
+
+}  // namespace web_gpu_app
@@ -0,0 +1,45 @@
+#include "benchmark.h"
+#include "render_graph_generator.h"
+#include "web_gpu_app/render_graph.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+void SetRenderGraphCounters(BenchmarkState& state, const RenderGraph& graph) {
+  const RenderGraphStats& stats = graph.GetStats();
+  state.SetCounter("passes", stats.num_passes);
+  state.SetCounter("culled_passes", stats.num_culled_passes);
+  state.SetCounter("transient_textures", stats.num_transient_textures);
+  state.SetCounter("physical_textures", stats.num_physical_textures);
+  state.SetCounter("discarded_attachments", stats.num_discarded_attachments);
+}
+
+// Building and compiling the graph of a frame, as done every frame.
+void CompileFrameRenderGraph(BenchmarkState& state) {
+  RenderGraph graph;
+  while (state.KeepRunning()) {
+    BuildFrameRenderGraph(&graph);
+    DoNotOptimize(graph.Compile());
+  }
+  state.SetItemsProcessed(state.iterations());
+  SetRenderGraphCounters(state, graph);
+}
+
+// web_gpu_app_tests checks the compiled graphs of these against the declared passes.
+void CompileRandomRenderGraph(BenchmarkState& state) {
+  RenderGraph graph;
+  BuildRandomRenderGraph(state.size(), 1, &graph);
+  while (state.KeepRunning()) {
+    DoNotOptimize(graph.Compile());
+  }
+  state.SetItemsProcessed(state.iterations() * state.size());
+  SetRenderGraphCounters(state, graph);
+}
+
+}  // namespace
+
+REGISTER_BENCHMARK(CompileFrameRenderGraph, 1);
+REGISTER_BENCHMARK(CompileRandomRenderGraph, 10, 100, 1'000);
+
+}  // namespace web_gpu_app
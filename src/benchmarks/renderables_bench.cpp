@@ -0,0 +1,79 @@
+#include <vector>
+
+#include "benchmark.h"
+#include "scene_generator.h"
+#include "web_gpu_app/instance_packing.h"
+#include "web_gpu_app/mesh_cache.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+void BuildRenderables(BenchmarkState& state) {
+  std::vector<Cube> cubes;
+  uint32_t seed = 0;
+  while (state.KeepRunning()) {
+    GenerateCubes(state.size(), 100.f, ++seed, &cubes);
+    DoNotOptimize(cubes.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.size());
+}
+
+void PackCubeInstances(BenchmarkState& state) {
+  std::vector<Cube> cubes;
+  GenerateCubes(state.size(), 100.f, 1, &cubes);
+  std::vector<PackedInstance> instances(cubes.size());
+  while (state.KeepRunning()) {
+    PackCubes(cubes, instances);
+    DoNotOptimize(instances.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.size());
+  state.SetBytesProcessed(state.iterations() * state.size() * sizeof(PackedInstance));
+}
+
+void PackSphereInstances(BenchmarkState& state) {
+  std::vector<Sphere> spheres;
+  GenerateSpheres(state.size(), 100.f, 1, &spheres);
+  std::vector<PackedInstance> instances(spheres.size());
+  while (state.KeepRunning()) {
+    PackSpheres(spheres, instances);
+    DoNotOptimize(instances.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.size());
+  state.SetBytesProcessed(state.iterations() * state.size() * sizeof(PackedInstance));
+}
+
+// Size is the number of quads, i.e. half the number of triangles.
+void ConvertTinyObjMesh(BenchmarkState& state) {
+  tinyobj::attrib_t attrib;
+  tinyobj::mesh_t mesh;
+  GenerateGridMesh(state.size(), &attrib, &mesh);
+  size_t num_vertices = 0;
+  while (state.KeepRunning()) {
+    PrimitiveGeometry geometry = ConvertMesh(attrib, mesh);
+    num_vertices = geometry.vertices.size();
+    DoNotOptimize(geometry.vertices.data());
+  }
+  state.SetItemsProcessed(state.iterations() * mesh.num_face_vertices.size());
+  state.SetCounter("vertices", static_cast<double>(num_vertices));
+}
+
+void HashTinyObjMesh(BenchmarkState& state) {
+  tinyobj::attrib_t attrib;
+  tinyobj::mesh_t mesh;
+  GenerateGridMesh(state.size(), &attrib, &mesh);
+  while (state.KeepRunning()) {
+    DoNotOptimize(HashMesh(attrib, mesh));
+  }
+  state.SetItemsProcessed(state.iterations() * mesh.num_face_vertices.size());
+}
+
+}  // namespace
+
+REGISTER_BENCHMARK(BuildRenderables, 1'000, 10'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(PackCubeInstances, 1'000, 10'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(PackSphereInstances, 1'000, 10'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(ConvertTinyObjMesh, 1'000, 10'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(HashTinyObjMesh, 1'000, 10'000, 100'000, 1'000'000);
+
+}  // namespace web_gpu_app
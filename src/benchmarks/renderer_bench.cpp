@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "benchmark.h"
+#include "imgui.h"
+#include "scene_generator.h"
+#include "web_gpu_app/bind_group_cache.h"
+#include "web_gpu_app/retained_scene.h"
+#include "web_gpu_app/web_gpu_renderer.h"
+#include "web_gpu_app/web_gpu_utils.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+// Shared by all renderer benchmarks: creating a device per benchmark would dominate run times.
+WebGpuRenderer* GetHeadlessRenderer() {
+  static std::unique_ptr<WebGpuRenderer> renderer;
+  if (renderer == nullptr) {
+    HeadlessOptions options;
+    options.backend = HeadlessBackend::kNull;
+    WebGpuRenderer::CreateHeadless(options, [](std::unique_ptr<WebGpuRenderer> created) {
+      renderer = std::move(created);
+    });
+  }
+  return renderer.get();
+}
+
+// Full CPU cost of a frame: packing, uploads, command encoding and submission on Dawn's null
+// backend, which does no GPU work.
+void RunEndFrameHeadless(BenchmarkState& state, bool gpu_culling, bool impostors,
+                         bool translucent = false) {
+  WebGpuRenderer* renderer = GetHeadlessRenderer();
+  if (renderer == nullptr) {
+    state.SkipWithError("No headless adapter");
+    return;
+  }
+
+  renderer->SetGpuCullingEnabled(gpu_culling);
+  renderer->SetSphereImpostorsEnabled(impostors);
+  Scene scene = GenerateScene(state.size());
+  if (translucent) {
+    for (size_t i = 0; i < scene.cubes.size(); i += 2) scene.cubes[i].color.a = 0.5f;
+    for (size_t i = 0; i < scene.spheres.size(); i += 2) scene.spheres[i].color.a = 0.5f;
+  }
+  // A translucent cube, which the culling pass must leave to the translucent draws.
+  if (gpu_culling && !scene.cubes.empty()) scene.cubes[0].color.a = 0.5f;
+  Renderables renderables = scene.GetRenderables();
+  const uint64_t num_culled_before = renderer->GetGpuCulling()->GetStats().num_instances;
+  while (state.KeepRunning()) {
+    renderer->BeginFrame();
+    renderer->EndFrame(renderables);
+  }
+  state.SetItemsProcessed(state.iterations() * state.size());
+  const RenderStats& stats = renderer->GetRenderStats();
+  if (translucent && stats.translucent_instances == 0) {
+    state.SkipWithError("No translucent instances drawn");
+    return;
+  }
+  const uint64_t num_culled = renderer->GetGpuCulling()->GetStats().num_instances -
+                              num_culled_before;
+  if (gpu_culling && renderer->GetGpuCulling()->IsReady() &&
+      num_culled != state.iterations() * (state.size() - 1)) {
+    state.SkipWithError("GPU culling did not get exactly the opaque instances");
+    return;
+  }
+  state.SetCounter("draw_calls_per_frame", renderer->GetRenderStats().draw_calls);
+  state.SetCounter("instances_per_frame", renderer->GetRenderStats().instances);
+  state.SetCounter("vertices_per_frame",
+                   static_cast<double>(renderer->GetRenderStats().vertices));
+  state.SetCounter("upload_bytes_per_frame",
+                   static_cast<double>(renderer->GetRenderStats().instance_bytes));
+  state.SetCounter("triangles_per_frame",
+                   static_cast<double>(renderer->GetRenderStats().triangles));
+  state.SetCounter("bind_groups_created_per_frame",
+                   renderer->GetRenderStats().bind_groups_created);
+  state.SetCounter("bind_groups_reused_per_frame", renderer->GetRenderStats().bind_groups_reused);
+  state.SetCounter("pipeline_switches_per_frame", stats.pipeline_switches);
+  state.SetCounter("buffer_switches_per_frame", stats.buffer_switches);
+  state.SetCounter("translucent_instances_per_frame", stats.translucent_instances);
+  state.SetCounter("sort_ms_per_frame", static_cast<double>(stats.sort_ns) / 1e6);
+  renderer->SetGpuCullingEnabled(false);
+  renderer->SetSphereImpostorsEnabled(false);
+}
+
+void EndFrameHeadless(BenchmarkState& state) { RunEndFrameHeadless(state, false, false); }
+
+// Same as above with the culling moved to a compute pass, which the null backend skips: measures
+// the CPU time saved.
+void EndFrameHeadlessGpuCulling(BenchmarkState& state) { RunEndFrameHeadless(state, true, false); }
+
+// Spheres drawn as impostors: compare vertices_per_frame with EndFrameHeadless.
+void EndFrameHeadlessImpostors(BenchmarkState& state) { RunEndFrameHeadless(state, false, true); }
+
+// Every other object at half opacity: these are sorted back to front and drawn after the opaque
+// ones, one batch per run of the same geometry.
+void EndFrameHeadlessTranslucent(BenchmarkState& state) {
+  RunEndFrameHeadless(state, false, false, true);
+}
+
+// The scene of EndFrameHeadless in a RetainedScene, with 1% of the objects moved every frame:
+// compare upload_bytes_per_frame. The retained objects are drawn without culling.
+void EndFrameHeadlessRetained(BenchmarkState& state) {
+  WebGpuRenderer* renderer = GetHeadlessRenderer();
+  if (renderer == nullptr) {
+    state.SkipWithError("No headless adapter");
+    return;
+  }
+
+  Scene scene = GenerateScene(state.size());
+  RetainedScene retained_scene;
+  std::vector<SceneObjectHandle> handles;
+  for (const Cube& cube : scene.cubes) handles.push_back(retained_scene.AddCube(cube));
+  for (const Sphere& sphere : scene.spheres) handles.push_back(retained_scene.AddSphere(sphere));
+  Renderables renderables;
+  renderables.scene = &retained_scene;
+  renderables.camera = scene.camera;
+  renderer->BeginFrame();
+  renderer->EndFrame(renderables);
+
+  std::mt19937 random(2);
+  const Mat4 move = glm::translate(Mat4(1.f), Vec3(0.1f, 0.f, 0.f));
+  const size_t num_changed = std::max<size_t>(1, handles.size() / 100);
+  uint64_t num_bytes = 0;
+  uint32_t draw_calls = 0;
+  while (state.KeepRunning()) {
+    for (size_t i = 0; i < num_changed; ++i) {
+      const SceneObjectHandle handle = handles[random() % handles.size()];
+      SceneObjectKind kind;
+      uint32_t index;
+      retained_scene.GetInstanceIndex(handle, &kind, &index);
+      retained_scene.SetTransform(handle, move * retained_scene.GetTransforms(kind)[index]);
+    }
+    renderer->BeginFrame();
+    renderer->EndFrame(renderables);
+    num_bytes += renderer->GetRenderStats().instance_bytes +
+                 renderer->GetRenderStats().retained_instance_bytes;
+    draw_calls = renderer->GetRenderStats().draw_calls;
+  }
+  // Drops the renderer's pointer to the scene.
+  renderables.scene = nullptr;
+  renderer->BeginFrame();
+  renderer->EndFrame(renderables);
+  state.SetItemsProcessed(state.iterations() * state.size());
+  state.SetCounter("upload_bytes_per_frame",
+                   static_cast<double>(num_bytes) / static_cast<double>(state.iterations()));
+  state.SetCounter("draw_calls_per_frame", draw_calls);
+}
+
+// A static dashboard of "size" lines of text drawn every frame, rendered by ImGui every frame or
+// only once into the cached UI texture.
+void RunStaticUi(BenchmarkState& state, bool cached) {
+  WebGpuRenderer* renderer = GetHeadlessRenderer();
+  if (renderer == nullptr) {
+    state.SkipWithError("No headless adapter");
+    return;
+  }
+
+  Ui* ui = renderer->GetUi();
+  ui->SetCachingEnabled(cached);
+  const UiStats begin_stats = ui->GetStats();
+  Renderables renderables;
+  while (state.KeepRunning()) {
+    renderer->BeginFrame();
+    ImGui::SetNextWindowPos(ImVec2(0.f, 0.f));
+    ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
+    ImGui::Begin("Dashboard");
+    for (size_t i = 0; i < state.size(); ++i) {
+      ImGui::Text("Metric %zu: %zu", i, 7 * i);
+    }
+    ImGui::End();
+    renderer->EndFrame(renderables);
+  }
+  ui->SetCachingEnabled(false);
+  const UiStats& stats = ui->GetStats();
+  const double num_frames = static_cast<double>(stats.num_frames - begin_stats.num_frames);
+  state.SetItemsProcessed(state.iterations() * state.size());
+  state.SetCounter("ui_bytes_per_frame",
+                   static_cast<double>(stats.bytes_uploaded - begin_stats.bytes_uploaded) /
+                       num_frames);
+  state.SetCounter("ui_cache_hit_rate",
+                   static_cast<double>(stats.num_cache_hits - begin_stats.num_cache_hits) /
+                       num_frames);
+}
+
+void StaticUiHeadless(BenchmarkState& state) { RunStaticUi(state, false); }
+
+void StaticUiHeadlessCached(BenchmarkState& state) { RunStaticUi(state, true); }
+
+// Bind groups of "size" uniform buffers requested in turn, created every time or looked up in a
+// BindGroupCache.
+void RunBindGroups(BenchmarkState& state, bool cached) {
+  WebGpuRenderer* renderer = GetHeadlessRenderer();
+  if (renderer == nullptr) {
+    state.SkipWithError("No headless adapter");
+    return;
+  }
+
+  wgpu::Device device = renderer->GetDevice();
+  wgpu::BindGroupLayoutEntry layout_entry{
+      .binding = 0,
+      .visibility = wgpu::ShaderStage::Vertex,
+      .buffer = {.type = wgpu::BufferBindingType::Uniform, .hasDynamicOffset = true}};
+  wgpu::BindGroupLayoutDescriptor layout_descriptor{.entryCount = 1, .entries = &layout_entry};
+  wgpu::BindGroupLayout layout = device.CreateBindGroupLayout(&layout_descriptor);
+  std::vector<wgpu::Buffer> buffers;
+  for (size_t i = 0; i < state.size(); ++i) {
+    buffers.push_back(CreateBuffer(device, wgpu::BufferUsage::Uniform, 256));
+  }
+  BindGroupCache cache(device);
+  size_t next = 0;
+  while (state.KeepRunning()) {
+    wgpu::BindGroupEntry entry{.binding = 0, .buffer = buffers[next], .size = 256};
+    if (cached) {
+      DoNotOptimize(cache.Get(layout, std::span(&entry, 1)));
+    } else {
+      wgpu::BindGroupDescriptor descriptor{.layout = layout, .entryCount = 1, .entries = &entry};
+      DoNotOptimize(device.CreateBindGroup(&descriptor));
+    }
+    next = next + 1 == buffers.size() ? 0 : next + 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (cached) {
+    state.SetCounter("bind_groups_created", static_cast<double>(cache.GetStats().num_created));
+  }
+}
+
+void CreateBindGroup(BenchmarkState& state) { RunBindGroups(state, false); }
+
+void CachedBindGroup(BenchmarkState& state) { RunBindGroups(state, true); }
+
+}  // namespace
+
+#if !defined(__EMSCRIPTEN__)
+REGISTER_BENCHMARK(CreateBindGroup, 1, 16, 256);
+REGISTER_BENCHMARK(CachedBindGroup, 1, 16, 256);
+REGISTER_BENCHMARK(EndFrameHeadless, 1'000, 10'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(EndFrameHeadlessGpuCulling, 1'000, 10'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(EndFrameHeadlessImpostors, 1'000, 10'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(EndFrameHeadlessTranslucent, 1'000, 10'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(EndFrameHeadlessRetained, 1'000, 10'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(StaticUiHeadless, 10, 100, 1'000);
+REGISTER_BENCHMARK(StaticUiHeadlessCached, 10, 100, 1'000);
+#endif
+
+}  // namespace web_gpu_app
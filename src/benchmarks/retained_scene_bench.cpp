@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "scene_generator.h"
+#include "web_gpu_app/instance_packing.h"
+#include "web_gpu_app/retained_scene.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+// Objects moved per frame, out of 100.
+constexpr size_t kChangedPercent = 1;
+// Frames of precomputed edits, cycled through.
+constexpr size_t kNumEditFrames = 16;
+
+// Object "index" of the scene, cubes first, is moved to "transform".
+struct Edit {
+  uint32_t index;
+  Mat4 transform;
+};
+
+std::vector<std::vector<Edit>> GenerateEdits(const Scene& scene) {
+  const size_t num_objects = scene.cubes.size() + scene.spheres.size();
+  std::mt19937 random(2);
+  std::uniform_int_distribution<uint32_t> object(0, static_cast<uint32_t>(num_objects) - 1);
+  std::uniform_real_distribution<float> move(-0.5f, 0.5f);
+  std::vector<std::vector<Edit>> frames(kNumEditFrames);
+  for (std::vector<Edit>& edits : frames) {
+    edits.resize(std::max<size_t>(1, num_objects * kChangedPercent / 100));
+    for (Edit& edit : edits) {
+      edit.index = object(random);
+      edit.transform = glm::translate(Mat4(1.f), Vec3(move(random), move(random), move(random)));
+    }
+  }
+  return frames;
+}
+
+void ApplyEdits(std::span<const Edit> edits, Scene* scene) {
+  for (const Edit& edit : edits) {
+    if (edit.index < scene->cubes.size()) {
+      Mat4& transform = scene->cubes[edit.index].transform;
+      transform = edit.transform * transform;
+    } else {
+      Mat4& transform = scene->spheres[edit.index - scene->cubes.size()].transform;
+      transform = edit.transform * transform;
+    }
+  }
+}
+
+// Stand-in for the GPU buffers of the renderer, written with the dirty ranges only.
+struct InstanceBuffers {
+  std::vector<PackedInstance> instances[kNumSceneObjectKinds];
+  std::vector<DirtyRange> ranges;
+  uint64_t num_bytes = 0;
+  uint64_t num_writes = 0;
+};
+
+void UploadDirtyRanges(RetainedScene* scene, InstanceBuffers* buffers) {
+  for (size_t kind = 0; kind < kNumSceneObjectKinds; ++kind) {
+    const std::span<const PackedInstance> instances =
+        scene->GetInstances(static_cast<SceneObjectKind>(kind));
+    std::vector<PackedInstance>& buffer = buffers->instances[kind];
+    buffer.resize(instances.size());
+    scene->TakeDirtyRanges(static_cast<SceneObjectKind>(kind), &buffers->ranges);
+    for (const DirtyRange& range : buffers->ranges) {
+      const size_t num_bytes = (range.end - range.begin) * sizeof(PackedInstance);
+      std::memcpy(&buffer[range.begin], &instances[range.begin], num_bytes);
+      buffers->num_bytes += num_bytes;
+      ++buffers->num_writes;
+    }
+  }
+}
+
+// Whether "buffers" hold the instances of "scene" as the immediate mode packs them.
+bool CheckInstances(const Scene& scene, const InstanceBuffers& buffers, std::string* error) {
+  std::vector<PackedInstance> expected(scene.cubes.size() + scene.spheres.size());
+  PackCubes(scene.cubes, expected);
+  PackSpheres(scene.spheres, std::span(expected).subspan(scene.cubes.size()));
+  const std::vector<PackedInstance>& cubes = buffers.instances[0];
+  const std::vector<PackedInstance>& spheres = buffers.instances[1];
+  if (cubes.size() != scene.cubes.size() || spheres.size() != scene.spheres.size() ||
+      std::memcmp(cubes.data(), expected.data(), cubes.size() * sizeof(PackedInstance)) != 0 ||
+      std::memcmp(spheres.data(), expected.data() + cubes.size(),
+                  spheres.size() * sizeof(PackedInstance)) != 0) {
+    *error = "Uploaded instances differ from the packed scene";
+    return false;
+  }
+  return true;
+}
+
+// Immediate mode: the whole scene is packed every frame although only 1% of it moved.
+void PackImmediateScene(BenchmarkState& state) {
+  Scene scene = GenerateScene(state.size());
+  const std::vector<std::vector<Edit>> edits = GenerateEdits(scene);
+  std::vector<PackedInstance> instances(scene.cubes.size() + scene.spheres.size());
+  size_t frame = 0;
+  while (state.KeepRunning()) {
+    ApplyEdits(edits[frame++ % edits.size()], &scene);
+    PackCubes(scene.cubes, instances);
+    PackSpheres(scene.spheres, std::span(instances).subspan(scene.cubes.size()));
+    DoNotOptimize(instances.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.size());
+  state.SetCounter("upload_bytes_per_frame",
+                   static_cast<double>(instances.size() * sizeof(PackedInstance)));
+}
+
+// Retained mode: the same edits go through handles and only the dirty ranges are copied. Also
+// checks the copies against the immediate mode.
+void UpdateRetainedScene(BenchmarkState& state) {
+  Scene scene = GenerateScene(state.size());
+  const std::vector<std::vector<Edit>> edits = GenerateEdits(scene);
+  RetainedScene retained_scene;
+  std::vector<SceneObjectHandle> handles;
+  for (const Cube& cube : scene.cubes) handles.push_back(retained_scene.AddCube(cube));
+  for (const Sphere& sphere : scene.spheres) handles.push_back(retained_scene.AddSphere(sphere));
+  std::vector<Mat4> transforms;
+  for (const Cube& cube : scene.cubes) transforms.push_back(cube.transform);
+  for (const Sphere& sphere : scene.spheres) transforms.push_back(sphere.transform);
+  InstanceBuffers buffers;
+  UploadDirtyRanges(&retained_scene, &buffers);
+
+  auto run_frame = [&](std::span<const Edit> frame_edits) {
+    for (const Edit& edit : frame_edits) {
+      Mat4& transform = transforms[edit.index];
+      transform = edit.transform * transform;
+      retained_scene.SetTransform(handles[edit.index], transform);
+    }
+    UploadDirtyRanges(&retained_scene, &buffers);
+  };
+  std::string error;
+  for (const std::vector<Edit>& frame_edits : edits) {
+    run_frame(frame_edits);
+    ApplyEdits(frame_edits, &scene);
+    if (!CheckInstances(scene, buffers, &error)) {
+      state.SkipWithError(error);
+      return;
+    }
+  }
+
+  buffers.num_bytes = 0;
+  buffers.num_writes = 0;
+  size_t frame = 0;
+  while (state.KeepRunning()) {
+    run_frame(edits[frame++ % edits.size()]);
+    DoNotOptimize(buffers.instances[0].data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.size());
+  const double iterations = static_cast<double>(state.iterations());
+  state.SetCounter("upload_bytes_per_frame", static_cast<double>(buffers.num_bytes) / iterations);
+  state.SetCounter("writes_per_frame", static_cast<double>(buffers.num_writes) / iterations);
+}
+
+// Objects added and removed in turn, 1% per frame: removals move the last instances into the
+// holes, which makes them dirty too.
+void ChurnRetainedScene(BenchmarkState& state) {
+  Scene scene = GenerateScene(state.size());
+  RetainedScene retained_scene;
+  std::vector<SceneObjectHandle> handles;
+  for (const Cube& cube : scene.cubes) handles.push_back(retained_scene.AddCube(cube));
+  for (const Sphere& sphere : scene.spheres) handles.push_back(retained_scene.AddSphere(sphere));
+  InstanceBuffers buffers;
+  UploadDirtyRanges(&retained_scene, &buffers);
+  buffers.num_bytes = 0;
+  buffers.num_writes = 0;
+
+  std::mt19937 random(2);
+  const size_t num_changed = std::max<size_t>(1, handles.size() * kChangedPercent / 100);
+  while (state.KeepRunning()) {
+    for (size_t i = 0; i < num_changed; ++i) {
+      SceneObjectHandle& handle = handles[random() % handles.size()];
+      SceneObjectKind kind;
+      uint32_t index;
+      retained_scene.GetInstanceIndex(handle, &kind, &index);
+      const Mat4 transform = retained_scene.GetTransforms(kind)[index];
+      retained_scene.Remove(handle);
+      handle = kind == SceneObjectKind::kCube
+                   ? retained_scene.AddCube({transform, 1.f, Color(1.f)})
+                   : retained_scene.AddSphere({transform, 1.f, Color(1.f)});
+    }
+    UploadDirtyRanges(&retained_scene, &buffers);
+  }
+  if (retained_scene.size() != handles.size()) {
+    state.SkipWithError("Lost objects");
+    return;
+  }
+  state.SetItemsProcessed(state.iterations() * num_changed);
+  const double iterations = static_cast<double>(state.iterations());
+  state.SetCounter("upload_bytes_per_frame", static_cast<double>(buffers.num_bytes) / iterations);
+  state.SetCounter("writes_per_frame", static_cast<double>(buffers.num_writes) / iterations);
+}
+
+}  // namespace
+
+REGISTER_BENCHMARK(PackImmediateScene, 10'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(UpdateRetainedScene, 10'000, 100'000, 1'000'000);
+REGISTER_BENCHMARK(ChurnRetainedScene, 10'000, 100'000, 1'000'000);
+
+}  // namespace web_gpu_app
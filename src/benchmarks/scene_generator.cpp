@@ -0,0 +1,135 @@
+#include "scene_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+
+namespace web_gpu_app {
+
+namespace {
+
+Mat4 RandomTransform(std::mt19937& random, float extent) {
+  std::uniform_real_distribution<float> position(-0.5f * extent, 0.5f * extent);
+  std::uniform_real_distribution<float> angle(0.f, 2.f * glm::pi<float>());
+  Mat4 transform = glm::translate(Mat4(1.f), Vec3(position(random), position(random),
+                                                  position(random)));
+  return glm::rotate(transform, angle(random), glm::normalize(Vec3(1.f, 0.5f, 0.25f)));
+}
+
+Color RandomColor(std::mt19937& random) {
+  std::uniform_real_distribution<float> channel(0.f, 1.f);
+  return Color(channel(random), channel(random), channel(random), 1.f);
+}
+
+}  // namespace
+
+Renderables Scene::GetRenderables() {
+  Renderables renderables;
+  renderables.cubes = cubes;
+  renderables.spheres = spheres;
+  renderables.camera = camera;
+  return renderables;
+}
+
+void GenerateCubes(size_t num_cubes, float extent, uint32_t seed, std::vector<Cube>* cubes) {
+  std::mt19937 random(seed);
+  std::uniform_real_distribution<float> size(0.1f, 1.f);
+  cubes->resize(num_cubes);
+  for (Cube& cube : *cubes) {
+    cube.transform = RandomTransform(random, extent);
+    cube.size = size(random);
+    cube.color = RandomColor(random);
+  }
+}
+
+void GenerateSpheres(size_t num_spheres, float extent, uint32_t seed,
+                     std::vector<Sphere>* spheres) {
+  std::mt19937 random(seed);
+  std::uniform_real_distribution<float> radius(0.05f, 0.5f);
+  spheres->resize(num_spheres);
+  for (Sphere& sphere : *spheres) {
+    sphere.transform = RandomTransform(random, extent);
+    sphere.radius = radius(random);
+    sphere.color = RandomColor(random);
+  }
+}
+
+Scene GenerateScene(size_t num_objects, uint32_t seed) {
+  // Keep the density constant so that the visible fraction does not depend on the scene size.
+  const float extent = 4.f * std::cbrt(static_cast<float>(num_objects));
+  Scene scene;
+  GenerateCubes(num_objects / 2, extent, seed, &scene.cubes);
+  GenerateSpheres(num_objects - num_objects / 2, extent, seed + 1, &scene.spheres);
+  scene.camera = GenerateCamera();
+  scene.camera.view = glm::lookAt(Vec3(0.f, 0.f, 0.75f * extent), Vec3(0.f), Vec3(0.f, 1.f, 0.f));
+  return scene;
+}
+
+Camera GenerateCamera(float aspect_ratio) {
+  Camera camera;
+  camera.projection = glm::perspective(glm::radians(60.f), aspect_ratio, 0.1f, 1000.f);
+  camera.view = glm::lookAt(Vec3(0.f, 0.f, 50.f), Vec3(0.f), Vec3(0.f, 1.f, 0.f));
+  return camera;
+}
+
+void GenerateGridMesh(size_t num_quads, tinyobj::attrib_t* attrib, tinyobj::mesh_t* mesh) {
+  const size_t side = std::max<size_t>(1, static_cast<size_t>(std::sqrt(num_quads)));
+  const size_t num_vertices_per_side = side + 1;
+  *attrib = {};
+  *mesh = {};
+  for (size_t y = 0; y < num_vertices_per_side; ++y) {
+    for (size_t x = 0; x < num_vertices_per_side; ++x) {
+      float fx = static_cast<float>(x) / side;
+      float fy = static_cast<float>(y) / side;
+      float height = 0.1f * std::sin(10.f * fx) * std::cos(10.f * fy);
+      attrib->vertices.insert(attrib->vertices.end(), {fx, height, fy});
+      attrib->normals.insert(attrib->normals.end(), {0.f, 1.f, 0.f});
+    }
+  }
+
+  auto add_corner = [&](size_t x, size_t y) {
+    int index = static_cast<int>(y * num_vertices_per_side + x);
+    mesh->indices.push_back({index, index, -1});
+  };
+  for (size_t y = 0; y < side; ++y) {
+    for (size_t x = 0; x < side; ++x) {
+      add_corner(x, y);
+      add_corner(x + 1, y);
+      add_corner(x + 1, y + 1);
+      add_corner(x, y + 1);
+      mesh->num_face_vertices.push_back(4);
+    }
+  }
+}
+
+bool WriteGridObj(size_t num_quads, const std::string& file_name) {
+  tinyobj::attrib_t attrib;
+  tinyobj::mesh_t mesh;
+  GenerateGridMesh(num_quads, &attrib, &mesh);
+
+  std::ofstream file(file_name);
+  if (!file) return false;
+  for (size_t i = 0; i + 2 < attrib.vertices.size(); i += 3) {
+    file << "v " << attrib.vertices[i] << ' ' << attrib.vertices[i + 1] << ' '
+         << attrib.vertices[i + 2] << '\n';
+  }
+  for (size_t i = 0; i + 2 < attrib.normals.size(); i += 3) {
+    file << "vn " << attrib.normals[i] << ' ' << attrib.normals[i + 1] << ' '
+         << attrib.normals[i + 2] << '\n';
+  }
+  size_t index_offset = 0;
+  for (unsigned int num_face_vertices : mesh.num_face_vertices) {
+    file << 'f';
+    for (unsigned int i = 0; i < num_face_vertices; ++i) {
+      const tinyobj::index_t& index = mesh.indices[index_offset + i];
+      // OBJ indices start at 1.
+      file << ' ' << index.vertex_index + 1 << "//" << index.normal_index + 1;
+    }
+    file << '\n';
+    index_offset += num_face_vertices;
+  }
+  return static_cast<bool>(file);
+}
+
+}  // namespace web_gpu_app
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "web_gpu_app/renderer.h"
+
+namespace web_gpu_app {
+
+// Deterministic synthetic scenes for benchmarks. Objects are scattered in a cube of side
+// "extent" centered on the origin.
+struct Scene {
+  std::vector<Cube> cubes;
+  std::vector<Sphere> spheres;
+  Camera camera;
+
+  Renderables GetRenderables();
+};
+
+void GenerateCubes(size_t num_cubes, float extent, uint32_t seed, std::vector<Cube>* cubes);
+void GenerateSpheres(size_t num_spheres, float extent, uint32_t seed,
+                     std::vector<Sphere>* spheres);
+Scene GenerateScene(size_t num_objects, uint32_t seed = 1);
+Camera GenerateCamera(float aspect_ratio = 16.f / 9.f);
+
+// Tessellated height field of "num_quads" quads as a tinyobj mesh with shared positions and
+// normals, similar to what tinyobj produces for a smooth OBJ model.
+void GenerateGridMesh(size_t num_quads, tinyobj::attrib_t* attrib, tinyobj::mesh_t* mesh);
+
+// Writes the mesh of GenerateGridMesh to "file_name" as OBJ text. Returns false on failure.
+bool WriteGridObj(size_t num_quads, const std::string& file_name);
+
+}  // namespace web_gpu_app
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "benchmark.h"
+#include "web_gpu_app/texture_compression.h"
+#include "web_gpu_app/texture_file.h"
+#include "web_gpu_app/thread_pool.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+// Square RGBA8 image of smooth gradients with some noise and a soft alpha edge, closer to a photo
+// than to flat colors that every encoder gets right.
+std::vector<uint8_t> GenerateImage(uint32_t size) {
+  std::vector<uint8_t> pixels(size_t{4} * size * size);
+  uint32_t seed = 1;
+  for (uint32_t y = 0; y < size; ++y) {
+    for (uint32_t x = 0; x < size; ++x) {
+      seed = seed * 1664525u + 1013904223u;
+      const float u = static_cast<float>(x) / size;
+      const float v = static_cast<float>(y) / size;
+      uint8_t* pixel = &pixels[(size_t{y} * size + x) * 4];
+      const int noise = static_cast<int>(seed >> 28) - 8;
+      pixel[0] = static_cast<uint8_t>(std::clamp(static_cast<int>(255 * u) + noise, 0, 255));
+      pixel[1] = static_cast<uint8_t>(std::clamp(static_cast<int>(255 * v) + noise, 0, 255));
+      pixel[2] = static_cast<uint8_t>(127.5f + 127.5f * std::sin(12.f * (u + v)));
+      pixel[3] = static_cast<uint8_t>(std::clamp(static_cast<int>(512 * (u - 0.25f)), 0, 255));
+    }
+  }
+  return pixels;
+}
+
+// Size is the width and height of the image.
+void GenerateTextureMipChain(BenchmarkState& state) {
+  const std::vector<uint8_t> pixels = GenerateImage(static_cast<uint32_t>(state.size()));
+  while (state.KeepRunning()) {
+    std::vector<std::vector<uint8_t>> levels =
+        GenerateMipChain(pixels, state.size(), state.size(), /*srgb=*/true);
+    DoNotOptimize(levels.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.size() * state.size());
+}
+
+void CompressTexture(BenchmarkState& state, TextureFileFormat format, ThreadPool* thread_pool) {
+  const uint32_t size = static_cast<uint32_t>(state.size());
+  const std::vector<uint8_t> pixels = GenerateImage(size);
+  std::vector<uint8_t> data;
+  while (state.KeepRunning()) {
+    data = CompressImage(pixels, size, size, format, thread_pool);
+    DoNotOptimize(data.data());
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+  state.SetCounter("ratio", static_cast<double>(pixels.size()) / data.size());
+}
+
+void CompressTextureBc1(BenchmarkState& state) {
+  CompressTexture(state, TextureFileFormat::kBc1, nullptr);
+}
+
+void CompressTextureBc3(BenchmarkState& state) {
+  CompressTexture(state, TextureFileFormat::kBc3, nullptr);
+}
+
+void CompressTextureEtc2Rgb8(BenchmarkState& state) {
+  CompressTexture(state, TextureFileFormat::kEtc2Rgb8, nullptr);
+}
+
+void CompressTextureEtc2Rgba8(BenchmarkState& state) {
+  CompressTexture(state, TextureFileFormat::kEtc2Rgba8, nullptr);
+}
+
+void CompressTextureEtc2Rgb8Parallel(BenchmarkState& state) {
+  ThreadPool thread_pool;
+  CompressTexture(state, TextureFileFormat::kEtc2Rgb8, &thread_pool);
+}
+
+}  // namespace
+
+REGISTER_BENCHMARK(GenerateTextureMipChain, 256, 1024);
+REGISTER_BENCHMARK(CompressTextureBc1, 256, 1024);
+REGISTER_BENCHMARK(CompressTextureBc3, 256, 1024);
+REGISTER_BENCHMARK(CompressTextureEtc2Rgb8, 256, 1024);
+REGISTER_BENCHMARK(CompressTextureEtc2Rgba8, 256, 1024);
+REGISTER_BENCHMARK(CompressTextureEtc2Rgb8Parallel, 256, 1024);
+
+}  // namespace web_gpu_app
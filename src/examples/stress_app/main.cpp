@@ -0,0 +1,154 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "stress_app.h"
+#include "web_gpu_app/profiler.h"
+#include "web_gpu_app/web_gpu_renderer.h"
+
+namespace {
+
+struct Args {
+  bool headless = false;
+  uint32_t num_frames = 300;
+  web_gpu_app::HeadlessOptions options;
+  web_gpu_app::StressOptions stress_options;
+  web_gpu_app::FramePacing frame_pacing;
+  std::string trace_file;
+  bool gpu_culling = false;
+  bool verify_culling = false;
+  bool impostors = false;
+};
+
+// Usage: stress_app [--headless[=num_frames]] [--backend=null|swiftshader|default]
+//                   [--spheres=N] [--work=N] [--pipelined] [--trace=trace.json]
+//                   [--gpu_culling] [--verify_culling] [--impostors]
+// --verify_culling compares the last headless frame's GPU culling with CPU culling, which needs a
+// backend that runs shaders, e.g. SwiftShader. Some spheres are then translucent, which the
+// culling pass must leave out.
+Args ParseArgs(int argc, char** argv) {
+  Args args;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "--headless") {
+      args.headless = true;
+    } else if (arg.starts_with("--headless=")) {
+      args.headless = true;
+      args.num_frames = std::atoi(arg.substr(arg.find('=') + 1).data());
+    } else if (arg == "--backend=swiftshader") {
+      args.options.backend = web_gpu_app::HeadlessBackend::kSwiftShader;
+    } else if (arg == "--backend=default") {
+      args.options.backend = web_gpu_app::HeadlessBackend::kDefault;
+    } else if (arg.starts_with("--spheres=")) {
+      args.stress_options.num_spheres = std::atoi(arg.substr(arg.find('=') + 1).data());
+    } else if (arg.starts_with("--work=")) {
+      args.stress_options.work_per_sphere = std::atoi(arg.substr(arg.find('=') + 1).data());
+    } else if (arg == "--pipelined") {
+      args.frame_pacing.pipelined_update = true;
+    } else if (arg.starts_with("--trace=")) {
+      args.trace_file = arg.substr(arg.find('=') + 1);
+    } else if (arg == "--gpu_culling") {
+      args.gpu_culling = true;
+    } else if (arg == "--verify_culling") {
+      args.gpu_culling = true;
+      args.verify_culling = true;
+      args.stress_options.num_translucent_spheres = 16;
+    } else if (arg == "--impostors") {
+      args.impostors = true;
+    }
+  }
+  return args;
+}
+
+Args g_args;
+int g_exit_code = 0;
+
+// Returns false if any batch has a different number of visible instances on the GPU and the CPU.
+bool VerifyGpuCulling(web_gpu_app::GpuCulling* gpu_culling) {
+  const std::vector<uint32_t> counts = gpu_culling->ReadInstanceCounts();
+  const std::vector<uint32_t>& expected_counts = gpu_culling->GetExpectedInstanceCounts();
+  if (counts.empty() || counts.size() != expected_counts.size()) {
+    std::cerr << "GPU culling did not run" << std::endl;
+    return false;
+  }
+  bool matches = true;
+  uint64_t num_visible = 0;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    num_visible += counts[i];
+    if (counts[i] != expected_counts[i]) {
+      std::cerr << "Batch " << i << ": " << counts[i] << " visible instances on the GPU, "
+                << expected_counts[i] << " on the CPU" << std::endl;
+      matches = false;
+    }
+  }
+  std::cout << "GPU culling " << (matches ? "matches" : "differs from") << " CPU culling: "
+            << num_visible << " visible instances in " << counts.size() << " batches"
+            << std::endl;
+  return matches;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  g_args = ParseArgs(argc, argv);
+  web_gpu_app::Profiler::Get().SetEnabled(!g_args.trace_file.empty());
+  if (g_args.headless) {
+    web_gpu_app::WebGpuRenderer::CreateHeadless(
+        g_args.options, [](std::unique_ptr<web_gpu_app::WebGpuRenderer> renderer) {
+          web_gpu_app::WebGpuRenderer* web_gpu_renderer = renderer.get();
+          web_gpu_renderer->SetGpuCullingEnabled(g_args.gpu_culling);
+          web_gpu_renderer->SetSphereImpostorsEnabled(g_args.impostors);
+          web_gpu_renderer->GetGpuCulling()->SetValidationEnabled(g_args.verify_culling);
+          web_gpu_app::StressApp app(std::move(renderer), g_args.stress_options);
+          app.SetFramePacing(g_args.frame_pacing);
+          if (!g_args.trace_file.empty()) {
+            web_gpu_app::Profiler::Get().StartCapture(g_args.num_frames);
+          }
+          const auto start = std::chrono::steady_clock::now();
+          app.RunHeadless(g_args.num_frames);
+          const std::chrono::duration<double, std::milli> elapsed =
+              std::chrono::steady_clock::now() - start;
+          if (!g_args.trace_file.empty()) {
+            web_gpu_app::Profiler::Get().WriteChromeTrace(g_args.trace_file);
+          }
+
+          // In pipelined mode, the main thread only waits for the part of Update that is longer
+          // than the rest of the frame.
+          const web_gpu_app::FramePacingStats& stats = app.GetFramePacingStats();
+          const double num_frames = static_cast<double>(stats.num_frames);
+          const double update_ms = static_cast<double>(stats.update_ns) * 1e-6 / num_frames;
+          const double wait_ms = static_cast<double>(stats.update_wait_ns) * 1e-6 / num_frames;
+          std::cout << (g_args.frame_pacing.pipelined_update ? "Pipelined" : "Serial")
+                    << " update, " << g_args.stress_options.num_spheres << " spheres: "
+                    << elapsed.count() / num_frames << " ms/frame, update " << update_ms
+                    << " ms, main thread waited " << wait_ms << " ms" << std::endl;
+          const web_gpu_app::FrameArenaStats arena_stats = app.GetFrameArena()->GetStats();
+          std::cout << "Frame arena: " << arena_stats.high_water_mark << " bytes at most, "
+                    << arena_stats.num_overflows << " overflows" << std::endl;
+          const web_gpu_app::RenderStats& render_stats = web_gpu_renderer->GetRenderStats();
+          std::cout << (g_args.impostors ? "Impostor" : "Mesh") << " spheres: "
+                    << render_stats.vertices << " vertices, " << render_stats.instances
+                    << " instances, " << render_stats.triangles << " triangles per frame"
+                    << std::endl;
+          std::cout << "Bind groups: " << render_stats.bind_groups_created << " created, "
+                    << render_stats.bind_groups_reused << " reused in the last frame" << std::endl;
+          if (g_args.verify_culling && !VerifyGpuCulling(web_gpu_renderer->GetGpuCulling())) {
+            g_exit_code = 1;
+          }
+        });
+    return g_exit_code;
+  }
+
+  GLFWwindow* window = web_gpu_app::App::CreateGlfwWindow();
+  web_gpu_app::WebGpuRenderer::Create(
+      window, [](std::unique_ptr<web_gpu_app::WebGpuRenderer> renderer) {
+        renderer->SetGpuCullingEnabled(g_args.gpu_culling);
+        renderer->SetSphereImpostorsEnabled(g_args.impostors);
+        static web_gpu_app::StressApp app(std::move(renderer), g_args.stress_options);
+        app.SetFramePacing(g_args.frame_pacing);
+        app.Run();
+      });
+}
@@ -0,0 +1,110 @@
+#include "stress_app.h"
+
+#include <cmath>
+#include <random>
+
+#include "imgui.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+constexpr float kExtent = 50.f;
+constexpr double kTimeStep = 1. / 60.;
+
+}  // namespace
+
+StressApp::StressApp(std::unique_ptr<Renderer> renderer, const StressOptions& options)
+    : renderer_(std::move(renderer)), options_(options) {
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<float> unit(-1.f, 1.f);
+  std::uniform_real_distribution<float> hue(0.2f, 1.f);
+  bodies_.resize(options_.num_spheres);
+  for (size_t i = 0; i < bodies_.size(); ++i) {
+    Body& body = bodies_[i];
+    body.center = kExtent * Vec3(unit(generator), unit(generator), unit(generator));
+    body.axis = glm::normalize(Vec3(unit(generator), unit(generator), unit(generator)));
+    body.orbit_radius = 1.f + 2.f * std::abs(unit(generator));
+    body.angular_speed = 2.f * unit(generator);
+    body.phase = glm::pi<float>() * unit(generator);
+    const float alpha = i < options_.num_translucent_spheres ? 0.5f : 1.f;
+    body.color = Color(hue(generator), hue(generator), hue(generator), alpha);
+  }
+}
+
+StressApp::~StressApp() {}
+
+const char* StressApp::GetTitle() { return "Stress App"; }
+
+Renderer* StressApp::GetRenderer() { return renderer_.get(); }
+
+Renderables StressApp::Update() {
+  time_ += kTimeStep;
+  std::span<Sphere> spheres = GetFrameArena()->Allocate<Sphere>(bodies_.size());
+  for (size_t i = 0; i < bodies_.size(); ++i) {
+    const Body& body = bodies_[i];
+    const float angle = body.phase + body.angular_speed * static_cast<float>(time_);
+    Vec3 wobble(0.f);
+    for (uint32_t k = 0; k < options_.work_per_sphere; ++k) {
+      const float t = angle + 0.1f * static_cast<float>(k);
+      wobble += Vec3(std::sin(1.3f * t), std::cos(0.7f * t), std::sin(0.9f * t));
+    }
+    if (options_.work_per_sphere > 0) wobble *= 0.2f / static_cast<float>(options_.work_per_sphere);
+    const Vec3 tangent =
+        glm::normalize(glm::cross(body.axis, Vec3(0.f, 0.f, 1.f)) + Vec3(1e-3f, 0.f, 0.f));
+    const Vec3 offset = Vec3(glm::rotate(Mat4(1.f), angle, body.axis) * Vec4(tangent, 0.f));
+    spheres[i] = {
+        .transform = glm::translate(Mat4(1.f), body.center + body.orbit_radius * offset + wobble),
+        .radius = 0.3f,
+        .color = body.color};
+  }
+
+  Renderables renderables;
+  renderables.spheres = spheres;
+  renderables.camera.projection =
+      glm::perspective(glm::radians(60.f), aspect_ratio_, 0.1f, 10.f * kExtent);
+  renderables.camera.view =
+      glm::lookAt(Vec3(0.f, 0.f, 2.5f * kExtent), Vec3(0.f), Vec3(0.f, 1.f, 0.f));
+  return renderables;
+}
+
+void StressApp::UpdateUi() {
+  const ImGuiIO& io = ImGui::GetIO();
+  if (io.DisplaySize.x > 0 && io.DisplaySize.y > 0) {
+    aspect_ratio_ = io.DisplaySize.x / io.DisplaySize.y;
+  }
+
+  // Exponential moving averages of the last frame's times.
+  const FramePacingStats& stats = GetFramePacingStats();
+  const float update_ms = static_cast<float>(stats.update_ns - previous_stats_.update_ns) * 1e-6f;
+  const float update_wait_ms =
+      static_cast<float>(stats.update_wait_ns - previous_stats_.update_wait_ns) * 1e-6f;
+  update_ms_ += 0.05f * (update_ms - update_ms_);
+  update_wait_ms_ += 0.05f * (update_wait_ms - update_wait_ms_);
+  previous_stats_ = stats;
+  // Safe to read here: the update worker is idle.
+  arena_stats_ = GetFrameArena()->GetStats();
+
+  ImGui::Begin("Stress");
+  ImGui::Text("%u spheres, %.1f ms/frame", options_.num_spheres, 1000.f / io.Framerate);
+  FramePacing frame_pacing = GetFramePacing();
+  if (ImGui::Checkbox("Pipelined update", &frame_pacing.pipelined_update)) {
+    SetFramePacing(frame_pacing);
+  }
+  ImGui::Text("Update: %.2f ms, waited for: %.2f ms", update_ms_, update_wait_ms_);
+  ImGui::Text("Frame arena: %.1f KiB peak, %llu overflows", arena_stats_.high_water_mark / 1024.f,
+              static_cast<unsigned long long>(arena_stats_.num_overflows));
+  const PickResult& picked = GetPicked();
+  if (picked.kind == PickedKind::kSphere) {
+    ImGui::Text("Picked sphere %u at distance %.1f", picked.index, picked.distance);
+  } else {
+    ImGui::Text("Click a sphere to pick it");
+  }
+  const PickerStats& picker_stats = GetPicker().GetStats();
+  ImGui::Text("Picker: %llu builds, %llu refits",
+              static_cast<unsigned long long>(picker_stats.num_builds),
+              static_cast<unsigned long long>(picker_stats.num_refits));
+  ImGui::End();
+}
+
+}  // namespace web_gpu_app
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "web_gpu_app/app.h"
+#include "web_gpu_app/renderer.h"
+
+namespace web_gpu_app {
+
+struct StressOptions {
+  uint32_t num_spheres = 20'000;
+  // Iterations of busy work per sphere and frame, standing in for game logic.
+  uint32_t work_per_sphere = 64;
+  // Spheres at half opacity, drawn after the opaque ones.
+  uint32_t num_translucent_spheres = 0;
+};
+
+// Orbiting spheres with a CPU-heavy Update, to measure how much of it pipelined updates hide
+// behind the encoding of the previous frame.
+class StressApp : public App {
+ public:
+  StressApp(std::unique_ptr<Renderer> renderer, const StressOptions& options);
+  virtual ~StressApp();
+
+  const char* GetTitle() override;
+  Renderer* GetRenderer() override;
+  Renderables Update() override;
+  void UpdateUi() override;
+
+ protected:
+  struct Body {
+    Vec3 center;
+    Vec3 axis;
+    float orbit_radius = 0;
+    float angular_speed = 0;
+    float phase = 0;
+    Color color;
+  };
+
+  std::unique_ptr<Renderer> renderer_;
+  StressOptions options_;
+  std::vector<Body> bodies_;
+  double time_ = 0;
+  float aspect_ratio_ = 16.f / 9.f;
+  FramePacingStats previous_stats_;
+  float update_ms_ = 0;
+  float update_wait_ms_ = 0;
+  FrameArenaStats arena_stats_;
+};
+
+}  // namespace web_gpu_app
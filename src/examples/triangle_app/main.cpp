@@ -1,10 +1,111 @@
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
 #include "triangle_app.h"
+#include "web_gpu_app/pipeline_cache.h"
+#include "web_gpu_app/profiler.h"
+#include "web_gpu_app/utils.h"
 #include "web_gpu_app/web_gpu_renderer.h"
 
-int main() {
+namespace {
+
+struct Args {
+  bool headless = false;
+  uint32_t num_frames = 100;
+  web_gpu_app::HeadlessOptions options;
+  web_gpu_app::PresentOptions present_options;
+  web_gpu_app::FramePacing frame_pacing;
+  std::string output_file;
+  bool profile = false;
+  std::string trace_file;
+  std::string pipeline_cache_directory = "pipeline_cache";
+};
+
+// Usage: triangle_app [--headless[=num_frames]] [--backend=null|swiftshader|default]
+//                     [--output=frame.ppm] [--profile] [--trace=trace.json]
+//                     [--pipeline_cache=directory] [--present_mode=fifo|mailbox|immediate]
+//                     [--frames_in_flight=N] [--on_demand] [--fixed_timestep=seconds]
+Args ParseArgs(int argc, char** argv) {
+  Args args;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "--headless") {
+      args.headless = true;
+    } else if (arg.starts_with("--headless=")) {
+      args.headless = true;
+      args.num_frames = std::atoi(arg.substr(arg.find('=') + 1).data());
+    } else if (arg == "--backend=swiftshader") {
+      args.options.backend = web_gpu_app::HeadlessBackend::kSwiftShader;
+    } else if (arg == "--backend=default") {
+      args.options.backend = web_gpu_app::HeadlessBackend::kDefault;
+    } else if (arg.starts_with("--output=")) {
+      args.output_file = arg.substr(arg.find('=') + 1);
+    } else if (arg == "--profile") {
+      args.profile = true;
+    } else if (arg.starts_with("--trace=")) {
+      args.profile = true;
+      args.trace_file = arg.substr(arg.find('=') + 1);
+    } else if (arg.starts_with("--pipeline_cache=")) {
+      args.pipeline_cache_directory = arg.substr(arg.find('=') + 1);
+    } else if (arg == "--present_mode=fifo") {
+      args.present_options.present_mode = wgpu::PresentMode::Fifo;
+    } else if (arg == "--present_mode=mailbox") {
+      args.present_options.present_mode = wgpu::PresentMode::Mailbox;
+    } else if (arg == "--present_mode=immediate") {
+      args.present_options.present_mode = wgpu::PresentMode::Immediate;
+    } else if (arg.starts_with("--frames_in_flight=")) {
+      args.present_options.frames_in_flight = std::atoi(arg.substr(arg.find('=') + 1).data());
+      args.options.frames_in_flight = args.present_options.frames_in_flight;
+    } else if (arg == "--on_demand") {
+      args.frame_pacing.on_demand = true;
+    } else if (arg.starts_with("--fixed_timestep=")) {
+      args.frame_pacing.fixed_timestep = std::atof(arg.substr(arg.find('=') + 1).data());
+    }
+  }
+  return args;
+}
+
+Args g_args;
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  g_args = ParseArgs(argc, argv);
+  web_gpu_app::Profiler::Get().SetEnabled(g_args.profile);
+#if !defined(__EMSCRIPTEN__)
+  web_gpu_app::BlobCache::Get().SetDirectory(g_args.pipeline_cache_directory);
+#endif
+  if (g_args.headless) {
+    web_gpu_app::WebGpuRenderer::CreateHeadless(
+        g_args.options, [](std::unique_ptr<web_gpu_app::WebGpuRenderer> renderer) {
+          web_gpu_app::WebGpuRenderer* web_gpu_renderer = renderer.get();
+          web_gpu_app::TriangleApp app(std::move(renderer));
+          app.SetFramePacing(g_args.frame_pacing);
+          if (!g_args.trace_file.empty()) {
+            web_gpu_app::Profiler::Get().StartCapture(g_args.num_frames);
+          }
+          app.RunHeadless(g_args.num_frames);
+          if (!g_args.trace_file.empty()) {
+            web_gpu_app::Profiler::Get().WriteChromeTrace(g_args.trace_file);
+          }
+          if (!g_args.output_file.empty()) {
+            web_gpu_app::WriteBgraToPpm(g_args.output_file,
+                                        web_gpu_renderer->ReadPixels(),
+                                        g_args.options.width,
+                                        g_args.options.height);
+          }
+        });
+    return 0;
+  }
+
   GLFWwindow* window = web_gpu_app::App::CreateGlfwWindow();
-  web_gpu_app::WebGpuRenderer::Create(window, [](std::unique_ptr<Renderer> renderer) {
-    static web_gpu_app::TriangleApp app(std::move(renderer));
-    app.Run();
-  });
+  web_gpu_app::WebGpuRenderer::Create(
+      window,
+      [](std::unique_ptr<Renderer> renderer) {
+        static web_gpu_app::TriangleApp app(std::move(renderer));
+        app.SetFramePacing(g_args.frame_pacing);
+        app.Run();
+      },
+      g_args.present_options);
 }
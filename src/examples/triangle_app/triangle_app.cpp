@@ -12,9 +12,8 @@ const char* TriangleApp::GetTitle() { return "Triangle App"; }
 
 Renderer* TriangleApp::GetRenderer() { return renderer_.get(); }
 
-Renderables TriangleApp::Update() {
-  ImGui::ShowDemoWindow();
-  return {};
-}
+Renderables TriangleApp::Update() { return {}; }
+
+void TriangleApp::UpdateUi() { ImGui::ShowDemoWindow(); }
 
 }  // namespace web_gpu_app
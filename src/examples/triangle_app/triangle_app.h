@@ -17,6 +17,7 @@ class TriangleApp : public App {
   const char* GetTitle() override;
   Renderer* GetRenderer() override;
   Renderables Update() override;
+  void UpdateUi() override;
 
  protected:
   std::unique_ptr<Renderer> renderer_;
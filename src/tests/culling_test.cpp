@@ -0,0 +1,133 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "test.h"
+#include "web_gpu_app/culling.h"
+#include "web_gpu_app/thread_pool.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+Frustum GetTestFrustum() {
+  const Mat4 projection = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 100.f);
+  const Mat4 view = glm::lookAt(Vec3(0.f, 0.f, 50.f), Vec3(0.f), Vec3(0.f, 1.f, 0.f));
+  return ExtractFrustum(projection * view);
+}
+
+// Spheres spread inside and around the frustum, many of them crossing its planes.
+BoundingSpheres GenerateBounds(size_t count) {
+  std::mt19937 random(7);
+  std::uniform_real_distribution<float> position(-80.f, 80.f);
+  std::uniform_real_distribution<float> radius(0.f, 4.f);
+  BoundingSpheres bounds;
+  for (size_t i = 0; i < count; ++i) {
+    bounds.push_back(Vec3(position(random), position(random), position(random)), radius(random));
+  }
+  return bounds;
+}
+
+void CullKnownSpheres(TestState& state) {
+  BoundingSpheres bounds;
+  bounds.push_back(Vec3(0.f), 1.f);
+  // Behind the camera, then beyond the far plane at z = -50.
+  bounds.push_back(Vec3(0.f, 0.f, 60.f), 1.f);
+  bounds.push_back(Vec3(0.f, 0.f, -60.f), 1.f);
+  // Center outside the far plane, within its radius of it.
+  bounds.push_back(Vec3(0.f, 0.f, -51.f), 2.f);
+  // Far to the left, then crossing the left plane.
+  bounds.push_back(Vec3(-200.f, 0.f, 0.f), 1.f);
+  bounds.push_back(Vec3(-30.f, 0.f, 0.f), 5.f);
+  const std::vector<uint32_t> expected = {0, 3, 5};
+  std::vector<uint32_t> visible;
+  state.Check(CullSpheresScalar(GetTestFrustum(), bounds, 0, bounds.size(), &visible) == 3);
+  state.Check(visible == expected, "scalar");
+  visible.clear();
+  CullSpheresSimd(GetTestFrustum(), bounds, 0, bounds.size(), &visible);
+  state.Check(visible == expected, GetCullingSimdName());
+}
+
+// Ranges of every alignment and remainder with respect to the SIMD width.
+void CullSimdMatchesScalar(TestState& state) {
+  const Frustum frustum = GetTestFrustum();
+  const BoundingSpheres bounds = GenerateBounds(1000);
+  std::vector<uint32_t> expected;
+  std::vector<uint32_t> visible;
+  for (size_t begin = 0; begin < 9; ++begin) {
+    for (size_t end : {begin, begin + 1, begin + 3, begin + 8, begin + 17, bounds.size()}) {
+      expected.assign(1, 12345);
+      visible.assign(1, 12345);
+      const size_t num_expected = CullSpheresScalar(frustum, bounds, begin, end, &expected);
+      const size_t num_visible = CullSpheresSimd(frustum, bounds, begin, end, &visible);
+      state.Check(num_visible == num_expected && visible == expected,
+                  std::string(GetCullingSimdName()) + " differs in [" + std::to_string(begin) +
+                      ", " + std::to_string(end) + ")");
+    }
+  }
+  state.Check(expected.size() > 100 && expected.size() < 900, "spheres on both sides");
+}
+
+void CullThreadedMatchesScalar(TestState& state) {
+  const Frustum frustum = GetTestFrustum();
+  ThreadPool thread_pool(3);
+  for (size_t count : {0, 1, 1000, 100'000, 100'003}) {
+    const BoundingSpheres bounds = GenerateBounds(count);
+    std::vector<uint32_t> expected;
+    CullSpheresScalar(frustum, bounds, 0, count, &expected);
+    std::vector<uint32_t> visible = {12345};
+    CullSpheres(frustum, bounds, &visible, &thread_pool);
+    state.Check(visible == expected, "threaded culling of " + std::to_string(count));
+  }
+}
+
+// Every index is visited once, by non-empty chunks with distinct indices below the returned count.
+void ParallelForCoversRange(TestState& state) {
+  ThreadPool thread_pool(3);
+  for (size_t count = 0; count < 40; ++count) {
+    for (size_t min_chunk_size : {0, 1, 2, 7}) {
+      std::vector<int> visits(count, 0);
+      std::vector<int> chunk_visits(4, 0);
+      bool valid_chunks = true;
+      auto visit = [&](size_t begin, size_t end, size_t chunk) {
+        if (begin >= end || end > count || chunk >= 4) {
+          valid_chunks = false;
+          return;
+        }
+        ++chunk_visits[chunk];
+        for (size_t i = begin; i < end; ++i) ++visits[i];
+      };
+      const size_t num_chunks = thread_pool.ParallelFor(count, min_chunk_size, visit);
+      const std::string label =
+          "count " + std::to_string(count) + ", min chunk " + std::to_string(min_chunk_size);
+      if (!state.Check(valid_chunks, label)) continue;
+      state.Check(visits == std::vector<int>(count, 1), label);
+      for (size_t chunk = 0; chunk < 4; ++chunk) {
+        state.Check(chunk_visits[chunk] == (chunk < num_chunks ? 1 : 0), label);
+      }
+    }
+  }
+}
+
+// Many short calls, which return as soon as the last chunk is done: the workers must be done with
+// the call's state by then.
+void ParallelForReturnsAfterWorkers(TestState& state) {
+  ThreadPool thread_pool(3);
+  std::vector<size_t> sums(4);
+  for (int i = 0; i < 20'000; ++i) {
+    const size_t num_chunks = thread_pool.ParallelFor(
+        4, 1, [&](size_t begin, size_t, size_t chunk) { sums[chunk] += begin; });
+    if (!state.Check(num_chunks == 4)) return;
+  }
+  state.Check(sums[0] == 0 && sums[1] == 20'000 && sums[3] == 60'000);
+}
+
+}  // namespace
+
+REGISTER_TEST(CullKnownSpheres);
+REGISTER_TEST(CullSimdMatchesScalar);
+REGISTER_TEST(CullThreadedMatchesScalar);
+REGISTER_TEST(ParallelForCoversRange);
+REGISTER_TEST(ParallelForReturnsAfterWorkers);
+
+}  // namespace web_gpu_app
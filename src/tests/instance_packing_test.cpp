@@ -0,0 +1,81 @@
+#include <vector>
+
+#include "test.h"
+#include "web_gpu_app/instance_packing.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+// Applies the affine model matrix of "instance" to "position", as the vertex shader does.
+Vec3 TransformPosition(const PackedInstance& instance, const Vec3& position) {
+  const float* model = instance.model;
+  return Vec3(model[0], model[1], model[2]) * position.x +
+         Vec3(model[3], model[4], model[5]) * position.y +
+         Vec3(model[6], model[7], model[8]) * position.z + Vec3(model[9], model[10], model[11]);
+}
+
+void PackColorToRgba8(TestState& state) {
+  state.Check(PackColor(Color(1.f, 0.f, 0.5f, 1.f)) == 0xff8000ffu, "RGBA8 from r in low byte");
+  state.Check(PackColor(Color(0.f)) == 0u);
+  state.Check(PackColor(Color(-1.f, 2.f, 0.f, 0.f)) == 0x0000ff00u, "clamped to [0, 1]");
+  state.Check(PackColor(Color(1.f / 255.f, 0.499f / 255.f, 0.501f / 255.f, 1.f)) == 0xff010001u,
+              "rounded to the nearest");
+}
+
+void PackInstanceLayout(TestState& state) {
+  const Mat4 transform = glm::rotate(glm::translate(Mat4(1.f), Vec3(1.f, 2.f, 3.f)),
+                                     glm::pi<float>() / 2.f, Vec3(0.f, 0.f, 1.f));
+  PackedInstance instance;
+  instance.texture_layer = 7;
+  PackInstance(transform, 2.f, Color(1.f), &instance);
+  // Columns of the rotation scaled by 2, then the translation.
+  const float expected[12] = {0.f, 2.f, 0.f, -2.f, 0.f, 0.f, 0.f, 0.f, 2.f, 1.f, 2.f, 3.f};
+  for (int i = 0; i < 12; ++i) state.CheckNear(instance.model[i], expected[i], 1e-6f);
+  state.Check(instance.color == 0xffffffffu);
+  state.Check(instance.texture_layer == 0, "texture layer reset");
+}
+
+void PackQuantizedInstanceDequantizes(TestState& state) {
+  const Mat4 transform = glm::rotate(glm::translate(Mat4(1.f), Vec3(-4.f, 0.5f, 2.f)), 0.7f,
+                                     glm::normalize(Vec3(1.f, 2.f, 3.f)));
+  const Vec3 position_offset(-1.f, -2.f, -0.5f);
+  const float position_scale = 3.f;
+  PackedInstance quantized;
+  PackQuantizedInstance(transform, 1.5f, position_offset, position_scale, Color(1.f), &quantized);
+  // A unorm position q stands for position_offset + q * position_scale in object space.
+  for (const Vec3 q : {Vec3(0.f), Vec3(1.f), Vec3(0.25f, 0.5f, 0.75f)}) {
+    const Vec3 object_position = position_offset + q * position_scale;
+    const Vec3 expected = Vec3(transform * Vec4(object_position * 1.5f, 1.f));
+    const Vec3 actual = TransformPosition(quantized, q);
+    for (int i = 0; i < 3; ++i) state.CheckNear(actual[i], expected[i], 1e-5f);
+  }
+}
+
+void PackIndexedCubesAndSpheres(TestState& state) {
+  std::vector<Cube> cubes;
+  std::vector<Sphere> spheres;
+  for (int i = 0; i < 4; ++i) {
+    const Mat4 transform = glm::translate(Mat4(1.f), Vec3(static_cast<float>(i), 0.f, 0.f));
+    cubes.push_back({transform, 1.f + i, Color(0.f, 0.f, 0.f, 1.f)});
+    spheres.push_back({transform, 2.f + i, Color(1.f)});
+  }
+  const uint32_t indices[] = {3, 1};
+  std::vector<PackedInstance> instances(4);
+  if (!state.Check(PackCubes(cubes, indices, instances) == 2)) return;
+  state.CheckNear(instances[0].model[9], 3.f, 0.f, "first index packed first");
+  state.CheckNear(instances[0].model[0], 4.f, 0.f, "size of cube 3");
+  state.CheckNear(instances[1].model[9], 1.f, 0.f);
+  state.Check(instances[1].color == 0xff000000u);
+  if (!state.Check(PackSpheres(spheres, instances) == 4)) return;
+  for (int i = 0; i < 4; ++i) state.CheckNear(instances[i].model[4], 2.f + i, 0.f, "radius");
+}
+
+}  // namespace
+
+REGISTER_TEST(PackColorToRgba8);
+REGISTER_TEST(PackInstanceLayout);
+REGISTER_TEST(PackQuantizedInstanceDequantizes);
+REGISTER_TEST(PackIndexedCubesAndSpheres);
+
+}  // namespace web_gpu_app
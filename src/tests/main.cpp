@@ -0,0 +1,20 @@
+#include <iostream>
+#include <string_view>
+
+#include "test.h"
+
+// Usage: web_gpu_app_tests [--filter=substring]
+// Returns 1 if any test failed.
+int main(int argc, char** argv) {
+  std::string_view filter;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg.starts_with("--filter=")) {
+      filter = arg.substr(arg.find('=') + 1);
+    } else {
+      std::cerr << "Unknown argument: " << arg << std::endl;
+      return 1;
+    }
+  }
+  return web_gpu_app::TestRunner::Get().Run(filter) == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "test.h"
+#include "web_gpu_app/mapped_file.h"
+#include "web_gpu_app/mesh_file.h"
+#include "web_gpu_app/primitives.h"
+#include "web_gpu_app/web_gpu_utils.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+// Bytes of a mesh file of a cube.
+std::vector<uint8_t> GetCubeMeshFile() {
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "web_gpu_app_tests_cube.wgmesh";
+  MappedFile file;
+  if (!WriteMeshFile(path.string(), CreateCubeGeometry()) || !file.Open(path.string())) return {};
+  std::span<const uint8_t> data = file.GetData();
+  return std::vector<uint8_t>(data.begin(), data.end());
+}
+
+bool OpenMeshFile(std::vector<uint8_t> bytes, MeshFile* mesh_file, std::string* error) {
+  MappedFile file;
+  file.Assign(std::move(bytes));
+  return mesh_file->Open(std::move(file), error);
+}
+
+MeshFileHeader GetHeader(const std::vector<uint8_t>& bytes) {
+  MeshFileHeader header;
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  return header;
+}
+
+void SetHeader(const MeshFileHeader& header, std::vector<uint8_t>* bytes) {
+  std::memcpy(bytes->data(), &header, sizeof(header));
+}
+
+void MeshFileOpensWrittenFile(TestState& state) {
+  const PrimitiveGeometry geometry = CreateCubeGeometry();
+  MeshFile mesh_file;
+  std::string error;
+  if (!state.Check(OpenMeshFile(GetCubeMeshFile(), &mesh_file, &error), error)) return;
+  state.Check(mesh_file.HasVertexLayout());
+  state.Check(mesh_file.GetVertexData().size() == geometry.vertices.size() * sizeof(Vertex));
+  state.Check(mesh_file.GetIndexData().size() == geometry.indices.size() * sizeof(uint32_t));
+}
+
+void MeshFileRejectsTruncatedFile(TestState& state) {
+  std::vector<uint8_t> bytes = GetCubeMeshFile();
+  if (!state.Check(!bytes.empty(), "Cannot write the mesh file")) return;
+  MeshFile mesh_file;
+  std::string error;
+  for (size_t size : {bytes.size() - 1, size_t{100}, sizeof(MeshFileHeader) - 1, size_t{0}}) {
+    state.Check(!OpenMeshFile({bytes.begin(), bytes.begin() + size}, &mesh_file, &error),
+                "Opened a file truncated to " + std::to_string(size) + " bytes");
+    state.Check(!mesh_file.IsOpen());
+  }
+}
+
+// Offsets whose sum with the data size wraps around.
+void MeshFileRejectsHugeOffsets(TestState& state) {
+  const std::vector<uint8_t> bytes = GetCubeMeshFile();
+  if (!state.Check(!bytes.empty(), "Cannot write the mesh file")) return;
+  constexpr uint64_t kHugeOffset = ~uint64_t{0} & ~(kMeshFileAlignment - 1);
+  MeshFile mesh_file;
+  std::string error;
+
+  std::vector<uint8_t> corrupt = bytes;
+  MeshFileHeader header = GetHeader(bytes);
+  header.vertex_data_offset = kHugeOffset;
+  SetHeader(header, &corrupt);
+  state.Check(!OpenMeshFile(corrupt, &mesh_file, &error), "Huge vertex data offset");
+
+  corrupt = bytes;
+  header = GetHeader(bytes);
+  header.index_data_offset = kHugeOffset;
+  SetHeader(header, &corrupt);
+  state.Check(!OpenMeshFile(corrupt, &mesh_file, &error), "Huge index data offset");
+
+  // Past the end of the file by less than the data size.
+  corrupt = bytes;
+  header = GetHeader(bytes);
+  header.index_data_offset = AlignUp(bytes.size(), kMeshFileAlignment);
+  SetHeader(header, &corrupt);
+  state.Check(!OpenMeshFile(corrupt, &mesh_file, &error), "Index data offset past the end");
+}
+
+}  // namespace
+
+REGISTER_TEST(MeshFileOpensWrittenFile);
+REGISTER_TEST(MeshFileRejectsTruncatedFile);
+REGISTER_TEST(MeshFileRejectsHugeOffsets);
+
+}  // namespace web_gpu_app
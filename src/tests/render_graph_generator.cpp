@@ -0,0 +1,111 @@
+#include "render_graph_generator.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace web_gpu_app {
+
+void BuildFrameRenderGraph(RenderGraph* graph) {
+  graph->Reset();
+  auto draw = [](wgpu::RenderPassEncoder) {};
+  const RenderGraphResource output = graph->ImportTexture("Output", nullptr);
+  const RenderGraphResource instances = graph->ImportBuffer("Culled instances");
+  const RenderGraphResource shadow_map = graph->CreateTexture(
+      "Shadow map", {.width = 2048, .height = 2048, .format = wgpu::TextureFormat::Depth32Float});
+  const RenderGraphResource color = graph->CreateTexture(
+      "Color", {.width = 1280, .height = 720, .format = wgpu::TextureFormat::RGBA16Float});
+  const RenderGraphResource depth = graph->CreateTexture(
+      "Depth", {.width = 1280, .height = 720, .format = wgpu::TextureFormat::Depth24Plus});
+  const RenderGraphResource debug = graph->CreateTexture(
+      "Debug", {.width = 1280, .height = 720, .format = wgpu::TextureFormat::RGBA8Unorm});
+
+  graph->AddEncoderPass("Culling", [](wgpu::CommandEncoder) {}).Write(instances);
+  graph->AddRenderPass("Shadows", draw).SetDepthAttachment(shadow_map, 1.f).Read(instances);
+  graph->AddRenderPass("Depth prepass", draw).SetDepthAttachment(depth, 1.f).Read(instances);
+  graph->AddRenderPass("Opaque", draw)
+      .AddColorAttachment(color, wgpu::Color{})
+      .SetReadOnlyDepthAttachment(depth)
+      .Read(shadow_map)
+      .Read(instances);
+  graph->AddRenderPass("Debug", draw).AddColorAttachment(debug).Read(depth);
+  // Blur chain: each level is read by the next one only, so levels of the same size alias.
+  RenderGraphResource previous = color;
+  for (uint32_t size : {640u, 320u, 640u, 320u}) {
+    const RenderGraphResource level = graph->CreateTexture(
+        "Bloom", {.width = size, .height = size / 2, .format = wgpu::TextureFormat::RGBA16Float});
+    graph->AddRenderPass("Bloom", draw).AddColorAttachment(level).Read(previous);
+    previous = level;
+  }
+  graph->AddRenderPass("Tone mapping", draw)
+      .AddColorAttachment(output, wgpu::Color{})
+      .Read(color)
+      .Read(previous);
+  graph->AddRenderPass("Ui", draw).AddColorAttachment(output);
+}
+
+void BuildRandomRenderGraph(size_t num_passes, uint32_t seed, RenderGraph* graph) {
+  graph->Reset();
+  std::mt19937 random(seed);
+  auto draw = [](wgpu::RenderPassEncoder) {};
+  const uint32_t sizes[] = {256, 512, 1024};
+  std::vector<RenderGraphResource> colors;
+  std::vector<RenderGraphResource> depths;
+  for (size_t i = 0; i < num_passes; ++i) {
+    const uint32_t size = sizes[random() % std::size(sizes)];
+    colors.push_back(graph->CreateTexture(
+        "Color", {.width = size, .height = size, .format = wgpu::TextureFormat::RGBA8Unorm}));
+    depths.push_back(graph->CreateTexture(
+        "Depth", {.width = size, .height = size, .format = wgpu::TextureFormat::Depth24Plus}));
+  }
+  const RenderGraphResource output = graph->ImportTexture("Output", nullptr);
+
+  std::vector<RenderGraphResource> written;
+  std::vector<uint8_t> is_written(graph->GetResources().size());
+  auto add_reads = [&](RenderGraph::PassBuilder* pass, RenderGraphResource color,
+                       RenderGraphResource depth, uint32_t num_reads) {
+    for (uint32_t i = 0; i < num_reads && !written.empty(); ++i) {
+      const RenderGraphResource read = written[random() % written.size()];
+      if (read != color && read != depth) pass->Read(read);
+    }
+  };
+  for (size_t i = 0; i < num_passes; ++i) {
+    // Recent textures are more likely, so that lifetimes vary.
+    const size_t window = std::min<size_t>(i + 1, 8);
+    const RenderGraphResource color = colors[i - random() % window];
+    RenderGraph::PassBuilder pass = graph->AddRenderPass("Pass", draw);
+    if (random() % 2) {
+      pass.AddColorAttachment(color, wgpu::Color{});
+    } else {
+      pass.AddColorAttachment(color);
+    }
+    RenderGraphResource depth = color;
+    switch (random() % 4) {
+      case 0:
+        depth = depths[i];
+        pass.SetDepthAttachment(depth, 1.f);
+        break;
+      case 1:
+        depth = depths[random() % (i + 1)];
+        if (is_written[depth]) {
+          pass.SetReadOnlyDepthAttachment(depth);
+        } else {
+          pass.SetDepthAttachment(depth);
+        }
+        break;
+      default:
+        break;
+    }
+    add_reads(&pass, color, depth, random() % 3);
+    if (random() % 50 == 0) pass.SetSideEffects();
+    for (RenderGraphResource texture : {color, depth}) {
+      if (!is_written[texture]) written.push_back(texture);
+      is_written[texture] = true;
+    }
+  }
+  RenderGraph::PassBuilder pass =
+      graph->AddRenderPass("Output", draw).AddColorAttachment(output, wgpu::Color{});
+  add_reads(&pass, output, output, 4);
+}
+
+}  // namespace web_gpu_app
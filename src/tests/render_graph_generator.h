@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "web_gpu_app/render_graph.h"
+
+namespace web_gpu_app {
+
+// Render graphs shared by the render graph tests and benchmarks.
+
+// Passes of a frame with shadows and post-processing, of which a debug pass is unused.
+void BuildFrameRenderGraph(RenderGraph* graph);
+
+// Passes drawing to random textures of a few kinds while reading textures written before, the
+// last one drawing to the output.
+void BuildRandomRenderGraph(size_t num_passes, uint32_t seed, RenderGraph* graph);
+
+}  // namespace web_gpu_app
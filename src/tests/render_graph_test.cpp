@@ -0,0 +1,209 @@
+#include <string>
+
+#include "render_graph_generator.h"
+#include "test.h"
+#include "web_gpu_app/render_graph.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+// Reference checks of a compiled graph, derived from the declared passes independently of the way
+// Compile computes them.
+class RenderGraphValidator {
+ public:
+  explicit RenderGraphValidator(const RenderGraph& graph)
+      : graph_(graph), passes_(graph.GetPasses()), resources_(graph.GetResources()) {}
+
+  bool Validate(std::string* error) {
+    for (uint32_t p = 0; p < passes_.size(); ++p) {
+      if (!ValidatePass(p, error)) return false;
+    }
+    for (uint32_t r = 0; r < resources_.size(); ++r) {
+      if (!ValidateResource(r, error)) return false;
+    }
+    return true;
+  }
+
+ private:
+  // The contents of "resource" before the pass.
+  bool Reads(const RenderGraphPassInfo& pass, RenderGraphResource resource) const {
+    for (const RenderGraphAttachment& attachment : graph_.GetAttachments(pass)) {
+      if (attachment.texture == resource && (attachment.read_only || !attachment.clear)) {
+        return true;
+      }
+    }
+    for (const RenderGraphAccess& access : graph_.GetAccesses(pass)) {
+      if (access.resource == resource && !access.write) return true;
+    }
+    return false;
+  }
+
+  bool Writes(const RenderGraphPassInfo& pass, RenderGraphResource resource) const {
+    for (const RenderGraphAttachment& attachment : graph_.GetAttachments(pass)) {
+      if (attachment.texture == resource && !attachment.read_only) return true;
+    }
+    for (const RenderGraphAccess& access : graph_.GetAccesses(pass)) {
+      if (access.resource == resource && access.write) return true;
+    }
+    return false;
+  }
+
+  bool Touches(const RenderGraphPassInfo& pass, RenderGraphResource resource) const {
+    return Reads(pass, resource) || Writes(pass, resource);
+  }
+
+  bool IsOutput(RenderGraphResource resource) const {
+    return resources_[resource].imported && !resources_[resource].buffer;
+  }
+
+  // Whether the contents of "resource" after pass "p" are read by a kept pass or are an output.
+  bool IsUsedAfter(uint32_t p, RenderGraphResource resource) const {
+    for (uint32_t q = p + 1; q < passes_.size(); ++q) {
+      if (passes_[q].culled) continue;
+      if (Reads(passes_[q], resource)) return true;
+      if (Writes(passes_[q], resource)) return false;
+    }
+    return IsOutput(resource);
+  }
+
+  bool IsDefinedBefore(uint32_t p, RenderGraphResource resource) const {
+    if (resources_[resource].imported) return true;
+    for (uint32_t q = 0; q < p; ++q) {
+      if (!passes_[q].culled && Writes(passes_[q], resource)) return true;
+    }
+    return false;
+  }
+
+  bool Fail(std::string* error, const RenderGraphPassInfo& pass, const std::string& message) {
+    *error = std::string(pass.name) + ": " + message;
+    return false;
+  }
+
+  bool ValidatePass(uint32_t p, std::string* error) {
+    const RenderGraphPassInfo& pass = passes_[p];
+    bool used = pass.side_effects;
+    for (uint32_t r = 0; r < resources_.size(); ++r) {
+      used |= Writes(pass, r) && IsUsedAfter(p, r);
+    }
+    if (used == pass.culled) {
+      return Fail(error, pass, used ? "culled but its outputs are used" : "kept but unused");
+    }
+    if (pass.culled) return true;
+
+    for (const RenderGraphAccess& access : graph_.GetAccesses(pass)) {
+      if (!access.write && !IsDefinedBefore(p, access.resource)) {
+        return Fail(error, pass, "reads undefined contents");
+      }
+    }
+    for (const RenderGraphAttachment& attachment : graph_.GetAttachments(pass)) {
+      if (attachment.read_only) {
+        if (attachment.load_op != wgpu::LoadOp::Undefined ||
+            attachment.store_op != wgpu::StoreOp::Undefined) {
+          return Fail(error, pass, "read-only attachment with load or store operations");
+        }
+        continue;
+      }
+      const bool load = !attachment.clear && IsDefinedBefore(p, attachment.texture);
+      if (attachment.load_op != (load ? wgpu::LoadOp::Load : wgpu::LoadOp::Clear)) {
+        return Fail(error, pass, "wrong load operation");
+      }
+      const bool store = IsUsedAfter(p, attachment.texture);
+      if (attachment.store_op != (store ? wgpu::StoreOp::Store : wgpu::StoreOp::Discard)) {
+        return Fail(error, pass, "wrong store operation");
+      }
+    }
+    return true;
+  }
+
+  bool ValidateResource(RenderGraphResource r, std::string* error) {
+    const RenderGraphResourceInfo& resource = resources_[r];
+    uint32_t first_pass = RenderGraph::kNoPass;
+    uint32_t last_pass = RenderGraph::kNoPass;
+    bool attached = false;
+    bool sampled = false;
+    for (uint32_t p = 0; p < passes_.size(); ++p) {
+      const RenderGraphPassInfo& pass = passes_[p];
+      if (pass.culled || !Touches(pass, r)) continue;
+      if (first_pass == RenderGraph::kNoPass) first_pass = p;
+      last_pass = p;
+      for (const RenderGraphAttachment& attachment : graph_.GetAttachments(pass)) {
+        attached |= attachment.texture == r;
+      }
+      for (const RenderGraphAccess& access : graph_.GetAccesses(pass)) {
+        sampled |= access.resource == r && !access.write;
+      }
+    }
+    if (resource.first_pass != first_pass || resource.last_pass != last_pass) {
+      *error = std::string(resource.name) + ": wrong lifetime";
+      return false;
+    }
+    if (resource.imported || resource.buffer || first_pass == RenderGraph::kNoPass) return true;
+
+    auto has_usage = [&](wgpu::TextureUsage usage) {
+      return (resource.descriptor.usage & usage) != wgpu::TextureUsage::None;
+    };
+    if ((attached && !has_usage(wgpu::TextureUsage::RenderAttachment)) ||
+        (sampled && !has_usage(wgpu::TextureUsage::TextureBinding))) {
+      *error = std::string(resource.name) + ": missing usage";
+      return false;
+    }
+    // Textures sharing a pool texture must not be alive at the same time.
+    for (RenderGraphResource other = 0; other < r; ++other) {
+      const RenderGraphResourceInfo& info = resources_[other];
+      if (info.imported || info.buffer || info.first_pass == RenderGraph::kNoPass ||
+          !(info.descriptor == resource.descriptor) ||
+          info.physical_index != resource.physical_index) {
+        continue;
+      }
+      if (info.first_pass <= resource.last_pass && resource.first_pass <= info.last_pass) {
+        *error = std::string(resource.name) + " aliases " + info.name + " while alive";
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const RenderGraph& graph_;
+  std::span<const RenderGraphPassInfo> passes_;
+  std::span<const RenderGraphResourceInfo> resources_;
+};
+
+bool CompileAndValidate(RenderGraph* graph, std::string* error) {
+  return graph->Compile(error) && RenderGraphValidator(*graph).Validate(error);
+}
+
+void RenderGraphFrameGraph(TestState& state) {
+  RenderGraph graph;
+  BuildFrameRenderGraph(&graph);
+  std::string error;
+  if (!state.Check(CompileAndValidate(&graph, &error), error)) return;
+  const RenderGraphStats& stats = graph.GetStats();
+  state.Check(stats.num_culled_passes == 1, "Only the debug pass is culled");
+  // Shadow map, color, depth and the four bloom levels; the debug texture is never created.
+  state.Check(stats.num_transient_textures == 7);
+  state.Check(stats.num_physical_textures < stats.num_transient_textures,
+              "Bloom levels of the same size share a pool texture");
+}
+
+void RenderGraphRandomGraphs(TestState& state) {
+  RenderGraph graph;
+  std::string error;
+  for (size_t num_passes : {10, 100, 1'000}) {
+    for (uint32_t seed = 1; seed <= 100; ++seed) {
+      BuildRandomRenderGraph(num_passes, seed, &graph);
+      if (!state.Check(CompileAndValidate(&graph, &error),
+                       std::to_string(num_passes) + " passes, seed " + std::to_string(seed) +
+                           ": " + error)) {
+        return;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+REGISTER_TEST(RenderGraphFrameGraph);
+REGISTER_TEST(RenderGraphRandomGraphs);
+
+}  // namespace web_gpu_app
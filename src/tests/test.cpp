@@ -0,0 +1,49 @@
+#include "test.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace web_gpu_app {
+
+bool TestState::Check(bool condition, std::string_view message, std::source_location location) {
+  if (condition) return true;
+  ++num_failures_;
+  std::fprintf(stderr, "%s:%u: check failed%s%.*s\n", location.file_name(), location.line(),
+               message.empty() ? "" : ": ", static_cast<int>(message.size()), message.data());
+  return false;
+}
+
+bool TestState::CheckNear(float actual, float expected, float tolerance, std::string_view message,
+                          std::source_location location) {
+  if (std::abs(actual - expected) <= tolerance) return true;
+  std::fprintf(stderr, "%s:%u: %g is not within %g of %g\n", location.file_name(),
+               location.line(), actual, tolerance, expected);
+  return Check(false, message, location);
+}
+
+TestRunner& TestRunner::Get() {
+  static TestRunner runner;
+  return runner;
+}
+
+void TestRunner::Register(const char* name, TestFunction function) {
+  tests_.push_back({name, std::move(function)});
+}
+
+int TestRunner::Run(std::string_view filter) {
+  int num_failed = 0;
+  int num_run = 0;
+  for (const Test& test : tests_) {
+    if (test.name.find(filter) == std::string::npos) continue;
+    std::fprintf(stderr, "[ RUN    ] %s\n", test.name.c_str());
+    TestState state;
+    test.function(state);
+    ++num_run;
+    if (state.failed()) ++num_failed;
+    std::fprintf(stderr, "[ %s ] %s\n", state.failed() ? "FAILED" : "    OK", test.name.c_str());
+  }
+  std::fprintf(stderr, "%d of %d tests failed\n", num_failed, num_run);
+  return num_failed;
+}
+
+}  // namespace web_gpu_app
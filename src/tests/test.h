@@ -0,0 +1,59 @@
+#pragma once
+
+#include <functional>
+#include <source_location>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "web_gpu_app/profiler.h"
+
+// Registers "function" to run as a test of web_gpu_app_tests.
+#define REGISTER_TEST(function)                                               \
+  static ::web_gpu_app::TestRegistration WEB_GPU_APP_CONCAT(registration_, \
+                                                            __LINE__)(#function, function)
+
+namespace web_gpu_app {
+
+// Failures of one test run, which goes on after a failed check unless it returns.
+class TestState {
+ public:
+  // Records a failure at the caller's location if "condition" is false, and returns "condition".
+  bool Check(bool condition, std::string_view message = {},
+             std::source_location location = std::source_location::current());
+  // Same as above for |actual - expected| <= tolerance.
+  bool CheckNear(float actual, float expected, float tolerance, std::string_view message = {},
+                 std::source_location location = std::source_location::current());
+
+  bool failed() const { return num_failures_ > 0; }
+
+ private:
+  int num_failures_ = 0;
+};
+
+using TestFunction = std::function<void(TestState&)>;
+
+class TestRunner {
+ public:
+  static TestRunner& Get();
+
+  void Register(const char* name, TestFunction function);
+  // Runs the tests whose name contains "filter". Returns the number of failed tests.
+  int Run(std::string_view filter);
+
+ private:
+  struct Test {
+    std::string name;
+    TestFunction function;
+  };
+
+  std::vector<Test> tests_;
+};
+
+struct TestRegistration {
+  TestRegistration(const char* name, TestFunction function) {
+    TestRunner::Get().Register(name, std::move(function));
+  }
+};
+
+}  // namespace web_gpu_app
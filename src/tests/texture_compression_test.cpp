@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "test.h"
+#include "web_gpu_app/texture_compression.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+// Reference decoders of single 4x4 blocks, written from the format specifications rather than
+// from the encoders. Each writes the channels it decodes of the 16 RGBA8 pixels of "block", in
+// row-major order.
+using DecodedBlock = std::array<std::array<int, 4>, 16>;
+
+uint64_t LoadLittleEndian(const uint8_t* data, int num_bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < num_bytes; ++i) value |= uint64_t{data[i]} << (8 * i);
+  return value;
+}
+
+uint64_t LoadBigEndian(const uint8_t* data) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; ++i) value = value << 8 | data[i];
+  return value;
+}
+
+int Extend(int value, int num_bits) {
+  return value << (8 - num_bits) | value >> (2 * num_bits - 8);
+}
+
+void DecodeBc1(const uint8_t* data, DecodedBlock* block) {
+  const int color0 = static_cast<int>(LoadLittleEndian(data, 2));
+  const int color1 = static_cast<int>(LoadLittleEndian(data + 2, 2));
+  const uint64_t indices = LoadLittleEndian(data + 4, 4);
+  std::array<int, 3> palette[4];
+  for (int i = 0; i < 2; ++i) {
+    const int color = i == 0 ? color0 : color1;
+    palette[i] = {Extend(color >> 11, 5), Extend((color >> 5) & 63, 6), Extend(color & 31, 5)};
+  }
+  for (int c = 0; c < 3; ++c) {
+    if (color0 > color1) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    } else {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    }
+  }
+  for (int i = 0; i < 16; ++i) {
+    const std::array<int, 3>& color = palette[(indices >> (2 * i)) & 3];
+    std::copy(color.begin(), color.end(), (*block)[i].begin());
+  }
+}
+
+void DecodeBc3Alpha(const uint8_t* data, DecodedBlock* block) {
+  const int alpha0 = data[0];
+  const int alpha1 = data[1];
+  const uint64_t indices = LoadLittleEndian(data + 2, 6);
+  int palette[8] = {alpha0, alpha1};
+  if (alpha0 > alpha1) {
+    for (int i = 2; i < 8; ++i) palette[i] = ((8 - i) * alpha0 + (i - 1) * alpha1) / 7;
+  } else {
+    for (int i = 2; i < 6; ++i) palette[i] = ((6 - i) * alpha0 + (i - 1) * alpha1) / 5;
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+  for (int i = 0; i < 16; ++i) (*block)[i][3] = palette[(indices >> (3 * i)) & 7];
+}
+
+// The individual and differential modes, the only ones of ETC2 that ETC1 has.
+void DecodeEtc1(const uint8_t* data, DecodedBlock* block) {
+  static constexpr int kModifiers[8][2] = {{2, 8},   {5, 17},  {9, 29},  {13, 42},
+                                           {18, 60}, {24, 80}, {33, 106}, {47, 183}};
+  const uint64_t bits = LoadBigEndian(data);
+  const bool differential = (bits >> 33) & 1;
+  const bool flip = (bits >> 32) & 1;
+  int base[2][3];
+  for (int c = 0; c < 3; ++c) {
+    const int byte = static_cast<int>(bits >> (56 - 8 * c)) & 255;
+    if (differential) {
+      const int delta = ((byte & 7) ^ 4) - 4;
+      base[0][c] = Extend(byte >> 3, 5);
+      base[1][c] = Extend((byte >> 3) + delta, 5);
+    } else {
+      base[0][c] = Extend(byte >> 4, 4);
+      base[1][c] = Extend(byte & 15, 4);
+    }
+  }
+  const int tables[2] = {static_cast<int>(bits >> 37) & 7, static_cast<int>(bits >> 34) & 7};
+  for (int y = 0; y < 4; ++y) {
+    for (int x = 0; x < 4; ++x) {
+      const int subblock = (flip ? y : x) >= 2 ? 1 : 0;
+      const int i = x * 4 + y;
+      const int msb = static_cast<int>(bits >> (16 + i)) & 1;
+      const int lsb = static_cast<int>(bits >> i) & 1;
+      const int modifier = kModifiers[tables[subblock]][lsb] * (msb ? -1 : 1);
+      for (int c = 0; c < 3; ++c) {
+        (*block)[y * 4 + x][c] = std::clamp(base[subblock][c] + modifier, 0, 255);
+      }
+    }
+  }
+}
+
+void DecodeEacAlpha(const uint8_t* data, DecodedBlock* block) {
+  static constexpr int kModifiers[16][8] = {
+      {-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12},
+      {-2, -5, -8, -13, 1, 4, 7, 12}, {-2, -4, -6, -13, 1, 3, 5, 12},
+      {-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10},
+      {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10},
+      {-2, -6, -8, -10, 1, 5, 7, 9},  {-2, -5, -8, -10, 1, 4, 7, 9},
+      {-2, -4, -8, -10, 1, 3, 7, 9},  {-2, -5, -7, -10, 1, 4, 6, 9},
+      {-3, -4, -7, -10, 2, 3, 6, 9},  {-1, -2, -3, -10, 0, 1, 2, 9},
+      {-4, -6, -8, -9, 3, 5, 7, 8},   {-3, -5, -7, -9, 2, 4, 6, 8}};
+  const uint64_t bits = LoadBigEndian(data);
+  const int base = static_cast<int>(bits >> 56);
+  const int multiplier = static_cast<int>(bits >> 52) & 15;
+  const int table = static_cast<int>(bits >> 48) & 15;
+  for (int y = 0; y < 4; ++y) {
+    for (int x = 0; x < 4; ++x) {
+      const int index = static_cast<int>(bits >> (45 - 3 * (x * 4 + y))) & 7;
+      (*block)[y * 4 + x][3] = std::clamp(base + kModifiers[table][index] * multiplier, 0, 255);
+    }
+  }
+}
+
+bool HasAlpha(TextureFileFormat format) {
+  return format == TextureFileFormat::kBc3 || format == TextureFileFormat::kEtc2Rgba8;
+}
+
+// Decodes the "format" blocks of "data" back to RGBA8 pixels, with an opaque alpha if the format
+// has none.
+std::vector<uint8_t> Decompress(std::span<const uint8_t> data, uint32_t width, uint32_t height,
+                                TextureFileFormat format) {
+  const uint32_t blocks_x = (width + 3) / 4;
+  const uint32_t bytes_per_block = GetTextureFormatInfo(format).bytes_per_block;
+  std::vector<uint8_t> pixels(size_t{width} * height * 4);
+  for (uint32_t y = 0; y < height; y += 4) {
+    for (uint32_t x = 0; x < width; x += 4) {
+      const uint8_t* block_data = &data[(size_t{y / 4} * blocks_x + x / 4) * bytes_per_block];
+      DecodedBlock block;
+      for (auto& pixel : block) pixel[3] = 255;
+      switch (format) {
+        case TextureFileFormat::kBc1:
+          DecodeBc1(block_data, &block);
+          break;
+        case TextureFileFormat::kBc3:
+          DecodeBc3Alpha(block_data, &block);
+          DecodeBc1(block_data + 8, &block);
+          break;
+        case TextureFileFormat::kEtc2Rgb8:
+          DecodeEtc1(block_data, &block);
+          break;
+        case TextureFileFormat::kEtc2Rgba8:
+          DecodeEacAlpha(block_data, &block);
+          DecodeEtc1(block_data + 8, &block);
+          break;
+        case TextureFileFormat::kRgba8:
+          break;
+      }
+      for (uint32_t by = 0; by < 4 && y + by < height; ++by) {
+        for (uint32_t bx = 0; bx < 4 && x + bx < width; ++bx) {
+          for (int c = 0; c < 4; ++c) {
+            pixels[((size_t{y} + by) * width + x + bx) * 4 + c] =
+                static_cast<uint8_t>(block[by * 4 + bx][c]);
+          }
+        }
+      }
+    }
+  }
+  return pixels;
+}
+
+// Smooth color and alpha gradients with a little noise, of a size that is not a multiple of the
+// blocks.
+std::vector<uint8_t> GenerateImage(uint32_t width, uint32_t height) {
+  std::vector<uint8_t> pixels(size_t{width} * height * 4);
+  for (uint32_t y = 0; y < height; ++y) {
+    for (uint32_t x = 0; x < width; ++x) {
+      uint8_t* pixel = &pixels[(size_t{y} * width + x) * 4];
+      const int noise = static_cast<int>((x * 7 + y * 13) % 5) - 2;
+      const int red = static_cast<int>(x * 255 / width) + noise;
+      pixel[0] = static_cast<uint8_t>(std::clamp(red, 0, 255));
+      pixel[1] = static_cast<uint8_t>(y * 255 / height);
+      pixel[2] = static_cast<uint8_t>(128 + 100 * std::sin(0.1f * static_cast<float>(x + y)));
+      pixel[3] = static_cast<uint8_t>(255 - (x + y) * 255 / (width + height));
+    }
+  }
+  return pixels;
+}
+
+struct RoundTripError {
+  double color_rmse = 0;
+  double alpha_rmse = 0;
+  int max_color_error = 0;
+  int max_alpha_error = 0;
+};
+
+RoundTripError CompressAndDecompress(std::span<const uint8_t> pixels, uint32_t width,
+                                     uint32_t height, TextureFileFormat format) {
+  const std::vector<uint8_t> data = CompressImage(pixels, width, height, format);
+  const std::vector<uint8_t> decoded = Decompress(data, width, height, format);
+  RoundTripError error;
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    const int difference = std::abs(int{decoded[i]} - int{pixels[i]});
+    if (i % 4 == 3) {
+      error.alpha_rmse += difference * difference;
+      error.max_alpha_error = std::max(error.max_alpha_error, difference);
+    } else {
+      error.color_rmse += difference * difference;
+      error.max_color_error = std::max(error.max_color_error, difference);
+    }
+  }
+  const double num_pixels = static_cast<double>(pixels.size() / 4);
+  error.color_rmse = std::sqrt(error.color_rmse / (3 * num_pixels));
+  error.alpha_rmse = std::sqrt(error.alpha_rmse / num_pixels);
+  return error;
+}
+
+constexpr TextureFileFormat kCompressedFormats[] = {
+    TextureFileFormat::kBc1, TextureFileFormat::kBc3, TextureFileFormat::kEtc2Rgb8,
+    TextureFileFormat::kEtc2Rgba8};
+
+void CompressGradientsWithinErrorBounds(TestState& state) {
+  constexpr uint32_t kWidth = 30;
+  constexpr uint32_t kHeight = 18;
+  const std::vector<uint8_t> pixels = GenerateImage(kWidth, kHeight);
+  for (TextureFileFormat format : kCompressedFormats) {
+    const std::string name = GetTextureFormatName(format);
+    const RoundTripError error = CompressAndDecompress(pixels, kWidth, kHeight, format);
+    state.Check(error.color_rmse < 9, name + " color RMSE " + std::to_string(error.color_rmse));
+    state.Check(error.max_color_error <= 32,
+                name + " color error " + std::to_string(error.max_color_error));
+    if (!HasAlpha(format)) continue;
+    state.Check(error.alpha_rmse < 2, name + " alpha RMSE " + std::to_string(error.alpha_rmse));
+    state.Check(error.max_alpha_error <= 6,
+                name + " alpha error " + std::to_string(error.max_alpha_error));
+  }
+}
+
+// A single color is only off by the quantization of the endpoints or base colors.
+void CompressSolidColorNearlyExactly(TestState& state) {
+  std::vector<uint8_t> pixels;
+  for (int i = 0; i < 6 * 5; ++i) pixels.insert(pixels.end(), {200, 100, 50, 128});
+  for (TextureFileFormat format : kCompressedFormats) {
+    const std::string name = GetTextureFormatName(format);
+    const RoundTripError error = CompressAndDecompress(pixels, 6, 5, format);
+    state.Check(error.max_color_error <= 4,
+                name + " color error " + std::to_string(error.max_color_error));
+    if (!HasAlpha(format)) continue;
+    state.Check(error.max_alpha_error == 0,
+                name + " alpha error " + std::to_string(error.max_alpha_error));
+  }
+}
+
+// Blocks split in two colors, left and right or top and bottom, and one pixel wide stripes of two
+// grays, which every encoder can represent closely. Catches pixels decoded out of place, which the
+// gradients mostly hide.
+void CompressTwoColorBlocks(TestState& state) {
+  constexpr uint32_t kSize = 8;
+  const char* const kPatterns[] = {"left and right", "top and bottom", "stripes"};
+  for (int pattern = 0; pattern < 3; ++pattern) {
+    using Rgba = std::array<uint8_t, 4>;
+    const Rgba first = pattern == 2 ? Rgba{100, 100, 100, 200} : Rgba{230, 40, 60, 255};
+    const Rgba second = pattern == 2 ? Rgba{140, 140, 140, 120} : Rgba{30, 90, 200, 64};
+    std::vector<uint8_t> pixels;
+    for (uint32_t y = 0; y < kSize; ++y) {
+      for (uint32_t x = 0; x < kSize; ++x) {
+        const bool is_first = pattern == 2 ? x % 2 == 0 : (pattern == 0 ? x : y) % 4 < 2;
+        const Rgba& color = is_first ? first : second;
+        pixels.insert(pixels.end(), color.begin(), color.end());
+      }
+    }
+    for (TextureFileFormat format : kCompressedFormats) {
+      const std::string name = std::string(GetTextureFormatName(format)) + " " + kPatterns[pattern];
+      const RoundTripError error = CompressAndDecompress(pixels, kSize, kSize, format);
+      state.Check(error.max_color_error <= 8,
+                  name + " color error " + std::to_string(error.max_color_error));
+      if (!HasAlpha(format)) continue;
+      state.Check(error.max_alpha_error <= 1,
+                  name + " alpha error " + std::to_string(error.max_alpha_error));
+    }
+  }
+}
+
+}  // namespace
+
+REGISTER_TEST(CompressGradientsWithinErrorBounds);
+REGISTER_TEST(CompressSolidColorNearlyExactly);
+REGISTER_TEST(CompressTwoColorBlocks);
+
+}  // namespace web_gpu_app
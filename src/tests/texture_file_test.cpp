@@ -0,0 +1,105 @@
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "test.h"
+#include "web_gpu_app/mapped_file.h"
+#include "web_gpu_app/texture_file.h"
+#include "web_gpu_app/web_gpu_utils.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+constexpr uint32_t kSize = 8;
+
+// Bytes of an 8x8 texture file with an RGBA8 and a BC1 variant, all mip levels.
+std::vector<uint8_t> GetTextureFile() {
+  const uint32_t num_levels = GetNumMipLevels(kSize, kSize);
+  TextureVariant variants[2] = {{.format = TextureFileFormat::kRgba8},
+                                {.format = TextureFileFormat::kBc1}};
+  for (TextureVariant& variant : variants) {
+    for (uint32_t level = 0; level < num_levels; ++level) {
+      variant.levels.emplace_back(GetMipLevelSize(variant.format, kSize, kSize, level), 0x80);
+    }
+  }
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "web_gpu_app_tests_texture.wgtex";
+  MappedFile file;
+  if (!WriteTextureFile(path.string(), kSize, kSize, true, variants) ||
+      !file.Open(path.string())) {
+    return {};
+  }
+  std::span<const uint8_t> data = file.GetData();
+  return std::vector<uint8_t>(data.begin(), data.end());
+}
+
+bool OpenTextureFile(std::vector<uint8_t> bytes, TextureFile* texture_file, std::string* error) {
+  MappedFile file;
+  file.Assign(std::move(bytes));
+  return texture_file->Open(std::move(file), error);
+}
+
+// Overwrites field "T" at "offset" of the file.
+template <typename T>
+void SetField(size_t offset, T value, std::vector<uint8_t>* bytes) {
+  std::memcpy(bytes->data() + offset, &value, sizeof(value));
+}
+
+void TextureFileOpensWrittenFile(TestState& state) {
+  TextureFile texture_file;
+  std::string error;
+  if (!state.Check(OpenTextureFile(GetTextureFile(), &texture_file, &error), error)) return;
+  const TextureFileVariant* variant = texture_file.FindVariant(TextureFileFormat::kBc1);
+  if (!state.Check(variant != nullptr)) return;
+  state.Check(texture_file.GetMipLevel(*variant, 0).size() == 32, "2x2 blocks of 8 bytes");
+  state.Check(texture_file.GetMipLevel(*variant, 3).size() == 8, "Partial block");
+}
+
+void TextureFileRejectsTruncatedFile(TestState& state) {
+  const std::vector<uint8_t> bytes = GetTextureFile();
+  if (!state.Check(!bytes.empty(), "Cannot write the texture file")) return;
+  TextureFile texture_file;
+  std::string error;
+  // The file ends with the padding of the last variant, shorter than kTextureFileAlignment.
+  for (size_t size : {bytes.size() - size_t{kTextureFileAlignment}, size_t{100},
+                      sizeof(TextureFileHeader) + 1, size_t{0}}) {
+    state.Check(!OpenTextureFile({bytes.begin(), bytes.begin() + size}, &texture_file, &error),
+                "Opened a file truncated to " + std::to_string(size) + " bytes");
+    state.Check(!texture_file.IsOpen());
+  }
+}
+
+// Offsets whose sum with the data size wraps around, and sizes that overflow.
+void TextureFileRejectsHugeOffsets(TestState& state) {
+  const std::vector<uint8_t> bytes = GetTextureFile();
+  if (!state.Check(!bytes.empty(), "Cannot write the texture file")) return;
+  const size_t variant_offset = sizeof(TextureFileHeader) + sizeof(TextureFileVariant);
+  TextureFile texture_file;
+  std::string error;
+
+  std::vector<uint8_t> corrupt = bytes;
+  SetField(variant_offset + offsetof(TextureFileVariant, data_offset),
+           ~uint64_t{0} & ~(kTextureFileAlignment - 1), &corrupt);
+  state.Check(!OpenTextureFile(corrupt, &texture_file, &error), "Huge data offset");
+
+  corrupt = bytes;
+  SetField(variant_offset + offsetof(TextureFileVariant, data_offset),
+           AlignUp(bytes.size(), kTextureFileAlignment), &corrupt);
+  state.Check(!OpenTextureFile(corrupt, &texture_file, &error), "Data offset past the end");
+
+  corrupt = bytes;
+  SetField(offsetof(TextureFileHeader, width), ~uint32_t{0}, &corrupt);
+  SetField(offsetof(TextureFileHeader, height), ~uint32_t{0}, &corrupt);
+  state.Check(!OpenTextureFile(corrupt, &texture_file, &error), "Huge texture size");
+}
+
+}  // namespace
+
+REGISTER_TEST(TextureFileOpensWrittenFile);
+REGISTER_TEST(TextureFileRejectsTruncatedFile);
+REGISTER_TEST(TextureFileRejectsHugeOffsets);
+
+}  // namespace web_gpu_app
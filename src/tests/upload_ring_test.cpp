@@ -0,0 +1,88 @@
+#include "test.h"
+#include "web_gpu_app/upload_ring.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+void UploadRingAlignsAllocations(TestState& state) {
+  // Slots are rounded up to 256 bytes.
+  UploadRingAllocator allocator(3, 1000);
+  state.Check(allocator.GetSlotSize() == 1024);
+  state.Check(allocator.BeginFrame(), "first use of a slot creates it");
+  state.Check(allocator.Allocate(10, 1) == 0);
+  state.Check(allocator.Allocate(4, 16) == 16);
+  state.Check(allocator.Allocate(1, 256) == 256);
+  state.Check(allocator.Allocate(8, 4) == 260);
+  state.Check(allocator.GetUsedBytes() == 268);
+  state.Check(allocator.Allocate(1024 - 268, 1) == 268, "fills the slot exactly");
+  state.Check(allocator.GetNumOverflows() == 0);
+  state.Check(allocator.GetHighWaterMark() == 1024);
+  allocator.EndFrame();
+}
+
+void UploadRingWrapsAround(TestState& state) {
+  UploadRingAllocator allocator(3, 256);
+  for (uint32_t frame = 0; frame < 7; ++frame) {
+    if (!state.Check(allocator.IsNextSlotAvailable())) return;
+    state.Check(allocator.BeginFrame() == (frame < 3), "slots are created once");
+    state.Check(allocator.GetCurrentSlot() == frame % 3);
+    state.Check(allocator.GetUsedBytes() == 0, "a new frame starts at the slot's beginning");
+    state.Check(allocator.Allocate(100, 4) == 0);
+    const uint64_t fence = allocator.EndFrame();
+    state.Check(fence == frame + 1, "fences increase by one per frame");
+    allocator.SignalFence(fence);
+  }
+}
+
+void UploadRingWaitsForFences(TestState& state) {
+  UploadRingAllocator allocator(3, 256);
+  uint64_t fences[3];
+  for (uint64_t& fence : fences) {
+    allocator.BeginFrame();
+    fence = allocator.EndFrame();
+  }
+  state.Check(!allocator.IsNextSlotAvailable(), "all slots in flight");
+  allocator.SignalFence(fences[0]);
+  if (!state.Check(allocator.IsNextSlotAvailable(), "first slot signaled")) return;
+  allocator.BeginFrame();
+  state.Check(allocator.GetCurrentSlot() == 0);
+  allocator.EndFrame();
+  state.Check(!allocator.IsNextSlotAvailable(), "second slot still in flight");
+  // Fences are signaled in order: a later one completes the earlier frames too.
+  allocator.SignalFence(fences[2]);
+  allocator.SignalFence(fences[1]);
+  state.Check(allocator.GetCompletedFence() == fences[2], "completed fence never decreases");
+  state.Check(allocator.IsNextSlotAvailable());
+}
+
+void UploadRingGrowsAfterOverflow(TestState& state) {
+  UploadRingAllocator allocator(2, 1024);
+  allocator.BeginFrame();
+  state.Check(allocator.Allocate(1000, 4) == 0);
+  state.Check(allocator.Allocate(100, 16) == UploadRingAllocator::kInvalidOffset, "overflow");
+  state.Check(allocator.GetNumOverflows() == 1);
+  state.Check(allocator.GetSlotSize() == 2048, "grows to fit the failed allocation");
+  state.Check(allocator.GetUsedBytes() == 1000, "a failed allocation takes no space");
+  state.Check(allocator.Allocate(24, 4) == 1000, "smaller allocations still fit");
+  allocator.SignalFence(allocator.EndFrame());
+
+  state.Check(allocator.BeginFrame(), "the second slot is created at the new size");
+  state.Check(allocator.Allocate(2048, 4) == 0);
+  allocator.SignalFence(allocator.EndFrame());
+  state.Check(allocator.BeginFrame(), "the first slot is recreated at the new size");
+  state.Check(allocator.GetCurrentSlot() == 0);
+  state.Check(allocator.Allocate(2048, 4) == 0);
+  allocator.SignalFence(allocator.EndFrame());
+  state.Check(!allocator.BeginFrame(), "no growth without overflow");
+  state.Check(allocator.GetNumOverflows() == 1);
+}
+
+}  // namespace
+
+REGISTER_TEST(UploadRingAlignsAllocations);
+REGISTER_TEST(UploadRingWrapsAround);
+REGISTER_TEST(UploadRingWaitsForFences);
+REGISTER_TEST(UploadRingGrowsAfterOverflow);
+
+}  // namespace web_gpu_app
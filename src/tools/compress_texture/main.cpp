@@ -0,0 +1,115 @@
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "web_gpu_app/texture_compression.h"
+#include "web_gpu_app/texture_file.h"
+#include "web_gpu_app/thread_pool.h"
+
+namespace {
+
+web_gpu_app::TextureVariant CompressMipChain(
+    const std::vector<std::vector<uint8_t>>& levels, uint32_t width, uint32_t height,
+    web_gpu_app::TextureFileFormat format, web_gpu_app::ThreadPool* thread_pool) {
+  web_gpu_app::TextureVariant variant;
+  variant.format = format;
+  for (size_t level = 0; level < levels.size(); ++level) {
+    variant.levels.push_back(web_gpu_app::CompressImage(
+        levels[level], std::max(width >> level, 1u), std::max(height >> level, 1u), format,
+        thread_pool));
+  }
+  return variant;
+}
+
+}  // namespace
+
+// Usage: compress_texture [--no_bc] [--no_etc2] [--no_rgba8] [--linear] input.png output.wgtex
+// Converts an image readable by stb_image into a texture file, see texture_file.h. The mip chain is
+// generated once and encoded in BC1 and ETC2 RGB8 if the image is opaque, BC3 and ETC2 RGBA8
+// otherwise, and kept uncompressed as a fallback for devices without either. The colors are
+// treated as sRGB when filtering the mips unless --linear is passed.
+int main(int argc, char** argv) {
+  bool bc = true;
+  bool etc2 = true;
+  bool rgba8 = true;
+  bool srgb = true;
+  std::string input_file;
+  std::string output_file;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "--no_bc") {
+      bc = false;
+    } else if (arg == "--no_etc2") {
+      etc2 = false;
+    } else if (arg == "--no_rgba8") {
+      rgba8 = false;
+    } else if (arg == "--linear") {
+      srgb = false;
+    } else if (input_file.empty()) {
+      input_file = arg;
+    } else {
+      output_file = arg;
+    }
+  }
+  if (input_file.empty() || output_file.empty() || !(bc || etc2 || rgba8)) {
+    std::cerr << "Usage: compress_texture [--no_bc] [--no_etc2] [--no_rgba8] [--linear] "
+                 "input.png output.wgtex"
+              << std::endl;
+    return 1;
+  }
+
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  stbi_uc* pixels = stbi_load(input_file.c_str(), &width, &height, &channels, 4);
+  if (pixels == nullptr) {
+    std::cerr << "Cannot load " << input_file << ": " << stbi_failure_reason() << std::endl;
+    return 1;
+  }
+  const std::span<const uint8_t> image(pixels, size_t{4} * width * height);
+  const bool opaque = web_gpu_app::IsOpaque(image);
+  std::vector<std::vector<uint8_t>> levels =
+      web_gpu_app::GenerateMipChain(image, width, height, srgb);
+  stbi_image_free(pixels);
+  if (levels.size() > web_gpu_app::kMaxTextureMipLevels) {
+    levels.resize(web_gpu_app::kMaxTextureMipLevels);
+  }
+  std::cout << "Input: " << width << "x" << height << ", " << levels.size() << " mip levels, "
+            << (opaque ? "opaque" : "with alpha") << std::endl;
+
+  web_gpu_app::ThreadPool thread_pool;
+  std::vector<web_gpu_app::TextureVariant> variants;
+  if (bc) {
+    variants.push_back(CompressMipChain(
+        levels, width, height,
+        opaque ? web_gpu_app::TextureFileFormat::kBc1 : web_gpu_app::TextureFileFormat::kBc3,
+        &thread_pool));
+  }
+  if (etc2) {
+    variants.push_back(CompressMipChain(levels, width, height,
+                                        opaque ? web_gpu_app::TextureFileFormat::kEtc2Rgb8
+                                               : web_gpu_app::TextureFileFormat::kEtc2Rgba8,
+                                        &thread_pool));
+  }
+  if (rgba8) {
+    variants.push_back({.format = web_gpu_app::TextureFileFormat::kRgba8, .levels = levels});
+  }
+  for (const web_gpu_app::TextureVariant& variant : variants) {
+    size_t num_bytes = 0;
+    for (const std::vector<uint8_t>& level : variant.levels) num_bytes += level.size();
+    std::cout << web_gpu_app::GetTextureFormatName(variant.format) << ": " << num_bytes
+              << " bytes" << std::endl;
+  }
+
+  if (!web_gpu_app::WriteTextureFile(output_file, width, height, srgb, variants)) return 1;
+  std::cout << input_file << " (" << std::filesystem::file_size(input_file) << " bytes) -> "
+            << output_file << " (" << std::filesystem::file_size(output_file) << " bytes)"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "web_gpu_app/mesh_cache.h"
+#include "web_gpu_app/mesh_file.h"
+#include "web_gpu_app/mesh_lod.h"
+#include "web_gpu_app/mesh_optimizer.h"
+
+namespace {
+
+void PrintStats(const char* name, const web_gpu_app::MeshStats& stats) {
+  std::cout << name << ": " << stats.num_vertices << " vertices, " << stats.num_triangles
+            << " triangles, ACMR " << stats.acmr << ", " << stats.bytes_per_vertex
+            << " bytes/vertex, " << stats.num_bytes << " bytes" << std::endl;
+}
+
+}  // namespace
+
+// Usage: obj_to_mesh [--no_optimize] [--no_lods] [--quantize] input.obj output.wgmesh
+// Converts all the shapes of the OBJ file into a single mesh file, see mesh_file.h. The mesh is
+// welded and reordered for the vertex cache and vertex fetch unless --no_optimize is passed, and
+// simplified into a chain of LODs unless --no_lods is passed.
+int main(int argc, char** argv) {
+  bool optimize = true;
+  bool generate_lods = true;
+  bool quantize = false;
+  std::string input_file;
+  std::string output_file;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "--no_optimize") {
+      optimize = false;
+    } else if (arg == "--no_lods") {
+      generate_lods = false;
+    } else if (arg == "--quantize") {
+      quantize = true;
+    } else if (input_file.empty()) {
+      input_file = arg;
+    } else {
+      output_file = arg;
+    }
+  }
+  if (input_file.empty() || output_file.empty()) {
+    std::cerr << "Usage: obj_to_mesh [--no_optimize] [--no_lods] [--quantize] input.obj "
+                 "output.wgmesh"
+              << std::endl;
+    return 1;
+  }
+
+  std::string base_directory = std::filesystem::path(input_file).parent_path().string();
+  if (!base_directory.empty()) base_directory += '/';
+  tinyobj::attrib_t attrib;
+  std::vector<tinyobj::shape_t> shapes;
+  std::vector<tinyobj::material_t> materials;
+  std::string warning;
+  std::string error;
+  if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warning, &error, input_file.c_str(),
+                        base_directory.c_str())) {
+    std::cerr << "Cannot load " << input_file << ": " << error << std::endl;
+    return 1;
+  }
+  if (!warning.empty()) std::cerr << warning << std::endl;
+
+  web_gpu_app::PrimitiveGeometry geometry;
+  for (const tinyobj::shape_t& shape : shapes) {
+    web_gpu_app::PrimitiveGeometry shape_geometry = web_gpu_app::ConvertMesh(attrib, shape.mesh);
+    const uint32_t base = static_cast<uint32_t>(geometry.vertices.size());
+    geometry.vertices.insert(geometry.vertices.end(), shape_geometry.vertices.begin(),
+                             shape_geometry.vertices.end());
+    for (uint32_t index : shape_geometry.indices) geometry.indices.push_back(base + index);
+  }
+  PrintStats("Input", web_gpu_app::ComputeMeshStats(geometry));
+
+  if (optimize) web_gpu_app::OptimizeMesh(&geometry);
+  std::vector<web_gpu_app::MeshLod> lods;
+  if (generate_lods) {
+    lods = web_gpu_app::GenerateLods(&geometry);
+    for (size_t i = 0; i < lods.size(); ++i) {
+      std::cout << "LOD " << i << ": " << lods[i].num_indices / 3 << " triangles, error "
+                << lods[i].error << std::endl;
+    }
+  }
+  if (quantize) {
+    web_gpu_app::QuantizedGeometry quantized = web_gpu_app::QuantizeGeometry(geometry);
+    PrintStats("Output", web_gpu_app::ComputeMeshStats(quantized));
+    if (!web_gpu_app::WriteMeshFile(output_file, quantized, lods)) return 1;
+  } else {
+    PrintStats("Output", web_gpu_app::ComputeMeshStats(geometry));
+    if (!web_gpu_app::WriteMeshFile(output_file, geometry, lods)) return 1;
+  }
+  std::cout << input_file << " (" << std::filesystem::file_size(input_file) << " bytes) -> "
+            << output_file << " (" << std::filesystem::file_size(output_file) << " bytes), "
+            << shapes.size() << " shapes" << std::endl;
+  return 0;
+}
@@ -2,7 +2,10 @@
 
 #include <GLFW/glfw3.h>
 
+#include <cmath>
+
 #include "imgui.h"
+#include "web_gpu_app/profiler.h"
 #include "web_gpu_app/utils.h"
 #include "web_gpu_app/web_gpu_renderer.h"
 
@@ -15,6 +18,17 @@
 
 namespace {
 
+// ImGui needs a few frames to settle after an input, e.g. to update hovered items.
+constexpr uint32_t kInputRedrawFrames = 3;
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+// Pipelined updates run inline.
+constexpr uint32_t kNumUpdateThreads = 0;
+#else
+// Even on a single core, Update overlaps with the waits for the GPU and the display.
+constexpr uint32_t kNumUpdateThreads = 1;
+#endif
+
 web_gpu_app::App* AppFromWindow(GLFWwindow* window) {
   return reinterpret_cast<web_gpu_app::App*>(glfwGetWindowUserPointer(window));
 }
@@ -23,13 +37,16 @@ web_gpu_app::App* AppFromWindow(GLFWwindow* window) {
 
 namespace web_gpu_app {
 
-App::App() {}
+App::App() : asset_loader_(std::make_unique<AssetLoader>()) {
+  asset_loader_->SetCompletionNotifier([this] { RequestRedraw(); });
+}
 
-App::~App() {}
+App::~App() { asset_loader_->SetCompletionNotifier(nullptr); }
 
 void App::Run() {
   window_ = reinterpret_cast<GLFWwindow*>(GetRenderer()->GetWindow());
   glfwSetWindowUserPointer(window_, this);
+  last_frame_ns_ = Profiler::NowNs();
 
 #if defined(__EMSCRIPTEN__)
   emscripten_set_main_loop_arg(EmscriptenMainLoop, reinterpret_cast<void*>(this), 0, false);
@@ -37,18 +54,141 @@ void App::Run() {
                                  EmscriptenCanvasSizeChanged);
 #else
   while (!glfwWindowShouldClose(window_)) {
-    glfwPollEvents();
+    // Throttles before polling so that the input is as recent as possible when presented.
+    GetRenderer()->WaitForNextFrame();
+    if (frame_pacing_.on_demand && !IsRedrawPending()) {
+      waiting_for_events_ = true;
+      if (!IsRedrawPending()) {
+        ++frame_pacing_stats_.num_idle_waits;
+        glfwWaitEvents();
+      } else {
+        glfwPollEvents();
+      }
+      waiting_for_events_ = false;
+      // The idle time is not simulated.
+      last_frame_ns_ = Profiler::NowNs();
+      if (!IsRedrawPending()) continue;
+    } else {
+      glfwPollEvents();
+    }
+    RunFixedUpdates();
     Render();
   }
 #endif
 }
 
+void App::RunHeadless(uint32_t num_frames) {
+  window_ = nullptr;
+  for (uint32_t i = 0; i < num_frames; ++i) {
+    // One step per frame, independently of the frame times, for reproducible frames.
+    if (frame_pacing_.fixed_timestep > 0) {
+      FixedUpdate(frame_pacing_.fixed_timestep);
+      ++frame_pacing_stats_.num_fixed_steps;
+    }
+    Render();
+  }
+}
+
+double App::GetFixedUpdateAlpha() const {
+  if (frame_pacing_.fixed_timestep <= 0) return 0;
+  return fixed_time_accumulator_ / frame_pacing_.fixed_timestep;
+}
+
+void App::RequestRedraw(uint32_t num_frames) {
+  uint32_t pending = num_redraw_frames_.load();
+  while (pending < num_frames && !num_redraw_frames_.compare_exchange_weak(pending, num_frames)) {
+  }
+#if !defined(__EMSCRIPTEN__)
+  if (waiting_for_events_) glfwPostEmptyEvent();
+#endif
+}
+
+bool App::IsRedrawPending() { return num_redraw_frames_ > 0 || GetRenderer()->HasPendingWork(); }
+
+void App::RunFixedUpdates() {
+  const uint64_t now_ns = Profiler::NowNs();
+  const double elapsed = static_cast<double>(now_ns - last_frame_ns_) * 1e-9;
+  last_frame_ns_ = now_ns;
+  const double timestep = frame_pacing_.fixed_timestep;
+  if (timestep <= 0) return;
+
+  PROFILE_SCOPE("App::FixedUpdate");
+  fixed_time_accumulator_ += elapsed;
+  for (uint32_t i = 0; fixed_time_accumulator_ >= timestep; ++i) {
+    if (i == frame_pacing_.max_fixed_steps) {
+      frame_pacing_stats_.num_dropped_steps +=
+          static_cast<uint64_t>(fixed_time_accumulator_ / timestep);
+      fixed_time_accumulator_ = std::fmod(fixed_time_accumulator_, timestep);
+      break;
+    }
+    FixedUpdate(timestep);
+    fixed_time_accumulator_ -= timestep;
+    ++frame_pacing_stats_.num_fixed_steps;
+  }
+}
+
 void App::Render() {
-  glfwSetWindowTitle(window_, GetTitle());
-  Renderer* renderer = GetRenderer();
-  renderer->BeginFrame();
+  // Setting the title is a round trip to the window system on some platforms.
+  if (window_ != nullptr) {
+    const char* title = GetTitle();
+    if (title_ != title) {
+      title_ = title;
+      glfwSetWindowTitle(window_, title);
+    }
+  }
+  uint32_t pending = num_redraw_frames_.load();
+  while (pending > 0 && !num_redraw_frames_.compare_exchange_weak(pending, pending - 1)) {
+  }
+  ++frame_pacing_stats_.num_frames;
+
+  Profiler& profiler = Profiler::Get();
+  profiler.BeginFrame();
+  {
+    PROFILE_SCOPE("App::Render");
+    Renderer* renderer = GetRenderer();
+    renderer->BeginFrame();
+    asset_loader_->ProcessCompletions();
+    {
+      PROFILE_SCOPE("App::UpdateUi");
+      UpdateUi();
+    }
+    Renderables renderables = GetNextRenderables();
+    if (frame_pacing_.pipelined_update) {
+      if (!update_thread_) {
+        update_thread_ = std::make_unique<ThreadPool>(kNumUpdateThreads);
+      }
+      update_slot_ = (update_slot_ + 1) % kNumUpdateSlots;
+      auto promise = std::make_shared<std::promise<Renderables>>();
+      pending_renderables_ = promise->get_future();
+      update_thread_->Submit([this, promise] { promise->set_value(RunUpdate()); });
+    }
+    profiler.DrawOverlay();
+    renderer->EndFrame(renderables);
+    picking_renderables_ = renderables;
+    picking_renderables_changed_ = true;
+    if (pending_renderables_.valid()) {
+      PROFILE_SCOPE("App::WaitForUpdate");
+      const uint64_t begin_ns = Profiler::NowNs();
+      pending_renderables_.wait();
+      frame_pacing_stats_.update_wait_ns += Profiler::NowNs() - begin_ns;
+    }
+  }
+  profiler.EndFrame();
+}
+
+Renderables App::RunUpdate() {
+  PROFILE_SCOPE("App::Update");
+  const uint64_t begin_ns = Profiler::NowNs();
+  frame_arenas_[update_slot_].Reset();
   Renderables renderables = Update();
-  renderer->EndFrame(renderables);
+  frame_pacing_stats_.update_ns += Profiler::NowNs() - begin_ns;
+  return renderables;
+}
+
+Renderables App::GetNextRenderables() {
+  if (pending_renderables_.valid()) return pending_renderables_.get();
+  if (!frame_pacing_.pipelined_update) update_slot_ = 0;
+  return RunUpdate();
 }
 
 GLFWwindow* App::CreateGlfwWindow(const char* title, CanvasSize canvas_size, void* user_pointer) {
@@ -68,6 +208,9 @@ GLFWwindow* App::CreateGlfwWindow(const char* title, CanvasSize canvas_size, voi
   glfwSetCursorPosCallback(window, &OnGlfwSetCursorPos);
   glfwSetMouseButtonCallback(window, &OnGlfwSetMouseButton);
   glfwSetScrollCallback(window, OnGlfwScroll);
+  glfwSetKeyCallback(window, &OnGlfwKey);
+  glfwSetCharCallback(window, &OnGlfwChar);
+  glfwSetWindowRefreshCallback(window, &OnGlfwRefresh);
   return window;
 }
 
@@ -80,28 +223,77 @@ void App::OnResize(int width, int height) {
   Render();
 }
 
-void App::OnMouseMove(double xpos, double ypos) {}
-void App::OnMouseButton(int button, int action, int mods) {}
+PickResult App::Pick(double x, double y) {
+  if (window_ == nullptr) return {};
+  PROFILE_SCOPE("App::Pick");
+  if (picking_renderables_changed_) {
+    if (auto* renderer = dynamic_cast<WebGpuRenderer*>(GetRenderer())) {
+      picker_.SetMeshCache(renderer->GetMeshCache());
+    }
+    picker_.Update(picking_renderables_);
+    picking_renderables_changed_ = false;
+  }
+  int width = 0;
+  int height = 0;
+  glfwGetWindowSize(window_, &width, &height);
+  return picker_.Pick(ComputeScreenRay(picking_renderables_.camera, {width, height}, x, y));
+}
+
+void App::OnMouseMove(double xpos, double ypos) {
+  cursor_x_ = xpos;
+  cursor_y_ = ypos;
+}
+
+void App::OnMouseButton(int button, int action, int mods) {
+  if (button != GLFW_MOUSE_BUTTON_LEFT || action != GLFW_PRESS) return;
+  if (ImGui::GetCurrentContext() != nullptr && ImGui::GetIO().WantCaptureMouse) return;
+  OnPick(Pick(cursor_x_, cursor_y_));
+}
 void App::OnScroll(double xoffset, double yoffset) {}
+void App::OnKey(int key, int scancode, int action, int mods) {}
 
 void App::OnGlfwResize(GLFWwindow* window, int width, int height) {
+  AppFromWindow(window)->RequestRedraw(kInputRedrawFrames);
   AppFromWindow(window)->OnResize(width, height);
 }
 
 void App::OnGlfwSetCursorPos(GLFWwindow* window, double xpos, double ypos) {
+  AppFromWindow(window)->RequestRedraw(kInputRedrawFrames);
   AppFromWindow(window)->OnMouseMove(xpos, ypos);
 }
 
 void App::OnGlfwSetMouseButton(GLFWwindow* window, int button, int action, int mods) {
+  AppFromWindow(window)->RequestRedraw(kInputRedrawFrames);
   AppFromWindow(window)->OnMouseButton(button, action, mods);
 }
 
 void App::OnGlfwScroll(GLFWwindow* window, double x_offset, double y_offset) {
+  AppFromWindow(window)->RequestRedraw(kInputRedrawFrames);
   AppFromWindow(window)->OnScroll(x_offset, y_offset);
 }
 
+void App::OnGlfwKey(GLFWwindow* window, int key, int scancode, int action, int mods) {
+  AppFromWindow(window)->RequestRedraw(kInputRedrawFrames);
+  AppFromWindow(window)->OnKey(key, scancode, action, mods);
+}
+
+void App::OnGlfwChar(GLFWwindow* window, unsigned int codepoint) {
+  AppFromWindow(window)->RequestRedraw(kInputRedrawFrames);
+}
+
+void App::OnGlfwRefresh(GLFWwindow* window) { AppFromWindow(window)->RequestRedraw(); }
+
 #if defined(__EMSCRIPTEN__)
-void App::EmscriptenMainLoop(void* app) { reinterpret_cast<App*>(app)->Render(); }
+void App::EmscriptenMainLoop(void* user_data) {
+  App* app = reinterpret_cast<App*>(user_data);
+  // The browser schedules the frames, skipping them is the only way to idle.
+  if (app->frame_pacing_.on_demand && !app->IsRedrawPending()) {
+    app->last_frame_ns_ = Profiler::NowNs();
+    return;
+  }
+  app->RunFixedUpdates();
+  app->Render();
+}
 
 int App::EmscriptenCanvasSizeChanged(int event_type, const EmscriptenUiEvent* ui_event,
                                      void* user_data) {
@@ -0,0 +1,341 @@
+#include "web_gpu_app/asset_loader.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <istream>
+#include <streambuf>
+
+#include "web_gpu_app/mapped_file.h"
+#include "web_gpu_app/profiler.h"
+
+#if defined(WEB_GPU_APP_FETCH)
+#include <emscripten/fetch.h>
+#include <emscripten/threading.h>
+
+#include <cstring>
+#endif
+
+namespace web_gpu_app {
+
+namespace {
+
+// Lets tinyobj parse a mapped file without copying it into a string first.
+class MemoryStreamBuffer : public std::streambuf {
+ public:
+  explicit MemoryStreamBuffer(std::span<const uint8_t> data) {
+    char* begin = reinterpret_cast<char*>(const_cast<uint8_t*>(data.data()));
+    setg(begin, begin, begin + data.size());
+  }
+};
+
+bool ParseObj(std::span<const uint8_t> data, const std::string& path, ObjAsset* obj,
+              std::string* error) {
+  MemoryStreamBuffer stream_buffer(data);
+  std::istream stream(&stream_buffer);
+  std::string base_directory = std::filesystem::path(path).parent_path().string();
+  if (!base_directory.empty()) base_directory += '/';
+  tinyobj::MaterialFileReader material_reader(base_directory);
+  std::string warning;
+  return tinyobj::LoadObj(&obj->attrib, &obj->shapes, &obj->materials, &warning, error, &stream,
+                          &material_reader);
+}
+
+bool DecodeImage(std::span<const uint8_t> data, ImageAsset* image, std::string* error) {
+  int num_channels = 0;
+  stbi_uc* pixels = stbi_load_from_memory(data.data(), static_cast<int>(data.size()),
+                                          &image->width, &image->height, &num_channels,
+                                          STBI_rgb_alpha);
+  if (pixels == nullptr) {
+    *error = stbi_failure_reason();
+    return false;
+  }
+  image->pixels.assign(pixels, pixels + static_cast<size_t>(image->width) * image->height * 4);
+  stbi_image_free(pixels);
+  return true;
+}
+
+}  // namespace
+
+#if defined(WEB_GPU_APP_FETCH)
+// "loader" is reset when the loader is destroyed. Recursive: StartFetch holds it while the fetch
+// callbacks, which lock it too, may run synchronously.
+struct AssetLoader::FetchContext {
+  std::recursive_mutex mutex;
+  AssetLoader* loader = nullptr;
+};
+
+struct AssetLoader::Fetch {
+  std::shared_ptr<FetchContext> context;
+  std::shared_ptr<Request> request;
+};
+#endif
+
+AssetLoader::AssetLoader(uint32_t num_threads)
+    : thread_pool_(std::make_unique<ThreadPool>(num_threads)) {
+#if defined(WEB_GPU_APP_FETCH)
+  fetch_context_ = std::make_shared<FetchContext>();
+  fetch_context_->loader = this;
+#endif
+}
+
+AssetLoader::~AssetLoader() {
+  CancelAll();
+#if defined(WEB_GPU_APP_FETCH)
+  {
+    // StartFetch calls still queued on the main thread then drop their request.
+    std::lock_guard<std::recursive_mutex> context_lock(fetch_context_->mutex);
+    fetch_context_->loader = nullptr;
+    // Closing a fetch in flight aborts it without invoking its callbacks.
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [id, request] : requests_) {
+      if (request->fetch == nullptr) continue;
+      delete static_cast<Fetch*>(request->fetch->userData);
+      emscripten_fetch_close(request->fetch);
+      request->fetch = nullptr;
+    }
+  }
+#endif
+  // Joins the workers before the queues are destroyed.
+  thread_pool_.reset();
+}
+
+uint32_t AssetLoader::GetDefaultNumThreads() {
+  uint32_t num_threads = ThreadPool::GetDefaultNumThreads();
+  return num_threads > 0 ? std::max(1u, num_threads / 2) : 0;
+}
+
+AssetId AssetLoader::Load(const std::string& path, AssetType type, Callback callback,
+                          int priority) {
+  auto request = std::make_shared<Request>();
+  request->path = path;
+  request->type = type;
+  request->priority = priority;
+  request->callback = std::move(callback);
+  AssetId id;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    id = request->id = next_id_++;
+    requests_.emplace(request->id, request);
+  }
+#if defined(WEB_GPU_APP_FETCH)
+  // Files missing from Emscripten's file system, i.e. not preloaded, are fetched from the server.
+  std::error_code error;
+  if (!std::filesystem::exists(path, error)) {
+    request->fetched = true;
+    auto* fetch = new Fetch{fetch_context_, std::move(request)};
+#if defined(__EMSCRIPTEN_PTHREADS__)
+    if (!emscripten_is_main_runtime_thread()) {
+      emscripten_async_run_in_main_runtime_thread(
+          EM_FUNC_SIG_VI, reinterpret_cast<void*>(&AssetLoader::StartFetch), fetch);
+      return id;
+    }
+#endif
+    StartFetch(fetch);
+    return id;
+  }
+#endif
+  Enqueue(std::move(request));
+  return id;
+}
+
+void AssetLoader::Enqueue(std::shared_ptr<Request> request) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(std::move(request));
+    std::push_heap(queue_.begin(), queue_.end(), HasLowerPriority);
+  }
+  // Each task runs whichever request has the highest priority when a worker becomes free.
+  thread_pool_->Submit([this] { RunNext(); });
+}
+
+#if defined(WEB_GPU_APP_FETCH)
+void AssetLoader::StartFetch(void* fetch) {
+  auto* context = static_cast<Fetch*>(fetch);
+  // The callbacks may delete "context" before emscripten_fetch returns.
+  const std::shared_ptr<FetchContext> fetch_context = context->context;
+  const std::shared_ptr<Request> request = context->request;
+  std::lock_guard<std::recursive_mutex> context_lock(fetch_context->mutex);
+  AssetLoader* loader = fetch_context->loader;
+  if (loader == nullptr) {
+    delete context;
+    return;
+  }
+
+  emscripten_fetch_attr_t attributes;
+  emscripten_fetch_attr_init(&attributes);
+  std::strcpy(attributes.requestMethod, "GET");
+  attributes.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY;
+  attributes.userData = fetch;
+  attributes.onsuccess = attributes.onerror = [](emscripten_fetch_t* result) {
+    std::unique_ptr<Fetch> fetch(static_cast<Fetch*>(result->userData));
+    // The destructor closes the fetches in flight under this lock, so the loader is alive.
+    std::lock_guard<std::recursive_mutex> context_lock(fetch->context->mutex);
+    AssetLoader* loader = fetch->context->loader;
+    Request& request = *fetch->request;
+    if (result->status == 200) {
+      const auto* data = reinterpret_cast<const uint8_t*>(result->data);
+      request.fetched_bytes.assign(data, data + result->numBytes);
+    } else {
+      request.fetch_error = "Cannot fetch file: " + request.path + " (HTTP status " +
+                            std::to_string(result->status) + ")";
+    }
+    {
+      std::lock_guard<std::mutex> lock(loader->mutex_);
+      request.fetch = nullptr;
+      request.fetch_done = true;
+    }
+    emscripten_fetch_close(result);
+    loader->Enqueue(std::move(fetch->request));
+  };
+
+  // The callbacks run before emscripten_fetch returns when the request cannot be sent.
+  emscripten_fetch_t* result = emscripten_fetch(&attributes, request->path.c_str());
+  std::lock_guard<std::mutex> lock(loader->mutex_);
+  if (!request->fetch_done) request->fetch = result;
+}
+#endif
+
+bool AssetLoader::HasLowerPriority(const std::shared_ptr<Request>& a,
+                                   const std::shared_ptr<Request>& b) {
+  if (a->priority != b->priority) return a->priority < b->priority;
+  return a->id > b->id;
+}
+
+bool AssetLoader::Cancel(AssetId id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = requests_.find(id);
+  if (it == requests_.end()) return false;
+  it->second->cancelled = true;
+  return true;
+}
+
+void AssetLoader::CancelAll() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& [id, request] : requests_) request->cancelled = true;
+}
+
+void AssetLoader::SetCompletionNotifier(std::function<void()> notifier) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  completion_notifier_ = std::move(notifier);
+}
+
+void AssetLoader::RunNext() {
+  std::shared_ptr<Request> request;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::pop_heap(queue_.begin(), queue_.end(), HasLowerPriority);
+    request = std::move(queue_.back());
+    queue_.pop_back();
+  }
+
+  Asset asset;
+  asset.id = request->id;
+  asset.path = request->path;
+  asset.type = request->type;
+  const uint64_t begin_ns = Profiler::NowNs();
+  if (!request->cancelled) {
+    PROFILE_SCOPE("AssetLoader::LoadAsset");
+    LoadAsset(request.get(), &asset);
+  }
+  // Cancelling while loading drops the result.
+  if (request->cancelled) {
+    asset = {.id = request->id,
+             .path = request->path,
+             .type = request->type,
+             .status = AssetStatus::kCancelled};
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  stats_.load_ns += Profiler::NowNs() - begin_ns;
+  switch (asset.status) {
+    case AssetStatus::kLoaded:
+      ++stats_.num_loaded;
+      stats_.loaded_bytes += asset.file_size;
+      break;
+    case AssetStatus::kFailed:
+      ++stats_.num_failed;
+      break;
+    case AssetStatus::kCancelled:
+      ++stats_.num_cancelled;
+      break;
+  }
+  requests_.erase(request->id);
+  completions_.push_back({std::move(request), std::move(asset)});
+  if (requests_.empty()) idle_condition_.notify_all();
+  std::function<void()> notifier = completion_notifier_;
+  lock.unlock();
+  if (notifier) notifier();
+}
+
+void AssetLoader::LoadAsset(Request* request, Asset* asset) {
+  MappedFile file;
+  if (request->fetched) {
+    if (!request->fetch_error.empty()) {
+      asset->error = request->fetch_error;
+      return;
+    }
+    file.Assign(std::move(request->fetched_bytes));
+  } else if (!file.Open(request->path)) {
+    asset->error = "Cannot open file: " + request->path;
+    return;
+  }
+  asset->file_size = file.GetSize();
+
+  bool success = true;
+  switch (request->type) {
+    case AssetType::kBytes:
+      asset->bytes.assign(file.GetData().begin(), file.GetData().end());
+      break;
+    case AssetType::kObj:
+      success = ParseObj(file.GetData(), request->path, &asset->obj, &asset->error);
+      break;
+    case AssetType::kImage:
+      success = DecodeImage(file.GetData(), &asset->image, &asset->error);
+      break;
+    case AssetType::kMesh:
+      success = asset->mesh.Open(std::move(file), &asset->error);
+      // Reads the pages here rather than during the upload on the main thread.
+      if (success) asset->mesh.Prefetch();
+      break;
+    case AssetType::kTexture:
+      success = asset->texture.Open(std::move(file), &asset->error);
+      if (success) asset->texture.Prefetch();
+      break;
+  }
+  asset->status = success ? AssetStatus::kLoaded : AssetStatus::kFailed;
+}
+
+size_t AssetLoader::ProcessCompletions() {
+  std::vector<Completion> completions;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    completions.swap(completions_);
+  }
+  if (completions.empty()) return 0;
+
+  PROFILE_SCOPE("AssetLoader::ProcessCompletions");
+  for (Completion& completion : completions) {
+    if (completion.request->callback) completion.request->callback(completion.asset);
+  }
+  return completions.size();
+}
+
+void AssetLoader::WaitIdle() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_condition_.wait(lock, [this] { return requests_.empty(); });
+  }
+  ProcessCompletions();
+}
+
+size_t AssetLoader::GetNumPending() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return requests_.size();
+}
+
+AssetLoaderStats AssetLoader::GetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+}  // namespace web_gpu_app
@@ -0,0 +1,92 @@
+#include "web_gpu_app/bind_group_cache.h"
+
+#include "web_gpu_app/profiler.h"
+#include "web_gpu_app/utils.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+uint64_t HashKey(const wgpu::BindGroupLayout& layout,
+                 std::span<const wgpu::BindGroupEntry> entries) {
+  uint64_t hash = kFnvOffsetBasis;
+  HashValue(layout.Get(), &hash);
+  for (const wgpu::BindGroupEntry& entry : entries) {
+    HashValue(entry.binding, &hash);
+    HashValue(entry.buffer.Get(), &hash);
+    HashValue(entry.offset, &hash);
+    HashValue(entry.size, &hash);
+    HashValue(entry.sampler.Get(), &hash);
+    HashValue(entry.textureView.Get(), &hash);
+  }
+  return hash;
+}
+
+}  // namespace
+
+BindGroupCache::BindGroupCache(wgpu::Device device, uint32_t max_unused_frames)
+    : device_(device), max_unused_frames_(max_unused_frames) {}
+
+BindGroupCache::~BindGroupCache() {}
+
+bool BindGroupCache::Matches(const Entry& entry, const wgpu::BindGroupLayout& layout,
+                             std::span<const wgpu::BindGroupEntry> entries) {
+  if (entry.layout.Get() != layout.Get() || entry.entries.size() != entries.size()) return false;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const wgpu::BindGroupEntry& a = entry.entries[i];
+    const wgpu::BindGroupEntry& b = entries[i];
+    if (a.binding != b.binding || a.buffer.Get() != b.buffer.Get() || a.offset != b.offset ||
+        a.size != b.size || a.sampler.Get() != b.sampler.Get() ||
+        a.textureView.Get() != b.textureView.Get()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+wgpu::BindGroup BindGroupCache::Get(const wgpu::BindGroupLayout& layout,
+                                    std::span<const wgpu::BindGroupEntry> entries) {
+  std::vector<Entry>& bucket = buckets_[HashKey(layout, entries)];
+  for (Entry& entry : bucket) {
+    if (Matches(entry, layout, entries)) {
+      entry.last_used_frame = frame_;
+      ++stats_.num_reused;
+      return entry.bind_group;
+    }
+  }
+
+  PROFILE_SCOPE("BindGroupCache::Create");
+  wgpu::BindGroupDescriptor descriptor{
+      .layout = layout, .entryCount = entries.size(), .entries = entries.data()};
+  // The cached entries hold references to the layout and resources, so their handles cannot be
+  // reused by other objects while cached.
+  Entry& entry = bucket.emplace_back(Entry{.layout = layout,
+                                           .entries = {entries.begin(), entries.end()},
+                                           .bind_group = device_.CreateBindGroup(&descriptor),
+                                           .last_used_frame = frame_});
+  for (wgpu::BindGroupEntry& cached_entry : entry.entries) cached_entry.nextInChain = nullptr;
+  ++stats_.num_created;
+  ++stats_.size;
+  return entry.bind_group;
+}
+
+void BindGroupCache::BeginFrame() {
+  ++frame_;
+  for (auto it = buckets_.begin(); it != buckets_.end();) {
+    std::vector<Entry>& bucket = it->second;
+    const size_t num_evicted = std::erase_if(bucket, [this](const Entry& entry) {
+      return frame_ - entry.last_used_frame > max_unused_frames_;
+    });
+    stats_.num_evicted += num_evicted;
+    stats_.size -= num_evicted;
+    it = bucket.empty() ? buckets_.erase(it) : std::next(it);
+  }
+}
+
+void BindGroupCache::Clear() {
+  stats_.num_evicted += stats_.size;
+  stats_.size = 0;
+  buckets_.clear();
+}
+
+}  // namespace web_gpu_app
@@ -0,0 +1,199 @@
+#include "web_gpu_app/bvh.h"
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <glm/common.hpp>
+
+#include "web_gpu_app/profiler.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+constexpr uint32_t kNumBins = 16;
+
+struct Bin {
+  Aabb bounds;
+  uint32_t count = 0;
+};
+
+}  // namespace
+
+void Aabb::Grow(const Vec3& point) {
+  min = glm::min(min, point);
+  max = glm::max(max, point);
+}
+
+void Aabb::Grow(const Aabb& box) {
+  min = glm::min(min, box.min);
+  max = glm::max(max, box.max);
+}
+
+float Aabb::GetSurfaceArea() const {
+  if (IsEmpty()) return 0.f;
+  const Vec3 extent = max - min;
+  return 2.f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+Aabb TransformAabb(const Mat4& transform, const Aabb& box) {
+  if (box.IsEmpty()) return box;
+  const Vec3 center = Vec3(transform * Vec4(box.GetCenter(), 1.f));
+  const Vec3 half_extent = 0.5f * (box.max - box.min);
+  const Vec3 extent = glm::abs(Vec3(transform[0])) * half_extent.x +
+                      glm::abs(Vec3(transform[1])) * half_extent.y +
+                      glm::abs(Vec3(transform[2])) * half_extent.z;
+  return {.min = center - extent, .max = center + extent};
+}
+
+float IntersectAabb(const Vec3& origin, const Vec3& inverse_direction, const Vec3& box_min,
+                    const Vec3& box_max, float max_distance) {
+  const Vec3 t0 = (box_min - origin) * inverse_direction;
+  const Vec3 t1 = (box_max - origin) * inverse_direction;
+  const Vec3 t_min = glm::min(t0, t1);
+  const Vec3 t_max = glm::max(t0, t1);
+  const float enter = std::max(std::max(t_min.x, t_min.y), std::max(t_min.z, 0.f));
+  const float exit = std::min(std::min(t_max.x, t_max.y), std::min(t_max.z, max_distance));
+  return enter <= exit && enter < max_distance ? enter : std::numeric_limits<float>::infinity();
+}
+
+void Bvh::Build(std::span<const Aabb> boxes) {
+  PROFILE_SCOPE("Bvh::Build");
+  Clear();
+  if (boxes.empty()) return;
+  const uint32_t num_boxes = static_cast<uint32_t>(boxes.size());
+  indices_.resize(num_boxes);
+  centers_.resize(num_boxes);
+  for (uint32_t i = 0; i < num_boxes; ++i) {
+    indices_[i] = i;
+    centers_[i] = boxes[i].GetCenter();
+  }
+  nodes_.reserve(2 * (num_boxes / kMaxLeafSize + 1));
+  nodes_.push_back({.first = 0, .count = num_boxes});
+  Subdivide(boxes);
+}
+
+void Bvh::SetBounds(Node* node, std::span<const Aabb> boxes) const {
+  Aabb bounds;
+  if (node->count > 0) {
+    for (uint32_t i = node->first; i < node->first + node->count; ++i) {
+      bounds.Grow(boxes[indices_[i]]);
+    }
+  } else {
+    bounds.Grow({.min = nodes_[node->first].min, .max = nodes_[node->first].max});
+    bounds.Grow({.min = nodes_[node->first + 1].min, .max = nodes_[node->first + 1].max});
+  }
+  node->min = bounds.min;
+  node->max = bounds.max;
+}
+
+void Bvh::Subdivide(std::span<const Aabb> boxes) {
+  // Children are appended to nodes_ when their parent is split, so they follow it.
+  struct Task {
+    uint32_t node_index;
+    uint32_t depth;
+  };
+  std::vector<Task> tasks = {{0, 0}};
+  while (!tasks.empty()) {
+    const Task task = tasks.back();
+    tasks.pop_back();
+    Node& node = nodes_[task.node_index];
+    SetBounds(&node, boxes);
+    if (node.count <= kMaxLeafSize || task.depth + 1 >= kMaxDepth) continue;
+
+    Aabb center_bounds;
+    for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+      center_bounds.Grow(centers_[indices_[i]]);
+    }
+    // Bins the boxes along the three axes in a single pass, then picks the plane between bins
+    // with the lowest surface area heuristic cost.
+    const Vec3 extent = center_bounds.max - center_bounds.min;
+    Vec3 bin_scale(0.f);
+    for (int axis = 0; axis < 3; ++axis) {
+      if (extent[axis] > 0.f) bin_scale[axis] = kNumBins / extent[axis];
+    }
+    auto get_bin = [&](uint32_t index, int axis) {
+      const float bin = (centers_[index][axis] - center_bounds.min[axis]) * bin_scale[axis];
+      return std::min(kNumBins - 1, static_cast<uint32_t>(bin));
+    };
+    std::array<std::array<Bin, kNumBins>, 3> bins;
+    for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+      const uint32_t index = indices_[i];
+      for (int axis = 0; axis < 3; ++axis) {
+        Bin& bin = bins[axis][get_bin(index, axis)];
+        bin.bounds.Grow(boxes[index]);
+        ++bin.count;
+      }
+    }
+    float best_cost = std::numeric_limits<float>::infinity();
+    int best_axis = -1;
+    uint32_t best_split = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+      if (extent[axis] <= 0.f) continue;
+      std::array<float, kNumBins - 1> left_costs;
+      Aabb left;
+      uint32_t left_count = 0;
+      for (uint32_t split = 0; split + 1 < kNumBins; ++split) {
+        left.Grow(bins[axis][split].bounds);
+        left_count += bins[axis][split].count;
+        left_costs[split] = left_count * left.GetSurfaceArea();
+      }
+      Aabb right;
+      uint32_t right_count = 0;
+      for (uint32_t split = kNumBins - 1; split > 0; --split) {
+        right.Grow(bins[axis][split].bounds);
+        right_count += bins[axis][split].count;
+        if (right_count == 0 || right_count == node.count) continue;
+        const float cost = left_costs[split - 1] + right_count * right.GetSurfaceArea();
+        if (cost < best_cost) {
+          best_cost = cost;
+          best_axis = axis;
+          best_split = split;
+        }
+      }
+    }
+    // All centers coincide: the boxes cannot be separated.
+    if (best_axis < 0) continue;
+
+    uint32_t* begin = indices_.data() + node.first;
+    uint32_t* middle = std::partition(begin, begin + node.count, [&](uint32_t index) {
+      return get_bin(index, best_axis) < best_split;
+    });
+    const uint32_t left_count = static_cast<uint32_t>(middle - begin);
+    const uint32_t first = node.first;
+    const uint32_t count = node.count;
+    const uint32_t children = static_cast<uint32_t>(nodes_.size());
+    node.first = children;
+    node.count = 0;
+    // Invalidates "node".
+    nodes_.push_back({.first = first, .count = left_count});
+    nodes_.push_back({.first = first + left_count, .count = count - left_count});
+    tasks.push_back({children, task.depth + 1});
+    tasks.push_back({children + 1, task.depth + 1});
+  }
+}
+
+void Bvh::Refit(std::span<const Aabb> boxes) {
+  PROFILE_SCOPE("Bvh::Refit");
+  assert(boxes.size() == indices_.size());
+  for (size_t i = nodes_.size(); i-- > 0;) SetBounds(&nodes_[i], boxes);
+}
+
+void Bvh::Clear() {
+  nodes_.clear();
+  indices_.clear();
+}
+
+float Bvh::GetCost() const {
+  if (nodes_.empty()) return 0.f;
+  const float root_area = Aabb{.min = nodes_[0].min, .max = nodes_[0].max}.GetSurfaceArea();
+  if (root_area <= 0.f) return static_cast<float>(indices_.size());
+  float cost = 0.f;
+  for (const Node& node : nodes_) {
+    const float area = Aabb{.min = node.min, .max = node.max}.GetSurfaceArea();
+    cost += area * (node.count > 0 ? static_cast<float>(node.count) : 1.f);
+  }
+  return cost / root_area;
+}
+
+}  // namespace web_gpu_app
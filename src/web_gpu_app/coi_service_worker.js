@@ -0,0 +1,24 @@
+// Adds the cross-origin isolation headers that SharedArrayBuffer, hence pthreads, requires to the
+// responses of servers that cannot send them, e.g. `npx http-server`. Registered by
+// shell_threads.html.
+self.addEventListener("install", () => self.skipWaiting());
+self.addEventListener("activate", (event) => event.waitUntil(self.clients.claim()));
+
+self.addEventListener("fetch", (event) => {
+  const request = event.request;
+  if (request.cache === "only-if-cached" && request.mode !== "same-origin") return;
+  event.respondWith(fetch(request).then((response) => {
+    // Opaque responses cannot be modified.
+    if (response.status === 0) return response;
+    const headers = new Headers(response.headers);
+    headers.set("Cross-Origin-Opener-Policy", "same-origin");
+    headers.set("Cross-Origin-Embedder-Policy", "require-corp");
+    // Keeps the body streamed, and the content type with it, so that the module is still
+    // compiled while it downloads.
+    return new Response(response.body, {
+      status: response.status,
+      statusText: response.statusText,
+      headers: headers,
+    });
+  }));
+});
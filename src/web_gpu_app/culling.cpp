@@ -0,0 +1,249 @@
+#include "web_gpu_app/culling.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <glm/geometric.hpp>
+
+#include "web_gpu_app/thread_pool.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WEB_GPU_APP_CULLING_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+namespace web_gpu_app {
+
+namespace {
+
+// Below this many spheres per thread, splitting the work costs more than it saves.
+constexpr size_t kMinSpheresPerTask = 16 * 1024;
+
+bool IsSphereVisible(const Frustum& frustum, float x, float y, float z, float radius) {
+  for (const Vec4& plane : frustum.planes) {
+    if (plane.x * x + plane.y * y + plane.z * z + plane.w < -radius) return false;
+  }
+  return true;
+}
+
+void AppendVisibleIndices(uint32_t mask, size_t base, std::vector<uint32_t>* visible) {
+  while (mask != 0) {
+    visible->push_back(static_cast<uint32_t>(base + std::countr_zero(mask)));
+    mask &= mask - 1;
+  }
+}
+
+}  // namespace
+
+Frustum ExtractFrustum(const Mat4& view_projection) {
+  auto row = [&](int i) {
+    return Vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i],
+                view_projection[3][i]);
+  };
+  const Vec4 x = row(0);
+  const Vec4 y = row(1);
+  const Vec4 z = row(2);
+  const Vec4 w = row(3);
+
+  Frustum frustum = {{w + x, w - x, w + y, w - y, z, w - z}};
+  for (Vec4& plane : frustum.planes) {
+    float length = glm::length(Vec3(plane));
+    if (length > 0.f) plane /= length;
+  }
+  return frustum;
+}
+
+void BoundingSpheres::clear() {
+  x.clear();
+  y.clear();
+  z.clear();
+  radius.clear();
+}
+
+void BoundingSpheres::reserve(size_t capacity) {
+  x.reserve(capacity);
+  y.reserve(capacity);
+  z.reserve(capacity);
+  radius.reserve(capacity);
+}
+
+void BoundingSpheres::push_back(const Vec3& center, float sphere_radius) {
+  x.push_back(center.x);
+  y.push_back(center.y);
+  z.push_back(center.z);
+  radius.push_back(sphere_radius);
+}
+
+float GetMaxScale(const Mat4& transform) {
+  float max_squared_scale = std::max({glm::dot(Vec3(transform[0]), Vec3(transform[0])),
+                                      glm::dot(Vec3(transform[1]), Vec3(transform[1])),
+                                      glm::dot(Vec3(transform[2]), Vec3(transform[2]))});
+  return std::sqrt(max_squared_scale);
+}
+
+void AppendBounds(std::span<const Cube> cubes, BoundingSpheres* bounds) {
+  // Half the diagonal of a cube with an edge length of 1.
+  constexpr float kUnitCubeRadius = 0.8660254f;
+  for (const Cube& cube : cubes) {
+    bounds->push_back(Vec3(cube.transform[3]),
+                      kUnitCubeRadius * cube.size * GetMaxScale(cube.transform));
+  }
+}
+
+void AppendBounds(std::span<const Sphere> spheres, BoundingSpheres* bounds) {
+  for (const Sphere& sphere : spheres) {
+    bounds->push_back(Vec3(sphere.transform[3]), sphere.radius * GetMaxScale(sphere.transform));
+  }
+}
+
+size_t CullSpheresScalar(const Frustum& frustum, const BoundingSpheres& bounds, size_t begin,
+                         size_t end, std::vector<uint32_t>* visible) {
+  size_t num_visible = visible->size();
+  for (size_t i = begin; i < end; ++i) {
+    if (IsSphereVisible(frustum, bounds.x[i], bounds.y[i], bounds.z[i], bounds.radius[i])) {
+      visible->push_back(static_cast<uint32_t>(i));
+    }
+  }
+  return visible->size() - num_visible;
+}
+
+size_t CullSpheresSimd(const Frustum& frustum, const BoundingSpheres& bounds, size_t begin,
+                       size_t end, std::vector<uint32_t>* visible) {
+  const size_t num_visible = visible->size();
+  const float* xs = bounds.x.data();
+  const float* ys = bounds.y.data();
+  const float* zs = bounds.z.data();
+  const float* radii = bounds.radius.data();
+  size_t i = begin;
+
+#if defined(__AVX2__)
+  __m256 planes[6][4];
+  for (int p = 0; p < 6; ++p) {
+    for (int c = 0; c < 4; ++c) planes[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+  }
+  for (; i + 8 <= end; i += 8) {
+    __m256 x = _mm256_loadu_ps(xs + i);
+    __m256 y = _mm256_loadu_ps(ys + i);
+    __m256 z = _mm256_loadu_ps(zs + i);
+    __m256 negative_radius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radii + i));
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (int p = 0; p < 6; ++p) {
+      __m256 distance = _mm256_fmadd_ps(
+          planes[p][0], x,
+          _mm256_fmadd_ps(planes[p][1], y, _mm256_fmadd_ps(planes[p][2], z, planes[p][3])));
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negative_radius, _CMP_GE_OQ));
+    }
+    AppendVisibleIndices(static_cast<uint32_t>(_mm256_movemask_ps(inside)), i, visible);
+  }
+#elif defined(WEB_GPU_APP_CULLING_SSE2)
+  __m128 planes[6][4];
+  for (int p = 0; p < 6; ++p) {
+    for (int c = 0; c < 4; ++c) planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+  }
+  for (; i + 4 <= end; i += 4) {
+    __m128 x = _mm_loadu_ps(xs + i);
+    __m128 y = _mm_loadu_ps(ys + i);
+    __m128 z = _mm_loadu_ps(zs + i);
+    __m128 negative_radius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radii + i));
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int p = 0; p < 6; ++p) {
+      __m128 distance = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)),
+          _mm_add_ps(_mm_mul_ps(planes[p][2], z), planes[p][3]));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negative_radius));
+    }
+    AppendVisibleIndices(static_cast<uint32_t>(_mm_movemask_ps(inside)), i, visible);
+  }
+#elif defined(__ARM_NEON)
+  float32x4_t planes[6][4];
+  for (int p = 0; p < 6; ++p) {
+    for (int c = 0; c < 4; ++c) planes[p][c] = vdupq_n_f32(frustum.planes[p][c]);
+  }
+  const uint32x4_t lane_bits = {1, 2, 4, 8};
+  for (; i + 4 <= end; i += 4) {
+    float32x4_t x = vld1q_f32(xs + i);
+    float32x4_t y = vld1q_f32(ys + i);
+    float32x4_t z = vld1q_f32(zs + i);
+    float32x4_t negative_radius = vnegq_f32(vld1q_f32(radii + i));
+    uint32x4_t inside = vdupq_n_u32(~0u);
+    for (int p = 0; p < 6; ++p) {
+      float32x4_t distance = vmlaq_f32(
+          vmlaq_f32(vmlaq_f32(planes[p][3], planes[p][2], z), planes[p][1], y), planes[p][0], x);
+      inside = vandq_u32(inside, vcgeq_f32(distance, negative_radius));
+    }
+    AppendVisibleIndices(vaddvq_u32(vandq_u32(inside, lane_bits)), i, visible);
+  }
+#elif defined(__wasm_simd128__)
+  v128_t planes[6][4];
+  for (int p = 0; p < 6; ++p) {
+    for (int c = 0; c < 4; ++c) planes[p][c] = wasm_f32x4_splat(frustum.planes[p][c]);
+  }
+  for (; i + 4 <= end; i += 4) {
+    v128_t x = wasm_v128_load(xs + i);
+    v128_t y = wasm_v128_load(ys + i);
+    v128_t z = wasm_v128_load(zs + i);
+    v128_t negative_radius = wasm_f32x4_neg(wasm_v128_load(radii + i));
+    v128_t inside = wasm_i32x4_splat(-1);
+    for (int p = 0; p < 6; ++p) {
+      v128_t distance = wasm_f32x4_add(
+          wasm_f32x4_add(wasm_f32x4_mul(planes[p][0], x), wasm_f32x4_mul(planes[p][1], y)),
+          wasm_f32x4_add(wasm_f32x4_mul(planes[p][2], z), planes[p][3]));
+      inside = wasm_v128_and(inside, wasm_f32x4_ge(distance, negative_radius));
+    }
+    AppendVisibleIndices(wasm_i32x4_bitmask(inside), i, visible);
+  }
+#endif
+
+  CullSpheresScalar(frustum, bounds, i, end, visible);
+  return visible->size() - num_visible;
+}
+
+const char* GetCullingSimdName() {
+#if defined(__AVX2__)
+  return "AVX2";
+#elif defined(WEB_GPU_APP_CULLING_SSE2)
+  return "SSE2";
+#elif defined(__ARM_NEON)
+  return "NEON";
+#elif defined(__wasm_simd128__)
+  return "WASM SIMD";
+#else
+  return "Scalar";
+#endif
+}
+
+void CullSpheres(const Frustum& frustum, const BoundingSpheres& bounds,
+                 std::vector<uint32_t>* visible, ThreadPool* thread_pool) {
+  visible->clear();
+  const size_t count = bounds.size();
+  if (thread_pool == nullptr || count < 2 * kMinSpheresPerTask) {
+    visible->reserve(count);
+    CullSpheresSimd(frustum, bounds, 0, count, visible);
+    return;
+  }
+
+  // Each chunk compacts into its own list, which are then concatenated in order.
+  std::vector<std::vector<uint32_t>> chunk_visible(thread_pool->GetNumThreads() + 1);
+  size_t num_chunks = thread_pool->ParallelFor(
+      count, kMinSpheresPerTask, [&](size_t begin, size_t end, size_t chunk_index) {
+        std::vector<uint32_t>& chunk = chunk_visible[chunk_index];
+        chunk.clear();
+        chunk.reserve(end - begin);
+        CullSpheresSimd(frustum, bounds, begin, end, &chunk);
+      });
+
+  size_t num_visible = 0;
+  for (size_t chunk = 0; chunk < num_chunks; ++chunk) num_visible += chunk_visible[chunk].size();
+  visible->reserve(num_visible);
+  for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+    visible->insert(visible->end(), chunk_visible[chunk].begin(), chunk_visible[chunk].end());
+  }
+}
+
+}  // namespace web_gpu_app
@@ -0,0 +1,113 @@
+#include "web_gpu_app/draw_sort.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <functional>
+
+#include "web_gpu_app/thread_pool.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+constexpr uint32_t kDepthBits = 24;
+constexpr uint32_t kMaxDepth = (1u << kDepthBits) - 1;
+constexpr size_t kRadixBits = 8;
+constexpr size_t kRadixSize = size_t{1} << kRadixBits;
+constexpr size_t kNumDigits = sizeof(DrawKey) * 8 / kRadixBits;
+// Below this many items, the histograms cost more than a comparison sort.
+constexpr size_t kMinRadixSortItems = 64;
+// Below this many items per thread, splitting a pass costs more than it saves.
+constexpr size_t kMinItemsPerTask = 16 * 1024;
+
+DrawKey MakePassKey(uint32_t pass, bool translucent) {
+  return DrawKey{pass % kMaxDrawPasses} << 62 | DrawKey{translucent} << 61;
+}
+
+}  // namespace
+
+uint32_t QuantizeDrawDepth(float depth) {
+  // The bits of positive floats are ordered like their values.
+  if (!(depth > 0.f)) return 0;
+  return std::bit_cast<uint32_t>(depth) >> (31 - kDepthBits);
+}
+
+DrawKey MakeOpaqueDrawKey(uint32_t pass, const DrawState& state, float depth) {
+  return MakePassKey(pass, false) | DrawKey{state.pipeline % kMaxDrawPipelines} << 56 |
+         DrawKey{state.bind_group % kMaxDrawBindGroups} << 40 |
+         DrawKey{state.geometry % kMaxDrawGeometries} << 24 | QuantizeDrawDepth(depth);
+}
+
+DrawKey MakeTranslucentDrawKey(uint32_t pass, const DrawState& state, float depth) {
+  return MakePassKey(pass, true) | DrawKey{kMaxDepth - QuantizeDrawDepth(depth)} << 37 |
+         DrawKey{state.pipeline % kMaxDrawPipelines} << 32 |
+         DrawKey{state.bind_group % kMaxDrawBindGroups} << 16;
+}
+
+bool IsTranslucentDrawKey(DrawKey key) { return (key >> 61 & 1) != 0; }
+
+void RadixSortDrawItems(std::span<DrawItem> items, std::vector<DrawItem>* scratch,
+                        ThreadPool* thread_pool) {
+  const size_t count = items.size();
+  if (count < kMinRadixSortItems) {
+    std::stable_sort(items.begin(), items.end(),
+                     [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+    return;
+  }
+  scratch->resize(count);
+
+  // Chunk boundaries only depend on the count, so each chunk scatters the items it counted.
+  const size_t max_chunks = thread_pool != nullptr ? thread_pool->GetNumThreads() + 1 : 1;
+  auto for_each_chunk =
+      [&](const std::function<void(size_t begin, size_t end, size_t chunk_index)>& function) {
+        if (thread_pool == nullptr) {
+          function(0, count, 0);
+          return size_t{1};
+        }
+        return thread_pool->ParallelFor(count, kMinItemsPerTask, function);
+      };
+
+  // Bits that differ between the items: digits without any are already sorted.
+  std::vector<DrawKey> chunk_differences(max_chunks, 0);
+  const DrawKey first_key = items[0].key;
+  size_t num_chunks = for_each_chunk([&](size_t begin, size_t end, size_t chunk_index) {
+    DrawKey differences = 0;
+    for (size_t i = begin; i < end; ++i) differences |= items[i].key ^ first_key;
+    chunk_differences[chunk_index] = differences;
+  });
+  DrawKey differences = 0;
+  for (size_t chunk = 0; chunk < num_chunks; ++chunk) differences |= chunk_differences[chunk];
+
+  std::vector<std::array<uint32_t, kRadixSize>> histograms(max_chunks);
+  DrawItem* source = items.data();
+  DrawItem* destination = scratch->data();
+  for (size_t digit = 0; digit < kNumDigits; ++digit) {
+    const uint32_t shift = static_cast<uint32_t>(digit * kRadixBits);
+    if ((differences >> shift & (kRadixSize - 1)) == 0) continue;
+    num_chunks = for_each_chunk([&](size_t begin, size_t end, size_t chunk_index) {
+      std::array<uint32_t, kRadixSize>& histogram = histograms[chunk_index];
+      histogram.fill(0);
+      for (size_t i = begin; i < end; ++i) ++histogram[source[i].key >> shift & (kRadixSize - 1)];
+    });
+    // Bucket offsets, ordered by value then chunk so that equal keys keep their order.
+    uint32_t offset = 0;
+    for (size_t value = 0; value < kRadixSize; ++value) {
+      for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+        const uint32_t bucket_size = histograms[chunk][value];
+        histograms[chunk][value] = offset;
+        offset += bucket_size;
+      }
+    }
+    for_each_chunk([&](size_t begin, size_t end, size_t chunk_index) {
+      std::array<uint32_t, kRadixSize>& offsets = histograms[chunk_index];
+      for (size_t i = begin; i < end; ++i) {
+        destination[offsets[source[i].key >> shift & (kRadixSize - 1)]++] = source[i];
+      }
+    });
+    std::swap(source, destination);
+  }
+  if (source != items.data()) std::copy(source, source + count, items.data());
+}
+
+}  // namespace web_gpu_app
@@ -0,0 +1,89 @@
+#include "web_gpu_app/frame_arena.h"
+
+#include <algorithm>
+#include <bit>
+#include <new>
+
+namespace web_gpu_app {
+
+FrameArena::FrameArena(size_t initial_size) {
+  blocks_.push_back(AllocateBlock(std::max(initial_size, kMaxAlignment)));
+}
+
+FrameArena::~FrameArena() {
+  Reset();
+  for (const Block& block : blocks_) FreeBlock(block);
+}
+
+void* FrameArena::AllocateBytes(size_t size, size_t alignment) {
+  ++stats_.num_allocations;
+  size_t offset = (head_ + alignment - 1) & ~(alignment - 1);
+  if (offset + size > blocks_.back().size) {
+    // Keeps the current blocks alive: previous allocations of the frame may still be in use.
+    ++stats_.num_overflows;
+    blocks_.push_back(AllocateBlock(std::max(size, blocks_.back().size)));
+    offset = 0;
+  }
+  head_ = offset + size;
+  stats_.bytes_allocated += size;
+  stats_.high_water_mark = std::max(stats_.high_water_mark, stats_.bytes_allocated);
+  return static_cast<std::byte*>(blocks_.back().data) + offset;
+}
+
+void FrameArena::Reset() {
+  // In reverse order, like the destruction of local variables.
+  for (auto it = destructors_.rbegin(); it != destructors_.rend(); ++it) {
+    it->destroy(it->data, it->count);
+  }
+  destructors_.clear();
+
+  if (blocks_.size() > 1) {
+    // Replaces the overflowed blocks with one that fits the whole frame.
+    size_t total_size = 0;
+    for (const Block& block : blocks_) {
+      total_size += block.size;
+      FreeBlock(block);
+    }
+    blocks_.clear();
+    blocks_.push_back(AllocateBlock(std::bit_ceil(total_size)));
+  }
+  head_ = 0;
+  stats_.bytes_allocated = 0;
+  stats_.num_allocations = 0;
+
+  std::lock_guard<std::mutex> lock(sub_arenas_mutex_);
+  for (const std::unique_ptr<FrameArena>& sub_arena : sub_arenas_) {
+    if (sub_arena) sub_arena->Reset();
+  }
+}
+
+FrameArena* FrameArena::GetSubArena(size_t index) {
+  std::lock_guard<std::mutex> lock(sub_arenas_mutex_);
+  if (index >= sub_arenas_.size()) sub_arenas_.resize(index + 1);
+  if (!sub_arenas_[index]) sub_arenas_[index] = std::make_unique<FrameArena>(blocks_[0].size);
+  return sub_arenas_[index].get();
+}
+
+FrameArenaStats FrameArena::GetStats() {
+  FrameArenaStats stats = stats_;
+  std::lock_guard<std::mutex> lock(sub_arenas_mutex_);
+  for (const std::unique_ptr<FrameArena>& sub_arena : sub_arenas_) {
+    if (!sub_arena) continue;
+    const FrameArenaStats sub_stats = sub_arena->GetStats();
+    stats.bytes_allocated += sub_stats.bytes_allocated;
+    stats.num_allocations += sub_stats.num_allocations;
+    stats.high_water_mark += sub_stats.high_water_mark;
+    stats.num_overflows += sub_stats.num_overflows;
+  }
+  return stats;
+}
+
+FrameArena::Block FrameArena::AllocateBlock(size_t size) {
+  return {::operator new(size, std::align_val_t{kMaxAlignment}), size};
+}
+
+void FrameArena::FreeBlock(const Block& block) {
+  ::operator delete(block.data, std::align_val_t{kMaxAlignment});
+}
+
+}  // namespace web_gpu_app
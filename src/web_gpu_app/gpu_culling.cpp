@@ -0,0 +1,244 @@
+#include "web_gpu_app/gpu_culling.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <glm/geometric.hpp>
+
+#include "web_gpu_app/instance_packing.h"
+#include "web_gpu_app/profiler.h"
+#include "web_gpu_app/web_gpu_utils.h"
+
+namespace web_gpu_app {
+
+static_assert(sizeof(DrawIndexedIndirectArgs) == 20, "DrawIndexedIndirectArgs must be packed");
+
+namespace {
+
+constexpr uint32_t kWorkgroupSize = 64;
+constexpr uint32_t kMaxWorkgroupsPerDimension = 65535;
+
+// Matches the Params struct of the shader.
+struct CullParams {
+  Vec4 planes[6];
+  uint32_t num_instances = 0;
+  uint32_t num_batches = 0;
+  uint32_t padding[2] = {};
+};
+
+const char* cull_shader_code = R"(
+struct Params {
+    planes : array<vec4f, 6>,
+    num_instances : u32,
+    num_batches : u32,
+}
+// PackedInstance.
+struct Instance {
+    model : array<f32, 12>,
+    color : u32,
+    texture_layer : u32,
+}
+struct Batch {
+    center : vec3f,
+    radius : f32,
+    first_instance : u32,
+}
+struct DrawArgs {
+    index_count : u32,
+    instance_count : atomic<u32>,
+    first_index : u32,
+    base_vertex : i32,
+    first_instance : u32,
+}
+@group(0) @binding(0) var<uniform> params : Params;
+@group(0) @binding(1) var<storage, read> instances : array<Instance>;
+@group(0) @binding(2) var<storage, read> batches : array<Batch>;
+@group(0) @binding(3) var<storage, read_write> draws : array<DrawArgs>;
+@group(0) @binding(4) var<storage, read_write> visible_instances : array<Instance>;
+
+@compute @workgroup_size(64)
+fn cull(@builtin(global_invocation_id) id : vec3u,
+        @builtin(num_workgroups) num_workgroups : vec3u) {
+    let index = id.y * num_workgroups.x * 64 + id.x;
+    if (index >= params.num_instances) {
+        return;
+    }
+    // Last batch starting at or before the instance.
+    var low = 0u;
+    var high = params.num_batches;
+    while (high - low > 1) {
+        let middle = (low + high) / 2;
+        if (batches[middle].first_instance <= index) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    let batch = batches[low];
+    let instance = instances[index];
+    let m = instance.model;
+    let x = vec3f(m[0], m[1], m[2]);
+    let y = vec3f(m[3], m[4], m[5]);
+    let z = vec3f(m[6], m[7], m[8]);
+    let center = x * batch.center.x + y * batch.center.y + z * batch.center.z +
+                 vec3f(m[9], m[10], m[11]);
+    let radius = batch.radius * sqrt(max(dot(x, x), max(dot(y, y), dot(z, z))));
+    for (var i = 0; i < 6; i++) {
+        let plane = params.planes[i];
+        if (dot(plane.xyz, center) + plane.w < -radius) {
+            return;
+        }
+    }
+    let slot = atomicAdd(&draws[low].instance_count, 1u);
+    visible_instances[batch.first_instance + slot] = instance;
+}
+)";
+
+}  // namespace
+
+GpuCulling::GpuCulling(wgpu::Device device, PipelineCache* pipeline_cache) : device_(device) {
+  params_buffer_ = CreateBuffer(device_, wgpu::BufferUsage::Uniform, sizeof(CullParams));
+  wgpu::ComputePipelineDescriptor descriptor{
+      .compute = {.module = pipeline_cache->GetShaderModule(cull_shader_code),
+                  .entryPoint = "cull"}};
+  pipeline_cache->GetComputePipeline(
+      descriptor, [this](wgpu::ComputePipeline pipeline) { pipeline_ = pipeline; });
+}
+
+GpuCulling::~GpuCulling() {}
+
+void GpuCulling::Reserve(uint64_t num_instances, uint64_t num_batches) {
+  if (num_instances > instance_capacity_) {
+    instance_capacity_ = std::bit_ceil(std::max<uint64_t>(num_instances, 1024));
+    instance_buffer_ =
+        CreateBuffer(device_, wgpu::BufferUsage::Vertex | wgpu::BufferUsage::Storage,
+                     instance_capacity_ * sizeof(PackedInstance));
+    ++stats_.num_buffer_grows;
+  }
+  if (num_batches > batch_capacity_) {
+    batch_capacity_ = std::bit_ceil(std::max<uint64_t>(num_batches, 64));
+    batch_buffer_ =
+        CreateBuffer(device_, wgpu::BufferUsage::Storage, batch_capacity_ * sizeof(BatchData));
+    draw_buffer_ = CreateBuffer(device_,
+                                wgpu::BufferUsage::Storage | wgpu::BufferUsage::Indirect |
+                                    wgpu::BufferUsage::CopySrc,
+                                batch_capacity_ * sizeof(DrawIndexedIndirectArgs));
+    readback_buffer_ = CreateBuffer(device_, wgpu::BufferUsage::MapRead,
+                                    batch_capacity_ * sizeof(DrawIndexedIndirectArgs));
+    ++stats_.num_buffer_grows;
+  }
+}
+
+void GpuCulling::Cull(wgpu::CommandEncoder encoder, const Frustum& frustum,
+                      const UploadAllocation& instances, std::span<const GpuCullBatch> batches) {
+  num_readback_batches_ = 0;
+  const uint64_t num_instances = instances.size / sizeof(PackedInstance);
+  if (!pipeline_ || num_instances == 0 || batches.empty()) return;
+  PROFILE_SCOPE("GpuCulling::Cull");
+  Reserve(num_instances, batches.size());
+
+  CullParams params;
+  std::memcpy(params.planes, frustum.planes, sizeof(params.planes));
+  params.num_instances = static_cast<uint32_t>(num_instances);
+  params.num_batches = static_cast<uint32_t>(batches.size());
+  wgpu::Queue queue = device_.GetQueue();
+  queue.WriteBuffer(params_buffer_, 0, &params, sizeof(params));
+
+  // The instance counts start at 0 and are incremented by the shader. The first instances stay 0:
+  // non-zero ones need the indirect-first-instance feature, the draws offset the vertex buffer
+  // instead.
+  batch_data_.resize(batches.size());
+  draw_args_.resize(batches.size());
+  for (size_t i = 0; i < batches.size(); ++i) {
+    const GpuCullBatch& batch = batches[i];
+    batch_data_[i] = {.center = {batch.bounds.center.x, batch.bounds.center.y,
+                                 batch.bounds.center.z},
+                      .radius = batch.bounds.radius,
+                      .first_instance = batch.first_instance};
+    draw_args_[i] = {.index_count = batch.index_count, .first_index = batch.first_index};
+  }
+  queue.WriteBuffer(batch_buffer_, 0, batch_data_.data(), batch_data_.size() * sizeof(BatchData));
+  queue.WriteBuffer(draw_buffer_, 0, draw_args_.data(),
+                    draw_args_.size() * sizeof(DrawIndexedIndirectArgs));
+
+  wgpu::BindGroupEntry entries[] = {
+      {.binding = 0, .buffer = params_buffer_, .size = sizeof(CullParams)},
+      {.binding = 1, .buffer = instances.buffer, .offset = instances.offset,
+       .size = instances.size},
+      {.binding = 2, .buffer = batch_buffer_, .size = batches.size() * sizeof(BatchData)},
+      {.binding = 3,
+       .buffer = draw_buffer_,
+       .size = batches.size() * sizeof(DrawIndexedIndirectArgs)},
+      {.binding = 4, .buffer = instance_buffer_, .size = instances.size},
+  };
+  wgpu::BindGroupDescriptor bind_group_descriptor{.layout = pipeline_.GetBindGroupLayout(0),
+                                                  .entryCount = std::size(entries),
+                                                  .entries = entries};
+  const uint32_t num_workgroups =
+      static_cast<uint32_t>((num_instances + kWorkgroupSize - 1) / kWorkgroupSize);
+  const uint32_t num_workgroups_x = std::min(num_workgroups, kMaxWorkgroupsPerDimension);
+  wgpu::ComputePassEncoder pass = encoder.BeginComputePass();
+  pass.SetPipeline(pipeline_);
+  pass.SetBindGroup(0, device_.CreateBindGroup(&bind_group_descriptor));
+  pass.DispatchWorkgroups(num_workgroups_x,
+                          (num_workgroups + num_workgroups_x - 1) / num_workgroups_x);
+  pass.End();
+  ++stats_.num_dispatches;
+  stats_.num_instances += num_instances;
+  stats_.num_batches += batches.size();
+
+  if (validation_enabled_) {
+    encoder.CopyBufferToBuffer(draw_buffer_, 0, readback_buffer_, 0,
+                               batches.size() * sizeof(DrawIndexedIndirectArgs));
+    num_readback_batches_ = static_cast<uint32_t>(batches.size());
+    ComputeExpectedCounts(frustum, instances, batches);
+  }
+}
+
+void GpuCulling::ComputeExpectedCounts(const Frustum& frustum, const UploadAllocation& instances,
+                                       std::span<const GpuCullBatch> batches) {
+  expected_counts_.assign(batches.size(), 0);
+  const PackedInstance* packed = static_cast<const PackedInstance*>(instances.data);
+  if (packed == nullptr) return;
+  for (size_t i = 0; i < batches.size(); ++i) {
+    const GpuCullBatch& batch = batches[i];
+    validation_bounds_.clear();
+    for (uint32_t j = 0; j < batch.num_instances; ++j) {
+      const float* m = packed[batch.first_instance + j].model;
+      const Vec3 x(m[0], m[1], m[2]);
+      const Vec3 y(m[3], m[4], m[5]);
+      const Vec3 z(m[6], m[7], m[8]);
+      const Vec3 center = x * batch.bounds.center.x + y * batch.bounds.center.y +
+                          z * batch.bounds.center.z + Vec3(m[9], m[10], m[11]);
+      const float scale =
+          std::sqrt(std::max({glm::dot(x, x), glm::dot(y, y), glm::dot(z, z)}));
+      validation_bounds_.push_back(center, batch.bounds.radius * scale);
+    }
+    CullSpheres(frustum, validation_bounds_, &validation_visible_);
+    expected_counts_[i] = static_cast<uint32_t>(validation_visible_.size());
+  }
+}
+
+std::vector<uint32_t> GpuCulling::ReadInstanceCounts() {
+  if (num_readback_batches_ == 0) return {};
+  const uint64_t size = num_readback_batches_ * sizeof(DrawIndexedIndirectArgs);
+  bool mapped = false;
+  readback_buffer_.MapAsync(
+      wgpu::MapMode::Read, 0, size,
+      [](WGPUBufferMapAsyncStatus status, void* user_data) {
+        *reinterpret_cast<bool*>(user_data) = true;
+      },
+      &mapped);
+  WaitUntil(device_, [&mapped] { return mapped; });
+
+  const auto* args =
+      static_cast<const DrawIndexedIndirectArgs*>(readback_buffer_.GetConstMappedRange(0, size));
+  if (args == nullptr) return {};
+  std::vector<uint32_t> counts(num_readback_batches_);
+  for (uint32_t i = 0; i < num_readback_batches_; ++i) counts[i] = args[i].instance_count;
+  readback_buffer_.Unmap();
+  return counts;
+}
+
+}  // namespace web_gpu_app
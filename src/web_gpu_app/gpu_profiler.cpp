@@ -0,0 +1,115 @@
+#include "web_gpu_app/gpu_profiler.h"
+
+#include <algorithm>
+
+#include "web_gpu_app/profiler.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+constexpr uint64_t kQueryBufferSize = 2 * GpuProfiler::kMaxPassesPerFrame * sizeof(uint64_t);
+
+}  // namespace
+
+GpuProfiler::GpuProfiler(wgpu::Device device)
+    : device_(device), supported_(device.HasFeature(wgpu::FeatureName::TimestampQuery)) {
+  if (!supported_) return;
+
+  for (uint32_t i = 0; i < kNumFramesInFlight; ++i) {
+    auto frame = std::make_shared<Frame>();
+    wgpu::QuerySetDescriptor query_set_descriptor{.type = wgpu::QueryType::Timestamp,
+                                                  .count = 2 * kMaxPassesPerFrame};
+    frame->query_set = device_.CreateQuerySet(&query_set_descriptor);
+    wgpu::BufferDescriptor resolve_descriptor{
+        .usage = wgpu::BufferUsage::QueryResolve | wgpu::BufferUsage::CopySrc,
+        .size = kQueryBufferSize};
+    frame->resolve_buffer = device_.CreateBuffer(&resolve_descriptor);
+    wgpu::BufferDescriptor readback_descriptor{
+        .usage = wgpu::BufferUsage::MapRead | wgpu::BufferUsage::CopyDst,
+        .size = kQueryBufferSize};
+    frame->readback_buffer = device_.CreateBuffer(&readback_descriptor);
+    frame->timestamp_writes.reserve(kMaxPassesPerFrame);
+    frames_.push_back(std::move(frame));
+  }
+}
+
+GpuProfiler::~GpuProfiler() {
+  // Cancels the pending maps, whose callbacks still own their frame.
+  for (const std::shared_ptr<Frame>& frame : frames_) {
+    if (frame->mapping) frame->readback_buffer.Unmap();
+  }
+}
+
+const wgpu::RenderPassTimestampWrites* GpuProfiler::BeginPass(const char* name) {
+  if (!supported_ || !Profiler::IsEnabled()) return nullptr;
+
+  Frame& frame = *frames_[frame_index_];
+  if (frame.mapping || frame.pass_names.size() >= kMaxPassesPerFrame) return nullptr;
+
+  uint32_t query_index = 2 * static_cast<uint32_t>(frame.pass_names.size());
+  frame.pass_names.push_back(name);
+  frame.timestamp_writes.push_back({.querySet = frame.query_set,
+                                    .beginningOfPassWriteIndex = query_index,
+                                    .endOfPassWriteIndex = query_index + 1});
+  return &frame.timestamp_writes.back();
+}
+
+void GpuProfiler::Resolve(wgpu::CommandEncoder encoder) {
+  if (!supported_) return;
+
+  Frame& frame = *frames_[frame_index_];
+  if (frame.mapping || frame.pass_names.empty()) return;
+
+  uint32_t num_queries = 2 * static_cast<uint32_t>(frame.pass_names.size());
+  encoder.ResolveQuerySet(frame.query_set, 0, num_queries, frame.resolve_buffer, 0);
+  encoder.CopyBufferToBuffer(frame.resolve_buffer, 0, frame.readback_buffer, 0,
+                             num_queries * sizeof(uint64_t));
+  frame.resolved = true;
+}
+
+void GpuProfiler::EndFrame() {
+  if (!supported_) return;
+
+  const std::shared_ptr<Frame>& frame_pointer = frames_[frame_index_];
+  Frame& frame = *frame_pointer;
+  frame_index_ = (frame_index_ + 1) % kNumFramesInFlight;
+  if (!frame.resolved) {
+    if (!frame.mapping) {
+      frame.pass_names.clear();
+      frame.timestamp_writes.clear();
+    }
+    return;
+  }
+
+  frame.resolved = false;
+  frame.mapping = true;
+  frame.submit_ns = Profiler::NowNs();
+  frame.readback_buffer.MapAsync(wgpu::MapMode::Read, 0, kQueryBufferSize, OnReadbackMapped,
+                                 new std::shared_ptr<Frame>(frame_pointer));
+}
+
+void GpuProfiler::OnReadbackMapped(WGPUBufferMapAsyncStatus status, void* user_data) {
+  const std::unique_ptr<std::shared_ptr<Frame>> frame_pointer(
+      static_cast<std::shared_ptr<Frame>*>(user_data));
+  Frame& frame = **frame_pointer;
+  if (status == WGPUBufferMapAsyncStatus_Success) {
+    const uint64_t* timestamps = static_cast<const uint64_t*>(
+        frame.readback_buffer.GetConstMappedRange(0, kQueryBufferSize));
+    // GPU timestamps use their own time base: place the passes relative to the submit time.
+    const uint64_t base_timestamp = timestamps[0];
+    for (size_t i = 0; i < frame.pass_names.size(); ++i) {
+      uint64_t begin = timestamps[2 * i];
+      uint64_t end = std::max(begin, timestamps[2 * i + 1]);
+      Profiler::Get().AddGpuEvent(frame.pass_names[i],
+                                  frame.submit_ns + (begin - base_timestamp),
+                                  frame.submit_ns + (end - base_timestamp));
+    }
+    frame.readback_buffer.Unmap();
+  }
+  frame.pass_names.clear();
+  frame.timestamp_writes.clear();
+  frame.mapping = false;
+}
+
+}  // namespace web_gpu_app
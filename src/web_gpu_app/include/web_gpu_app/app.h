@@ -1,23 +1,96 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <future>
 #include <memory>
+#include <string>
 
 #include "renderer.h"
+#include "web_gpu_app/asset_loader.h"
+#include "web_gpu_app/frame_arena.h"
+#include "web_gpu_app/picking.h"
+#include "web_gpu_app/thread_pool.h"
 
 struct GLFWwindow;
 struct EmscriptenUiEvent;
 
 namespace web_gpu_app {
 
+struct FramePacing {
+  // Duration in seconds of the FixedUpdate steps, decoupled from the frame rate. 0 disables them.
+  double fixed_timestep = 0;
+  // Steps run per frame at most. The time left after a long frame is dropped rather than caught
+  // up, so that a slow simulation cannot make the following frames slower and slower.
+  uint32_t max_fixed_steps = 8;
+  // Waits for events instead of rendering continuously: frames are only rendered after input,
+  // RequestRedraw, a completed asset or while the renderer has pending work.
+  bool on_demand = false;
+  // Runs Update for the next frame on a worker thread while the renderer encodes and presents the
+  // current frame, at the cost of one frame of latency. See App::Update for the contract.
+  bool pipelined_update = false;
+};
+
+struct FramePacingStats {
+  uint64_t num_frames = 0;
+  // Times the main loop slept in on demand mode.
+  uint64_t num_idle_waits = 0;
+  uint64_t num_fixed_steps = 0;
+  uint64_t num_dropped_steps = 0;
+  // Time spent in Update, and the part of it the main thread waited for in pipelined mode.
+  uint64_t update_ns = 0;
+  uint64_t update_wait_ns = 0;
+};
+
 class App {
  public:
   App();
   virtual ~App();
   virtual void Run();
+  // Renders "num_frames" frames without a window, see WebGpuRenderer::CreateHeadless.
+  virtual void RunHeadless(uint32_t num_frames);
 
   virtual const char* GetTitle() = 0;
   virtual Renderer* GetRenderer() = 0;
+  // Returns what the next frame draws. In pipelined mode, Update runs on a worker thread while the
+  // previous frame's renderables are drawn, and only then: it must not use ImGui or the renderer,
+  // and the spans it returns must not alias the previous frame's, e.g. by writing the renderables
+  // into buffer GetUpdateSlot() of kNumUpdateSlots or into GetFrameArena(). The spans stay in use
+  // until the next Update returns, or the one after it in pipelined mode where Pick reads them
+  // meanwhile, and the renderer writes to Mesh::lod and CachedMesh::lod through them.
   virtual Renderables Update() = 0;
+  // Called on the main thread every frame before Update, for ImGui and anything else that must
+  // run on the main thread. The update worker is idle meanwhile.
+  virtual void UpdateUi() {}
+  // Called with FramePacing::fixed_timestep zero or more times before each Update.
+  virtual void FixedUpdate(double dt) {}
+
+  void SetFramePacing(const FramePacing& frame_pacing) { frame_pacing_ = frame_pacing; }
+  const FramePacing& GetFramePacing() const { return frame_pacing_; }
+  const FramePacingStats& GetFramePacingStats() const { return frame_pacing_stats_; }
+  // Fraction of a fixed step elapsed since the last FixedUpdate, to interpolate the rendered
+  // state between the last two steps.
+  double GetFixedUpdateAlpha() const;
+  // Renders at least "num_frames" more frames in on demand mode. Can be called from any thread.
+  void RequestRedraw(uint32_t num_frames = 1);
+
+  static constexpr uint32_t kNumUpdateSlots = 2;
+  // Alternates between frames in pipelined mode, always 0 otherwise.
+  uint32_t GetUpdateSlot() const { return update_slot_; }
+  // Storage for the renderables returned by Update, reset before each Update. There is one arena
+  // per update slot, so that it is not reset while the renderer still reads it.
+  FrameArena* GetFrameArena() { return &frame_arenas_[update_slot_]; }
+
+  // Closest object under the point at ("x", "y") in window coordinates in the last rendered frame.
+  // The picker's BVH is refit or rebuilt on the first pick after each frame.
+  PickResult Pick(double x, double y);
+  // Object picked by the last left click, see OnPick.
+  const PickResult& GetPicked() const { return picked_; }
+  const Picker& GetPicker() const { return picker_; }
+
+  // Completed assets are delivered at the start of each frame, before Update.
+  AssetLoader* GetAssetLoader() { return asset_loader_.get(); }
 
   static CanvasSize GetInitialCanvasSize();
   static GLFWwindow* CreateGlfwWindow(const char* title, CanvasSize size, void* user_pointer);
@@ -26,14 +99,27 @@ class App {
  protected:
   virtual void Render();
   virtual void OnResize(int width, int height);
+  // Track the cursor and pick on left clicks outside of ImGui windows: overrides call them.
   virtual void OnMouseMove(double xpos, double ypos);
   virtual void OnMouseButton(int button, int action, int mods);
+  virtual void OnPick(const PickResult& result) { picked_ = result; }
   virtual void OnScroll(double xoffset, double yoffset);
+  virtual void OnKey(int key, int scancode, int action, int mods);
+
+  bool IsRedrawPending();
+  // Runs the FixedUpdate steps of the time elapsed since the previous call.
+  void RunFixedUpdates();
+  Renderables RunUpdate();
+  // Returns the renderables of the pending pipelined Update, if any, or runs Update.
+  Renderables GetNextRenderables();
 
   static void OnGlfwResize(GLFWwindow* window, int width, int height);
   static void OnGlfwSetCursorPos(GLFWwindow* window, double xpos, double ypos);
   static void OnGlfwSetMouseButton(GLFWwindow* window, int button, int action, int mods);
   static void OnGlfwScroll(GLFWwindow* window, double x_offset, double y_offset);
+  static void OnGlfwKey(GLFWwindow* window, int key, int scancode, int action, int mods);
+  static void OnGlfwChar(GLFWwindow* window, unsigned int codepoint);
+  static void OnGlfwRefresh(GLFWwindow* window);
 
 #if defined(__EMSCRIPTEN__)
   static void EmscriptenMainLoop(void* app);
@@ -43,6 +129,29 @@ class App {
 #endif
 
   GLFWwindow* window_ = nullptr;
+  std::string title_;
+  FramePacing frame_pacing_;
+  FramePacingStats frame_pacing_stats_;
+  double fixed_time_accumulator_ = 0;
+  uint64_t last_frame_ns_ = 0;
+  // Frames left to render in on demand mode, and whether the main loop waits for events. Both are
+  // sequentially consistent so that RequestRedraw either sees the wait or is seen before it.
+  std::atomic<uint32_t> num_redraw_frames_ = 1;
+  std::atomic<bool> waiting_for_events_ = false;
+  uint32_t update_slot_ = 0;
+  std::array<FrameArena, kNumUpdateSlots> frame_arenas_;
+  // Renderables of the last rendered frame, given to the picker on the next pick.
+  Renderables picking_renderables_;
+  bool picking_renderables_changed_ = false;
+  Picker picker_;
+  PickResult picked_;
+  double cursor_x_ = 0;
+  double cursor_y_ = 0;
+  // Pipelined Update, started in Render and done when Render returns.
+  std::unique_ptr<ThreadPool> update_thread_;
+  std::future<Renderables> pending_renderables_;
+  // Last, its workers call RequestRedraw.
+  std::unique_ptr<AssetLoader> asset_loader_;
 };
 
 }  // namespace web_gpu_app
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "web_gpu_app/mesh_file.h"
+#include "web_gpu_app/renderer.h"
+#include "web_gpu_app/texture_file.h"
+#include "web_gpu_app/thread_pool.h"
+
+#if defined(WEB_GPU_APP_FETCH)
+struct emscripten_fetch_t;
+#endif
+
+namespace web_gpu_app {
+
+using AssetId = uint64_t;
+
+enum class AssetType {
+  kBytes,
+  kObj,
+  kImage,
+  // Binary mesh file, mapped and validated but not copied. See MeshCache::Add.
+  kMesh,
+  // Texture file, as kMesh. See TextureManager::Add.
+  kTexture,
+};
+
+enum class AssetStatus {
+  kLoaded,
+  kFailed,
+  kCancelled,
+};
+
+struct ObjAsset {
+  tinyobj::attrib_t attrib;
+  std::vector<tinyobj::shape_t> shapes;
+  std::vector<tinyobj::material_t> materials;
+};
+
+// Decoded as RGBA8 regardless of the number of channels of the file.
+struct ImageAsset {
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> pixels;
+};
+
+struct Asset {
+  AssetId id = 0;
+  std::string path;
+  AssetType type = AssetType::kBytes;
+  AssetStatus status = AssetStatus::kFailed;
+  std::string error;
+  uint64_t file_size = 0;
+  // Only the member matching "type" is filled.
+  std::vector<uint8_t> bytes;
+  ObjAsset obj;
+  ImageAsset image;
+  MeshFile mesh;
+  TextureFile texture;
+};
+
+struct AssetLoaderStats {
+  uint64_t num_loaded = 0;
+  uint64_t num_failed = 0;
+  uint64_t num_cancelled = 0;
+  uint64_t loaded_bytes = 0;
+  // Time spent reading and parsing, summed over the worker threads.
+  uint64_t load_ns = 0;
+};
+
+// Reads and parses assets on worker threads. Results are delivered on the thread calling
+// ProcessCompletions, which App::Render does every frame.
+// Web builds configured with WEB_GPU_APP_WEB_FETCH fetch the files that are not in Emscripten's
+// file system from the server, asynchronously on the main thread, before parsing them likewise.
+class AssetLoader {
+ public:
+  using Callback = std::function<void(Asset& asset)>;
+
+  explicit AssetLoader(uint32_t num_threads = GetDefaultNumThreads());
+  ~AssetLoader();
+
+  // Half of the worker threads: parsing is long running, and the other half is left to the
+  // renderer's thread pool.
+  static uint32_t GetDefaultNumThreads();
+
+  // Requests with a higher priority are started first, requests of equal priority in order.
+  AssetId Load(const std::string& path, AssetType type, Callback callback, int priority = 0);
+  // The callback of a cancelled asset is still invoked, with AssetStatus::kCancelled. Returns
+  // false if the asset is already completed.
+  bool Cancel(AssetId id);
+  void CancelAll();
+  // Called on a worker thread each time an asset is completed, e.g. to wake up a main loop that
+  // waits for events.
+  void SetCompletionNotifier(std::function<void()> notifier);
+
+  // Invokes the callbacks of the completed assets. Returns their number.
+  size_t ProcessCompletions();
+  // Blocks until all requested assets are completed, then processes them. Never returns when
+  // called on the main thread of a web build while files are fetched.
+  void WaitIdle();
+
+  size_t GetNumPending();
+  AssetLoaderStats GetStats();
+
+ private:
+  struct Request {
+    AssetId id = 0;
+    std::string path;
+    AssetType type = AssetType::kBytes;
+    int priority = 0;
+    Callback callback;
+    std::atomic<bool> cancelled = false;
+    // Set when the file was fetched rather than read, with its bytes or the fetch error.
+    bool fetched = false;
+    std::vector<uint8_t> fetched_bytes;
+    std::string fetch_error;
+#if defined(WEB_GPU_APP_FETCH)
+    // Fetch in flight, closed if the loader is destroyed first.
+    emscripten_fetch_t* fetch = nullptr;
+    bool fetch_done = false;
+#endif
+  };
+  struct Completion {
+    std::shared_ptr<Request> request;
+    Asset asset;
+  };
+
+  static bool HasLowerPriority(const std::shared_ptr<Request>& a,
+                               const std::shared_ptr<Request>& b);
+  // Queues "request" for loading on a worker thread.
+  void Enqueue(std::shared_ptr<Request> request);
+  void RunNext();
+  void LoadAsset(Request* request, Asset* asset);
+#if defined(WEB_GPU_APP_FETCH)
+  struct Fetch;
+  struct FetchContext;
+  // Fetches the file of a request, then enqueues it. Runs on the main thread, which receives the
+  // fetch callbacks. Drops the request if the loader was destroyed since Load queued the call.
+  static void StartFetch(void* fetch);
+#endif
+
+  std::mutex mutex_;
+  std::condition_variable idle_condition_;
+  AssetId next_id_ = 1;
+  // Max-heap of the requests that are not started yet.
+  std::vector<std::shared_ptr<Request>> queue_;
+  // Requests that are not completed yet.
+  std::unordered_map<AssetId, std::shared_ptr<Request>> requests_;
+  std::vector<Completion> completions_;
+  std::function<void()> completion_notifier_;
+  AssetLoaderStats stats_;
+#if defined(WEB_GPU_APP_FETCH)
+  // Shared with the fetches, which can outlive the loader.
+  std::shared_ptr<FetchContext> fetch_context_;
+#endif
+  std::unique_ptr<ThreadPool> thread_pool_;
+};
+
+}  // namespace web_gpu_app
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <webgpu/webgpu_cpp.h>
+
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace web_gpu_app {
+
+struct BindGroupCacheStats {
+  uint64_t num_created = 0;
+  uint64_t num_reused = 0;
+  uint64_t num_evicted = 0;
+  // Bind groups currently cached.
+  uint64_t size = 0;
+};
+
+// Bind groups keyed by a hash of their layout and resources, so that a resource set bound every
+// frame is only created once. Cached bind groups keep their resources alive: the ones not
+// requested during the last "max_unused_frames" frames are released by BeginFrame, e.g. those of
+// a texture array that grew or of an upload buffer that overflowed.
+class BindGroupCache {
+ public:
+  explicit BindGroupCache(wgpu::Device device, uint32_t max_unused_frames = 16);
+  ~BindGroupCache();
+
+  // Returns the bind group of "layout" with "entries", creating it unless an identical one is
+  // cached. Entries are compared by binding, resource handles and buffer range, so buffers bound
+  // at varying offsets should be bound at offset 0 with a dynamic offset instead.
+  wgpu::BindGroup Get(const wgpu::BindGroupLayout& layout,
+                      std::span<const wgpu::BindGroupEntry> entries);
+
+  void BeginFrame();
+  void Clear();
+
+  const BindGroupCacheStats& GetStats() const { return stats_; }
+
+ private:
+  struct Entry {
+    wgpu::BindGroupLayout layout;
+    std::vector<wgpu::BindGroupEntry> entries;
+    wgpu::BindGroup bind_group;
+    uint64_t last_used_frame = 0;
+  };
+
+  static bool Matches(const Entry& entry, const wgpu::BindGroupLayout& layout,
+                      std::span<const wgpu::BindGroupEntry> entries);
+
+  wgpu::Device device_;
+  uint32_t max_unused_frames_ = 0;
+  uint64_t frame_ = 0;
+  // Bind groups whose keys have the same hash share a bucket.
+  std::unordered_map<uint64_t, std::vector<Entry>> buckets_;
+  BindGroupCacheStats stats_;
+};
+
+}  // namespace web_gpu_app
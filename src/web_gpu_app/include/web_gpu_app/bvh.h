@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "web_gpu_app/renderer.h"
+
+namespace web_gpu_app {
+
+struct Ray {
+  Vec3 origin = Vec3(0.f);
+  // Not necessarily normalized: distances are in units of its length.
+  Vec3 direction = Vec3(0.f, 0.f, -1.f);
+};
+
+// Axis-aligned bounding box, empty by default.
+struct Aabb {
+  Vec3 min = Vec3(std::numeric_limits<float>::max());
+  Vec3 max = Vec3(-std::numeric_limits<float>::max());
+
+  void Grow(const Vec3& point);
+  void Grow(const Aabb& box);
+  bool IsEmpty() const { return min.x > max.x; }
+  Vec3 GetCenter() const { return 0.5f * (min + max); }
+  float GetSurfaceArea() const;
+};
+
+// Bounds of "box" transformed by "transform".
+Aabb TransformAabb(const Mat4& transform, const Aabb& box);
+
+// Distance along "ray" to the entry of "box" if it is below "max_distance", or infinity. Rays
+// starting inside the box enter it at 0. "inverse_direction" is 1 / ray.direction.
+float IntersectAabb(const Vec3& origin, const Vec3& inverse_direction, const Vec3& box_min,
+                    const Vec3& box_max, float max_distance);
+
+// Bounding volume hierarchy of boxes, e.g. of the objects of a scene or the triangles of a mesh,
+// built with the binned surface area heuristic. Refit keeps the tree and only recomputes the
+// bounds of its nodes, which is linear in the number of boxes and much faster than Build, but the
+// tree degrades as the boxes move away from their neighbors at build time: GetCost tells when to
+// rebuild.
+class Bvh {
+ public:
+  static constexpr uint32_t kMaxLeafSize = 4;
+  // Deeper nodes become leaves, bounding the traversal stack of Raycast.
+  static constexpr uint32_t kMaxDepth = 64;
+
+  void Build(std::span<const Aabb> boxes);
+  // "boxes" must have the size of those of the last Build.
+  void Refit(std::span<const Aabb> boxes);
+  void Clear();
+
+  // Calls "intersect(index, max_distance)" for the boxes that "ray" enters before the closest hit
+  // so far, nearest nodes first. It returns the distance of the hit with the object of box
+  // "index", or anything not below "max_distance" if it misses. Returns the distance of the
+  // closest hit, or "max_distance" if none.
+  template <typename Intersect>
+  float Raycast(const Ray& ray, float max_distance, Intersect&& intersect) const;
+
+  size_t size() const { return indices_.size(); }
+  size_t GetNumNodes() const { return nodes_.size(); }
+  // Expected cost of a query relative to a single box test: the surface area of the nodes over
+  // the one of the root, weighted by the number of boxes of the leaves.
+  float GetCost() const;
+
+ private:
+  // Leaves have "count" boxes starting at indices_[first], inner nodes have their children at
+  // nodes_[first] and nodes_[first + 1]. Children follow their parent, which Refit relies on.
+  struct Node {
+    Vec3 min;
+    uint32_t first = 0;
+    Vec3 max;
+    uint32_t count = 0;
+  };
+
+  // Splits the root until the leaves are small enough.
+  void Subdivide(std::span<const Aabb> boxes);
+  void SetBounds(Node* node, std::span<const Aabb> boxes) const;
+
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> indices_;
+  // Scratch of Build.
+  std::vector<Vec3> centers_;
+};
+
+template <typename Intersect>
+float Bvh::Raycast(const Ray& ray, float max_distance, Intersect&& intersect) const {
+  if (nodes_.empty()) return max_distance;
+  const Vec3 inverse_direction = Vec3(1.f) / ray.direction;
+  auto enter = [&](const Node& node) {
+    return IntersectAabb(ray.origin, inverse_direction, node.min, node.max, max_distance);
+  };
+  if (enter(nodes_[0]) == std::numeric_limits<float>::infinity()) return max_distance;
+
+  std::pair<uint32_t, float> stack[kMaxDepth];
+  uint32_t stack_size = 0;
+  uint32_t node_index = 0;
+  while (true) {
+    const Node& node = nodes_[node_index];
+    if (node.count > 0) {
+      for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+        max_distance = std::min(max_distance, intersect(indices_[i], max_distance));
+      }
+    } else {
+      uint32_t near = node.first;
+      uint32_t far = node.first + 1;
+      float near_distance = enter(nodes_[near]);
+      float far_distance = enter(nodes_[far]);
+      if (far_distance < near_distance) {
+        std::swap(near, far);
+        std::swap(near_distance, far_distance);
+      }
+      if (near_distance < max_distance) {
+        if (far_distance < max_distance) stack[stack_size++] = {far, far_distance};
+        node_index = near;
+        continue;
+      }
+    }
+    // Skips the pending nodes entered beyond the closest hit found since they were pushed.
+    while (stack_size > 0 && stack[stack_size - 1].second >= max_distance) --stack_size;
+    if (stack_size == 0) return max_distance;
+    node_index = stack[--stack_size].first;
+  }
+}
+
+}  // namespace web_gpu_app
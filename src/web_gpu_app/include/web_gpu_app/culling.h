@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "web_gpu_app/renderer.h"
+
+namespace web_gpu_app {
+
+class ThreadPool;
+
+// Planes of a view frustum, (a, b, c, d) with a point p inside when a*p.x + b*p.y + c*p.z + d >= 0.
+// The normals (a, b, c) are normalized.
+struct Frustum {
+  Vec4 planes[6];
+};
+
+// Extracts the frustum of a WebGPU view-projection matrix (clip space depth in [0, 1]).
+Frustum ExtractFrustum(const Mat4& view_projection);
+
+// World-space bounding spheres in structure-of-arrays layout.
+struct BoundingSpheres {
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+  std::vector<float> radius;
+
+  size_t size() const { return x.size(); }
+  void clear();
+  void reserve(size_t capacity);
+  void push_back(const Vec3& center, float sphere_radius);
+};
+
+// Largest scale factor applied by "transform" to any direction.
+float GetMaxScale(const Mat4& transform);
+
+void AppendBounds(std::span<const Cube> cubes, BoundingSpheres* bounds);
+void AppendBounds(std::span<const Sphere> spheres, BoundingSpheres* bounds);
+
+// Appends to "visible" the indices in [begin, end) of the spheres intersecting "frustum", in
+// increasing order. Returns the number of visible spheres.
+size_t CullSpheresScalar(const Frustum& frustum, const BoundingSpheres& bounds, size_t begin,
+                         size_t end, std::vector<uint32_t>* visible);
+// Same as CullSpheresScalar using the widest SIMD instruction set available at compile time:
+// AVX2, SSE2, NEON or WASM SIMD.
+size_t CullSpheresSimd(const Frustum& frustum, const BoundingSpheres& bounds, size_t begin,
+                       size_t end, std::vector<uint32_t>* visible);
+const char* GetCullingSimdName();
+
+// Culls all spheres, splitting the work across "thread_pool" when there are enough of them.
+// "visible" is replaced by the compacted list of visible indices.
+void CullSpheres(const Frustum& frustum, const BoundingSpheres& bounds,
+                 std::vector<uint32_t>* visible, ThreadPool* thread_pool = nullptr);
+
+}  // namespace web_gpu_app
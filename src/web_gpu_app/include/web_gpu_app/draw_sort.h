@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace web_gpu_app {
+
+class ThreadPool;
+
+// Draws are submitted in increasing order of their 64-bit key. From the most significant bits:
+//   opaque:      pass (2) | 0 (1) | pipeline (5) | bind group (16) | geometry (16) | depth (24)
+//   translucent: pass (2) | 1 (1) | far depth (24) | pipeline (5) | bind group (16) | 0 (16)
+// Within a pass, the opaque draws come first, grouped by state to minimize the switches and front
+// to back within a state for early depth rejection. The translucent draws come after them, back
+// to front for blending, and by state when their depths are equal.
+using DrawKey = uint64_t;
+
+inline constexpr uint32_t kMaxDrawPasses = 1u << 2;
+inline constexpr uint32_t kMaxDrawPipelines = 1u << 5;
+inline constexpr uint32_t kMaxDrawBindGroups = 1u << 16;
+inline constexpr uint32_t kMaxDrawGeometries = 1u << 16;
+
+// Identifiers of the state of a draw, which the caller assigns. Out of range values are wrapped.
+struct DrawState {
+  uint32_t pipeline = 0;
+  uint32_t bind_group = 0;
+  uint32_t geometry = 0;
+};
+
+// "depth" is the view space distance of the draw from the eye, negative ones are clamped to 0.
+DrawKey MakeOpaqueDrawKey(uint32_t pass, const DrawState& state, float depth);
+// The geometry is left out: translucent draws are only merged when consecutive anyway.
+DrawKey MakeTranslucentDrawKey(uint32_t pass, const DrawState& state, float depth);
+bool IsTranslucentDrawKey(DrawKey key);
+// 24 bits increasing with "depth", the float's exponent and first 16 bits of mantissa.
+uint32_t QuantizeDrawDepth(float depth);
+
+struct DrawItem {
+  DrawKey key = 0;
+  // Caller defined, e.g. the index of the draw's batch.
+  uint32_t index = 0;
+};
+
+// Sorts "items" by key with a stable least significant digit radix sort, 8 bits per pass. Passes
+// whose digit is the same for every item are skipped, e.g. the pass bits when there is a single
+// one. The histograms and scatters are split across "thread_pool" when there are enough items.
+// "scratch" is resized to the number of items.
+void RadixSortDrawItems(std::span<DrawItem> items, std::vector<DrawItem>* scratch,
+                        ThreadPool* thread_pool = nullptr);
+
+}  // namespace web_gpu_app
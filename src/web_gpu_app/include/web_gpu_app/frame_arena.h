@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace web_gpu_app {
+
+struct FrameArenaStats {
+  // Since the last Reset.
+  uint64_t bytes_allocated = 0;
+  uint64_t num_allocations = 0;
+  // Since creation: bytes allocated in a frame at most.
+  uint64_t high_water_mark = 0;
+  // Allocations that did not fit in the arena and got a new heap block. The arena grows to the
+  // frame's size on the next Reset, so they stop once the frames have a steady size.
+  uint64_t num_overflows = 0;
+};
+
+// Linear allocator for the arrays of a frame, e.g. the storage of Renderables, released all at
+// once by Reset without any heap traffic. Not thread-safe, except for GetSubArena: parallel
+// builders allocate from a sub-arena each.
+class FrameArena {
+ public:
+  // Allocations are aligned to at most kMaxAlignment bytes.
+  static constexpr size_t kMaxAlignment = 64;
+
+  explicit FrameArena(size_t initial_size = 1024 * 1024);
+  ~FrameArena();
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  // Returns "count" default-initialized objects, as with new T[count], valid until Reset.
+  template <typename T>
+  std::span<T> Allocate(size_t count);
+  template <typename T>
+  std::span<T> Copy(std::span<const T> data);
+  // Concatenates "parts", e.g. the arrays built in the sub-arenas.
+  template <typename T>
+  std::span<T> Concatenate(std::span<const std::span<T>> parts);
+
+  // Destroys the objects of the frame and of the sub-arenas, and reuses their memory.
+  void Reset();
+
+  // Sub-arena "index", e.g. one per ThreadPool::ParallelFor chunk, created on first use. Can be
+  // called from any thread. Sub-arenas are reset with their parent.
+  FrameArena* GetSubArena(size_t index);
+
+  // Including the sub-arenas.
+  FrameArenaStats GetStats();
+
+ private:
+  struct Block {
+    void* data = nullptr;
+    size_t size = 0;
+  };
+  struct Destructor {
+    void* data = nullptr;
+    size_t count = 0;
+    void (*destroy)(void* data, size_t count) = nullptr;
+  };
+
+  void* AllocateBytes(size_t size, size_t alignment);
+  static Block AllocateBlock(size_t size);
+  static void FreeBlock(const Block& block);
+
+  // The last block is the one being allocated from.
+  std::vector<Block> blocks_;
+  size_t head_ = 0;
+  std::vector<Destructor> destructors_;
+  FrameArenaStats stats_;
+  std::mutex sub_arenas_mutex_;
+  std::vector<std::unique_ptr<FrameArena>> sub_arenas_;
+};
+
+template <typename T>
+std::span<T> FrameArena::Allocate(size_t count) {
+  static_assert(alignof(T) <= kMaxAlignment);
+  if (count == 0) return {};
+  T* data = static_cast<T*>(AllocateBytes(count * sizeof(T), alignof(T)));
+  std::uninitialized_default_construct_n(data, count);
+  if constexpr (!std::is_trivially_destructible_v<T>) {
+    destructors_.push_back({data, count, [](void* data, size_t count) {
+                              std::destroy_n(static_cast<T*>(data), count);
+                            }});
+  }
+  return {data, count};
+}
+
+template <typename T>
+std::span<T> FrameArena::Copy(std::span<const T> data) {
+  std::span<T> copy = Allocate<T>(data.size());
+  std::copy(data.begin(), data.end(), copy.begin());
+  return copy;
+}
+
+template <typename T>
+std::span<T> FrameArena::Concatenate(std::span<const std::span<T>> parts) {
+  size_t count = 0;
+  for (std::span<T> part : parts) count += part.size();
+  std::span<T> result = Allocate<T>(count);
+  auto it = result.begin();
+  for (std::span<T> part : parts) it = std::copy(part.begin(), part.end(), it);
+  return result;
+}
+
+}  // namespace web_gpu_app
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <webgpu/webgpu_cpp.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "web_gpu_app/culling.h"
+#include "web_gpu_app/pipeline_cache.h"
+#include "web_gpu_app/primitives.h"
+#include "web_gpu_app/upload_ring.h"
+
+namespace web_gpu_app {
+
+// Instances drawn by one indirect draw.
+struct GpuCullBatch {
+  uint32_t first_instance = 0;
+  uint32_t num_instances = 0;
+  uint32_t first_index = 0;
+  uint32_t index_count = 0;
+  // Bounding sphere of the geometry in the space of PackedInstance::model, i.e. before the scale
+  // and dequantization that the model applies.
+  BoundingSphere bounds;
+};
+
+// Arguments of DrawIndexedIndirect as the GPU reads them.
+struct DrawIndexedIndirectArgs {
+  uint32_t index_count = 0;
+  uint32_t instance_count = 0;
+  uint32_t first_index = 0;
+  int32_t base_vertex = 0;
+  uint32_t first_instance = 0;
+};
+
+struct GpuCullingStats {
+  uint64_t num_dispatches = 0;
+  uint64_t num_instances = 0;
+  uint64_t num_batches = 0;
+  // Output, batch and draw buffers recreated with twice the capacity.
+  uint64_t num_buffer_grows = 0;
+};
+
+// Frustum culling of packed instances in a compute pass. Each instance transforms the bounding
+// sphere of its batch by its model matrix, and the visible ones are appended to the batch's range
+// of the output buffer, counted in the instance count of the batch's DrawIndexedIndirect
+// arguments. The CPU only writes the arguments of each batch, never touching the instances again.
+class GpuCulling {
+ public:
+  GpuCulling(wgpu::Device device, PipelineCache* pipeline_cache);
+  ~GpuCulling();
+
+  // Whether the culling pipeline has been created.
+  bool IsReady() const { return static_cast<bool>(pipeline_); }
+  // Records the culling of the PackedInstances of "instances", whose offset must be aligned to
+  // kStorageOffsetAlignment. The batches must be sorted by first instance and cover all of them.
+  void Cull(wgpu::CommandEncoder encoder, const Frustum& frustum,
+            const UploadAllocation& instances, std::span<const GpuCullBatch> batches);
+
+  // Vertex buffer of the visible instances of the last Cull, each batch's visible instances
+  // starting at its first instance, to be bound at that offset.
+  wgpu::Buffer GetInstanceBuffer() const { return instance_buffer_; }
+  // DrawIndexedIndirectArgs of the batches of the last Cull, in order, with 0 as first instance.
+  wgpu::Buffer GetDrawBuffer() const { return draw_buffer_; }
+
+  // Makes Cull also cull the instances with CullSpheres and copy the instance counts back, so that
+  // ReadInstanceCounts can be compared with GetExpectedInstanceCounts. Costs a CPU pass over the
+  // instances, for testing only.
+  void SetValidationEnabled(bool enabled) { validation_enabled_ = enabled; }
+  bool IsValidationEnabled() const { return validation_enabled_; }
+  // Visible instances of each batch of the last Cull according to the CPU.
+  const std::vector<uint32_t>& GetExpectedInstanceCounts() const { return expected_counts_; }
+  // Visible instances of each batch of the last Cull according to the GPU. Blocks until the GPU is
+  // done. Empty if validation was disabled during the last Cull.
+  std::vector<uint32_t> ReadInstanceCounts();
+
+  const GpuCullingStats& GetStats() const { return stats_; }
+
+  static constexpr uint64_t kStorageOffsetAlignment = 256;
+
+ private:
+  // Batch as the shader reads it, with WGSL's alignment of vec3f.
+  struct BatchData {
+    float center[3];
+    float radius;
+    uint32_t first_instance;
+    uint32_t padding[3];
+  };
+
+  void Reserve(uint64_t num_instances, uint64_t num_batches);
+  void ComputeExpectedCounts(const Frustum& frustum, const UploadAllocation& instances,
+                             std::span<const GpuCullBatch> batches);
+
+  wgpu::Device device_;
+  wgpu::ComputePipeline pipeline_;
+  wgpu::Buffer params_buffer_;
+  wgpu::Buffer instance_buffer_;
+  wgpu::Buffer batch_buffer_;
+  wgpu::Buffer draw_buffer_;
+  wgpu::Buffer readback_buffer_;
+  uint64_t instance_capacity_ = 0;
+  uint64_t batch_capacity_ = 0;
+  uint32_t num_readback_batches_ = 0;
+  std::vector<BatchData> batch_data_;
+  std::vector<DrawIndexedIndirectArgs> draw_args_;
+  bool validation_enabled_ = false;
+  BoundingSpheres validation_bounds_;
+  std::vector<uint32_t> validation_visible_;
+  std::vector<uint32_t> expected_counts_;
+  GpuCullingStats stats_;
+};
+
+}  // namespace web_gpu_app
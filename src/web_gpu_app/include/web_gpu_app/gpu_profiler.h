@@ -0,0 +1,54 @@
+#pragma once
+
+#include <webgpu/webgpu_cpp.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace web_gpu_app {
+
+// Measures render pass durations with timestamp queries and forwards them to the Profiler. Does
+// nothing if the device was created without the TimestampQuery feature, which GetDevice only
+// requests when the Profiler is enabled.
+class GpuProfiler {
+ public:
+  static constexpr uint32_t kMaxPassesPerFrame = 16;
+  static constexpr uint32_t kNumFramesInFlight = 3;
+
+  explicit GpuProfiler(wgpu::Device device);
+  ~GpuProfiler();
+
+  bool IsSupported() const { return supported_; }
+
+  // Returns the timestamp writes to set on a render pass descriptor, or nullptr if the pass cannot
+  // be timed. "name" must have static storage duration.
+  const wgpu::RenderPassTimestampWrites* BeginPass(const char* name);
+  // Resolves this frame's queries. Must be called before finishing "encoder".
+  void Resolve(wgpu::CommandEncoder encoder);
+  // Must be called after the frame's submit.
+  void EndFrame();
+
+ private:
+  struct Frame {
+    wgpu::QuerySet query_set;
+    wgpu::Buffer resolve_buffer;
+    wgpu::Buffer readback_buffer;
+    std::vector<const char*> pass_names;
+    std::vector<wgpu::RenderPassTimestampWrites> timestamp_writes;
+    uint64_t submit_ns = 0;
+    bool resolved = false;
+    bool mapping = false;
+  };
+
+  // "user_data" is a new std::shared_ptr<Frame>, which keeps the frame alive until the callback
+  // even if the GpuProfiler is destroyed first.
+  static void OnReadbackMapped(WGPUBufferMapAsyncStatus status, void* user_data);
+
+  wgpu::Device device_;
+  bool supported_ = false;
+  std::vector<std::shared_ptr<Frame>> frames_;
+  uint32_t frame_index_ = 0;
+};
+
+}  // namespace web_gpu_app
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "web_gpu_app/renderer.h"
+
+namespace web_gpu_app {
+
+// Per-instance data as laid out in the GPU instance buffer. The model matrix is stored as the
+// four xyz columns of an affine transform with the uniform scale already applied, followed by the
+// color as RGBA8 unorm and the layer of the texture in its array.
+struct PackedInstance {
+  float model[12];
+  uint32_t color;
+  uint32_t texture_layer;
+};
+
+static_assert(sizeof(PackedInstance) == 56, "PackedInstance must stay tightly packed");
+
+uint32_t PackColor(const Color& color);
+void PackInstance(const Mat4& transform, float scale, const Color& color, PackedInstance* out);
+// Same as above for geometry with quantized positions, see QuantizedGeometry. The dequantization
+// is folded into the model matrix.
+void PackQuantizedInstance(const Mat4& transform, float scale, const Vec3& position_offset,
+                           float position_scale, const Color& color, PackedInstance* out);
+
+// Pack renderables into "out", which must hold at least as many elements as the input. Returns
+// the number of instances written.
+size_t PackCubes(std::span<const Cube> cubes, std::span<PackedInstance> out);
+size_t PackSpheres(std::span<const Sphere> spheres, std::span<PackedInstance> out);
+// Same as above for the elements at "indices" only, e.g. the ones which survived culling.
+size_t PackCubes(std::span<const Cube> cubes, std::span<const uint32_t> indices,
+                 std::span<PackedInstance> out);
+size_t PackSpheres(std::span<const Sphere> spheres, std::span<const uint32_t> indices,
+                   std::span<PackedInstance> out);
+
+}  // namespace web_gpu_app
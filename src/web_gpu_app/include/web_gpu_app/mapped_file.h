@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace web_gpu_app {
+
+// Read-only view of a whole file. The file is memory-mapped where the platform allows it, and read
+// into memory in one go otherwise, e.g. on Emscripten.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile();
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Returns false if the file cannot be opened.
+  bool Open(const std::string& file_name);
+  // Takes over bytes that are already in memory, e.g. fetched from a server.
+  void Assign(std::vector<uint8_t> bytes);
+  void Close();
+
+  std::span<const uint8_t> GetData() const { return {data_, size_}; }
+  size_t GetSize() const { return size_; }
+  bool IsMapped() const { return mapping_ != nullptr; }
+
+ private:
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  // Start of the mapping, nullptr when the file was read into "buffer_".
+  void* mapping_ = nullptr;
+#if defined(_WIN32)
+  void* mapping_handle_ = nullptr;
+#endif
+  std::vector<uint8_t> buffer_;
+};
+
+}  // namespace web_gpu_app
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <webgpu/webgpu_cpp.h>
+
+#include <list>
+#include <unordered_map>
+
+#include "web_gpu_app/mesh_file.h"
+#include "web_gpu_app/primitives.h"
+#include "web_gpu_app/renderer.h"
+#include "web_gpu_app/web_gpu_utils.h"
+
+namespace web_gpu_app {
+
+struct MeshCacheStats {
+  uint64_t num_hits = 0;
+  uint64_t num_misses = 0;
+  uint64_t num_evictions = 0;
+  uint64_t num_meshes = 0;
+  uint64_t resident_bytes = 0;
+  uint64_t memory_budget = 0;
+};
+
+// Expands the per-corner indices of "mesh" into an indexed vertex buffer of positions and normals.
+// Faces without normals get flat normals.
+PrimitiveGeometry ConvertMesh(const tinyobj::attrib_t& attrib, const tinyobj::mesh_t& mesh);
+
+// Stable content hash of the geometry referenced by "mesh".
+MeshHandle HashMesh(const tinyobj::attrib_t& attrib, const tinyobj::mesh_t& mesh);
+
+// GPU geometry of tinyobj meshes keyed by content hash. Meshes are converted, optimized with
+// OptimizeMesh, simplified into LODs with GenerateLods and uploaded once, then evicted in least
+// recently used order when the resident size exceeds the memory budget. Meshes used during the
+// current frame are never evicted.
+class MeshCache {
+ public:
+  MeshCache(wgpu::Device device, uint64_t memory_budget = 256 * 1024 * 1024);
+
+  void BeginFrame();
+
+  // Returns the handle of the mesh, uploading it if it is not resident.
+  MeshHandle Add(const tinyobj::attrib_t& attrib, const tinyobj::mesh_t& mesh);
+  // "lods" index into the indices of "geometry" and default to a single LOD.
+  MeshHandle Add(const PrimitiveGeometry& geometry, MeshHandle handle,
+                 std::span<const MeshLod> lods = {});
+  // Uploads the vertices and the indices of all the LODs straight from the file's mapping.
+  // Returns 0 if the vertices are laid out neither as Vertex nor as QuantizedVertex.
+  MeshHandle Add(const MeshFile& file);
+  // Returns nullptr if "handle" was never added or has been evicted.
+  const GpuGeometry* Get(MeshHandle handle);
+  bool Contains(MeshHandle handle) const { return entries_.contains(handle); }
+  // Local space bounds of the mesh, or nullptr if it is not resident.
+  const BoundingSphere* GetBounds(MeshHandle handle) const;
+
+  void SetMemoryBudget(uint64_t memory_budget);
+  // Quantizes the meshes added from now on with QuantizeGeometry, halving their vertex size.
+  // Disabled by default.
+  void SetQuantizationEnabled(bool enabled) { quantization_enabled_ = enabled; }
+  bool IsQuantizationEnabled() const { return quantization_enabled_; }
+  // Generates LODs for the tinyobj meshes added from now on. Enabled by default. Simplification
+  // takes about ten times as long as OptimizeMesh, large meshes load faster as mesh files
+  // converted with obj_to_mesh.
+  void SetLodGenerationEnabled(bool enabled) { lod_generation_enabled_ = enabled; }
+  bool IsLodGenerationEnabled() const { return lod_generation_enabled_; }
+  const MeshCacheStats& GetStats() const { return stats_; }
+
+ private:
+  struct Entry {
+    GpuGeometry geometry;
+    BoundingSphere bounds;
+    uint64_t num_bytes = 0;
+    uint64_t last_used_frame = 0;
+    std::list<MeshHandle>::iterator lru_position;
+  };
+
+  void Touch(Entry& entry);
+  void EvictOverBudget();
+
+  wgpu::Device device_;
+  std::unordered_map<MeshHandle, Entry> entries_;
+  // Most recently used first.
+  std::list<MeshHandle> lru_;
+  uint64_t frame_ = 0;
+  bool quantization_enabled_ = false;
+  bool lod_generation_enabled_ = true;
+  MeshCacheStats stats_;
+};
+
+}  // namespace web_gpu_app
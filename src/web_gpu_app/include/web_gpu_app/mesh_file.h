@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "web_gpu_app/mapped_file.h"
+#include "web_gpu_app/primitives.h"
+
+namespace web_gpu_app {
+
+// Binary mesh container that is memory-mapped and uploaded without parsing. Convert OBJ files with
+// the obj_to_mesh tool. The file is laid out as, in little-endian:
+//
+//   MeshFileHeader
+//   MeshFileAttribute[num_attributes]
+//   MeshLod[num_lods]
+//   Vertices: num_vertices * vertex_stride bytes at vertex_data_offset.
+//   Indices: num_indices * index_size bytes at index_data_offset.
+//
+// Both data blobs are aligned to kMeshFileAlignment. All the LODs share the vertices and each
+// references a range of the indices, LOD 0 being the full detail mesh.
+constexpr uint32_t kMeshFileMagic = 0x534d4757;  // "WGMS"
+// Version 2 added the dequantization of the positions to the header.
+constexpr uint32_t kMeshFileVersion = 2;
+constexpr uint64_t kMeshFileAlignment = 16;
+constexpr uint32_t kMaxMeshFileAttributes = 8;
+constexpr uint32_t kMaxMeshLods = 16;
+
+enum class MeshAttribute : uint32_t {
+  kPosition = 0,
+  kNormal = 1,
+};
+
+enum class MeshAttributeFormat : uint32_t {
+  kFloat32x3 = 0,
+  kUnorm16x4 = 1,
+  kSnorm16x2 = 2,
+};
+
+struct MeshFileAttribute {
+  MeshAttribute attribute = MeshAttribute::kPosition;
+  MeshAttributeFormat format = MeshAttributeFormat::kFloat32x3;
+  // Offset in bytes from the start of the vertex.
+  uint32_t offset = 0;
+};
+
+struct MeshFileHeader {
+  uint32_t magic = kMeshFileMagic;
+  uint32_t version = kMeshFileVersion;
+  uint32_t num_attributes = 0;
+  uint32_t vertex_stride = 0;
+  uint32_t num_lods = 0;
+  uint32_t index_size = sizeof(uint32_t);
+  uint32_t num_vertices = 0;
+  uint32_t num_indices = 0;
+  // Hash of the vertices and indices, used as the handle of the mesh in the mesh cache.
+  uint64_t content_hash = 0;
+  uint64_t vertex_data_offset = 0;
+  uint64_t index_data_offset = 0;
+  float bounds_center[3] = {0.f, 0.f, 0.f};
+  float bounds_radius = 0.f;
+  // Quantized positions map to position_offset + position_scale * unorm(position).
+  float position_offset[3] = {0.f, 0.f, 0.f};
+  float position_scale = 1.f;
+};
+static_assert(sizeof(MeshFileHeader) == 88, "Changing the header requires a new version");
+
+uint32_t GetMeshAttributeFormatSize(MeshAttributeFormat format);
+
+// Writes "geometry" with the layout of Vertex, or QuantizedVertex. "lods" defaults to a single LOD
+// spanning all the indices. Errors are reported on std::cerr.
+bool WriteMeshFile(const std::string& file_name, const PrimitiveGeometry& geometry,
+                   std::span<const MeshLod> lods = {});
+bool WriteMeshFile(const std::string& file_name, const QuantizedGeometry& geometry,
+                   std::span<const MeshLod> lods = {});
+
+// Validated view of a mesh file. The vertex and index data point into the mapping, so that they
+// can be handed to the GPU upload as is.
+class MeshFile {
+ public:
+  // Returns false and sets "error" if the file cannot be read or is not a valid mesh file of a
+  // supported version. Index values are not validated, out of bounds vertex fetches are defined
+  // in WebGPU.
+  bool Open(const std::string& file_name, std::string* error = nullptr);
+  bool Open(MappedFile file, std::string* error = nullptr);
+  void Close();
+  bool IsOpen() const { return header_.num_lods > 0; }
+
+  const MeshFileHeader& GetHeader() const { return header_; }
+  std::span<const MeshFileAttribute> GetAttributes() const { return attributes_; }
+  std::span<const MeshLod> GetLods() const { return lods_; }
+  BoundingSphere GetBounds() const;
+  // True if the vertices are laid out as Vertex, respectively QuantizedVertex, i.e. can be drawn
+  // by the renderer's pipelines.
+  bool HasVertexLayout() const;
+  bool HasQuantizedVertexLayout() const;
+
+  // Valid until the file is closed.
+  std::span<const uint8_t> GetVertexData() const;
+  std::span<const uint8_t> GetIndexData() const;
+  std::span<const uint8_t> GetIndexData(const MeshLod& lod) const;
+
+  // Reads every page of the data so that the upload does not wait for the disk, e.g. when the
+  // file is opened on an asset loader thread.
+  void Prefetch() const;
+
+ private:
+  MappedFile file_;
+  MeshFileHeader header_;
+  std::vector<MeshFileAttribute> attributes_;
+  std::vector<MeshLod> lods_;
+};
+
+}  // namespace web_gpu_app
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "web_gpu_app/primitives.h"
+#include "web_gpu_app/renderer.h"
+
+namespace web_gpu_app {
+
+struct LodOptions {
+  // Target triangle count of each LOD relative to the previous one.
+  float reduction = 0.5f;
+  // Including LOD 0, at most kMaxMeshLods to fit in a mesh file.
+  uint32_t max_lods = 8;
+  // No LOD is generated below this triangle count.
+  uint32_t min_triangles = 64;
+};
+
+// Simplifies the triangles of "geometry" down to about "target_index_count" indices with
+// half-edge collapses ordered by quadric error, "Surface Simplification Using Quadric Error
+// Metrics", Garland and Heckbert 1997. The vertices are not modified: the returned indices
+// reference a subset of them. Vertices sharing a position with different normals collapse
+// together. Open boundaries are preserved. If not null, "error" receives the object space
+// deviation of the result from the input surface.
+std::vector<uint32_t> SimplifyMesh(const PrimitiveGeometry& geometry, size_t target_index_count,
+                                   float* error = nullptr);
+
+// Appends a chain of simplified LODs to the indices of "geometry" and returns the LODs, LOD 0
+// spanning the original indices. The new LODs are optimized for the vertex cache and the
+// vertices are reordered for the fetches of LOD 0 first. The chain stops early when the mesh
+// cannot be reduced any further, so that a single LOD is returned for small meshes.
+std::vector<MeshLod> GenerateLods(PrimitiveGeometry* geometry, const LodOptions& options = {});
+
+// Renderer meshes are drawn with the coarsest LOD whose simplification error projects to at most
+// "pixel_error" pixels, see SelectLod.
+struct LodSettings {
+  bool enabled = true;
+  float pixel_error = 1.f;
+  float hysteresis = 0.25f;
+};
+
+// Camera terms of the screen-space error, computed once per frame.
+struct LodProjection {
+  Vec3 camera_position = Vec3(0.f);
+  // Pixels covered by one world unit at a distance of one from the camera, or at any distance
+  // for orthographic projections.
+  float pixels_per_unit = 1.f;
+  bool perspective = true;
+};
+
+LodProjection ComputeLodProjection(const Camera& camera, int viewport_height);
+
+// Pixels covered by one world unit on the side of the bounding sphere closest to the camera.
+float GetPixelsPerUnit(const LodProjection& projection, const Vec3& center, float radius);
+
+// Returns the coarsest LOD whose error projects to at most "pixel_error" pixels, "pixels_per_unit"
+// being the pixels per object space unit of the mesh. Switching to a coarser LOD than
+// "previous_lod" requires the error to be below pixel_error * (1 - hysteresis) and a finer LOD is
+// only selected above pixel_error * (1 + hysteresis), so that meshes do not pop back and forth at
+// the threshold. "lods" are sorted by increasing error, as returned by GenerateLods.
+uint32_t SelectLod(std::span<const MeshLod> lods, float pixels_per_unit, uint32_t previous_lod,
+                   float pixel_error, float hysteresis);
+
+}  // namespace web_gpu_app
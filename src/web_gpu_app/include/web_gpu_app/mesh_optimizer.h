@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "web_gpu_app/primitives.h"
+
+namespace web_gpu_app {
+
+// Size of the post-transform vertex cache assumed by OptimizeVertexCache and ComputeAcmr.
+constexpr uint32_t kVertexCacheSize = 16;
+
+struct MeshOptimizationOptions {
+  bool weld = true;
+  bool optimize_vertex_cache = true;
+  bool optimize_vertex_fetch = true;
+};
+
+struct MeshStats {
+  uint32_t num_vertices = 0;
+  uint32_t num_triangles = 0;
+  // Average cache miss ratio, see ComputeAcmr.
+  float acmr = 0.f;
+  uint32_t bytes_per_vertex = 0;
+  // Vertex and index buffer sizes.
+  uint64_t num_bytes = 0;
+};
+
+MeshStats ComputeMeshStats(const PrimitiveGeometry& geometry);
+MeshStats ComputeMeshStats(const QuantizedGeometry& geometry);
+
+// Number of vertices transformed per triangle with a FIFO vertex cache of "cache_size" entries.
+// 3 is the worst case and about 0.5 the best one for large regular meshes.
+float ComputeAcmr(std::span<const uint32_t> indices, size_t num_vertices,
+                  uint32_t cache_size = kVertexCacheSize);
+
+// Merges the vertices with bitwise identical attributes, e.g. the corners shared by the faces of
+// a smooth OBJ mesh once expanded by ConvertMesh.
+void WeldVertices(PrimitiveGeometry* geometry);
+
+// Reorders the triangles for the post-transform vertex cache with Tipsify, "Fast Triangle
+// Reordering for Vertex Locality and Reduced Overdraw", Sander et al. 2007. Linear time.
+void OptimizeVertexCache(std::vector<uint32_t>* indices, size_t num_vertices,
+                         uint32_t cache_size = kVertexCacheSize);
+
+// Reorders the vertices by first use in the indices so that the vertex fetches are sequential.
+// Unused vertices are removed.
+void OptimizeVertexFetch(PrimitiveGeometry* geometry);
+
+// Runs the enabled steps in order: welding, vertex cache then vertex fetch optimization.
+void OptimizeMesh(PrimitiveGeometry* geometry, const MeshOptimizationOptions& options = {});
+
+// Quantizes positions to 16 bits in the bounding cube of the mesh and normals to 16-bit
+// octahedral coordinates. Decoded by the vertex_main_quantized entry point of the instanced
+// shader.
+QuantizedGeometry QuantizeGeometry(const PrimitiveGeometry& geometry);
+
+}  // namespace web_gpu_app
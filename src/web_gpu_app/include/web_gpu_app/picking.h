@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "web_gpu_app/bvh.h"
+#include "web_gpu_app/primitives.h"
+#include "web_gpu_app/renderer.h"
+
+namespace web_gpu_app {
+
+class MeshCache;
+
+// Ray through the point at ("x", "y") in pixels from the top left corner of a "size" canvas,
+// starting on the near plane of "camera".
+Ray ComputeScreenRay(const Camera& camera, CanvasSize size, double x, double y);
+
+enum class PickedKind : uint8_t {
+  kNone,
+  kCube,
+  kSphere,
+  kMesh,
+  kCachedMesh,
+};
+
+struct PickResult {
+  PickedKind kind = PickedKind::kNone;
+  // Index in the span of the renderables of "kind".
+  uint32_t index = 0;
+  // Triangle of a mesh, kNoTriangle for the other objects and the meshes picked on their bounds.
+  uint32_t triangle = kNoTriangle;
+  // Along the ray, in units of its direction.
+  float distance = std::numeric_limits<float>::infinity();
+  Vec3 position = Vec3(0.f);
+
+  static constexpr uint32_t kNoTriangle = ~0u;
+};
+
+struct PickerStats {
+  uint64_t num_builds = 0;
+  uint64_t num_refits = 0;
+  uint64_t build_ns = 0;
+  uint64_t refit_ns = 0;
+  uint64_t num_objects = 0;
+  uint64_t num_mesh_bvhs = 0;
+};
+
+// Picks the objects of a frame's renderables with rays: a BVH over the world bounds of the cubes,
+// spheres and meshes finds the candidates, which are then intersected exactly, meshes through a
+// BVH over their triangles in mesh space. Cached meshes are picked on their bounding sphere
+// unless their triangles were given with SetMeshTriangles.
+class Picker {
+ public:
+  // Refit is cheaper than a rebuild until the tree costs this many times its cost when built.
+  static constexpr float kMaxRefitCostRatio = 2.f;
+
+  // "mesh_cache" provides the bounds of cached meshes, which are not pickable without it.
+  explicit Picker(const MeshCache* mesh_cache = nullptr);
+  ~Picker();
+
+  void SetMeshCache(const MeshCache* mesh_cache) { mesh_cache_ = mesh_cache; }
+  // Triangles of a cached mesh, in the space of its vertices.
+  void SetMeshTriangles(MeshHandle handle, const PrimitiveGeometry& geometry);
+  void RemoveMeshTriangles(MeshHandle handle);
+
+  // Picks in "renderables" from now on, whose spans must outlive the calls to Pick. The BVH is
+  // refit when there are as many objects as before, assumed to be the same ones moved, and
+  // rebuilt otherwise or once refits degraded it too much.
+  void Update(const Renderables& renderables);
+  void Rebuild();
+  // Closest object hit by "ray".
+  PickResult Pick(const Ray& ray) const;
+
+  const Bvh& GetBvh() const { return bvh_; }
+  const PickerStats& GetStats() const { return stats_; }
+
+ private:
+  struct MeshTriangles {
+    // Three vertices per triangle.
+    std::vector<Vec3> positions;
+    Aabb bounds;
+    Bvh bvh;
+    // Meshes given with SetMeshTriangles are kept until removed, the others while drawn.
+    bool pinned = false;
+    bool used = false;
+  };
+
+  void ComputeBounds();
+  MeshTriangles* GetTriangles(const Mesh& mesh);
+  static void BuildTriangles(MeshTriangles* triangles);
+  float IntersectObject(uint32_t object, const Ray& ray, float max_distance,
+                        uint32_t* triangle) const;
+
+  const MeshCache* mesh_cache_ = nullptr;
+  Renderables renderables_;
+  // Objects are numbered cubes first, then spheres, meshes and cached meshes.
+  uint32_t first_sphere_ = 0;
+  uint32_t first_mesh_ = 0;
+  uint32_t first_cached_mesh_ = 0;
+  uint32_t num_objects_ = 0;
+  std::vector<Aabb> bounds_;
+  // Triangles of the meshes, or nullptr if picked on their bounds.
+  std::vector<const MeshTriangles*> mesh_triangles_;
+  std::unordered_map<MeshHandle, MeshTriangles> triangles_;
+  Bvh bvh_;
+  float built_cost_ = 0.f;
+  PickerStats stats_;
+};
+
+}  // namespace web_gpu_app
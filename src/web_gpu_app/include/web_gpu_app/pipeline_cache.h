@@ -0,0 +1,151 @@
+#pragma once
+
+#include <webgpu/webgpu_cpp.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace web_gpu_app {
+
+struct BlobCacheStats {
+  uint64_t num_hits = 0;
+  uint64_t num_misses = 0;
+  uint64_t num_stores = 0;
+  uint64_t loaded_bytes = 0;
+  uint64_t stored_bytes = 0;
+};
+
+// Key-value store backing Dawn's blob cache, i.e. compiled shaders and pipelines, persisted as
+// one file per entry so that later launches skip compilation. Dawn calls it from any thread.
+class BlobCache {
+ public:
+  static BlobCache& Get();
+
+  // Entries are only kept in memory while the directory is empty, which is the default on
+  // Emscripten. Must be set before the device is created.
+  void SetDirectory(const std::filesystem::path& directory);
+  const std::filesystem::path& GetDirectory() const { return directory_; }
+
+  // Returns the size of the value stored for "key", or 0 if there is none. The value is copied to
+  // "value" if it is large enough.
+  size_t Load(const void* key, size_t key_size, void* value, size_t value_size);
+  void Store(const void* key, size_t key_size, const void* value, size_t value_size);
+
+  // Loads and stores issued by Dawn.
+  BlobCacheStats GetStats();
+
+#if !defined(__EMSCRIPTEN__)
+  // Adds the load and store hooks to "descriptor", which must then be chained to the device
+  // descriptor. Browsers cache pipelines themselves.
+  void InitDeviceDescriptor(wgpu::DawnCacheDeviceDescriptor* descriptor);
+#endif
+
+ private:
+  BlobCache();
+
+  static size_t LoadData(const void* key, size_t key_size, void* value, size_t value_size,
+                         void* user_data);
+  static void StoreData(const void* key, size_t key_size, const void* value, size_t value_size,
+                        void* user_data);
+
+  std::filesystem::path GetPath(const std::string& key) const;
+  const std::vector<uint8_t>* Find(const std::string& key);
+
+  std::mutex mutex_;
+  std::filesystem::path directory_;
+  std::unordered_map<std::string, std::vector<uint8_t>> entries_;
+  BlobCacheStats stats_;
+};
+
+struct PipelineCacheStats {
+  uint64_t num_shader_modules = 0;
+  uint64_t num_pipelines = 0;
+  uint64_t num_hits = 0;
+  uint64_t num_pending = 0;
+  // Time between each pipeline's request and its creation.
+  uint64_t creation_ns = 0;
+  // Sum over pipelines of the creation time of their first ever creation minus the current one.
+  uint64_t saved_ns = 0;
+};
+
+// Shader modules, render and compute pipelines keyed by a hash of their WGSL source and descriptor
+// state. Pipelines are created asynchronously so that a frame never waits for one.
+class PipelineCache {
+ public:
+  using Callback = std::function<void(wgpu::RenderPipeline)>;
+  using ComputeCallback = std::function<void(wgpu::ComputePipeline)>;
+
+  explicit PipelineCache(wgpu::Device device);
+  ~PipelineCache();
+
+  wgpu::ShaderModule GetShaderModule(const char* code);
+  // Layouts are created once per distinct descriptor and hashed by content, so that pipelines
+  // using them keep their keys across launches. Bind group layouts passed to GetPipelineLayout
+  // should come from GetBindGroupLayout, other ones are hashed by handle.
+  wgpu::BindGroupLayout GetBindGroupLayout(const wgpu::BindGroupLayoutDescriptor& descriptor);
+  wgpu::PipelineLayout GetPipelineLayout(std::span<const wgpu::BindGroupLayout> layouts);
+
+  // Invokes "callback" with the pipeline once it is created, immediately if it already is.
+  // Shader modules and layouts referenced by "descriptor" should come from this cache to be hashed
+  // by content, other ones are hashed by handle.
+  void GetRenderPipeline(const wgpu::RenderPipelineDescriptor& descriptor, Callback callback);
+  void GetComputePipeline(const wgpu::ComputePipelineDescriptor& descriptor,
+                          ComputeCallback callback);
+
+  // Blocks until all requested pipelines are created. Not available on Emscripten.
+  void WaitIdle();
+
+  const PipelineCacheStats& GetStats() const { return stats_; }
+
+ private:
+  struct Entry {
+    wgpu::RenderPipeline pipeline;
+    uint64_t request_ns = 0;
+    std::vector<Callback> callbacks;
+  };
+  struct ComputeEntry {
+    wgpu::ComputePipeline pipeline;
+    uint64_t request_ns = 0;
+    std::vector<ComputeCallback> callbacks;
+  };
+  struct PendingRequest {
+    std::shared_ptr<PipelineCache*> cache;
+    uint64_t key = 0;
+  };
+
+  static void OnPipelineCreated(WGPUCreatePipelineAsyncStatus status, WGPURenderPipeline pipeline,
+                                const char* message, void* user_data);
+  static void OnComputePipelineCreated(WGPUCreatePipelineAsyncStatus status,
+                                       WGPUComputePipeline pipeline, const char* message,
+                                       void* user_data);
+  uint64_t HashLayout(const wgpu::PipelineLayout& layout) const;
+  uint64_t HashDescriptor(const wgpu::RenderPipelineDescriptor& descriptor) const;
+  uint64_t HashDescriptor(const wgpu::ComputePipelineDescriptor& descriptor) const;
+  void RecordCreationTime(uint64_t key, uint64_t creation_ns);
+  // Prints the creation times once the first pipelines are all created.
+  void ReportWhenIdle();
+
+  wgpu::Device device_;
+  std::unordered_map<uint64_t, wgpu::ShaderModule> shader_modules_;
+  // Source hash of the shader modules created by GetShaderModule.
+  std::unordered_map<WGPUShaderModule, uint64_t> shader_module_hashes_;
+  std::unordered_map<uint64_t, wgpu::BindGroupLayout> bind_group_layouts_;
+  std::unordered_map<WGPUBindGroupLayout, uint64_t> bind_group_layout_hashes_;
+  std::unordered_map<uint64_t, wgpu::PipelineLayout> pipeline_layouts_;
+  std::unordered_map<WGPUPipelineLayout, uint64_t> pipeline_layout_hashes_;
+  std::unordered_map<uint64_t, Entry> pipelines_;
+  std::unordered_map<uint64_t, ComputeEntry> compute_pipelines_;
+  // Nulled on destruction so that callbacks of pending pipelines are ignored.
+  std::shared_ptr<PipelineCache*> self_;
+  PipelineCacheStats stats_;
+  bool reported_ = false;
+};
+
+}  // namespace web_gpu_app
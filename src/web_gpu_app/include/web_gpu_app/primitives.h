@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "web_gpu_app/renderer.h"
+
+namespace web_gpu_app {
+
+struct Vertex {
+  Vec3 position;
+  Vec3 normal;
+};
+
+struct PrimitiveGeometry {
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+};
+
+// Range of the indices of a mesh drawing one level of detail. All the LODs of a mesh share its
+// vertices.
+struct MeshLod {
+  uint32_t first_index = 0;
+  uint32_t num_indices = 0;
+  // Object space deviation from the full detail mesh, 0 for LOD 0. See GenerateLods.
+  float error = 0.f;
+};
+
+struct BoundingSphere {
+  Vec3 center = Vec3(0.f);
+  float radius = 0.f;
+};
+
+// Vertex compressed by QuantizeGeometry, 12 bytes instead of 24.
+struct QuantizedVertex {
+  // Unorm16 position in the bounding cube of the mesh, w is unused.
+  uint16_t position[4];
+  // Snorm16 octahedral encoding of the unit normal.
+  int16_t normal[2];
+};
+
+struct QuantizedGeometry {
+  std::vector<QuantizedVertex> vertices;
+  std::vector<uint32_t> indices;
+  // The object space position is position_offset + position_scale * unorm(position).
+  Vec3 position_offset = Vec3(0.f);
+  float position_scale = 1.f;
+  BoundingSphere bounds;
+};
+
+// Sphere centered on the bounding box of the vertices, not the tightest one.
+BoundingSphere ComputeBoundingSphere(const PrimitiveGeometry& geometry);
+
+// Unit cube centered on the origin with an edge length of 1.
+PrimitiveGeometry CreateCubeGeometry();
+
+// Unit sphere centered on the origin with a radius of 1.
+PrimitiveGeometry CreateSphereGeometry(uint32_t num_segments = 24, uint32_t num_rings = 16);
+
+}  // namespace web_gpu_app
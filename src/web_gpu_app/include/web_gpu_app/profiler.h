@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+#define WEB_GPU_APP_CONCAT_IMPL(a, b) a##b
+#define WEB_GPU_APP_CONCAT(a, b) WEB_GPU_APP_CONCAT_IMPL(a, b)
+
+// Times the enclosing scope. "name" must have static storage duration, e.g. a string literal.
+#define PROFILE_SCOPE(name) \
+  ::web_gpu_app::ProfileScope WEB_GPU_APP_CONCAT(profile_scope_, __LINE__)(name)
+
+namespace web_gpu_app {
+
+struct ProfileEvent {
+  const char* name = nullptr;
+  uint64_t begin_ns = 0;
+  uint64_t end_ns = 0;
+  uint32_t thread_id = 0;
+  uint32_t depth = 0;
+};
+
+// Value of the frame, e.g. a count of state changes.
+struct ProfileCounter {
+  const char* name = nullptr;
+  uint64_t time_ns = 0;
+  double value = 0;
+};
+
+struct FrameTimeStats {
+  float average_ms = 0;
+  float p50_ms = 0;
+  float p95_ms = 0;
+  float p99_ms = 0;
+  float max_ms = 0;
+};
+
+// Frame profiler collecting nested CPU scopes from any thread and GPU pass timings. Each thread
+// writes its events to its own lock-free ring buffer which the main thread drains at the end of
+// every frame. When disabled, a scope costs a single relaxed atomic load.
+class Profiler {
+ public:
+  static constexpr uint32_t kGpuThreadId = 0xffffffff;
+  static constexpr size_t kFrameHistorySize = 256;
+
+  static Profiler& Get();
+  static uint64_t NowNs();
+  static bool IsEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  void SetEnabled(bool enabled);
+  void SetOverlayVisible(bool visible) { overlay_visible_ = visible; }
+  bool IsOverlayVisible() const { return overlay_visible_; }
+
+  // Main thread only.
+  void BeginFrame();
+  void EndFrame();
+  void AddGpuEvent(const char* name, uint64_t begin_ns, uint64_t end_ns);
+  // Shown by the overlay and written to the traces as counter events, once per frame: the last
+  // value set in the frame wins. "name" must have static storage duration.
+  void SetCounter(const char* name, double value);
+
+  // Any thread.
+  void AddEvent(const ProfileEvent& event);
+
+  // Keeps all events of the next "num_frames" frames for WriteChromeTrace.
+  void StartCapture(uint32_t num_frames);
+  bool IsCapturing() const { return capture_frames_left_ > 0; }
+  // Writes captured events in the Chrome trace event format (chrome://tracing, Perfetto).
+  bool WriteChromeTrace(const std::string& file_name) const;
+
+  std::span<const ProfileEvent> GetLastFrameEvents() const { return last_frame_events_; }
+  std::span<const ProfileCounter> GetLastFrameCounters() const { return last_frame_counters_; }
+  FrameTimeStats GetFrameTimeStats() const;
+  uint64_t GetNumDroppedEvents() const { return num_dropped_events_; }
+
+  void DrawOverlay();
+
+  static thread_local uint32_t scope_depth_;
+
+ private:
+  struct ThreadBuffer;
+
+  Profiler();
+  ~Profiler();
+  ThreadBuffer* GetThreadBuffer();
+  void DrainThreadBuffers();
+
+  static std::atomic<bool> enabled_;
+  static thread_local ThreadBuffer* thread_buffer_;
+
+  std::mutex thread_buffers_mutex_;
+  std::vector<std::unique_ptr<ThreadBuffer>> thread_buffers_;
+  std::vector<ProfileEvent> frame_events_;
+  std::vector<ProfileEvent> last_frame_events_;
+  std::vector<ProfileEvent> captured_events_;
+  std::vector<ProfileCounter> frame_counters_;
+  std::vector<ProfileCounter> last_frame_counters_;
+  std::vector<ProfileCounter> captured_counters_;
+  uint32_t capture_frames_left_ = 0;
+  std::vector<float> frame_times_ms_;
+  size_t frame_time_index_ = 0;
+  uint64_t frame_begin_ns_ = 0;
+  uint64_t num_dropped_events_ = 0;
+  bool overlay_visible_ = true;
+};
+
+class ProfileScope {
+ public:
+  explicit ProfileScope(const char* name) {
+    if (Profiler::IsEnabled()) {
+      name_ = name;
+      depth_ = Profiler::scope_depth_++;
+      begin_ns_ = Profiler::NowNs();
+    }
+  }
+
+  ~ProfileScope() {
+    if (name_ != nullptr) {
+      --Profiler::scope_depth_;
+      Profiler::Get().AddEvent({name_, begin_ns_, Profiler::NowNs(), 0, depth_});
+    }
+  }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+ private:
+  const char* name_ = nullptr;
+  uint64_t begin_ns_ = 0;
+  uint32_t depth_ = 0;
+};
+
+}  // namespace web_gpu_app
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <webgpu/webgpu_cpp.h>
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "web_gpu_app/gpu_profiler.h"
+
+namespace web_gpu_app {
+
+// Index of a texture or buffer in its RenderGraph, valid until the graph is reset.
+using RenderGraphResource = uint32_t;
+
+struct TransientTextureDescriptor {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  wgpu::TextureFormat format = wgpu::TextureFormat::Undefined;
+  // Compile adds the usages of the passes: RenderAttachment, and TextureBinding if read.
+  wgpu::TextureUsage usage = wgpu::TextureUsage::None;
+
+  bool operator==(const TransientTextureDescriptor& other) const = default;
+};
+
+struct TransientTexturePoolStats {
+  uint64_t num_created = 0;
+  uint64_t num_evicted = 0;
+  uint64_t num_textures = 0;
+};
+
+// Textures backing the transient textures of render graphs, keyed by descriptor and reused across
+// frames. Textures unused for "max_unused_frames" frames are released by BeginFrame, e.g. those of
+// the previous size after a resize.
+class TransientTexturePool {
+ public:
+  explicit TransientTexturePool(wgpu::Device device, uint32_t max_unused_frames = 3);
+  ~TransientTexturePool();
+
+  // View of the "index"-th texture matching "descriptor", created on first use.
+  wgpu::TextureView Acquire(const TransientTextureDescriptor& descriptor, uint32_t index);
+  void BeginFrame();
+
+  const TransientTexturePoolStats& GetStats() const { return stats_; }
+
+ private:
+  struct Texture {
+    TransientTextureDescriptor descriptor;
+    uint32_t index = 0;
+    wgpu::Texture texture;
+    wgpu::TextureView view;
+    uint64_t last_used_frame = 0;
+  };
+
+  wgpu::Device device_;
+  uint32_t max_unused_frames_ = 0;
+  uint64_t frame_ = 0;
+  // A handful of textures: searched linearly.
+  std::vector<Texture> textures_;
+  TransientTexturePoolStats stats_;
+};
+
+struct RenderGraphResourceInfo {
+  const char* name = nullptr;
+  // Imported textures and buffers are owned by the caller. Imported textures are outputs of the
+  // frame, e.g. the swap chain: the passes writing them are kept and their attachments stored.
+  // Imported buffers only order the passes: their writers are culled unless a kept pass reads them.
+  bool imported = false;
+  bool buffer = false;
+  TransientTextureDescriptor descriptor;
+  // Set by Compile: first and last kept passes accessing the resource, kNoPass if none, and the
+  // index of the pool texture backing a transient texture, shared by textures with the same
+  // descriptor whose lifetimes do not overlap.
+  uint32_t first_pass = 0;
+  uint32_t last_pass = 0;
+  uint32_t physical_index = 0;
+};
+
+struct RenderGraphAttachment {
+  RenderGraphResource texture = 0;
+  bool depth = false;
+  // Attachments which are not cleared keep the contents written by the previous passes.
+  bool clear = false;
+  wgpu::Color clear_color = {};
+  float clear_depth = 1.f;
+  // Depth attachments only tested against, which leaves them unchanged.
+  bool read_only = false;
+  // Set by Compile. Loaded only if a kept pass wrote the texture before, stored only if a kept
+  // pass accesses it afterwards or if it is imported.
+  wgpu::LoadOp load_op = wgpu::LoadOp::Undefined;
+  wgpu::StoreOp store_op = wgpu::StoreOp::Undefined;
+};
+
+// Reads and writes of a pass besides its attachments, e.g. sampled textures or storage buffers.
+// A write replaces the contents: passes modifying a resource also read it.
+struct RenderGraphAccess {
+  RenderGraphResource resource = 0;
+  bool write = false;
+};
+
+struct RenderGraphPassInfo {
+  const char* name = nullptr;
+  bool render = false;
+  // Kept even if nothing reads its outputs, e.g. readbacks.
+  bool side_effects = false;
+  // Set by Compile.
+  bool culled = false;
+  uint32_t first_attachment = 0;
+  uint32_t num_attachments = 0;
+  uint32_t first_access = 0;
+  uint32_t num_accesses = 0;
+};
+
+struct RenderGraphStats {
+  uint32_t num_passes = 0;
+  uint32_t num_culled_passes = 0;
+  uint32_t num_transient_textures = 0;
+  // Pool textures backing the transient textures once aliased.
+  uint32_t num_physical_textures = 0;
+  uint32_t num_discarded_attachments = 0;
+};
+
+// Passes of a frame declaring the textures they draw to and the resources they read and write.
+// Compile culls the passes whose outputs are never used, picks the load and store operations of
+// the attachments, and assigns transient textures to pool textures, aliasing the ones whose
+// lifetimes do not overlap. Compile only runs on the CPU, Execute records the kept passes in
+// order. The graph is rebuilt every frame: Reset keeps the memory of the previous one.
+class RenderGraph {
+ public:
+  using RenderCallback = std::function<void(wgpu::RenderPassEncoder)>;
+  using EncoderCallback = std::function<void(wgpu::CommandEncoder)>;
+
+  static constexpr uint32_t kNoPass = ~0u;
+
+  // Declares the attachments and accesses of the last pass added to "graph".
+  class PassBuilder {
+   public:
+    PassBuilder(RenderGraph* graph, uint32_t pass) : graph_(graph), pass_(pass) {}
+
+    PassBuilder& AddColorAttachment(RenderGraphResource texture);
+    PassBuilder& AddColorAttachment(RenderGraphResource texture, wgpu::Color clear_color);
+    PassBuilder& SetDepthAttachment(RenderGraphResource texture);
+    PassBuilder& SetDepthAttachment(RenderGraphResource texture, float clear_depth);
+    PassBuilder& SetReadOnlyDepthAttachment(RenderGraphResource texture);
+    PassBuilder& Read(RenderGraphResource resource);
+    PassBuilder& Write(RenderGraphResource resource);
+    PassBuilder& SetSideEffects();
+
+   private:
+    PassBuilder& AddAttachment(const RenderGraphAttachment& attachment);
+    PassBuilder& AddAccess(RenderGraphResource resource, bool write);
+
+    RenderGraph* graph_ = nullptr;
+    uint32_t pass_ = 0;
+  };
+
+  RenderGraph();
+  ~RenderGraph();
+
+  void Reset();
+
+  RenderGraphResource CreateTexture(const char* name, const TransientTextureDescriptor& descriptor);
+  RenderGraphResource ImportTexture(const char* name, wgpu::TextureView view);
+  RenderGraphResource ImportBuffer(const char* name);
+
+  // "name" must have static storage duration: it also names the pass in the GPU profiler.
+  PassBuilder AddRenderPass(const char* name, RenderCallback callback);
+  // Records anything but a render pass on the frame's encoder, e.g. a compute pass or copies.
+  PassBuilder AddEncoderPass(const char* name, EncoderCallback callback);
+
+  // Returns false and sets "error" if a pass has no attachment or reads a transient resource that
+  // no kept pass wrote before.
+  bool Compile(std::string* error = nullptr);
+  // Records the kept passes of the compiled graph, transient textures coming from "pool".
+  void Execute(wgpu::CommandEncoder encoder, TransientTexturePool* pool,
+               GpuProfiler* profiler = nullptr);
+
+  std::span<const RenderGraphResourceInfo> GetResources() const { return resources_; }
+  std::span<const RenderGraphPassInfo> GetPasses() const { return pass_infos_; }
+  std::span<const RenderGraphAttachment> GetAttachments(const RenderGraphPassInfo& pass) const {
+    return std::span(attachments_).subspan(pass.first_attachment, pass.num_attachments);
+  }
+  std::span<const RenderGraphAccess> GetAccesses(const RenderGraphPassInfo& pass) const {
+    return std::span(accesses_).subspan(pass.first_access, pass.num_accesses);
+  }
+  // Of the last Compile.
+  const RenderGraphStats& GetStats() const { return stats_; }
+
+ private:
+  struct PhysicalTexture {
+    TransientTextureDescriptor descriptor;
+    uint32_t index = 0;
+    uint32_t last_pass = 0;
+  };
+
+  RenderGraphResource AddResource(const RenderGraphResourceInfo& resource);
+  uint32_t AddPass(const char* name, bool render);
+  bool CheckResource(const RenderGraphPassInfo& pass, RenderGraphResource resource,
+                     bool allow_buffer, std::string* error) const;
+  void CullPasses();
+  void AssignPhysicalTextures();
+
+  std::vector<RenderGraphResourceInfo> resources_;
+  std::vector<wgpu::TextureView> views_;
+  std::vector<RenderGraphPassInfo> pass_infos_;
+  std::vector<RenderCallback> render_callbacks_;
+  std::vector<EncoderCallback> encoder_callbacks_;
+  std::vector<RenderGraphAttachment> attachments_;
+  std::vector<RenderGraphAccess> accesses_;
+  // Scratch of Compile and Execute, kept across frames.
+  std::vector<uint8_t> live_;
+  std::vector<uint32_t> transient_order_;
+  std::vector<PhysicalTexture> physical_textures_;
+  std::vector<wgpu::RenderPassColorAttachment> color_attachments_;
+  RenderGraphStats stats_;
+  bool compiled_ = false;
+};
+
+}  // namespace web_gpu_app
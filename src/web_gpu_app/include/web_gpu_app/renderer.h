@@ -10,8 +10,13 @@
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
+#include <cstdint>
 #include <span>
 
+namespace web_gpu_app {
+class RetainedScene;
+}
+
 using Vec3 = glm::vec3;
 using Vec4 = glm::vec4;
 using Mat4 = glm::mat4;
@@ -50,6 +55,34 @@ struct Mesh {
   Mat4 transform;
   tinyobj::mesh_t mesh;
   float scale = 1.f;
+  const tinyobj::attrib_t* attrib = nullptr;
+  // Level of detail drawn in the last frame, written by the renderer for the hysteresis of the
+  // LOD selection.
+  uint32_t lod = 0;
+};
+
+// Handle of a mesh uploaded to the renderer's mesh cache, see MeshCache::Add.
+using MeshHandle = uint64_t;
+
+// Handle of a texture uploaded to the renderer's texture manager, see TextureManager::Add.
+using TextureHandle = uint64_t;
+
+// Mesh referencing geometry that is already resident in the mesh cache.
+struct CachedMesh {
+  Mat4 transform;
+  MeshHandle handle = 0;
+  float scale = 1.f;
+  Color color = Color(0.8f, 0.8f, 0.8f, 1.f);
+  // Modulates "color", mapped triplanarly since meshes have no texture coordinates. The mesh is
+  // drawn untextured until the texture is ready.
+  TextureHandle texture = 0;
+  // Same as Mesh::lod.
+  uint32_t lod = 0;
+};
+
+struct Camera {
+  Mat4 view = Mat4(1.f);
+  Mat4 projection = Mat4(1.f);
 };
 
 struct Renderables {
@@ -58,6 +91,11 @@ struct Renderables {
   std::span<Cube> cubes;
   std::span<Sphere> spheres;
   std::span<Mesh> meshes;
+  std::span<CachedMesh> cached_meshes;
+  // Objects kept between frames, drawn along with the ones above. Only its edits since the last
+  // frame are uploaded.
+  web_gpu_app::RetainedScene* scene = nullptr;
+  Camera camera;
 };
 
 class Renderer {
@@ -68,4 +106,10 @@ class Renderer {
   virtual void EndFrame(const Renderables& renderables) = 0;
   virtual void OnResize(int width, int height) = 0;
   virtual void* GetWindow() const = 0;
+  // Blocks until a new frame can be started without exceeding the frames in flight, before the
+  // frame's input is polled so that it is as recent as possible when the frame is presented.
+  virtual void WaitForNextFrame() {}
+  // Whether work started by previous frames, e.g. pipeline creation, will change the next frames
+  // even without new input.
+  virtual bool HasPendingWork() const { return false; }
 };
\ No newline at end of file
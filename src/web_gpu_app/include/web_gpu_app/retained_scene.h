@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "web_gpu_app/instance_packing.h"
+#include "web_gpu_app/renderer.h"
+
+namespace web_gpu_app {
+
+// Stable handle of an object of a RetainedScene, 0 is never a valid one. Handles of removed
+// objects stay invalid even once their slot is reused.
+using SceneObjectHandle = uint64_t;
+
+enum class SceneObjectKind : uint8_t {
+  kCube,
+  kSphere,
+};
+
+inline constexpr size_t kNumSceneObjectKinds = 2;
+
+// Instances [begin, end) of a kind.
+struct DirtyRange {
+  uint32_t begin = 0;
+  uint32_t end = 0;
+};
+
+struct RetainedSceneStats {
+  uint64_t num_edits = 0;
+  // Instances and ranges returned by TakeDirtyRanges, including the clean instances merged into
+  // the ranges.
+  uint64_t num_dirty_instances = 0;
+  uint64_t num_dirty_ranges = 0;
+};
+
+// Objects created once and kept packed between frames, as opposed to the Renderables handed over
+// every frame. The instances of each kind are kept dense, in the order of the GPU instance buffer
+// that the renderer keeps for them, and the ones edited since the last TakeDirtyRanges are the
+// only ones it uploads. Removing an object moves the last instance of its kind into its place.
+// Not thread safe: in pipelined mode, edit the scene in FixedUpdate or UpdateUi since the renderer
+// reads it while Update runs.
+class RetainedScene {
+ public:
+  // Dirty instances separated by at most this many clean ones are merged into one range: uploading
+  // a few clean instances costs less than another write.
+  static constexpr uint32_t kMaxRangeGap = 4;
+
+  SceneObjectHandle AddCube(const Cube& cube);
+  SceneObjectHandle AddSphere(const Sphere& sphere);
+  // Returns false if "handle" is not a valid handle, as the setters do.
+  bool Remove(SceneObjectHandle handle);
+  void Clear();
+  bool Contains(SceneObjectHandle handle) const;
+
+  bool SetTransform(SceneObjectHandle handle, const Mat4& transform);
+  bool SetColor(SceneObjectHandle handle, const Color& color);
+  // Cube size or sphere radius.
+  bool SetScale(SceneObjectHandle handle, float scale);
+  // Index of the object's instance in GetInstances, which changes when objects are removed.
+  bool GetInstanceIndex(SceneObjectHandle handle, SceneObjectKind* kind, uint32_t* index) const;
+
+  std::span<const PackedInstance> GetInstances(SceneObjectKind kind) const {
+    return groups_[static_cast<size_t>(kind)].instances;
+  }
+  // Transforms and scales of the instances, e.g. for culling or picking.
+  std::span<const Mat4> GetTransforms(SceneObjectKind kind) const {
+    return groups_[static_cast<size_t>(kind)].transforms;
+  }
+  std::span<const float> GetScales(SceneObjectKind kind) const {
+    return groups_[static_cast<size_t>(kind)].scales;
+  }
+  size_t size() const;
+
+  // Replaces "ranges" with the sorted ranges of the instances of "kind" edited, added or moved
+  // since the last call, and marks them clean.
+  void TakeDirtyRanges(SceneObjectKind kind, std::vector<DirtyRange>* ranges);
+  // Marks every instance dirty, e.g. when the GPU buffer was lost.
+  void MarkAllDirty();
+
+  const RetainedSceneStats& GetStats() const { return stats_; }
+
+ private:
+  struct Slot {
+    uint32_t generation = 0;
+    SceneObjectKind kind = SceneObjectKind::kCube;
+    uint32_t instance = 0;
+    bool alive = false;
+  };
+  struct Group {
+    std::vector<PackedInstance> instances;
+    std::vector<Mat4> transforms;
+    std::vector<float> scales;
+    // Slot of each instance.
+    std::vector<uint32_t> slots;
+    std::vector<uint8_t> dirty_flags;
+    // Instances whose flag was set, possibly twice or beyond the end after removals.
+    std::vector<uint32_t> dirty;
+    bool all_dirty = false;
+  };
+
+  SceneObjectHandle Add(SceneObjectKind kind, const Mat4& transform, float scale,
+                        const Color& color);
+  Slot* GetSlot(SceneObjectHandle handle);
+  const Slot* GetSlot(SceneObjectHandle handle) const;
+  // Packs the transform and scale of "instance", keeping its color.
+  static void Pack(Group* group, uint32_t instance);
+  void MarkDirty(Group* group, uint32_t instance);
+
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_slots_;
+  Group groups_[kNumSceneObjectKinds];
+  RetainedSceneStats stats_;
+};
+
+}  // namespace web_gpu_app
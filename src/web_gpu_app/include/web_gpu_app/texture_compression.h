@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "web_gpu_app/texture_file.h"
+#include "web_gpu_app/thread_pool.h"
+
+namespace web_gpu_app {
+
+// CPU side of the texture pipeline, used offline by the compress_texture tool. At runtime the
+// TextureManager generates the mips of RGBA8 textures on the GPU instead.
+
+// All levels of the RGBA8 image "pixels", level 0 first, box filtered. The colors are filtered in
+// linear space if "srgb", the alpha always is.
+std::vector<std::vector<uint8_t>> GenerateMipChain(std::span<const uint8_t> pixels,
+                                                   uint32_t width, uint32_t height, bool srgb);
+
+bool IsOpaque(std::span<const uint8_t> pixels);
+
+// Encodes the RGBA8 image "pixels" of any size in "format", partial blocks replicate the edge
+// pixels. The encoders favor speed over quality: a principal axis fit for BC1, the individual and
+// differential modes of ETC1 for the color of ETC2, and a bounded search for the alpha blocks.
+// Rows of blocks are split across "thread_pool" if there is one.
+std::vector<uint8_t> CompressImage(std::span<const uint8_t> pixels, uint32_t width,
+                                   uint32_t height, TextureFileFormat format,
+                                   ThreadPool* thread_pool = nullptr);
+
+}  // namespace web_gpu_app
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "web_gpu_app/mapped_file.h"
+
+namespace web_gpu_app {
+
+// Binary texture container holding the full mip chain of a texture in one or more formats, so
+// that each device uploads the best one it supports. Convert images with the compress_texture
+// tool. The file is laid out as, in little-endian:
+//
+//   TextureFileHeader
+//   TextureFileVariant[num_variants]
+//   Variant data: the mip levels of each variant, level 0 first, tightly packed rows of blocks,
+//   at data_offset aligned to kTextureFileAlignment.
+constexpr uint32_t kTextureFileMagic = 0x58544757;  // "WGTX"
+constexpr uint32_t kTextureFileVersion = 1;
+constexpr uint64_t kTextureFileAlignment = 16;
+constexpr uint32_t kMaxTextureFileVariants = 8;
+constexpr uint32_t kMaxTextureMipLevels = 16;
+
+enum class TextureFileFormat : uint32_t {
+  kRgba8 = 0,
+  // Opaque RGB, 4 bits per pixel.
+  kBc1 = 1,
+  // RGBA, 8 bits per pixel.
+  kBc3 = 2,
+  // Opaque RGB, 4 bits per pixel. Encoded in the ETC1 subset of ETC2.
+  kEtc2Rgb8 = 3,
+  // RGBA, 8 bits per pixel.
+  kEtc2Rgba8 = 4,
+};
+
+struct TextureFormatInfo {
+  // Side of the square blocks of pixels, 1 for uncompressed formats.
+  uint32_t block_size = 1;
+  uint32_t bytes_per_block = 4;
+};
+
+TextureFormatInfo GetTextureFormatInfo(TextureFileFormat format);
+const char* GetTextureFormatName(TextureFileFormat format);
+uint32_t GetNumMipLevels(uint32_t width, uint32_t height);
+// Size in bytes of mip level "level" of a "width" x "height" texture.
+uint64_t GetMipLevelSize(TextureFileFormat format, uint32_t width, uint32_t height,
+                         uint32_t level);
+
+struct TextureFileHeader {
+  uint32_t magic = kTextureFileMagic;
+  uint32_t version = kTextureFileVersion;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t num_mip_levels = 0;
+  uint32_t num_variants = 0;
+  // The colors are sRGB encoded, the alpha linear.
+  uint32_t srgb = 1;
+  uint32_t reserved = 0;
+};
+static_assert(sizeof(TextureFileHeader) == 32, "Changing the header requires a new version");
+
+struct TextureFileVariant {
+  TextureFileFormat format = TextureFileFormat::kRgba8;
+  uint32_t reserved = 0;
+  uint64_t data_offset = 0;
+  uint64_t data_size = 0;
+};
+
+// Mip levels of one format, level 0 first, as written to the file.
+struct TextureVariant {
+  TextureFileFormat format = TextureFileFormat::kRgba8;
+  std::vector<std::vector<uint8_t>> levels;
+};
+
+// Errors are reported on std::cerr.
+bool WriteTextureFile(const std::string& file_name, uint32_t width, uint32_t height, bool srgb,
+                      std::span<const TextureVariant> variants);
+
+// Validated view of a texture file, the mip levels point into the mapping.
+class TextureFile {
+ public:
+  // Returns false and sets "error" if the file cannot be read or is not a valid texture file of a
+  // supported version.
+  bool Open(const std::string& file_name, std::string* error = nullptr);
+  bool Open(MappedFile file, std::string* error = nullptr);
+  void Close();
+  bool IsOpen() const { return header_.num_variants > 0; }
+
+  const TextureFileHeader& GetHeader() const { return header_; }
+  std::span<const TextureFileVariant> GetVariants() const { return variants_; }
+  const TextureFileVariant* FindVariant(TextureFileFormat format) const;
+  // Valid until the file is closed.
+  std::span<const uint8_t> GetMipLevel(const TextureFileVariant& variant, uint32_t level) const;
+
+  // Reads every page of the data, see MeshFile::Prefetch.
+  void Prefetch() const;
+
+ private:
+  MappedFile file_;
+  TextureFileHeader header_;
+  std::vector<TextureFileVariant> variants_;
+};
+
+}  // namespace web_gpu_app
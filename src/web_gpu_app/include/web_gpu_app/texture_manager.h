@@ -0,0 +1,145 @@
+#pragma once
+
+#include <webgpu/webgpu_cpp.h>
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "web_gpu_app/pipeline_cache.h"
+#include "web_gpu_app/renderer.h"
+#include "web_gpu_app/texture_file.h"
+
+namespace web_gpu_app {
+
+struct TextureInfo {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t num_mip_levels = 0;
+  wgpu::TextureFormat format = wgpu::TextureFormat::Undefined;
+  // Texture array holding the texture, and the texture's layer in it.
+  uint32_t array = 0;
+  uint32_t layer = 0;
+  // GPU memory of the layer, all mip levels included.
+  uint64_t gpu_bytes = 0;
+};
+
+struct TextureManagerStats {
+  uint64_t num_textures = 0;
+  uint64_t num_arrays = 0;
+  // GPU memory of the textures, and of the arrays including their free layers.
+  uint64_t texture_bytes = 0;
+  uint64_t allocated_bytes = 0;
+  uint64_t uploaded_bytes = 0;
+  uint64_t num_mip_dispatches = 0;
+  // Arrays recreated with twice the layers, copying the previous ones on the GPU.
+  uint64_t num_array_grows = 0;
+};
+
+// GPU textures packed into texture arrays by size, mip levels and format, so that meshes with
+// different textures of the same kind are drawn with one bind group. Uploads go through staging
+// buffers and are recorded, along with the compute passes generating the mips of RGBA8 textures,
+// into a command buffer returned by FinishUploads. Decoding is left to the AssetLoader threads.
+//
+// The colors are uploaded and sampled as stored: the swap chain is not sRGB either. The sRGB flag
+// of a texture only makes its mips filtered in linear space.
+class TextureManager {
+ public:
+  TextureManager(wgpu::Device device, PipelineCache* pipeline_cache);
+  ~TextureManager();
+
+  // Uploads the RGBA8 "pixels" and generates the mips on the GPU. Returns 0 if the size is not
+  // supported by the device.
+  TextureHandle Add(std::span<const uint8_t> pixels, uint32_t width, uint32_t height,
+                    bool srgb = true);
+  // Uploads the mip levels of the smallest variant of "file" that the device supports. Returns 0
+  // and sets "error" if there is none.
+  TextureHandle Add(const TextureFile& file, std::string* error = nullptr);
+  // The layer is reused by the next texture of the same kind, arrays never shrink.
+  void Remove(TextureHandle handle);
+
+  // Returns nullptr if "handle" was never added or has been removed.
+  const TextureInfo* GetInfo(TextureHandle handle) const;
+  // Whether the commands filling the texture have been returned by FinishUploads, i.e. whether it
+  // can be drawn from now on.
+  bool IsReady(TextureHandle handle) const;
+  // 2D array view of all the layers of "array".
+  wgpu::TextureView GetArrayView(uint32_t array) const;
+  // Changes each time the array grows, invalidating the bind groups of its view.
+  uint64_t GetArrayGeneration(uint32_t array) const;
+  // Trilinear and anisotropic, repeating.
+  wgpu::Sampler GetSampler() const { return sampler_; }
+  bool SupportsFormat(TextureFileFormat format) const;
+
+  // Returns the uploads and mip generation recorded since the last call, or null if there are
+  // none. To be submitted before the commands of the frame drawing the textures.
+  wgpu::CommandBuffer FinishUploads();
+  // Whether textures are waiting for FinishUploads or for the downsample pipelines.
+  bool HasPendingUploads() const { return encoder_ || !pending_mips_.empty(); }
+
+  const TextureManagerStats& GetStats() const { return stats_; }
+
+ private:
+  // Textures sharing an array.
+  struct ArrayKey {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t num_mip_levels = 0;
+    TextureFileFormat format = TextureFileFormat::kRgba8;
+
+    bool operator==(const ArrayKey& other) const = default;
+  };
+  struct TextureArray {
+    ArrayKey key;
+    wgpu::Texture texture;
+    wgpu::TextureView view;
+    uint32_t capacity = 0;
+    // Layers below "num_layers" have been allocated at least once.
+    uint32_t num_layers = 0;
+    std::vector<uint32_t> free_layers;
+    uint64_t layer_bytes = 0;
+    uint64_t generation = 0;
+  };
+  struct Texture {
+    TextureInfo info;
+    bool srgb = true;
+    bool ready = false;
+  };
+  // Mip level of the data to upload, rows of blocks tightly packed.
+  struct LevelData {
+    std::span<const uint8_t> data;
+    uint32_t level = 0;
+  };
+
+  TextureHandle AddTexture(const ArrayKey& key, bool srgb, std::span<const LevelData> levels);
+  // Returns the array and the layer allocated for "key", growing or creating an array if needed.
+  std::pair<uint32_t, uint32_t> AllocateLayer(const ArrayKey& key);
+  wgpu::Texture CreateArrayTexture(const ArrayKey& key, uint32_t capacity);
+  void GrowArray(TextureArray* array);
+  void Upload(const TextureArray& array, uint32_t layer, std::span<const LevelData> levels);
+  void GenerateMips();
+  wgpu::CommandEncoder GetEncoder();
+
+  wgpu::Device device_;
+  PipelineCache* pipeline_cache_ = nullptr;
+  wgpu::Sampler sampler_;
+  wgpu::ComputePipeline downsample_pipeline_;
+  wgpu::ComputePipeline downsample_srgb_pipeline_;
+  uint32_t max_array_layers_ = 0;
+  uint32_t max_texture_size_ = 0;
+  std::unordered_map<TextureHandle, Texture> textures_;
+  std::unordered_map<uint32_t, TextureArray> arrays_;
+  TextureHandle next_handle_ = 1;
+  uint32_t next_array_ = 1;
+  wgpu::CommandEncoder encoder_;
+  // Textures whose commands are all recorded in "encoder_".
+  std::vector<TextureHandle> recorded_;
+  // RGBA8 textures waiting for the downsample pipelines to generate their mips.
+  std::vector<TextureHandle> pending_mips_;
+  TextureManagerStats stats_;
+};
+
+}  // namespace web_gpu_app
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace web_gpu_app {
+
+class ThreadPool {
+ public:
+  // Zero threads runs every task on the calling thread, which is what single-threaded Emscripten
+  // builds get.
+  explicit ThreadPool(uint32_t num_threads = GetDefaultNumThreads());
+  ~ThreadPool();
+
+  static uint32_t GetDefaultNumThreads();
+  uint32_t GetNumThreads() const { return static_cast<uint32_t>(threads_.size()); }
+
+  void Submit(std::function<void()> task);
+
+  // Calls "function(begin, end, chunk_index)" on consecutive chunks covering [0, count), using the
+  // pool and the calling thread. Chunks hold at least "min_chunk_size" elements. Returns the
+  // number of chunks once all of them are done.
+  size_t ParallelFor(size_t count, size_t min_chunk_size,
+                     const std::function<void(size_t begin, size_t end, size_t chunk_index)>&
+                         function);
+
+ private:
+  void WorkerMain();
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<std::function<void()>> tasks_;
+  bool stopping_ = false;
+};
+
+}  // namespace web_gpu_app
@@ -2,6 +2,7 @@
 
 #include <webgpu/webgpu_cpp.h>
 
+#include <cstdint>
 #include <functional>
 #include <vector>
 
@@ -9,19 +10,52 @@ struct GLFWwindow;
 
 namespace web_gpu_app {
 
+struct UiStats {
+  uint64_t num_frames = 0;
+  // Frames whose draw data was unchanged, composited from the cache instead of rendered.
+  uint64_t num_cache_hits = 0;
+  // Vertices and indices of the rendered draw data, which the ImGui backend uploads.
+  uint64_t bytes_uploaded = 0;
+  uint64_t last_frame_bytes = 0;
+};
+
 class Ui {
  public:
-  Ui(GLFWwindow* window, wgpu::Device device);
+  // "window" can be null for headless rendering, in which case no input is processed.
+  Ui(GLFWwindow* window, wgpu::Device device, uint32_t num_frames_in_flight = 3);
   ~Ui();
 
   void BeginUiFrame();
-  void EndUiFrame(wgpu::RenderPassEncoder render_pass);
+  // Ends the ImGui frame and hashes its draw data. Returns true if "cacheable" and the draw data
+  // is the one last rendered by RenderToCache, whose result can then be composited again.
+  bool EndUiFrame(bool cacheable = false);
+  // Renders the draw data of the ended frame.
+  void RenderDrawData(wgpu::RenderPassEncoder render_pass);
+  // Same as above into the cache texture, cleared to transparent black beforehand.
+  void RenderToCache(wgpu::RenderPassEncoder render_pass);
+  // Forgets the cached draw data, e.g. when the cache texture is recreated.
+  void InvalidateCache() { cached_hash_ = 0; }
+  void SetDisplaySize(int width, int height);
+
+  // Renders the UI into a texture composited over the frames, and only when its draw data
+  // changed. Disabled by default.
+  void SetCachingEnabled(bool enabled) { caching_enabled_ = enabled; }
+  bool IsCachingEnabled() const { return caching_enabled_; }
+  const UiStats& GetStats() const { return stats_; }
 
   void SetThemeDark();
   void SetThemeDarker();
 
  private:
   std::function<void()> callback_;
+  GLFWwindow* window_ = nullptr;
+  int display_width_ = 0;
+  int display_height_ = 0;
+  // 0 if the draw data cannot be cached, e.g. because of user callbacks.
+  uint64_t draw_data_hash_ = 0;
+  uint64_t cached_hash_ = 0;
+  bool caching_enabled_ = false;
+  UiStats stats_;
 };
 
 }  // namespace web_gpu_app
\ No newline at end of file
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <webgpu/webgpu_cpp.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace web_gpu_app {
+
+struct UploadRingStats {
+  uint64_t bytes_uploaded = 0;
+  uint64_t num_allocations = 0;
+  uint64_t num_copies = 0;
+  uint64_t num_fence_stalls = 0;
+  // Time blocked waiting for the GPU in WaitForNextSlot.
+  uint64_t fence_wait_ns = 0;
+  uint64_t num_overflows = 0;
+  uint64_t high_water_mark = 0;
+};
+
+// CPU-side bookkeeping of UploadRing, free of any GPU object. Each frame in flight owns a slot
+// that is sub-allocated linearly. A slot can only be reused once the fence of the frame that last
+// used it has been signaled.
+class UploadRingAllocator {
+ public:
+  static constexpr uint64_t kInvalidOffset = ~0ull;
+
+  UploadRingAllocator(uint32_t num_slots, uint64_t slot_size);
+
+  // Whether the next slot is no longer used by the GPU. BeginFrame must only be called when true.
+  bool IsNextSlotAvailable() const;
+  // Advances to the next slot. Returns true if the slot has to be (re)created with GetSlotSize()
+  // bytes because it was never used or because a previous frame overflowed.
+  bool BeginFrame();
+  // Returns the offset of the allocation in the current slot, or kInvalidOffset if the slot is
+  // full. A failed allocation grows the slots the next time they are reused.
+  uint64_t Allocate(uint64_t size, uint64_t alignment);
+  // Closes the current frame and returns the fence value that must be signaled once the GPU is
+  // done with it.
+  uint64_t EndFrame();
+  void SignalFence(uint64_t fence);
+
+  uint32_t GetCurrentSlot() const { return current_slot_; }
+  uint64_t GetSlotSize() const { return slot_size_; }
+  uint64_t GetUsedBytes() const { return head_; }
+  uint64_t GetCompletedFence() const { return completed_fence_; }
+  uint64_t GetHighWaterMark() const { return high_water_mark_; }
+  uint64_t GetNumOverflows() const { return num_overflows_; }
+
+ private:
+  struct Slot {
+    uint64_t fence = 0;
+    uint64_t size = 0;
+  };
+
+  std::vector<Slot> slots_;
+  uint64_t slot_size_ = 0;
+  uint32_t current_slot_ = 0;
+  uint64_t head_ = 0;
+  uint64_t next_fence_ = 1;
+  uint64_t completed_fence_ = 0;
+  uint64_t high_water_mark_ = 0;
+  uint64_t num_overflows_ = 0;
+  bool in_frame_ = false;
+};
+
+struct UploadAllocation {
+  wgpu::Buffer buffer;
+  uint64_t offset = 0;
+  uint64_t size = 0;
+  void* data = nullptr;
+};
+
+// Per-frame dynamic data uploads (instances, vertices, uniforms). Allocations are written through
+// their CPU pointer and all writes of a frame are flushed to the GPU with a single copy per slot.
+class UploadRing {
+ public:
+  static constexpr wgpu::BufferUsage kUsage =
+      wgpu::BufferUsage::Vertex | wgpu::BufferUsage::Index | wgpu::BufferUsage::Uniform |
+      wgpu::BufferUsage::Storage | wgpu::BufferUsage::Indirect;
+
+  UploadRing(wgpu::Device device, uint32_t num_frames_in_flight = 3,
+             uint64_t initial_slot_size = 4 * 1024 * 1024);
+  ~UploadRing();
+
+  // Blocks until the GPU is done with the frame that last used the next slot, which limits the
+  // frames in flight to the number of slots. Called by BeginFrame if not done before.
+  void WaitForNextSlot();
+  void BeginFrame();
+  UploadAllocation Allocate(uint64_t size, uint64_t alignment = 16);
+  template <typename T>
+  UploadAllocation Upload(std::span<const T> data, uint64_t alignment = 16);
+  // Copies this frame's writes to the GPU. Must be called before submitting work that reads them.
+  void Flush();
+  // Must be called right after the frame's last submit.
+  void EndFrame();
+
+  const UploadRingStats& GetStats() const { return stats_; }
+
+ private:
+  struct FenceState {
+    std::atomic<uint64_t> completed_fence = 0;
+  };
+
+  struct Slot {
+    wgpu::Buffer buffer;
+    std::vector<uint8_t> shadow;
+  };
+
+  void ProcessCompletedFences();
+
+  wgpu::Device device_;
+  UploadRingAllocator allocator_;
+  std::vector<Slot> slots_;
+  std::vector<wgpu::Buffer> overflow_buffers_;
+  std::shared_ptr<FenceState> fence_state_;
+  uint64_t flushed_bytes_ = 0;
+  UploadRingStats stats_;
+};
+
+template <typename T>
+UploadAllocation UploadRing::Upload(std::span<const T> data, uint64_t alignment) {
+  UploadAllocation allocation = Allocate(data.size_bytes(), alignment);
+  if (allocation.data != nullptr) {
+    std::memcpy(allocation.data, data.data(), data.size_bytes());
+  }
+  return allocation;
+}
+
+}  // namespace web_gpu_app
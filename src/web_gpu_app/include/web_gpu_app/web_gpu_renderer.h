@@ -2,58 +2,327 @@
 
 #include <webgpu/webgpu_cpp.h>
 
+#include <array>
 #include <memory>
+#include <vector>
 
+#include "web_gpu_app/bind_group_cache.h"
+#include "web_gpu_app/culling.h"
+#include "web_gpu_app/draw_sort.h"
+#include "web_gpu_app/gpu_culling.h"
+#include "web_gpu_app/gpu_profiler.h"
+#include "web_gpu_app/instance_packing.h"
+#include "web_gpu_app/mesh_cache.h"
+#include "web_gpu_app/mesh_lod.h"
+#include "web_gpu_app/pipeline_cache.h"
+#include "web_gpu_app/primitives.h"
+#include "web_gpu_app/render_graph.h"
 #include "web_gpu_app/renderer.h"
+#include "web_gpu_app/retained_scene.h"
+#include "web_gpu_app/texture_manager.h"
+#include "web_gpu_app/thread_pool.h"
 #include "web_gpu_app/ui.h"
+#include "web_gpu_app/upload_ring.h"
 
 struct GLFWwindow;
 
 namespace web_gpu_app {
 
-void GetDevice(wgpu::Instance instance, void (*callback)(wgpu::Device));
+void GetDevice(wgpu::Instance instance, void (*callback)(wgpu::Device),
+               const wgpu::RequestAdapterOptions* options = nullptr);
+
+enum class HeadlessBackend {
+  kDefault,
+  kNull,
+  kSwiftShader,
+};
+
+// Rendering into an offscreen color texture without a window or swap chain.
+struct HeadlessOptions {
+  int width = 1280;
+  int height = 720;
+  HeadlessBackend backend = HeadlessBackend::kNull;
+  uint32_t frames_in_flight = 3;
+};
+
+struct PresentOptions {
+  // Fifo waits for vertical blanks, Mailbox replaces the queued frame with the latest one and
+  // Immediate presents without waiting, with tearing. Browsers always present with Fifo.
+  wgpu::PresentMode present_mode = wgpu::PresentMode::Fifo;
+  // Frames the CPU can record ahead of the GPU. Fewer frames lower the input latency, more frames
+  // absorb CPU spikes.
+  uint32_t frames_in_flight = 3;
+};
+
+// With GPU culling, the instances and triangles are counted before culling: only the GPU knows
+// which instances are visible.
+struct RenderStats {
+  uint32_t draw_calls = 0;
+  uint32_t instances = 0;
+  // Vertex shader invocations, one per index of each instance.
+  uint64_t vertices = 0;
+  uint64_t instance_bytes = 0;
+  uint32_t culled_instances = 0;
+  // Triangles drawn, and the ones that would have been drawn with LOD 0 for every mesh.
+  uint64_t triangles = 0;
+  uint64_t full_detail_triangles = 0;
+  // Bind groups requested from the BindGroupCache, by whether they had to be created.
+  uint32_t bind_groups_created = 0;
+  uint32_t bind_groups_reused = 0;
+  // Dirty instances of the retained scene written to its buffers, and the writes.
+  uint64_t retained_instance_bytes = 0;
+  uint32_t retained_writes = 0;
+  // State set while drawing the instances in sort key order. Buffers count the vertex and index
+  // buffers, bind groups the texture arrays.
+  uint32_t pipeline_switches = 0;
+  uint32_t bind_group_switches = 0;
+  uint32_t buffer_switches = 0;
+  // Cubes, spheres and meshes whose color has an alpha below 1, blended back to front after the
+  // opaque ones.
+  uint32_t translucent_instances = 0;
+  // Sorting the translucent objects and the batches.
+  uint64_t sort_ns = 0;
+};
 
 class WebGpuRenderer : public Renderer {
  public:
   static void Create(GLFWwindow* window,
-                     std::function<void(std::unique_ptr<WebGpuRenderer>)> callback);
+                     std::function<void(std::unique_ptr<WebGpuRenderer>)> callback,
+                     const PresentOptions& present_options = {});
+
+  static void CreateHeadless(const HeadlessOptions& options,
+                             std::function<void(std::unique_ptr<WebGpuRenderer>)> callback);
+  static wgpu::RequestAdapterOptions GetAdapterOptions(HeadlessBackend backend);
 
-  WebGpuRenderer(wgpu::Instance instance, wgpu::Device device, GLFWwindow* window);
+  WebGpuRenderer(wgpu::Instance instance, wgpu::Device device, GLFWwindow* window,
+                 const PresentOptions& present_options = {});
+  WebGpuRenderer(wgpu::Instance instance, wgpu::Device device, const HeadlessOptions& options);
   virtual ~WebGpuRenderer();
 
   void BeginFrame() override;
   void EndFrame(const Renderables& renderables) override;
   void OnResize(int width, int height) override;
   void* GetWindow() const override;
+  void WaitForNextFrame() override;
+  bool HasPendingWork() const override;
+
+  const RenderStats& GetRenderStats() const { return render_stats_; }
+  const UploadRingStats& GetUploadStats() const { return upload_ring_->GetStats(); }
+  MeshCache* GetMeshCache() { return mesh_cache_.get(); }
+  PipelineCache* GetPipelineCache() { return pipeline_cache_.get(); }
+  TextureManager* GetTextureManager() { return texture_manager_.get(); }
+  BindGroupCache* GetBindGroupCache() { return bind_group_cache_.get(); }
+  // Graph of the last frame.
+  const RenderGraph& GetRenderGraph() const { return render_graph_; }
+  const TransientTexturePoolStats& GetTransientTextureStats() const {
+    return transient_textures_->GetStats();
+  }
+  GpuCulling* GetGpuCulling() { return gpu_culling_.get(); }
+  ThreadPool* GetThreadPool() { return thread_pool_.get(); }
+  // See Ui::SetCachingEnabled.
+  Ui* GetUi() { return ui_.get(); }
+  // Frustum culling of cubes, spheres and meshes against the camera, enabled by default.
+  void SetCullingEnabled(bool enabled) { culling_enabled_ = enabled; }
+  bool IsCullingEnabled() const { return culling_enabled_; }
+  // Culls the instances in a compute pass and draws each batch with DrawIndexedIndirect instead of
+  // culling on the CPU, once the culling pipeline is ready. Disabled by default.
+  void SetGpuCullingEnabled(bool enabled) { gpu_culling_enabled_ = enabled; }
+  bool IsGpuCullingEnabled() const { return gpu_culling_enabled_; }
+  // Draws spheres as quads ray cast in the fragment shader, 6 vertices each instead of hundreds,
+  // once the impostor pipeline is ready. Disabled by default.
+  void SetSphereImpostorsEnabled(bool enabled) { sphere_impostors_enabled_ = enabled; }
+  bool AreSphereImpostorsEnabled() const { return sphere_impostors_enabled_; }
+  void SetLodSettings(const LodSettings& settings) { lod_settings_ = settings; }
+  const LodSettings& GetLodSettings() const { return lod_settings_; }
+  // Recreates the swap chain if the mode changed. The frames in flight are fixed at creation.
+  void SetPresentMode(wgpu::PresentMode present_mode);
+  wgpu::PresentMode GetPresentMode() const { return present_mode_; }
+  uint32_t GetFramesInFlight() const { return frames_in_flight_; }
+  wgpu::Device GetDevice() const { return device_; }
+  bool IsHeadless() const { return window_ == nullptr; }
+
+  // Returns the BGRA8 pixels of the last headless frame, tightly packed row by row. Blocks until
+  // the GPU is done.
+  std::vector<uint8_t> ReadPixels();
+
+ protected:
+  struct InstanceBatch {
+    const GpuGeometry* geometry = nullptr;
+    uint32_t first_instance = 0;
+    uint32_t num_instances = 0;
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+    // TextureInfo::array of the instances, 0 if untextured.
+    uint32_t texture_array = 0;
+    // Buffer of the retained scene holding the instances from offset 0, null for the instances of
+    // the frame's renderables.
+    wgpu::Buffer instance_buffer;
+    // Translucent batches are blended, never culled on the GPU, and sorted by the key of their
+    // farthest instance.
+    bool translucent = false;
+    DrawKey key = 0;
+  };
+  struct RetainedBuffer {
+    wgpu::Buffer buffer;
+    uint64_t capacity = 0;
+  };
+  struct TranslucentObject {
+    const GpuGeometry* geometry = nullptr;
+    const Mat4* transform = nullptr;
+    float scale = 1.f;
+    Color color;
+    uint32_t lod = 0;
+    uint32_t texture_array = 0;
+    uint32_t texture_layer = 0;
+  };
+  struct MeshItem {
+    MeshHandle handle = 0;
+    const Mat4* transform = nullptr;
+    float scale = 1.f;
+    Color color;
+    uint32_t lod = 0;
+    // Mesh::lod or CachedMesh::lod of the renderable.
+    uint32_t* previous_lod = nullptr;
+    uint32_t texture_array = 0;
+    uint32_t texture_layer = 0;
+  };
 
- protected:  
   virtual wgpu::Surface CreateSurface(const wgpu::Instance& instance, GLFWwindow* window);
   virtual wgpu::SwapChain CreateSwapChain(wgpu::Surface surface, wgpu::Device device,
                                           uint32_t width, uint32_t height);
-  virtual wgpu::Texture CreateDepthTexture(wgpu::Device device,
-                                           wgpu::TextureFormat depth_texture_format, uint32_t width,
+  virtual wgpu::Texture CreateColorTexture(wgpu::Device device,
+                                           wgpu::TextureFormat color_texture_format, uint32_t width,
                                            uint32_t height);
-  virtual wgpu::TextureView CreateDepthTextureView(wgpu::Texture depth_texture,
-                                                   wgpu::TextureFormat depth_texture_format);
-  virtual wgpu::RenderPipeline CreateRenderPipeline(wgpu::Device device, const char* shader_code);
+  virtual void CreateRenderPipeline(const char* shader_code, PipelineCache::Callback callback);
+  // "quantized" selects the QuantizedVertex layout and the matching vertex entry point,
+  // "textured" the fragment entry point sampling the texture arrays. "translucent" pipelines blend
+  // the colors by their alpha and test the depth without writing it.
+  virtual void CreateInstancedRenderPipeline(const char* shader_code, bool quantized,
+                                             bool textured, bool translucent,
+                                             PipelineCache::Callback callback);
+  virtual void CreateImpostorRenderPipeline(const char* shader_code, bool translucent,
+                                            PipelineCache::Callback callback);
+  virtual void CreateUiCompositePipeline(const char* shader_code,
+                                         PipelineCache::Callback callback);
+
+  void Initialize();
+  void CreateLayouts();
+  void UpdateUniforms(const Camera& camera);
+  void CollectMeshItems(const Renderables& renderables);
+  void CullInstances(const Renderables& renderables);
+  void SelectLods(const Camera& camera);
+  // Moves the translucent cubes, spheres and mesh items to "translucent_objects_".
+  void CollectTranslucentObjects(const Renderables& renderables, bool culled);
+  // Packs the translucent objects back to front from "first_instance" on, in batches of
+  // consecutive objects drawn alike.
+  void PackTranslucentObjects(const Camera& camera, uint32_t first_instance,
+                              std::span<PackedInstance> instances);
+  void UploadInstances(const Renderables& renderables);
+  void UploadRetainedScene(RetainedScene* scene);
+  // Orders the batches of the frame and of the retained scene by sort key into "draw_items_".
+  void SortDraws();
+  // Index in "instanced_pipelines_" of the pipeline drawing "geometry", before falling back to
+  // another one while it is not ready.
+  size_t GetPipelineIndex(const GpuGeometry* geometry, uint32_t texture_array,
+                          bool translucent) const;
+  void DrawInstances(wgpu::RenderPassEncoder pass);
+  void BuildRenderGraph(const Renderables& renderables, wgpu::TextureView color_view);
+  wgpu::BindGroup GetTextureBindGroup(uint32_t texture_array);
 
   wgpu::Instance instance_;
   wgpu::Device device_;
   wgpu::Surface surface_;
   wgpu::SwapChain swap_chain_;
   wgpu::RenderPipeline render_pipeline_;
+  // Indexed by GetInstancedPipelineIndex, followed by the sphere impostor pipeline, then the same
+  // five pipelines for translucent instances.
+  std::array<wgpu::RenderPipeline, 10> instanced_pipelines_;
+  // Group 0 holds the frame's uniforms, bound at a dynamic offset, and group 1 the texture array
+  // of textured meshes. The instanced pipelines share these layouts, so their bind groups stay
+  // bound when switching pipelines.
+  wgpu::BindGroupLayout frame_bind_group_layout_;
+  wgpu::BindGroupLayout texture_bind_group_layout_;
+  wgpu::PipelineLayout instanced_pipeline_layout_;
+  wgpu::PipelineLayout textured_pipeline_layout_;
+  // The cached UI texture, composited with "ui_composite_pipeline_".
+  wgpu::BindGroupLayout ui_bind_group_layout_;
+  wgpu::PipelineLayout ui_composite_pipeline_layout_;
+  wgpu::RenderPipeline ui_composite_pipeline_;
+  wgpu::Texture ui_texture_;
+  wgpu::TextureView ui_texture_view_;
+  // Uniforms of the frame, allocated from the upload ring.
+  wgpu::BindGroup uniform_bind_group_;
+  uint32_t uniform_offset_ = 0;
+  uint64_t uniform_offset_alignment_ = 256;
+  UploadAllocation instance_allocation_;
+  // Instances of "instance_allocation_" before the translucent ones.
+  uint32_t num_opaque_instances_ = 0;
+  // Opaque batches, followed by the translucent ones.
+  std::vector<InstanceBatch> instance_batches_;
+  // Same order as the opaque "instance_batches_", filled when the frame is culled on the GPU.
+  std::vector<GpuCullBatch> gpu_cull_batches_;
+  std::vector<MeshItem> mesh_items_;
+  // Instances of the retained scene, in buffers that persist across frames, indexed by
+  // SceneObjectKind. They are drawn without culling, which would repack them every frame.
+  const RetainedScene* retained_scene_ = nullptr;
+  std::array<RetainedBuffer, kNumSceneObjectKinds> retained_buffers_;
+  std::vector<InstanceBatch> retained_batches_;
+  std::vector<DirtyRange> dirty_ranges_;
+  // Indices of "instance_batches_", then of "retained_batches_" past them, in draw order.
+  std::vector<DrawItem> draw_items_;
+  std::vector<TranslucentObject> translucent_objects_;
+  // Indices of "translucent_objects_" in draw order.
+  std::vector<DrawItem> translucent_items_;
+  std::vector<DrawItem> draw_sort_scratch_;
+  bool culling_enabled_ = true;
+  bool gpu_culling_enabled_ = false;
+  bool sphere_impostors_enabled_ = false;
+  // Whether the current frame is culled on the GPU.
+  bool gpu_culled_ = false;
+  LodSettings lod_settings_;
+  BoundingSpheres cull_bounds_;
+  // Opaque cubes and spheres to draw, when culled or when some of them are translucent. All of
+  // them are drawn otherwise.
+  std::vector<uint32_t> visible_cubes_;
+  std::vector<uint32_t> visible_spheres_;
+  std::vector<uint32_t> translucent_cubes_;
+  std::vector<uint32_t> translucent_spheres_;
+  std::vector<uint32_t> visible_mesh_items_;
+  GpuGeometry cube_geometry_;
+  GpuGeometry sphere_geometry_;
+  // Index buffer of a quad, without vertices.
+  GpuGeometry impostor_geometry_;
+  RenderStats render_stats_;
+  wgpu::TextureFormat color_texture_format_ = wgpu::TextureFormat::BGRA8Unorm;
+  wgpu::Texture color_texture_ = nullptr;
+  wgpu::TextureView color_texture_view_ = nullptr;
+  // The depth texture is transient: it is never read after the main pass.
   wgpu::TextureFormat depth_texture_format_ = wgpu::TextureFormat::Depth24Plus;
-  wgpu::Texture depth_texture_ = nullptr;
-  wgpu::TextureView depth_texture_view_ = nullptr;
+  RenderGraph render_graph_;
   GLFWwindow* window_ = nullptr;
+  wgpu::PresentMode present_mode_ = wgpu::PresentMode::Fifo;
+  uint32_t frames_in_flight_ = 3;
   int width_ = 0;
   int height_ = 0;
   std::string shader_code_;
+  std::string instanced_shader_code_;
+  std::string ui_composite_shader_code_;
   std::unique_ptr<Ui> ui_;
+  std::unique_ptr<UploadRing> upload_ring_;
+  std::unique_ptr<MeshCache> mesh_cache_;
+  std::unique_ptr<PipelineCache> pipeline_cache_;
+  std::unique_ptr<BindGroupCache> bind_group_cache_;
+  std::unique_ptr<TransientTexturePool> transient_textures_;
+  std::unique_ptr<TextureManager> texture_manager_;
+  std::unique_ptr<GpuCulling> gpu_culling_;
+  std::unique_ptr<GpuProfiler> gpu_profiler_;
+  std::unique_ptr<ThreadPool> thread_pool_;
 
   static GLFWwindow* g_window_;
   static std::function<void(std::unique_ptr<WebGpuRenderer>)> g_create_callback_;
   static wgpu::Instance g_instance_;
+  static HeadlessOptions g_headless_options_;
+  static PresentOptions g_present_options_;
 };
 
 }  // namespace web_gpu_app
\ No newline at end of file
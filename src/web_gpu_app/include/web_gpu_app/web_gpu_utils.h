@@ -0,0 +1,42 @@
+#pragma once
+
+#include <webgpu/webgpu_cpp.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "web_gpu_app/primitives.h"
+
+namespace web_gpu_app {
+
+struct GpuGeometry {
+  wgpu::Buffer vertex_buffer;
+  wgpu::Buffer index_buffer;
+  uint32_t index_count = 0;
+  // Index ranges of the levels of detail, LOD 0 first. CreateGpuGeometry adds a single LOD
+  // spanning all the indices.
+  std::vector<MeshLod> lods;
+  // The vertices are QuantizedVertex, drawn with the quantized pipeline.
+  bool quantized = false;
+  Vec3 position_offset = Vec3(0.f);
+  float position_scale = 1.f;
+};
+
+inline uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+wgpu::Buffer CreateBuffer(wgpu::Device device, wgpu::BufferUsage usage, uint64_t size,
+                          const void* data = nullptr);
+GpuGeometry CreateGpuGeometry(wgpu::Device device, const PrimitiveGeometry& geometry);
+GpuGeometry CreateGpuGeometry(wgpu::Device device, const QuantizedGeometry& geometry);
+
+// Invokes "callback" once all work submitted to "queue" so far has completed on the GPU.
+void OnSubmittedWorkDone(wgpu::Queue queue, std::function<void()> callback);
+
+// Blocks until "predicate" returns true, processing device callbacks in the meantime. Not
+// available on Emscripten where the browser main thread cannot block.
+void WaitUntil(wgpu::Device device, const std::function<bool()>& predicate);
+
+}  // namespace web_gpu_app
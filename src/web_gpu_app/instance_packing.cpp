@@ -0,0 +1,73 @@
+#include "web_gpu_app/instance_packing.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace web_gpu_app {
+
+uint32_t PackColor(const Color& color) {
+  auto to_unorm8 = [](float value) {
+    return static_cast<uint32_t>(std::clamp(value, 0.f, 1.f) * 255.f + 0.5f);
+  };
+  return to_unorm8(color.r) | (to_unorm8(color.g) << 8) | (to_unorm8(color.b) << 16) |
+         (to_unorm8(color.a) << 24);
+}
+
+void PackInstance(const Mat4& transform, float scale, const Color& color, PackedInstance* out) {
+  for (int column = 0; column < 3; ++column) {
+    out->model[column * 3 + 0] = transform[column].x * scale;
+    out->model[column * 3 + 1] = transform[column].y * scale;
+    out->model[column * 3 + 2] = transform[column].z * scale;
+  }
+  out->model[9] = transform[3].x;
+  out->model[10] = transform[3].y;
+  out->model[11] = transform[3].z;
+  out->color = PackColor(color);
+  out->texture_layer = 0;
+}
+
+void PackQuantizedInstance(const Mat4& transform, float scale, const Vec3& position_offset,
+                           float position_scale, const Color& color, PackedInstance* out) {
+  // transform * scale(scale) * translate(position_offset) * scale(position_scale)
+  Mat4 dequantized_transform = transform;
+  dequantized_transform[3] = transform * Vec4(scale * position_offset, 1.f);
+  PackInstance(dequantized_transform, scale * position_scale, color, out);
+}
+
+size_t PackCubes(std::span<const Cube> cubes, std::span<PackedInstance> out) {
+  assert(out.size() >= cubes.size());
+  for (size_t i = 0; i < cubes.size(); ++i) {
+    PackInstance(cubes[i].transform, cubes[i].size, cubes[i].color, &out[i]);
+  }
+  return cubes.size();
+}
+
+size_t PackSpheres(std::span<const Sphere> spheres, std::span<PackedInstance> out) {
+  assert(out.size() >= spheres.size());
+  for (size_t i = 0; i < spheres.size(); ++i) {
+    PackInstance(spheres[i].transform, spheres[i].radius, spheres[i].color, &out[i]);
+  }
+  return spheres.size();
+}
+
+size_t PackCubes(std::span<const Cube> cubes, std::span<const uint32_t> indices,
+                 std::span<PackedInstance> out) {
+  assert(out.size() >= indices.size());
+  for (size_t i = 0; i < indices.size(); ++i) {
+    const Cube& cube = cubes[indices[i]];
+    PackInstance(cube.transform, cube.size, cube.color, &out[i]);
+  }
+  return indices.size();
+}
+
+size_t PackSpheres(std::span<const Sphere> spheres, std::span<const uint32_t> indices,
+                   std::span<PackedInstance> out) {
+  assert(out.size() >= indices.size());
+  for (size_t i = 0; i < indices.size(); ++i) {
+    const Sphere& sphere = spheres[indices[i]];
+    PackInstance(sphere.transform, sphere.radius, sphere.color, &out[i]);
+  }
+  return indices.size();
+}
+
+}  // namespace web_gpu_app
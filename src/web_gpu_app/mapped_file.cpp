@@ -0,0 +1,114 @@
+#include "web_gpu_app/mapped_file.h"
+
+#include <fstream>
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace web_gpu_app {
+
+MappedFile::~MappedFile() { Close(); }
+
+MappedFile::MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    Close();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    mapping_ = std::exchange(other.mapping_, nullptr);
+#if defined(_WIN32)
+    mapping_handle_ = std::exchange(other.mapping_handle_, nullptr);
+#endif
+    buffer_ = std::move(other.buffer_);
+    // The data of a moved vector stays valid.
+    if (mapping_ == nullptr) data_ = buffer_.data();
+  }
+  return *this;
+}
+
+bool MappedFile::Open(const std::string& file_name) {
+  Close();
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file != INVALID_HANDLE_VALUE) {
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+      mapping_handle_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (mapping_handle_ != nullptr) {
+        mapping_ = MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0);
+      }
+    }
+    CloseHandle(file);
+    if (mapping_ != nullptr) {
+      data_ = static_cast<const uint8_t*>(mapping_);
+      size_ = static_cast<size_t>(size.QuadPart);
+      return true;
+    }
+    Close();
+  }
+#elif !defined(__EMSCRIPTEN__)
+  int file = open(file_name.c_str(), O_RDONLY);
+  if (file >= 0) {
+    struct stat status;
+    if (fstat(file, &status) == 0 && status.st_size > 0) {
+      void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+      if (mapping != MAP_FAILED) {
+        // Files are parsed front to back.
+        madvise(mapping, status.st_size, MADV_SEQUENTIAL);
+        mapping_ = mapping;
+        data_ = static_cast<const uint8_t*>(mapping);
+        size_ = static_cast<size_t>(status.st_size);
+      }
+    }
+    close(file);
+    if (mapping_ != nullptr) return true;
+  }
+#endif
+
+  // Empty files cannot be mapped, and Emscripten has no mmap worth using.
+  std::ifstream stream(file_name, std::ios::binary | std::ios::ate);
+  if (!stream) return false;
+  buffer_.resize(static_cast<size_t>(stream.tellg()));
+  stream.seekg(0);
+  if (!stream.read(reinterpret_cast<char*>(buffer_.data()), buffer_.size())) {
+    buffer_.clear();
+    return false;
+  }
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+  return true;
+}
+
+void MappedFile::Assign(std::vector<uint8_t> bytes) {
+  Close();
+  buffer_ = std::move(bytes);
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+}
+
+void MappedFile::Close() {
+#if defined(_WIN32)
+  if (mapping_ != nullptr) UnmapViewOfFile(mapping_);
+  if (mapping_handle_ != nullptr) CloseHandle(mapping_handle_);
+  mapping_handle_ = nullptr;
+#elif !defined(__EMSCRIPTEN__)
+  if (mapping_ != nullptr) munmap(mapping_, size_);
+#endif
+  mapping_ = nullptr;
+  data_ = nullptr;
+  size_ = 0;
+  buffer_.clear();
+}
+
+}  // namespace web_gpu_app
@@ -0,0 +1,201 @@
+#include "web_gpu_app/mesh_cache.h"
+
+#include <iostream>
+
+#include "web_gpu_app/mesh_lod.h"
+#include "web_gpu_app/mesh_optimizer.h"
+#include "web_gpu_app/utils.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+Vec3 GetVec3(const std::vector<tinyobj::real_t>& values, int index) {
+  return Vec3(values[3 * index + 0], values[3 * index + 1], values[3 * index + 2]);
+}
+
+}  // namespace
+
+PrimitiveGeometry ConvertMesh(const tinyobj::attrib_t& attrib, const tinyobj::mesh_t& mesh) {
+  PrimitiveGeometry geometry;
+  geometry.vertices.reserve(mesh.indices.size());
+  geometry.indices.reserve(mesh.indices.size());
+
+  size_t index_offset = 0;
+  for (unsigned int num_face_vertices : mesh.num_face_vertices) {
+    const tinyobj::index_t* face = &mesh.indices[index_offset];
+    index_offset += num_face_vertices;
+    if (num_face_vertices < 3) continue;
+
+    Vec3 p0 = GetVec3(attrib.vertices, face[0].vertex_index);
+    Vec3 p1 = GetVec3(attrib.vertices, face[1].vertex_index);
+    Vec3 p2 = GetVec3(attrib.vertices, face[2].vertex_index);
+    Vec3 face_normal = glm::cross(p1 - p0, p2 - p0);
+    float length = glm::length(face_normal);
+    face_normal = length > 0.f ? face_normal / length : Vec3(0.f, 1.f, 0.f);
+
+    uint32_t base = static_cast<uint32_t>(geometry.vertices.size());
+    for (unsigned int i = 0; i < num_face_vertices; ++i) {
+      const tinyobj::index_t& index = face[i];
+      Vec3 normal = index.normal_index >= 0 ? GetVec3(attrib.normals, index.normal_index)
+                                            : face_normal;
+      geometry.vertices.push_back({GetVec3(attrib.vertices, index.vertex_index), normal});
+    }
+    // Triangulate polygons as a fan.
+    for (unsigned int i = 1; i + 1 < num_face_vertices; ++i) {
+      geometry.indices.insert(geometry.indices.end(), {base, base + i, base + i + 1});
+    }
+  }
+  return geometry;
+}
+
+MeshHandle HashMesh(const tinyobj::attrib_t& attrib, const tinyobj::mesh_t& mesh) {
+  uint64_t hash = kFnvOffsetBasis;
+  HashWords(mesh.num_face_vertices.data(),
+            mesh.num_face_vertices.size() * sizeof(mesh.num_face_vertices[0]), &hash);
+  for (const tinyobj::index_t& index : mesh.indices) {
+    HashWords(&attrib.vertices[3 * index.vertex_index], 3 * sizeof(tinyobj::real_t), &hash);
+    if (index.normal_index >= 0) {
+      HashWords(&attrib.normals[3 * index.normal_index], 3 * sizeof(tinyobj::real_t), &hash);
+    }
+  }
+  // Final avalanche so that the low bits are usable for hash tables.
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  // Zero is reserved for "no mesh".
+  return hash != 0 ? hash : 1;
+}
+
+MeshCache::MeshCache(wgpu::Device device, uint64_t memory_budget) : device_(device) {
+  stats_.memory_budget = memory_budget;
+}
+
+void MeshCache::BeginFrame() {
+  ++frame_;
+  EvictOverBudget();
+}
+
+MeshHandle MeshCache::Add(const tinyobj::attrib_t& attrib, const tinyobj::mesh_t& mesh) {
+  MeshHandle handle = HashMesh(attrib, mesh);
+  auto it = entries_.find(handle);
+  if (it != entries_.end()) {
+    ++stats_.num_hits;
+    Touch(it->second);
+    return handle;
+  }
+  PrimitiveGeometry geometry = ConvertMesh(attrib, mesh);
+  OptimizeMesh(&geometry);
+  std::vector<MeshLod> lods;
+  if (lod_generation_enabled_) lods = GenerateLods(&geometry);
+  return Add(geometry, handle, lods);
+}
+
+MeshHandle MeshCache::Add(const PrimitiveGeometry& geometry, MeshHandle handle,
+                          std::span<const MeshLod> lods) {
+  auto [it, inserted] = entries_.try_emplace(handle);
+  Entry& entry = it->second;
+  if (!inserted) {
+    ++stats_.num_hits;
+    Touch(entry);
+    return handle;
+  }
+
+  ++stats_.num_misses;
+  if (quantization_enabled_) {
+    QuantizedGeometry quantized = QuantizeGeometry(geometry);
+    entry.geometry = CreateGpuGeometry(device_, quantized);
+    entry.bounds = quantized.bounds;
+    entry.num_bytes = quantized.vertices.size() * sizeof(QuantizedVertex) +
+                      quantized.indices.size() * sizeof(uint32_t);
+  } else {
+    entry.geometry = CreateGpuGeometry(device_, geometry);
+    entry.bounds = ComputeBoundingSphere(geometry);
+    entry.num_bytes = geometry.vertices.size() * sizeof(Vertex) +
+                      geometry.indices.size() * sizeof(uint32_t);
+  }
+  if (!lods.empty()) entry.geometry.lods.assign(lods.begin(), lods.end());
+  entry.last_used_frame = frame_;
+  entry.lru_position = lru_.insert(lru_.begin(), handle);
+  stats_.resident_bytes += entry.num_bytes;
+  stats_.num_meshes = entries_.size();
+  EvictOverBudget();
+  return handle;
+}
+
+MeshHandle MeshCache::Add(const MeshFile& file) {
+  const bool quantized = file.HasQuantizedVertexLayout();
+  if (!file.IsOpen() || (!file.HasVertexLayout() && !quantized)) {
+    std::cerr << "Unsupported mesh file vertex layout" << std::endl;
+    return 0;
+  }
+  const MeshHandle handle = file.GetHeader().content_hash;
+  auto [it, inserted] = entries_.try_emplace(handle);
+  Entry& entry = it->second;
+  if (!inserted) {
+    ++stats_.num_hits;
+    Touch(entry);
+    return handle;
+  }
+
+  ++stats_.num_misses;
+  std::span<const uint8_t> vertex_data = file.GetVertexData();
+  std::span<const uint8_t> index_data = file.GetIndexData();
+  entry.geometry.vertex_buffer = CreateBuffer(device_, wgpu::BufferUsage::Vertex,
+                                              vertex_data.size(), vertex_data.data());
+  entry.geometry.index_buffer = CreateBuffer(device_, wgpu::BufferUsage::Index,
+                                             index_data.size(), index_data.data());
+  entry.geometry.index_count = file.GetHeader().num_indices;
+  entry.geometry.lods.assign(file.GetLods().begin(), file.GetLods().end());
+  if (quantized) {
+    const MeshFileHeader& header = file.GetHeader();
+    entry.geometry.quantized = true;
+    entry.geometry.position_offset =
+        Vec3(header.position_offset[0], header.position_offset[1], header.position_offset[2]);
+    entry.geometry.position_scale = header.position_scale;
+  }
+  entry.bounds = file.GetBounds();
+  entry.num_bytes = vertex_data.size() + index_data.size();
+  entry.last_used_frame = frame_;
+  entry.lru_position = lru_.insert(lru_.begin(), handle);
+  stats_.resident_bytes += entry.num_bytes;
+  stats_.num_meshes = entries_.size();
+  EvictOverBudget();
+  return handle;
+}
+
+const GpuGeometry* MeshCache::Get(MeshHandle handle) {
+  auto it = entries_.find(handle);
+  if (it == entries_.end()) return nullptr;
+  Touch(it->second);
+  return &it->second.geometry;
+}
+
+const BoundingSphere* MeshCache::GetBounds(MeshHandle handle) const {
+  auto it = entries_.find(handle);
+  return it == entries_.end() ? nullptr : &it->second.bounds;
+}
+
+void MeshCache::SetMemoryBudget(uint64_t memory_budget) {
+  stats_.memory_budget = memory_budget;
+  EvictOverBudget();
+}
+
+void MeshCache::Touch(Entry& entry) {
+  entry.last_used_frame = frame_;
+  lru_.splice(lru_.begin(), lru_, entry.lru_position);
+}
+
+void MeshCache::EvictOverBudget() {
+  while (stats_.resident_bytes > stats_.memory_budget && !lru_.empty()) {
+    auto it = entries_.find(lru_.back());
+    if (it->second.last_used_frame == frame_) break;
+    stats_.resident_bytes -= it->second.num_bytes;
+    ++stats_.num_evictions;
+    lru_.pop_back();
+    entries_.erase(it);
+  }
+  stats_.num_meshes = entries_.size();
+}
+
+}  // namespace web_gpu_app
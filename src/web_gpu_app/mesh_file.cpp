@@ -0,0 +1,255 @@
+#include "web_gpu_app/mesh_file.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "web_gpu_app/utils.h"
+#include "web_gpu_app/web_gpu_utils.h"
+
+namespace web_gpu_app {
+
+static_assert(std::endian::native == std::endian::little, "Mesh files are little-endian");
+static_assert(sizeof(Vertex) == 6 * sizeof(float), "Vertex must be tightly packed");
+static_assert(sizeof(QuantizedVertex) == 12, "QuantizedVertex must be tightly packed");
+
+namespace {
+
+constexpr size_t kPageSize = 4096;
+
+const MeshFileAttribute kVertexAttributes[] = {
+    {MeshAttribute::kPosition, MeshAttributeFormat::kFloat32x3, offsetof(Vertex, position)},
+    {MeshAttribute::kNormal, MeshAttributeFormat::kFloat32x3, offsetof(Vertex, normal)},
+};
+
+const MeshFileAttribute kQuantizedVertexAttributes[] = {
+    {MeshAttribute::kPosition, MeshAttributeFormat::kUnorm16x4,
+     offsetof(QuantizedVertex, position)},
+    {MeshAttribute::kNormal, MeshAttributeFormat::kSnorm16x2, offsetof(QuantizedVertex, normal)},
+};
+
+bool HasAttributes(std::span<const MeshFileAttribute> attributes,
+                   std::span<const MeshFileAttribute> expected) {
+  return std::equal(attributes.begin(), attributes.end(), expected.begin(), expected.end(),
+                    [](const MeshFileAttribute& a, const MeshFileAttribute& b) {
+                      return a.attribute == b.attribute && a.format == b.format &&
+                             a.offset == b.offset;
+                    });
+}
+
+void WritePadding(std::ofstream& file, uint64_t offset) {
+  static const char kZeros[kMeshFileAlignment] = {};
+  file.write(kZeros, AlignUp(offset, kMeshFileAlignment) - offset);
+}
+
+bool SetError(const std::string& message, std::string* error) {
+  if (error != nullptr) *error = message;
+  return false;
+}
+
+}  // namespace
+
+uint32_t GetMeshAttributeFormatSize(MeshAttributeFormat format) {
+  switch (format) {
+    case MeshAttributeFormat::kFloat32x3:
+      return 3 * sizeof(float);
+    case MeshAttributeFormat::kUnorm16x4:
+      return 4 * sizeof(uint16_t);
+    case MeshAttributeFormat::kSnorm16x2:
+      return 2 * sizeof(int16_t);
+  }
+  return 0;
+}
+
+namespace {
+
+// "header" has the vertex layout and the dequantization set, the rest is filled here.
+bool WriteMeshData(const std::string& file_name, MeshFileHeader header,
+                   std::span<const MeshFileAttribute> attributes,
+                   std::span<const std::byte> vertex_data, std::span<const uint32_t> indices,
+                   const BoundingSphere& bounds, std::span<const MeshLod> lods) {
+  const MeshLod full_lod{.num_indices = static_cast<uint32_t>(indices.size())};
+  if (lods.empty()) lods = {&full_lod, 1};
+  if (lods.size() > kMaxMeshLods) {
+    std::cerr << "Too many LODs for " << file_name << ": " << lods.size() << std::endl;
+    return false;
+  }
+
+  header.num_attributes = static_cast<uint32_t>(attributes.size());
+  header.num_lods = static_cast<uint32_t>(lods.size());
+  header.num_vertices = static_cast<uint32_t>(vertex_data.size() / header.vertex_stride);
+  header.num_indices = static_cast<uint32_t>(indices.size());
+
+  const uint64_t index_data_size = indices.size() * sizeof(uint32_t);
+  const uint64_t tables_end = sizeof(MeshFileHeader) + attributes.size_bytes() +
+                              lods.size() * sizeof(MeshLod);
+  header.vertex_data_offset = AlignUp(tables_end, kMeshFileAlignment);
+  header.index_data_offset =
+      AlignUp(header.vertex_data_offset + vertex_data.size(), kMeshFileAlignment);
+
+  uint64_t hash = kFnvOffsetBasis;
+  HashWords(vertex_data.data(), vertex_data.size(), &hash);
+  HashWords(indices.data(), index_data_size, &hash);
+  // Zero is reserved for "no mesh".
+  header.content_hash = hash != 0 ? hash : 1;
+
+  header.bounds_center[0] = bounds.center.x;
+  header.bounds_center[1] = bounds.center.y;
+  header.bounds_center[2] = bounds.center.z;
+  header.bounds_radius = bounds.radius;
+
+  std::ofstream file(file_name, std::ios::binary);
+  if (!file) {
+    std::cerr << "Cannot open file: " << file_name << std::endl;
+    return false;
+  }
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(attributes.data()), attributes.size_bytes());
+  file.write(reinterpret_cast<const char*>(lods.data()), lods.size() * sizeof(MeshLod));
+  WritePadding(file, tables_end);
+  file.write(reinterpret_cast<const char*>(vertex_data.data()), vertex_data.size());
+  WritePadding(file, header.vertex_data_offset + vertex_data.size());
+  file.write(reinterpret_cast<const char*>(indices.data()), index_data_size);
+  if (!file) {
+    std::cerr << "Cannot write file: " << file_name << std::endl;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool WriteMeshFile(const std::string& file_name, const PrimitiveGeometry& geometry,
+                   std::span<const MeshLod> lods) {
+  MeshFileHeader header;
+  header.vertex_stride = sizeof(Vertex);
+  return WriteMeshData(file_name, header, kVertexAttributes,
+                       std::as_bytes(std::span(geometry.vertices)), geometry.indices,
+                       ComputeBoundingSphere(geometry), lods);
+}
+
+bool WriteMeshFile(const std::string& file_name, const QuantizedGeometry& geometry,
+                   std::span<const MeshLod> lods) {
+  MeshFileHeader header;
+  header.vertex_stride = sizeof(QuantizedVertex);
+  header.position_offset[0] = geometry.position_offset.x;
+  header.position_offset[1] = geometry.position_offset.y;
+  header.position_offset[2] = geometry.position_offset.z;
+  header.position_scale = geometry.position_scale;
+  return WriteMeshData(file_name, header, kQuantizedVertexAttributes,
+                       std::as_bytes(std::span(geometry.vertices)), geometry.indices,
+                       geometry.bounds, lods);
+}
+
+bool MeshFile::Open(const std::string& file_name, std::string* error) {
+  MappedFile file;
+  if (!file.Open(file_name)) return SetError("Cannot open file: " + file_name, error);
+  return Open(std::move(file), error);
+}
+
+bool MeshFile::Open(MappedFile file, std::string* error) {
+  Close();
+  std::span<const uint8_t> data = file.GetData();
+  MeshFileHeader header;
+  if (data.size() < sizeof(header)) return SetError("Truncated mesh file header", error);
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  if (header.magic != kMeshFileMagic) return SetError("Not a mesh file", error);
+  if (header.version != kMeshFileVersion) {
+    return SetError("Unsupported mesh file version " + std::to_string(header.version), error);
+  }
+  if (header.index_size != sizeof(uint32_t)) return SetError("Unsupported index size", error);
+  if (header.num_attributes > kMaxMeshFileAttributes || header.num_lods == 0 ||
+      header.num_lods > kMaxMeshLods) {
+    return SetError("Invalid number of attributes or LODs", error);
+  }
+
+  const uint64_t attributes_size = header.num_attributes * sizeof(MeshFileAttribute);
+  const uint64_t lods_size = header.num_lods * sizeof(MeshLod);
+  const uint64_t tables_end = sizeof(header) + attributes_size + lods_size;
+  const uint64_t vertex_data_size = uint64_t{header.num_vertices} * header.vertex_stride;
+  const uint64_t index_data_size = uint64_t{header.num_indices} * header.index_size;
+  if (header.vertex_data_offset % kMeshFileAlignment != 0 ||
+      header.index_data_offset % kMeshFileAlignment != 0 ||
+      header.vertex_data_offset < tables_end || header.index_data_offset < tables_end ||
+      !IsRangeInBounds(header.vertex_data_offset, vertex_data_size, data.size()) ||
+      !IsRangeInBounds(header.index_data_offset, index_data_size, data.size())) {
+    return SetError("Mesh file data out of bounds", error);
+  }
+
+  std::vector<MeshFileAttribute> attributes(header.num_attributes);
+  std::memcpy(attributes.data(), data.data() + sizeof(header), attributes_size);
+  for (const MeshFileAttribute& attribute : attributes) {
+    uint32_t size = GetMeshAttributeFormatSize(attribute.format);
+    if (size == 0 || attribute.offset + size > header.vertex_stride) {
+      return SetError("Invalid mesh file vertex layout", error);
+    }
+  }
+  std::vector<MeshLod> lods(header.num_lods);
+  std::memcpy(lods.data(), data.data() + sizeof(header) + attributes_size, lods_size);
+  for (const MeshLod& lod : lods) {
+    if (uint64_t{lod.first_index} + lod.num_indices > header.num_indices) {
+      return SetError("Mesh file LOD out of bounds", error);
+    }
+  }
+
+  header_ = header;
+  attributes_ = std::move(attributes);
+  lods_ = std::move(lods);
+  file_ = std::move(file);
+  return true;
+}
+
+void MeshFile::Close() {
+  file_.Close();
+  header_ = {};
+  attributes_.clear();
+  lods_.clear();
+}
+
+BoundingSphere MeshFile::GetBounds() const {
+  return {.center = Vec3(header_.bounds_center[0], header_.bounds_center[1],
+                         header_.bounds_center[2]),
+          .radius = header_.bounds_radius};
+}
+
+bool MeshFile::HasVertexLayout() const {
+  return header_.vertex_stride == sizeof(Vertex) &&
+         HasAttributes(attributes_, kVertexAttributes);
+}
+
+bool MeshFile::HasQuantizedVertexLayout() const {
+  return header_.vertex_stride == sizeof(QuantizedVertex) &&
+         HasAttributes(attributes_, kQuantizedVertexAttributes);
+}
+
+std::span<const uint8_t> MeshFile::GetVertexData() const {
+  return file_.GetData().subspan(header_.vertex_data_offset,
+                                 uint64_t{header_.num_vertices} * header_.vertex_stride);
+}
+
+std::span<const uint8_t> MeshFile::GetIndexData() const {
+  return file_.GetData().subspan(header_.index_data_offset,
+                                 uint64_t{header_.num_indices} * header_.index_size);
+}
+
+std::span<const uint8_t> MeshFile::GetIndexData(const MeshLod& lod) const {
+  return GetIndexData().subspan(uint64_t{lod.first_index} * header_.index_size,
+                                uint64_t{lod.num_indices} * header_.index_size);
+}
+
+void MeshFile::Prefetch() const {
+  std::span<const uint8_t> data = file_.GetData();
+  if (!file_.IsMapped()) return;
+  uint8_t sum = 0;
+  for (size_t i = header_.vertex_data_offset; i < data.size(); i += kPageSize) sum += data[i];
+  // Keeps the reads from being optimized away.
+  volatile uint8_t sink = sum;
+  static_cast<void>(sink);
+}
+
+}  // namespace web_gpu_app
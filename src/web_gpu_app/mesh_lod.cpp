@@ -0,0 +1,444 @@
+#include "web_gpu_app/mesh_lod.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <glm/geometric.hpp>
+
+#include "web_gpu_app/mesh_file.h"
+#include "web_gpu_app/mesh_optimizer.h"
+#include "web_gpu_app/utils.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+constexpr uint32_t kNoVertex = ~0u;
+// Weight of the planes keeping the open boundaries in place, relative to the faces.
+constexpr double kBoundaryWeight = 10.0;
+// Collapses turning a face by more than about 75 degrees are rejected.
+constexpr float kMinNormalCosine = 0.25f;
+// A LOD removing fewer triangles than this fraction of the previous one ends the chain.
+constexpr float kMinLodReduction = 0.1f;
+// Distance below which a mesh is considered to contain the camera.
+constexpr float kMinLodDistance = 1e-3f;
+
+// Symmetric matrix of the sum of the squared distances to a set of planes.
+struct Quadric {
+  double a2 = 0.0;
+  double ab = 0.0;
+  double ac = 0.0;
+  double ad = 0.0;
+  double b2 = 0.0;
+  double bc = 0.0;
+  double bd = 0.0;
+  double c2 = 0.0;
+  double cd = 0.0;
+  double d2 = 0.0;
+  // Area of the faces, to turn the error into a distance.
+  double area = 0.0;
+
+  void AddPlane(const Vec3& normal, double d, double weight) {
+    const double a = normal.x;
+    const double b = normal.y;
+    const double c = normal.z;
+    a2 += weight * a * a;
+    ab += weight * a * b;
+    ac += weight * a * c;
+    ad += weight * a * d;
+    b2 += weight * b * b;
+    bc += weight * b * c;
+    bd += weight * b * d;
+    c2 += weight * c * c;
+    cd += weight * c * d;
+    d2 += weight * d * d;
+  }
+
+  void Add(const Quadric& other) {
+    a2 += other.a2;
+    ab += other.ab;
+    ac += other.ac;
+    ad += other.ad;
+    b2 += other.b2;
+    bc += other.bc;
+    bd += other.bd;
+    c2 += other.c2;
+    cd += other.cd;
+    d2 += other.d2;
+    area += other.area;
+  }
+
+  double Evaluate(const Vec3& position) const {
+    const double x = position.x;
+    const double y = position.y;
+    const double z = position.z;
+    return a2 * x * x + b2 * y * y + c2 * z * z + 2.0 * (ab * x * y + ac * x * z + bc * y * z) +
+           2.0 * (ad * x + bd * y + cd * z) + d2;
+  }
+};
+
+struct PositionHash {
+  size_t operator()(const Vec3& position) const {
+    uint64_t hash = kFnvOffsetBasis;
+    HashValue(position, &hash);
+    return static_cast<size_t>(hash ^ (hash >> 32));
+  }
+};
+
+uint64_t GetEdgeKey(uint32_t a, uint32_t b) {
+  return a < b ? (uint64_t{a} << 32) | b : (uint64_t{b} << 32) | a;
+}
+
+// Edge collapses run on positions rather than vertices, so that the vertices of a position with
+// several normals, e.g. along a crease, move together. Each pass collapses the cheapest edges
+// which do not share an endpoint, then rebuilds the triangles and their adjacency.
+class Simplifier {
+ public:
+  explicit Simplifier(const PrimitiveGeometry& geometry);
+
+  // Collapses edges until at most "target_triangles" remain or no collapse is possible.
+  void Simplify(size_t target_triangles);
+
+  size_t GetTriangleCount() const { return corners_.size() / 3; }
+  // Maximum deviation from the input surface over all the collapses so far.
+  float GetError() const { return static_cast<float>(std::sqrt(max_error_)); }
+  const std::vector<uint32_t>& GetIndices() const { return corners_; }
+
+ private:
+  struct Collapse {
+    float cost = 0.f;
+    uint32_t from = 0;
+    uint32_t to = 0;
+  };
+
+  bool RunPass(size_t target_triangles);
+  uint32_t GetPosition(size_t corner) const { return vertex_positions_[corners_[corner]]; }
+  // Vertex at "position" with the normal closest to the one of "vertex".
+  uint32_t FindClosestVertex(uint32_t position, uint32_t vertex) const;
+
+  const std::vector<Vertex>& vertices_;
+  std::vector<Vec3> positions_;
+  std::vector<uint32_t> vertex_positions_;
+  // Vertices of each position as compressed rows.
+  std::vector<uint32_t> position_vertex_offsets_;
+  std::vector<uint32_t> position_vertices_;
+  std::vector<Quadric> quadrics_;
+  std::vector<bool> boundary_;
+  // Vertex indices of the remaining triangles.
+  std::vector<uint32_t> corners_;
+  double max_error_ = 0.0;
+
+  // Scratch memory of the passes.
+  std::vector<Collapse> collapses_;
+  std::vector<uint32_t> triangle_offsets_;
+  std::vector<uint32_t> triangles_;
+  std::vector<uint32_t> collapse_targets_;
+  std::vector<bool> locked_;
+};
+
+Simplifier::Simplifier(const PrimitiveGeometry& geometry) : vertices_(geometry.vertices) {
+  const size_t num_vertices = vertices_.size();
+  const size_t capacity = std::bit_ceil(std::max<size_t>(16, 2 * num_vertices));
+  std::vector<uint32_t> table(capacity, kNoVertex);
+  vertex_positions_.resize(num_vertices);
+  for (size_t i = 0; i < num_vertices; ++i) {
+    const Vec3& position = vertices_[i].position;
+    size_t slot = PositionHash()(position) & (capacity - 1);
+    while (table[slot] != kNoVertex && positions_[table[slot]] != position) {
+      slot = (slot + 1) & (capacity - 1);
+    }
+    if (table[slot] == kNoVertex) {
+      table[slot] = static_cast<uint32_t>(positions_.size());
+      positions_.push_back(position);
+    }
+    vertex_positions_[i] = table[slot];
+  }
+
+  const size_t num_positions = positions_.size();
+  position_vertex_offsets_.assign(num_positions + 1, 0);
+  for (uint32_t position : vertex_positions_) ++position_vertex_offsets_[position + 1];
+  for (size_t i = 0; i < num_positions; ++i) {
+    position_vertex_offsets_[i + 1] += position_vertex_offsets_[i];
+  }
+  position_vertices_.resize(num_vertices);
+  std::vector<uint32_t> next(position_vertex_offsets_.begin(), position_vertex_offsets_.end() - 1);
+  for (size_t i = 0; i < num_vertices; ++i) {
+    position_vertices_[next[vertex_positions_[i]]++] = static_cast<uint32_t>(i);
+  }
+
+  // Area weighted face planes.
+  quadrics_.resize(num_positions);
+  corners_.reserve(geometry.indices.size());
+  for (size_t i = 0; i + 2 < geometry.indices.size(); i += 3) {
+    const uint32_t* triangle = &geometry.indices[i];
+    const uint32_t p0 = vertex_positions_[triangle[0]];
+    const uint32_t p1 = vertex_positions_[triangle[1]];
+    const uint32_t p2 = vertex_positions_[triangle[2]];
+    if (p0 == p1 || p1 == p2 || p2 == p0) continue;
+    corners_.insert(corners_.end(), triangle, triangle + 3);
+    Vec3 normal = glm::cross(positions_[p1] - positions_[p0], positions_[p2] - positions_[p0]);
+    const float length = glm::length(normal);
+    if (length == 0.f) continue;
+    normal /= length;
+    const double area = 0.5 * length;
+    for (uint32_t position : {p0, p1, p2}) {
+      quadrics_[position].AddPlane(normal, -glm::dot(normal, positions_[p0]), area);
+      quadrics_[position].area += area;
+    }
+  }
+
+  // Planes perpendicular to the faces through the edges with a single face, so that the
+  // boundaries do not shrink.
+  boundary_.assign(num_positions, false);
+  std::vector<std::pair<uint64_t, uint32_t>> edges;
+  edges.reserve(corners_.size());
+  for (size_t corner = 0; corner < corners_.size(); ++corner) {
+    const size_t next_corner = corner % 3 == 2 ? corner - 2 : corner + 1;
+    edges.emplace_back(GetEdgeKey(GetPosition(corner), GetPosition(next_corner)),
+                       static_cast<uint32_t>(corner));
+  }
+  std::sort(edges.begin(), edges.end());
+  for (size_t i = 0; i < edges.size(); ++i) {
+    const uint64_t key = edges[i].first;
+    const bool shared = (i > 0 && edges[i - 1].first == key) ||
+                        (i + 1 < edges.size() && edges[i + 1].first == key);
+    if (shared) continue;
+    const size_t corner = edges[i].second;
+    const size_t first_corner = corner - corner % 3;
+    const uint32_t a = static_cast<uint32_t>(key >> 32);
+    const uint32_t b = static_cast<uint32_t>(key);
+    const Vec3 edge = positions_[b] - positions_[a];
+    const Vec3& p0 = positions_[GetPosition(first_corner)];
+    const Vec3 face_normal = glm::cross(positions_[GetPosition(first_corner + 1)] - p0,
+                                        positions_[GetPosition(first_corner + 2)] - p0);
+    Vec3 normal = glm::cross(edge, face_normal);
+    const float length = glm::length(normal);
+    boundary_[a] = true;
+    boundary_[b] = true;
+    if (length == 0.f) continue;
+    normal /= length;
+    const double weight = kBoundaryWeight * glm::dot(edge, edge);
+    quadrics_[a].AddPlane(normal, -glm::dot(normal, positions_[a]), weight);
+    quadrics_[b].AddPlane(normal, -glm::dot(normal, positions_[a]), weight);
+  }
+}
+
+void Simplifier::Simplify(size_t target_triangles) {
+  while (GetTriangleCount() > target_triangles && RunPass(target_triangles)) {
+  }
+}
+
+uint32_t Simplifier::FindClosestVertex(uint32_t position, uint32_t vertex) const {
+  uint32_t closest = position_vertices_[position_vertex_offsets_[position]];
+  float closest_cosine = -2.f;
+  for (uint32_t i = position_vertex_offsets_[position]; i < position_vertex_offsets_[position + 1];
+       ++i) {
+    const float cosine =
+        glm::dot(vertices_[vertex].normal, vertices_[position_vertices_[i]].normal);
+    if (cosine > closest_cosine) {
+      closest_cosine = cosine;
+      closest = position_vertices_[i];
+    }
+  }
+  return closest;
+}
+
+bool Simplifier::RunPass(size_t target_triangles) {
+  const size_t num_triangles = GetTriangleCount();
+  const size_t num_positions = positions_.size();
+
+  // Each interior edge is a half-edge of two faces, one per collapse direction. Boundary edges
+  // only collapse in the direction of their face, which keeps the candidates free of duplicates
+  // without sorting the edges.
+  collapses_.clear();
+  for (size_t corner = 0; corner < corners_.size(); ++corner) {
+    const size_t next_corner = corner % 3 == 2 ? corner - 2 : corner + 1;
+    const uint32_t from = GetPosition(corner);
+    const uint32_t to = GetPosition(next_corner);
+    // Boundary positions only move along the boundary, see the check of the collapse.
+    if (boundary_[from] && !boundary_[to]) continue;
+    const double area = quadrics_[from].area + quadrics_[to].area;
+    const double error =
+        quadrics_[from].Evaluate(positions_[to]) + quadrics_[to].Evaluate(positions_[to]);
+    collapses_.push_back(
+        {static_cast<float>(std::max(0.0, area > 0.0 ? error / area : error)), from, to});
+  }
+  if (collapses_.empty()) return false;
+  // An interior collapse removes two triangles, and many candidates share an endpoint with a
+  // cheaper collapse. Only the cheapest candidates, about three times the number of collapses
+  // needed, are considered so that the expensive ones wait for the later passes, in which cheaper
+  // ones may show up.
+  const size_t num_candidates =
+      std::min(3 * ((num_triangles - target_triangles + 1) / 2), collapses_.size());
+  auto cheaper = [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; };
+  std::nth_element(collapses_.begin(), collapses_.begin() + (num_candidates - 1), collapses_.end(),
+                   cheaper);
+  collapses_.resize(num_candidates);
+  std::sort(collapses_.begin(), collapses_.end(), cheaper);
+
+  // Triangles around each position as compressed rows.
+  triangle_offsets_.assign(num_positions + 1, 0);
+  for (size_t corner = 0; corner < corners_.size(); ++corner) {
+    ++triangle_offsets_[GetPosition(corner) + 1];
+  }
+  for (size_t i = 0; i < num_positions; ++i) triangle_offsets_[i + 1] += triangle_offsets_[i];
+  triangles_.resize(corners_.size());
+  {
+    std::vector<uint32_t> next(triangle_offsets_.begin(), triangle_offsets_.end() - 1);
+    for (size_t corner = 0; corner < corners_.size(); ++corner) {
+      triangles_[next[GetPosition(corner)]++] = static_cast<uint32_t>(corner / 3);
+    }
+  }
+
+  collapse_targets_.assign(num_positions, kNoVertex);
+  locked_.assign(num_positions, false);
+  size_t remaining_triangles = num_triangles;
+  size_t num_collapses = 0;
+  for (const Collapse& collapse : collapses_) {
+    if (remaining_triangles <= target_triangles) break;
+    if (locked_[collapse.from] || locked_[collapse.to]) continue;
+
+    // Rejects the collapse if a remaining face around "from" flips or folds over. The faces are
+    // seen through the collapses done earlier in the pass: positions do not move, so that only
+    // the endpoints of each collapse need to be locked.
+    bool valid = true;
+    size_t num_removed = 0;
+    for (uint32_t i = triangle_offsets_[collapse.from];
+         i < triangle_offsets_[collapse.from + 1] && valid; ++i) {
+      const size_t first_corner = 3 * size_t{triangles_[i]};
+      uint32_t triangle[3];
+      for (size_t k = 0; k < 3; ++k) {
+        const uint32_t position = GetPosition(first_corner + k);
+        triangle[k] = collapse_targets_[position] != kNoVertex ? collapse_targets_[position]
+                                                               : position;
+      }
+      if (triangle[0] == triangle[1] || triangle[1] == triangle[2] ||
+          triangle[2] == triangle[0]) {
+        continue;
+      }
+      if (triangle[0] == collapse.to || triangle[1] == collapse.to ||
+          triangle[2] == collapse.to) {
+        ++num_removed;
+        continue;
+      }
+      Vec3 corners[3];
+      Vec3 moved[3];
+      for (size_t k = 0; k < 3; ++k) {
+        corners[k] = positions_[triangle[k]];
+        moved[k] = triangle[k] == collapse.from ? positions_[collapse.to] : corners[k];
+      }
+      const Vec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+      const Vec3 moved_normal = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+      valid = glm::dot(normal, moved_normal) >=
+              kMinNormalCosine * glm::length(normal) * glm::length(moved_normal);
+    }
+    // A boundary edge has a single face.
+    if (!valid || (boundary_[collapse.from] && num_removed != 1)) continue;
+
+    collapse_targets_[collapse.from] = collapse.to;
+    quadrics_[collapse.to].Add(quadrics_[collapse.from]);
+    max_error_ = std::max(max_error_, double{collapse.cost});
+    locked_[collapse.from] = true;
+    locked_[collapse.to] = true;
+    remaining_triangles -= std::min(num_removed, remaining_triangles);
+    ++num_collapses;
+  }
+  if (num_collapses == 0) return false;
+
+  // Moves the corners of the collapsed positions and drops the degenerate triangles.
+  size_t num_corners = 0;
+  for (size_t first_corner = 0; first_corner < corners_.size(); first_corner += 3) {
+    uint32_t triangle[3];
+    uint32_t positions[3];
+    for (size_t k = 0; k < 3; ++k) {
+      triangle[k] = corners_[first_corner + k];
+      positions[k] = vertex_positions_[triangle[k]];
+      if (collapse_targets_[positions[k]] != kNoVertex) {
+        positions[k] = collapse_targets_[positions[k]];
+        triangle[k] = FindClosestVertex(positions[k], triangle[k]);
+      }
+    }
+    if (positions[0] == positions[1] || positions[1] == positions[2] ||
+        positions[2] == positions[0]) {
+      continue;
+    }
+    for (size_t k = 0; k < 3; ++k) corners_[num_corners++] = triangle[k];
+  }
+  corners_.resize(num_corners);
+  return true;
+}
+
+}  // namespace
+
+std::vector<uint32_t> SimplifyMesh(const PrimitiveGeometry& geometry, size_t target_index_count,
+                                   float* error) {
+  Simplifier simplifier(geometry);
+  simplifier.Simplify(target_index_count / 3);
+  if (error != nullptr) *error = simplifier.GetError();
+  return simplifier.GetIndices();
+}
+
+std::vector<MeshLod> GenerateLods(PrimitiveGeometry* geometry, const LodOptions& options) {
+  std::vector<MeshLod> lods = {
+      {.first_index = 0, .num_indices = static_cast<uint32_t>(geometry->indices.size())}};
+  const size_t max_lods = std::min(options.max_lods, kMaxMeshLods);
+  size_t num_triangles = geometry->indices.size() / 3;
+  if (max_lods <= 1 || num_triangles <= options.min_triangles) return lods;
+
+  // The LODs are simplified from each other with the same quadrics, so that their error is
+  // measured against the full detail mesh and never decreases along the chain.
+  Simplifier simplifier(*geometry);
+  std::vector<std::vector<uint32_t>> lod_indices;
+  while (lods.size() < max_lods && num_triangles > options.min_triangles) {
+    const size_t target_triangles = std::max<size_t>(
+        options.min_triangles, static_cast<size_t>(num_triangles * options.reduction));
+    simplifier.Simplify(target_triangles);
+    const size_t num_lod_triangles = simplifier.GetTriangleCount();
+    if (num_lod_triangles > num_triangles * (1.f - kMinLodReduction)) break;
+    lods.push_back({.num_indices = static_cast<uint32_t>(3 * num_lod_triangles),
+                    .error = simplifier.GetError()});
+    lod_indices.push_back(simplifier.GetIndices());
+    num_triangles = num_lod_triangles;
+  }
+
+  for (size_t i = 0; i < lod_indices.size(); ++i) {
+    OptimizeVertexCache(&lod_indices[i], geometry->vertices.size());
+    lods[i + 1].first_index = static_cast<uint32_t>(geometry->indices.size());
+    geometry->indices.insert(geometry->indices.end(), lod_indices[i].begin(),
+                             lod_indices[i].end());
+  }
+  OptimizeVertexFetch(geometry);
+  return lods;
+}
+
+LodProjection ComputeLodProjection(const Camera& camera, int viewport_height) {
+  LodProjection projection;
+  // The view matrix is a rigid transform, the camera is at -transpose(rotation) * translation.
+  const Vec3 translation = Vec3(camera.view[3]);
+  for (int i = 0; i < 3; ++i) {
+    projection.camera_position[i] = -glm::dot(Vec3(camera.view[i]), translation);
+  }
+  projection.perspective = camera.projection[3][3] == 0.f;
+  projection.pixels_per_unit = std::abs(camera.projection[1][1]) * 0.5f * viewport_height;
+  return projection;
+}
+
+float GetPixelsPerUnit(const LodProjection& projection, const Vec3& center, float radius) {
+  if (!projection.perspective) return projection.pixels_per_unit;
+  const float distance = glm::length(center - projection.camera_position) - radius;
+  return projection.pixels_per_unit / std::max(distance, kMinLodDistance);
+}
+
+uint32_t SelectLod(std::span<const MeshLod> lods, float pixels_per_unit, uint32_t previous_lod,
+                   float pixel_error, float hysteresis) {
+  for (size_t lod = lods.size(); lod-- > 1;) {
+    const float max_error =
+        pixel_error * (lod > previous_lod ? 1.f - hysteresis : 1.f + hysteresis);
+    if (lods[lod].error * pixels_per_unit <= max_error) return static_cast<uint32_t>(lod);
+  }
+  return 0;
+}
+
+}  // namespace web_gpu_app
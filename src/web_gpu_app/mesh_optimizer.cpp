@@ -0,0 +1,247 @@
+#include "web_gpu_app/mesh_optimizer.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <glm/common.hpp>
+
+#include "web_gpu_app/utils.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+constexpr uint32_t kNoVertex = ~0u;
+
+struct VertexHash {
+  size_t operator()(const Vertex& vertex) const {
+    uint64_t hash = kFnvOffsetBasis;
+    HashValue(vertex, &hash);
+    return static_cast<size_t>(hash ^ (hash >> 32));
+  }
+};
+
+struct VertexEqual {
+  bool operator()(const Vertex& a, const Vertex& b) const {
+    return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+  }
+};
+
+template <typename VertexType>
+MeshStats ComputeStats(const std::vector<VertexType>& vertices,
+                       const std::vector<uint32_t>& indices) {
+  return {.num_vertices = static_cast<uint32_t>(vertices.size()),
+          .num_triangles = static_cast<uint32_t>(indices.size() / 3),
+          .acmr = ComputeAcmr(indices, vertices.size()),
+          .bytes_per_vertex = sizeof(VertexType),
+          .num_bytes = vertices.size() * sizeof(VertexType) + indices.size() * sizeof(uint32_t)};
+}
+
+// Maps the unit sphere onto the [-1, 1] square, see "A Survey of Efficient Representations for
+// Independent Unit Vectors", Cigolle et al. 2014.
+void EncodeOctahedral(const Vec3& normal, float* u, float* v) {
+  float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  *u = sum > 0.f ? normal.x / sum : 0.f;
+  *v = sum > 0.f ? normal.y / sum : 0.f;
+  if (normal.z < 0.f) {
+    // Folds the lower hemisphere over the diagonals.
+    float folded_u = (1.f - std::abs(*v)) * (*u >= 0.f ? 1.f : -1.f);
+    float folded_v = (1.f - std::abs(*u)) * (*v >= 0.f ? 1.f : -1.f);
+    *u = folded_u;
+    *v = folded_v;
+  }
+}
+
+int16_t ToSnorm16(float value) {
+  return static_cast<int16_t>(std::round(std::clamp(value, -1.f, 1.f) * 32767.f));
+}
+
+uint16_t ToUnorm16(float value) {
+  return static_cast<uint16_t>(std::clamp(value, 0.f, 1.f) * 65535.f + 0.5f);
+}
+
+}  // namespace
+
+MeshStats ComputeMeshStats(const PrimitiveGeometry& geometry) {
+  return ComputeStats(geometry.vertices, geometry.indices);
+}
+
+MeshStats ComputeMeshStats(const QuantizedGeometry& geometry) {
+  return ComputeStats(geometry.vertices, geometry.indices);
+}
+
+float ComputeAcmr(std::span<const uint32_t> indices, size_t num_vertices, uint32_t cache_size) {
+  const size_t num_triangles = indices.size() / 3;
+  if (num_triangles == 0) return 0.f;
+  // A vertex is in the FIFO cache if fewer than "cache_size" misses happened since it was added.
+  std::vector<uint32_t> cache_time(num_vertices, 0);
+  uint32_t time = cache_size + 1;
+  for (size_t i = 0; i < 3 * num_triangles; ++i) {
+    uint32_t vertex = indices[i];
+    if (time - cache_time[vertex] > cache_size) cache_time[vertex] = time++;
+  }
+  return static_cast<float>(time - cache_size - 1) / static_cast<float>(num_triangles);
+}
+
+void WeldVertices(PrimitiveGeometry* geometry) {
+  // Open addressing with linear probing, about twice as fast as std::unordered_map.
+  const size_t capacity = std::bit_ceil(std::max<size_t>(16, 2 * geometry->vertices.size()));
+  std::vector<uint32_t> table(capacity, kNoVertex);
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> remap(geometry->vertices.size());
+  for (size_t i = 0; i < geometry->vertices.size(); ++i) {
+    const Vertex& vertex = geometry->vertices[i];
+    size_t slot = VertexHash()(vertex) & (capacity - 1);
+    while (table[slot] != kNoVertex && !VertexEqual()(vertices[table[slot]], vertex)) {
+      slot = (slot + 1) & (capacity - 1);
+    }
+    if (table[slot] == kNoVertex) {
+      table[slot] = static_cast<uint32_t>(vertices.size());
+      vertices.push_back(vertex);
+    }
+    remap[i] = table[slot];
+  }
+  for (uint32_t& index : geometry->indices) index = remap[index];
+  geometry->vertices = std::move(vertices);
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>* indices, size_t num_vertices,
+                         uint32_t cache_size) {
+  const size_t num_triangles = indices->size() / 3;
+  if (num_triangles == 0) return;
+  const std::vector<uint32_t>& input = *indices;
+
+  // Triangles adjacent to each vertex, as compressed rows.
+  std::vector<uint32_t> offsets(num_vertices + 1, 0);
+  for (size_t i = 0; i < 3 * num_triangles; ++i) ++offsets[input[i] + 1];
+  for (size_t vertex = 0; vertex < num_vertices; ++vertex) offsets[vertex + 1] += offsets[vertex];
+  std::vector<uint32_t> adjacency(3 * num_triangles);
+  std::vector<uint32_t> next_adjacency(offsets.begin(), offsets.end() - 1);
+  for (size_t i = 0; i < 3 * num_triangles; ++i) {
+    adjacency[next_adjacency[input[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+
+  // Number of adjacent triangles which are not emitted yet.
+  std::vector<uint32_t> live(num_vertices);
+  for (size_t vertex = 0; vertex < num_vertices; ++vertex) {
+    live[vertex] = offsets[vertex + 1] - offsets[vertex];
+  }
+  std::vector<uint32_t> cache_time(num_vertices, 0);
+  std::vector<bool> emitted(num_triangles, false);
+  std::vector<uint32_t> dead_end;
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> output;
+  output.reserve(3 * num_triangles);
+  uint32_t time = cache_size + 1;
+  size_t cursor = 0;
+
+  auto next_live_vertex = [&]() {
+    // Vertices of recently emitted triangles first, they are likely still in the cache.
+    while (!dead_end.empty()) {
+      uint32_t vertex = dead_end.back();
+      dead_end.pop_back();
+      if (live[vertex] > 0) return vertex;
+    }
+    while (cursor < num_vertices && live[cursor] == 0) ++cursor;
+    return cursor < num_vertices ? static_cast<uint32_t>(cursor) : kNoVertex;
+  };
+
+  uint32_t fanning_vertex = next_live_vertex();
+  while (fanning_vertex != kNoVertex) {
+    // Emits all the remaining triangles around the fanning vertex.
+    candidates.clear();
+    for (uint32_t i = offsets[fanning_vertex]; i < offsets[fanning_vertex + 1]; ++i) {
+      uint32_t triangle = adjacency[i];
+      if (emitted[triangle]) continue;
+      emitted[triangle] = true;
+      for (uint32_t corner = 0; corner < 3; ++corner) {
+        uint32_t vertex = input[3 * triangle + corner];
+        output.push_back(vertex);
+        dead_end.push_back(vertex);
+        candidates.push_back(vertex);
+        --live[vertex];
+        if (time - cache_time[vertex] > cache_size) cache_time[vertex] = time++;
+      }
+    }
+
+    // The next fanning vertex is the oldest candidate which stays in the cache while its
+    // remaining triangles are emitted.
+    fanning_vertex = kNoVertex;
+    int64_t best_priority = -1;
+    for (uint32_t vertex : candidates) {
+      if (live[vertex] == 0) continue;
+      int64_t priority = 0;
+      if (time - cache_time[vertex] + 2 * live[vertex] <= cache_size) {
+        priority = time - cache_time[vertex];
+      }
+      if (priority > best_priority) {
+        best_priority = priority;
+        fanning_vertex = vertex;
+      }
+    }
+    if (fanning_vertex == kNoVertex) fanning_vertex = next_live_vertex();
+  }
+  *indices = std::move(output);
+}
+
+void OptimizeVertexFetch(PrimitiveGeometry* geometry) {
+  std::vector<uint32_t> remap(geometry->vertices.size(), kNoVertex);
+  std::vector<Vertex> vertices;
+  vertices.reserve(geometry->vertices.size());
+  for (uint32_t& index : geometry->indices) {
+    if (remap[index] == kNoVertex) {
+      remap[index] = static_cast<uint32_t>(vertices.size());
+      vertices.push_back(geometry->vertices[index]);
+    }
+    index = remap[index];
+  }
+  geometry->vertices = std::move(vertices);
+}
+
+void OptimizeMesh(PrimitiveGeometry* geometry, const MeshOptimizationOptions& options) {
+  if (options.weld) WeldVertices(geometry);
+  if (options.optimize_vertex_cache) {
+    OptimizeVertexCache(&geometry->indices, geometry->vertices.size());
+  }
+  if (options.optimize_vertex_fetch) OptimizeVertexFetch(geometry);
+}
+
+QuantizedGeometry QuantizeGeometry(const PrimitiveGeometry& geometry) {
+  QuantizedGeometry quantized;
+  quantized.indices = geometry.indices;
+  quantized.bounds = ComputeBoundingSphere(geometry);
+  if (geometry.vertices.empty()) return quantized;
+
+  Vec3 min = geometry.vertices[0].position;
+  Vec3 max = min;
+  for (const Vertex& vertex : geometry.vertices) {
+    min = glm::min(min, vertex.position);
+    max = glm::max(max, vertex.position);
+  }
+  // A single scale for the three axes keeps the model matrix a similarity, so that the normals
+  // do not need a separate transform.
+  const Vec3 extent = max - min;
+  const float scale = std::max({extent.x, extent.y, extent.z});
+  quantized.position_offset = min;
+  quantized.position_scale = scale > 0.f ? scale : 1.f;
+
+  quantized.vertices.resize(geometry.vertices.size());
+  for (size_t i = 0; i < geometry.vertices.size(); ++i) {
+    const Vertex& vertex = geometry.vertices[i];
+    QuantizedVertex& out = quantized.vertices[i];
+    Vec3 position = (vertex.position - min) / quantized.position_scale;
+    out.position[0] = ToUnorm16(position.x);
+    out.position[1] = ToUnorm16(position.y);
+    out.position[2] = ToUnorm16(position.z);
+    out.position[3] = 0;
+    float u = 0.f;
+    float v = 0.f;
+    EncodeOctahedral(vertex.normal, &u, &v);
+    out.normal[0] = ToSnorm16(u);
+    out.normal[1] = ToSnorm16(v);
+  }
+  return quantized;
+}
+
+}  // namespace web_gpu_app
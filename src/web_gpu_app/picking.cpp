@@ -0,0 +1,299 @@
+#include "web_gpu_app/picking.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+
+#include "web_gpu_app/mesh_cache.h"
+#include "web_gpu_app/profiler.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+constexpr float kInfinity = std::numeric_limits<float>::infinity();
+
+// "transform" * scale("scale"), as applied to the instances of the renderer.
+Mat4 ScaleTransform(const Mat4& transform, float scale) {
+  Mat4 model = transform;
+  for (int column = 0; column < 3; ++column) model[column] *= scale;
+  return model;
+}
+
+Ray TransformRay(const Mat4& transform, const Ray& ray) {
+  return {.origin = Vec3(transform * Vec4(ray.origin, 1.f)),
+          .direction = Vec3(transform * Vec4(ray.direction, 0.f))};
+}
+
+// Distances along a ray are preserved by the affine transforms to object space, as long as the
+// direction is not normalized again.
+Ray ToObjectSpace(const Mat4& model, const Ray& ray) {
+  return TransformRay(glm::inverse(model), ray);
+}
+
+// Computes the discriminant from the distance of the closest point to the center, which unlike
+// b * b - a * c does not cancel out for distant spheres.
+float IntersectSphere(const Ray& ray, const Vec3& center, float radius, float max_distance) {
+  const float a = glm::dot(ray.direction, ray.direction);
+  if (a == 0.f) return kInfinity;
+  const Vec3 offset = ray.origin - center;
+  const float closest_distance = -glm::dot(offset, ray.direction) / a;
+  const Vec3 closest = offset + closest_distance * ray.direction;
+  const float discriminant = radius * radius - glm::dot(closest, closest);
+  if (discriminant < 0.f) return kInfinity;
+  const float half_chord = std::sqrt(discriminant / a);
+  float distance = closest_distance - half_chord;
+  // The ray starts inside the sphere.
+  if (distance < 0.f) distance = closest_distance + half_chord;
+  return distance >= 0.f && distance < max_distance ? distance : kInfinity;
+}
+
+// Möller-Trumbore, hitting both faces.
+float IntersectTriangle(const Ray& ray, const Vec3* vertices, float max_distance) {
+  const Vec3 edge1 = vertices[1] - vertices[0];
+  const Vec3 edge2 = vertices[2] - vertices[0];
+  const Vec3 p = glm::cross(ray.direction, edge2);
+  const float determinant = glm::dot(edge1, p);
+  if (std::abs(determinant) < 1e-12f) return kInfinity;
+  const float inverse_determinant = 1.f / determinant;
+  const Vec3 offset = ray.origin - vertices[0];
+  const float u = glm::dot(offset, p) * inverse_determinant;
+  if (u < 0.f || u > 1.f) return kInfinity;
+  const Vec3 q = glm::cross(offset, edge1);
+  const float v = glm::dot(ray.direction, q) * inverse_determinant;
+  if (v < 0.f || u + v > 1.f) return kInfinity;
+  const float distance = glm::dot(edge2, q) * inverse_determinant;
+  return distance >= 0.f && distance < max_distance ? distance : kInfinity;
+}
+
+}  // namespace
+
+Ray ComputeScreenRay(const Camera& camera, CanvasSize size, double x, double y) {
+  const Mat4 inverse_view_projection = glm::inverse(camera.projection * camera.view);
+  const float ndc_x = static_cast<float>(2. * x / std::max(size.width, 1) - 1.);
+  const float ndc_y = static_cast<float>(1. - 2. * y / std::max(size.height, 1));
+  auto unproject = [&](float depth) {
+    const Vec4 point = inverse_view_projection * Vec4(ndc_x, ndc_y, depth, 1.f);
+    return Vec3(point) / point.w;
+  };
+  // Depth 0 is the near plane of WebGPU's clip space. Depth 1 is at infinity for infinite
+  // projections, a point in between gives the direction.
+  const Vec3 near = unproject(0.f);
+  return {.origin = near, .direction = glm::normalize(unproject(0.5f) - near)};
+}
+
+Picker::Picker(const MeshCache* mesh_cache) : mesh_cache_(mesh_cache) {}
+
+Picker::~Picker() {}
+
+void Picker::SetMeshTriangles(MeshHandle handle, const PrimitiveGeometry& geometry) {
+  MeshTriangles& triangles = triangles_[handle];
+  triangles.positions.clear();
+  triangles.positions.reserve(geometry.indices.size());
+  for (uint32_t index : geometry.indices) {
+    triangles.positions.push_back(geometry.vertices[index].position);
+  }
+  triangles.pinned = true;
+  BuildTriangles(&triangles);
+}
+
+void Picker::RemoveMeshTriangles(MeshHandle handle) {
+  // Only unpinned: the triangles may be in use until the next Update.
+  auto it = triangles_.find(handle);
+  if (it != triangles_.end()) it->second.pinned = false;
+}
+
+void Picker::BuildTriangles(MeshTriangles* triangles) {
+  const size_t num_triangles = triangles->positions.size() / 3;
+  std::vector<Aabb> boxes(num_triangles);
+  triangles->bounds = {};
+  for (size_t i = 0; i < num_triangles; ++i) {
+    for (size_t k = 0; k < 3; ++k) boxes[i].Grow(triangles->positions[3 * i + k]);
+    triangles->bounds.Grow(boxes[i]);
+  }
+  triangles->bvh.Build(boxes);
+}
+
+Picker::MeshTriangles* Picker::GetTriangles(const Mesh& mesh) {
+  MeshTriangles& triangles = triangles_[HashMesh(*mesh.attrib, mesh.mesh)];
+  triangles.used = true;
+  if (triangles.bvh.size() > 0 || triangles.pinned) return &triangles;
+
+  PROFILE_SCOPE("Picker::BuildTriangles");
+  // Faces are triangulated as fans.
+  const tinyobj::attrib_t& attrib = *mesh.attrib;
+  auto position = [&](const tinyobj::index_t& index) {
+    const tinyobj::real_t* vertex = &attrib.vertices[3 * index.vertex_index];
+    return Vec3(vertex[0], vertex[1], vertex[2]);
+  };
+  size_t first_index = 0;
+  for (unsigned int num_face_vertices : mesh.mesh.num_face_vertices) {
+    for (unsigned int k = 2; k < num_face_vertices; ++k) {
+      triangles.positions.push_back(position(mesh.mesh.indices[first_index]));
+      triangles.positions.push_back(position(mesh.mesh.indices[first_index + k - 1]));
+      triangles.positions.push_back(position(mesh.mesh.indices[first_index + k]));
+    }
+    first_index += num_face_vertices;
+  }
+  BuildTriangles(&triangles);
+  return &triangles;
+}
+
+void Picker::ComputeBounds() {
+  bounds_.resize(num_objects_);
+  mesh_triangles_.assign(renderables_.meshes.size() + renderables_.cached_meshes.size(), nullptr);
+  uint32_t object = 0;
+  for (const Cube& cube : renderables_.cubes) {
+    const Vec3 half_extent = Vec3(0.5f * std::abs(cube.size));
+    bounds_[object++] = TransformAabb(cube.transform, {.min = -half_extent, .max = half_extent});
+  }
+  for (const Sphere& sphere : renderables_.spheres) {
+    const Vec3 radius = Vec3(std::abs(sphere.radius));
+    bounds_[object++] = TransformAabb(sphere.transform, {.min = -radius, .max = radius});
+  }
+  uint32_t mesh_index = 0;
+  for (const Mesh& mesh : renderables_.meshes) {
+    Aabb bounds;
+    if (mesh.attrib != nullptr) {
+      const MeshTriangles* triangles = GetTriangles(mesh);
+      mesh_triangles_[mesh_index] = triangles;
+      bounds = TransformAabb(ScaleTransform(mesh.transform, mesh.scale), triangles->bounds);
+    }
+    bounds_[object++] = bounds;
+    ++mesh_index;
+  }
+  for (const CachedMesh& mesh : renderables_.cached_meshes) {
+    Aabb bounds;
+    auto it = triangles_.find(mesh.handle);
+    if (it != triangles_.end()) {
+      it->second.used = true;
+      mesh_triangles_[mesh_index] = &it->second;
+      bounds = it->second.bounds;
+    } else if (mesh_cache_ != nullptr) {
+      if (const BoundingSphere* sphere = mesh_cache_->GetBounds(mesh.handle)) {
+        const Vec3 radius = Vec3(sphere->radius);
+        bounds = {.min = sphere->center - radius, .max = sphere->center + radius};
+      }
+    }
+    bounds_[object++] = TransformAabb(ScaleTransform(mesh.transform, mesh.scale), bounds);
+    ++mesh_index;
+  }
+}
+
+void Picker::Update(const Renderables& renderables) {
+  PROFILE_SCOPE("Picker::Update");
+  const uint32_t num_cubes = static_cast<uint32_t>(renderables.cubes.size());
+  const uint32_t first_mesh = num_cubes + static_cast<uint32_t>(renderables.spheres.size());
+  const uint32_t first_cached_mesh = first_mesh + static_cast<uint32_t>(renderables.meshes.size());
+  const uint32_t num_objects =
+      first_cached_mesh + static_cast<uint32_t>(renderables.cached_meshes.size());
+  const bool same_objects = num_cubes == first_sphere_ && first_mesh == first_mesh_ &&
+                            first_cached_mesh == first_cached_mesh_ &&
+                            num_objects == num_objects_ && bvh_.size() == num_objects;
+  renderables_ = renderables;
+  first_sphere_ = num_cubes;
+  first_mesh_ = first_mesh;
+  first_cached_mesh_ = first_cached_mesh;
+  num_objects_ = num_objects;
+
+  for (auto& [handle, triangles] : triangles_) triangles.used = false;
+  ComputeBounds();
+  std::erase_if(triangles_, [](const auto& entry) {
+    return !entry.second.used && !entry.second.pinned;
+  });
+  stats_.num_objects = num_objects;
+  stats_.num_mesh_bvhs = triangles_.size();
+
+  if (!same_objects) {
+    Rebuild();
+    return;
+  }
+  const uint64_t begin_ns = Profiler::NowNs();
+  bvh_.Refit(bounds_);
+  ++stats_.num_refits;
+  stats_.refit_ns += Profiler::NowNs() - begin_ns;
+  if (bvh_.GetCost() > kMaxRefitCostRatio * built_cost_) Rebuild();
+}
+
+void Picker::Rebuild() {
+  const uint64_t begin_ns = Profiler::NowNs();
+  bvh_.Build(bounds_);
+  built_cost_ = bvh_.GetCost();
+  ++stats_.num_builds;
+  stats_.build_ns += Profiler::NowNs() - begin_ns;
+}
+
+float Picker::IntersectObject(uint32_t object, const Ray& ray, float max_distance,
+                              uint32_t* triangle) const {
+  if (object < first_sphere_) {
+    const Cube& cube = renderables_.cubes[object];
+    const Ray local = ToObjectSpace(ScaleTransform(cube.transform, cube.size), ray);
+    return IntersectAabb(local.origin, Vec3(1.f) / local.direction, Vec3(-0.5f), Vec3(0.5f),
+                         max_distance);
+  }
+  if (object < first_mesh_) {
+    const Sphere& sphere = renderables_.spheres[object - first_sphere_];
+    const Ray local = ToObjectSpace(ScaleTransform(sphere.transform, sphere.radius), ray);
+    return IntersectSphere(local, Vec3(0.f), 1.f, max_distance);
+  }
+
+  const uint32_t mesh_index = object - first_mesh_;
+  const CachedMesh* cached_mesh = object >= first_cached_mesh_
+                                      ? &renderables_.cached_meshes[object - first_cached_mesh_]
+                                      : nullptr;
+  const Mat4 model = cached_mesh != nullptr
+                         ? ScaleTransform(cached_mesh->transform, cached_mesh->scale)
+                         : ScaleTransform(renderables_.meshes[mesh_index].transform,
+                                          renderables_.meshes[mesh_index].scale);
+  const Ray local = ToObjectSpace(model, ray);
+  const MeshTriangles* triangles = mesh_triangles_[mesh_index];
+  if (triangles == nullptr) {
+    // Cached mesh picked on its bounding sphere.
+    const BoundingSphere* sphere = cached_mesh != nullptr && mesh_cache_ != nullptr
+                                       ? mesh_cache_->GetBounds(cached_mesh->handle)
+                                       : nullptr;
+    if (sphere == nullptr) return kInfinity;
+    return IntersectSphere(local, sphere->center, sphere->radius, max_distance);
+  }
+  return triangles->bvh.Raycast(local, max_distance, [&](uint32_t index, float max_distance) {
+    const float distance = IntersectTriangle(local, &triangles->positions[3 * index], max_distance);
+    if (distance < max_distance) *triangle = index;
+    return distance;
+  });
+}
+
+PickResult Picker::Pick(const Ray& ray) const {
+  PickResult result;
+  uint32_t hit_object = 0;
+  uint32_t hit_triangle = PickResult::kNoTriangle;
+  result.distance = bvh_.Raycast(ray, kInfinity, [&](uint32_t object, float max_distance) {
+    uint32_t triangle = PickResult::kNoTriangle;
+    const float distance = IntersectObject(object, ray, max_distance, &triangle);
+    if (distance < max_distance) {
+      hit_object = object;
+      hit_triangle = triangle;
+    }
+    return distance;
+  });
+  if (result.distance == kInfinity) return result;
+
+  if (hit_object < first_sphere_) {
+    result.kind = PickedKind::kCube;
+    result.index = hit_object;
+  } else if (hit_object < first_mesh_) {
+    result.kind = PickedKind::kSphere;
+    result.index = hit_object - first_sphere_;
+  } else if (hit_object < first_cached_mesh_) {
+    result.kind = PickedKind::kMesh;
+    result.index = hit_object - first_mesh_;
+  } else {
+    result.kind = PickedKind::kCachedMesh;
+    result.index = hit_object - first_cached_mesh_;
+  }
+  result.triangle = hit_triangle;
+  result.position = ray.origin + result.distance * ray.direction;
+  return result;
+}
+
+}  // namespace web_gpu_app
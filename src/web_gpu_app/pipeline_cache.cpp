@@ -0,0 +1,489 @@
+#include "web_gpu_app/pipeline_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+#include "web_gpu_app/profiler.h"
+#include "web_gpu_app/utils.h"
+#include "web_gpu_app/web_gpu_utils.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+// Files of the blob cache start with this magic and format version, followed by the sizes of the
+// key and value, then the key and value themselves.
+constexpr char kBlobMagic[4] = {'W', 'G', 'B', 'C'};
+constexpr uint32_t kBlobVersion = 1;
+
+// Prefix of the blob cache keys under which the first creation time of each pipeline is stored.
+constexpr std::string_view kCreationTimeKeyPrefix = "web_gpu_app/pipeline_creation_ns/";
+
+class Hasher {
+ public:
+  void Add(const void* data, size_t num_bytes) { HashWords(data, num_bytes, &hash_); }
+  template <typename T>
+  void Add(T value) {
+    uint64_t word = static_cast<uint64_t>(value);
+    Add(&word, sizeof(word));
+  }
+  void Add(double value) { Add(&value, sizeof(value)); }
+  void Add(float value) { Add(&value, sizeof(value)); }
+  void Add(const char* string) {
+    std::string_view view = string != nullptr ? string : "";
+    Add(view.size());
+    Add(view.data(), view.size());
+  }
+  uint64_t Get() const { return hash_; }
+
+ private:
+  uint64_t hash_ = kFnvOffsetBasis;
+};
+
+uint64_t HashString(std::string_view string) {
+  Hasher hasher;
+  hasher.Add(string.data(), string.size());
+  return hasher.Get();
+}
+
+void AddBlendComponent(const wgpu::BlendComponent& component, Hasher* hasher) {
+  hasher->Add(component.operation);
+  hasher->Add(component.srcFactor);
+  hasher->Add(component.dstFactor);
+}
+
+void AddStencilFace(const wgpu::StencilFaceState& face, Hasher* hasher) {
+  hasher->Add(face.compare);
+  hasher->Add(face.failOp);
+  hasher->Add(face.depthFailOp);
+  hasher->Add(face.passOp);
+}
+
+void AddConstants(size_t count, const wgpu::ConstantEntry* constants, Hasher* hasher) {
+  hasher->Add(count);
+  for (size_t i = 0; i < count; ++i) {
+    hasher->Add(constants[i].key);
+    hasher->Add(constants[i].value);
+  }
+}
+
+}  // namespace
+
+BlobCache& BlobCache::Get() {
+  static BlobCache blob_cache;
+  return blob_cache;
+}
+
+BlobCache::BlobCache() {
+#if !defined(__EMSCRIPTEN__)
+  directory_ = "pipeline_cache";
+#endif
+}
+
+void BlobCache::SetDirectory(const std::filesystem::path& directory) {
+  std::lock_guard lock(mutex_);
+  directory_ = directory;
+}
+
+std::filesystem::path BlobCache::GetPath(const std::string& key) const {
+  char file_name[17];
+  std::snprintf(file_name, sizeof(file_name), "%016llx",
+                static_cast<unsigned long long>(HashString(key)));
+  return directory_ / file_name;
+}
+
+const std::vector<uint8_t>* BlobCache::Find(const std::string& key) {
+  auto it = entries_.find(key);
+  if (it != entries_.end()) return &it->second;
+  if (directory_.empty()) return nullptr;
+
+  std::ifstream file(GetPath(key), std::ios::binary);
+  char magic[sizeof(kBlobMagic)];
+  uint32_t version = 0;
+  uint64_t key_size = 0;
+  uint64_t value_size = 0;
+  if (!file.read(magic, sizeof(magic)) ||
+      !file.read(reinterpret_cast<char*>(&version), sizeof(version)) ||
+      !file.read(reinterpret_cast<char*>(&key_size), sizeof(key_size)) ||
+      !file.read(reinterpret_cast<char*>(&value_size), sizeof(value_size)) ||
+      std::memcmp(magic, kBlobMagic, sizeof(magic)) != 0 || version != kBlobVersion ||
+      key_size != key.size()) {
+    return nullptr;
+  }
+  // Different keys can have the same file name.
+  std::string file_key(key_size, '\0');
+  if (!file.read(file_key.data(), key_size) || file_key != key) return nullptr;
+  std::vector<uint8_t> value(value_size);
+  if (!file.read(reinterpret_cast<char*>(value.data()), value_size)) return nullptr;
+  return &entries_.emplace(key, std::move(value)).first->second;
+}
+
+size_t BlobCache::Load(const void* key, size_t key_size, void* value, size_t value_size) {
+  std::lock_guard lock(mutex_);
+  const std::vector<uint8_t>* entry = Find(std::string(static_cast<const char*>(key), key_size));
+  if (entry == nullptr) return 0;
+  if (value != nullptr && value_size >= entry->size()) {
+    std::memcpy(value, entry->data(), entry->size());
+  }
+  return entry->size();
+}
+
+void BlobCache::Store(const void* key, size_t key_size, const void* value, size_t value_size) {
+  std::lock_guard lock(mutex_);
+  std::string key_string(static_cast<const char*>(key), key_size);
+  const uint8_t* bytes = static_cast<const uint8_t*>(value);
+  entries_[key_string].assign(bytes, bytes + value_size);
+  if (directory_.empty()) return;
+
+  std::error_code error;
+  std::filesystem::create_directories(directory_, error);
+  // Write then rename so that a concurrent launch never reads a partial file.
+  std::filesystem::path path = GetPath(key_string);
+  std::filesystem::path temporary_path = path;
+  temporary_path += ".tmp";
+  {
+    std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+    uint64_t file_key_size = key_size;
+    uint64_t file_value_size = value_size;
+    file.write(kBlobMagic, sizeof(kBlobMagic));
+    file.write(reinterpret_cast<const char*>(&kBlobVersion), sizeof(kBlobVersion));
+    file.write(reinterpret_cast<const char*>(&file_key_size), sizeof(file_key_size));
+    file.write(reinterpret_cast<const char*>(&file_value_size), sizeof(file_value_size));
+    file.write(key_string.data(), key_size);
+    file.write(static_cast<const char*>(value), value_size);
+    if (!file) {
+      std::cerr << "Failed to write the blob cache entry " << temporary_path << std::endl;
+      return;
+    }
+  }
+  std::filesystem::rename(temporary_path, path, error);
+}
+
+BlobCacheStats BlobCache::GetStats() {
+  std::lock_guard lock(mutex_);
+  return stats_;
+}
+
+#if !defined(__EMSCRIPTEN__)
+void BlobCache::InitDeviceDescriptor(wgpu::DawnCacheDeviceDescriptor* descriptor) {
+  descriptor->isolationKey = "web_gpu_app";
+  descriptor->loadDataFunction = LoadData;
+  descriptor->storeDataFunction = StoreData;
+  descriptor->functionUserdata = this;
+}
+#endif
+
+size_t BlobCache::LoadData(const void* key, size_t key_size, void* value, size_t value_size,
+                           void* user_data) {
+  BlobCache* blob_cache = static_cast<BlobCache*>(user_data);
+  size_t size = blob_cache->Load(key, key_size, value, value_size);
+  std::lock_guard lock(blob_cache->mutex_);
+  // Dawn first queries the size, then loads the value.
+  if (size == 0) {
+    ++blob_cache->stats_.num_misses;
+  } else if (value != nullptr) {
+    ++blob_cache->stats_.num_hits;
+    blob_cache->stats_.loaded_bytes += size;
+  }
+  return size;
+}
+
+void BlobCache::StoreData(const void* key, size_t key_size, const void* value, size_t value_size,
+                          void* user_data) {
+  BlobCache* blob_cache = static_cast<BlobCache*>(user_data);
+  blob_cache->Store(key, key_size, value, value_size);
+  std::lock_guard lock(blob_cache->mutex_);
+  ++blob_cache->stats_.num_stores;
+  blob_cache->stats_.stored_bytes += value_size;
+}
+
+PipelineCache::PipelineCache(wgpu::Device device)
+    : device_(device), self_(std::make_shared<PipelineCache*>(this)) {}
+
+PipelineCache::~PipelineCache() { *self_ = nullptr; }
+
+wgpu::ShaderModule PipelineCache::GetShaderModule(const char* code) {
+  uint64_t hash = HashString(code);
+  auto it = shader_modules_.find(hash);
+  if (it != shader_modules_.end()) return it->second;
+
+  PROFILE_SCOPE("PipelineCache::GetShaderModule");
+  wgpu::ShaderModuleWGSLDescriptor wgsl_descriptor{};
+  wgsl_descriptor.code = code;
+  wgpu::ShaderModuleDescriptor descriptor{.nextInChain = &wgsl_descriptor};
+  wgpu::ShaderModule shader_module = device_.CreateShaderModule(&descriptor);
+  shader_modules_.emplace(hash, shader_module);
+  shader_module_hashes_.emplace(shader_module.Get(), hash);
+  ++stats_.num_shader_modules;
+  return shader_module;
+}
+
+wgpu::BindGroupLayout PipelineCache::GetBindGroupLayout(
+    const wgpu::BindGroupLayoutDescriptor& descriptor) {
+  Hasher hasher;
+  hasher.Add(descriptor.entryCount);
+  for (size_t i = 0; i < descriptor.entryCount; ++i) {
+    const wgpu::BindGroupLayoutEntry& entry = descriptor.entries[i];
+    hasher.Add(entry.binding);
+    hasher.Add(entry.visibility);
+    hasher.Add(entry.buffer.type);
+    hasher.Add(entry.buffer.hasDynamicOffset);
+    hasher.Add(entry.buffer.minBindingSize);
+    hasher.Add(entry.sampler.type);
+    hasher.Add(entry.texture.sampleType);
+    hasher.Add(entry.texture.viewDimension);
+    hasher.Add(entry.texture.multisampled);
+    hasher.Add(entry.storageTexture.access);
+    hasher.Add(entry.storageTexture.format);
+    hasher.Add(entry.storageTexture.viewDimension);
+  }
+  const uint64_t hash = hasher.Get();
+  auto it = bind_group_layouts_.find(hash);
+  if (it != bind_group_layouts_.end()) return it->second;
+
+  wgpu::BindGroupLayout layout = device_.CreateBindGroupLayout(&descriptor);
+  bind_group_layouts_.emplace(hash, layout);
+  bind_group_layout_hashes_.emplace(layout.Get(), hash);
+  return layout;
+}
+
+wgpu::PipelineLayout PipelineCache::GetPipelineLayout(
+    std::span<const wgpu::BindGroupLayout> layouts) {
+  Hasher hasher;
+  hasher.Add(layouts.size());
+  for (const wgpu::BindGroupLayout& layout : layouts) {
+    auto it = bind_group_layout_hashes_.find(layout.Get());
+    hasher.Add(it != bind_group_layout_hashes_.end() ? it->second
+                                                     : reinterpret_cast<uintptr_t>(layout.Get()));
+  }
+  const uint64_t hash = hasher.Get();
+  auto it = pipeline_layouts_.find(hash);
+  if (it != pipeline_layouts_.end()) return it->second;
+
+  wgpu::PipelineLayoutDescriptor descriptor{.bindGroupLayoutCount = layouts.size(),
+                                            .bindGroupLayouts = layouts.data()};
+  wgpu::PipelineLayout layout = device_.CreatePipelineLayout(&descriptor);
+  pipeline_layouts_.emplace(hash, layout);
+  pipeline_layout_hashes_.emplace(layout.Get(), hash);
+  return layout;
+}
+
+uint64_t PipelineCache::HashLayout(const wgpu::PipelineLayout& layout) const {
+  // The automatic layout (nullptr) only depends on the shaders.
+  if (!layout) return 0;
+  auto it = pipeline_layout_hashes_.find(layout.Get());
+  return it != pipeline_layout_hashes_.end() ? it->second
+                                             : reinterpret_cast<uintptr_t>(layout.Get());
+}
+
+uint64_t PipelineCache::HashDescriptor(const wgpu::RenderPipelineDescriptor& descriptor) const {
+  Hasher hasher;
+  auto add_module = [&](const wgpu::ShaderModule& module) {
+    auto it = shader_module_hashes_.find(module.Get());
+    hasher.Add(it != shader_module_hashes_.end() ? it->second
+                                                 : reinterpret_cast<uintptr_t>(module.Get()));
+  };
+  hasher.Add(HashLayout(descriptor.layout));
+
+  const wgpu::VertexState& vertex = descriptor.vertex;
+  add_module(vertex.module);
+  hasher.Add(vertex.entryPoint);
+  AddConstants(vertex.constantCount, vertex.constants, &hasher);
+  hasher.Add(vertex.bufferCount);
+  for (size_t i = 0; i < vertex.bufferCount; ++i) {
+    const wgpu::VertexBufferLayout& buffer = vertex.buffers[i];
+    hasher.Add(buffer.arrayStride);
+    hasher.Add(buffer.stepMode);
+    hasher.Add(buffer.attributeCount);
+    for (size_t j = 0; j < buffer.attributeCount; ++j) {
+      hasher.Add(buffer.attributes[j].format);
+      hasher.Add(buffer.attributes[j].offset);
+      hasher.Add(buffer.attributes[j].shaderLocation);
+    }
+  }
+
+  hasher.Add(descriptor.primitive.topology);
+  hasher.Add(descriptor.primitive.stripIndexFormat);
+  hasher.Add(descriptor.primitive.frontFace);
+  hasher.Add(descriptor.primitive.cullMode);
+
+  hasher.Add(descriptor.depthStencil != nullptr);
+  if (const wgpu::DepthStencilState* depth_stencil = descriptor.depthStencil) {
+    hasher.Add(depth_stencil->format);
+    hasher.Add(depth_stencil->depthWriteEnabled);
+    hasher.Add(depth_stencil->depthCompare);
+    AddStencilFace(depth_stencil->stencilFront, &hasher);
+    AddStencilFace(depth_stencil->stencilBack, &hasher);
+    hasher.Add(depth_stencil->stencilReadMask);
+    hasher.Add(depth_stencil->stencilWriteMask);
+    hasher.Add(static_cast<int64_t>(depth_stencil->depthBias));
+    hasher.Add(depth_stencil->depthBiasSlopeScale);
+    hasher.Add(depth_stencil->depthBiasClamp);
+  }
+
+  hasher.Add(descriptor.multisample.count);
+  hasher.Add(descriptor.multisample.mask);
+  hasher.Add(descriptor.multisample.alphaToCoverageEnabled);
+
+  hasher.Add(descriptor.fragment != nullptr);
+  if (const wgpu::FragmentState* fragment = descriptor.fragment) {
+    add_module(fragment->module);
+    hasher.Add(fragment->entryPoint);
+    AddConstants(fragment->constantCount, fragment->constants, &hasher);
+    hasher.Add(fragment->targetCount);
+    for (size_t i = 0; i < fragment->targetCount; ++i) {
+      const wgpu::ColorTargetState& target = fragment->targets[i];
+      hasher.Add(target.format);
+      hasher.Add(target.writeMask);
+      hasher.Add(target.blend != nullptr);
+      if (target.blend != nullptr) {
+        AddBlendComponent(target.blend->color, &hasher);
+        AddBlendComponent(target.blend->alpha, &hasher);
+      }
+    }
+  }
+  return hasher.Get();
+}
+
+void PipelineCache::GetRenderPipeline(const wgpu::RenderPipelineDescriptor& descriptor,
+                                      Callback callback) {
+  const uint64_t key = HashDescriptor(descriptor);
+  auto [it, inserted] = pipelines_.try_emplace(key);
+  Entry& entry = it->second;
+  if (!inserted) {
+    ++stats_.num_hits;
+    if (entry.pipeline) {
+      callback(entry.pipeline);
+    } else {
+      entry.callbacks.push_back(std::move(callback));
+    }
+    return;
+  }
+
+  PROFILE_SCOPE("PipelineCache::GetRenderPipeline");
+  entry.request_ns = Profiler::NowNs();
+  entry.callbacks.push_back(std::move(callback));
+  ++stats_.num_pending;
+  device_.CreateRenderPipelineAsync(&descriptor, OnPipelineCreated,
+                                    new PendingRequest{self_, key});
+}
+
+void PipelineCache::OnPipelineCreated(WGPUCreatePipelineAsyncStatus status,
+                                      WGPURenderPipeline c_pipeline, const char* message,
+                                      void* user_data) {
+  std::unique_ptr<PendingRequest> request(static_cast<PendingRequest*>(user_data));
+  wgpu::RenderPipeline pipeline = wgpu::RenderPipeline::Acquire(c_pipeline);
+  PipelineCache* cache = *request->cache;
+  if (cache == nullptr) return;
+
+  auto it = cache->pipelines_.find(request->key);
+  --cache->stats_.num_pending;
+  if (status != WGPUCreatePipelineAsyncStatus_Success) {
+    std::cerr << "Failed to create render pipeline: " << message << std::endl;
+    cache->pipelines_.erase(it);
+    return;
+  }
+
+  Entry& entry = it->second;
+  entry.pipeline = pipeline;
+  ++cache->stats_.num_pipelines;
+  cache->RecordCreationTime(request->key, Profiler::NowNs() - entry.request_ns);
+  std::vector<Callback> callbacks = std::move(entry.callbacks);
+  for (Callback& callback : callbacks) callback(pipeline);
+  cache->ReportWhenIdle();
+}
+
+uint64_t PipelineCache::HashDescriptor(const wgpu::ComputePipelineDescriptor& descriptor) const {
+  Hasher hasher;
+  hasher.Add(HashLayout(descriptor.layout));
+  const wgpu::ProgrammableStageDescriptor& compute = descriptor.compute;
+  auto it = shader_module_hashes_.find(compute.module.Get());
+  hasher.Add(it != shader_module_hashes_.end() ? it->second
+                                               : reinterpret_cast<uintptr_t>(compute.module.Get()));
+  hasher.Add(compute.entryPoint);
+  AddConstants(compute.constantCount, compute.constants, &hasher);
+  return hasher.Get();
+}
+
+void PipelineCache::GetComputePipeline(const wgpu::ComputePipelineDescriptor& descriptor,
+                                       ComputeCallback callback) {
+  const uint64_t key = HashDescriptor(descriptor);
+  auto [it, inserted] = compute_pipelines_.try_emplace(key);
+  ComputeEntry& entry = it->second;
+  if (!inserted) {
+    ++stats_.num_hits;
+    if (entry.pipeline) {
+      callback(entry.pipeline);
+    } else {
+      entry.callbacks.push_back(std::move(callback));
+    }
+    return;
+  }
+
+  PROFILE_SCOPE("PipelineCache::GetComputePipeline");
+  entry.request_ns = Profiler::NowNs();
+  entry.callbacks.push_back(std::move(callback));
+  ++stats_.num_pending;
+  device_.CreateComputePipelineAsync(&descriptor, OnComputePipelineCreated,
+                                     new PendingRequest{self_, key});
+}
+
+void PipelineCache::OnComputePipelineCreated(WGPUCreatePipelineAsyncStatus status,
+                                             WGPUComputePipeline c_pipeline, const char* message,
+                                             void* user_data) {
+  std::unique_ptr<PendingRequest> request(static_cast<PendingRequest*>(user_data));
+  wgpu::ComputePipeline pipeline = wgpu::ComputePipeline::Acquire(c_pipeline);
+  PipelineCache* cache = *request->cache;
+  if (cache == nullptr) return;
+
+  auto it = cache->compute_pipelines_.find(request->key);
+  --cache->stats_.num_pending;
+  if (status != WGPUCreatePipelineAsyncStatus_Success) {
+    std::cerr << "Failed to create compute pipeline: " << message << std::endl;
+    cache->compute_pipelines_.erase(it);
+    return;
+  }
+
+  ComputeEntry& entry = it->second;
+  entry.pipeline = pipeline;
+  ++cache->stats_.num_pipelines;
+  cache->RecordCreationTime(request->key, Profiler::NowNs() - entry.request_ns);
+  std::vector<ComputeCallback> callbacks = std::move(entry.callbacks);
+  for (ComputeCallback& callback : callbacks) callback(pipeline);
+  cache->ReportWhenIdle();
+}
+
+void PipelineCache::ReportWhenIdle() {
+  if (stats_.num_pending != 0 || reported_) return;
+  reported_ = true;
+  BlobCacheStats blob_stats = BlobCache::Get().GetStats();
+  std::cout << "Created " << stats_.num_pipelines << " pipelines and "
+            << stats_.num_shader_modules << " shader modules in " << stats_.creation_ns * 1e-6
+            << " ms, " << stats_.saved_ns * 1e-6 << " ms saved by the blob cache ("
+            << blob_stats.num_hits << " hits, " << blob_stats.num_misses << " misses)"
+            << std::endl;
+}
+
+void PipelineCache::RecordCreationTime(uint64_t key, uint64_t creation_ns) {
+  stats_.creation_ns += creation_ns;
+
+  // The first creation of a pipeline is assumed to be a full compilation.
+  std::string record_key = std::string(kCreationTimeKeyPrefix) + std::to_string(key);
+  BlobCache& blob_cache = BlobCache::Get();
+  uint64_t first_creation_ns = 0;
+  if (blob_cache.Load(record_key.data(), record_key.size(), &first_creation_ns,
+                      sizeof(first_creation_ns)) == sizeof(first_creation_ns)) {
+    if (first_creation_ns > creation_ns) stats_.saved_ns += first_creation_ns - creation_ns;
+  } else {
+    blob_cache.Store(record_key.data(), record_key.size(), &creation_ns, sizeof(creation_ns));
+  }
+}
+
+void PipelineCache::WaitIdle() {
+  WaitUntil(device_, [this] { return stats_.num_pending == 0; });
+}
+
+}  // namespace web_gpu_app
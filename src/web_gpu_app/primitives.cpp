@@ -0,0 +1,69 @@
+#include "web_gpu_app/primitives.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/common.hpp>
+
+namespace web_gpu_app {
+
+PrimitiveGeometry CreateCubeGeometry() {
+  static const Vec3 kNormals[] = {{1, 0, 0},  {-1, 0, 0}, {0, 1, 0},
+                                  {0, -1, 0}, {0, 0, 1},  {0, 0, -1}};
+  PrimitiveGeometry geometry;
+  for (const Vec3& normal : kNormals) {
+    // Build two tangent axes so that (u, v, normal) is right-handed.
+    Vec3 u = Vec3(normal.y, normal.z, normal.x);
+    Vec3 v = glm::cross(normal, u);
+    uint32_t base = static_cast<uint32_t>(geometry.vertices.size());
+    geometry.vertices.push_back({0.5f * (normal - u - v), normal});
+    geometry.vertices.push_back({0.5f * (normal + u - v), normal});
+    geometry.vertices.push_back({0.5f * (normal + u + v), normal});
+    geometry.vertices.push_back({0.5f * (normal - u + v), normal});
+    geometry.indices.insert(geometry.indices.end(),
+                            {base, base + 1, base + 2, base, base + 2, base + 3});
+  }
+  return geometry;
+}
+
+PrimitiveGeometry CreateSphereGeometry(uint32_t num_segments, uint32_t num_rings) {
+  PrimitiveGeometry geometry;
+  const float pi = glm::pi<float>();
+  for (uint32_t ring = 0; ring <= num_rings; ++ring) {
+    float theta = pi * static_cast<float>(ring) / static_cast<float>(num_rings);
+    for (uint32_t segment = 0; segment <= num_segments; ++segment) {
+      float phi = 2.f * pi * static_cast<float>(segment) / static_cast<float>(num_segments);
+      Vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta),
+                  std::sin(theta) * std::sin(phi));
+      geometry.vertices.push_back({normal, normal});
+    }
+  }
+
+  const uint32_t stride = num_segments + 1;
+  for (uint32_t ring = 0; ring < num_rings; ++ring) {
+    for (uint32_t segment = 0; segment < num_segments; ++segment) {
+      uint32_t i0 = ring * stride + segment;
+      uint32_t i1 = i0 + stride;
+      geometry.indices.insert(geometry.indices.end(), {i0, i0 + 1, i1, i1, i0 + 1, i1 + 1});
+    }
+  }
+  return geometry;
+}
+
+BoundingSphere ComputeBoundingSphere(const PrimitiveGeometry& geometry) {
+  if (geometry.vertices.empty()) return {};
+  Vec3 min = geometry.vertices[0].position;
+  Vec3 max = min;
+  for (const Vertex& vertex : geometry.vertices) {
+    min = glm::min(min, vertex.position);
+    max = glm::max(max, vertex.position);
+  }
+  BoundingSphere sphere{.center = 0.5f * (min + max)};
+  for (const Vertex& vertex : geometry.vertices) {
+    Vec3 offset = vertex.position - sphere.center;
+    sphere.radius = std::max(sphere.radius, glm::dot(offset, offset));
+  }
+  sphere.radius = std::sqrt(sphere.radius);
+  return sphere;
+}
+
+}  // namespace web_gpu_app
@@ -0,0 +1,244 @@
+#include "web_gpu_app/profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <tuple>
+
+#include "imgui.h"
+
+namespace web_gpu_app {
+
+std::atomic<bool> Profiler::enabled_ = false;
+thread_local uint32_t Profiler::scope_depth_ = 0;
+thread_local Profiler::ThreadBuffer* Profiler::thread_buffer_ = nullptr;
+
+// Single producer (the owning thread), single consumer (the main thread) ring buffer.
+struct Profiler::ThreadBuffer {
+  static constexpr size_t kCapacity = 16 * 1024;
+
+  std::array<ProfileEvent, kCapacity> events;
+  std::atomic<uint64_t> write_index = 0;
+  std::atomic<uint64_t> read_index = 0;
+  std::atomic<uint64_t> num_dropped = 0;
+  uint32_t thread_id = 0;
+};
+
+namespace {
+
+float Percentile(std::vector<float>& values, float percentile) {
+  if (values.empty()) return 0.f;
+  size_t index = std::min(values.size() - 1, static_cast<size_t>(percentile * values.size()));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+}  // namespace
+
+Profiler& Profiler::Get() {
+  static Profiler profiler;
+  return profiler;
+}
+
+Profiler::Profiler() { frame_times_ms_.reserve(kFrameHistorySize); }
+
+Profiler::~Profiler() {}
+
+uint64_t Profiler::NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Profiler::SetEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+
+Profiler::ThreadBuffer* Profiler::GetThreadBuffer() {
+  if (thread_buffer_ == nullptr) {
+    // Buffers are never freed so that events of exited threads can still be drained.
+    std::lock_guard<std::mutex> lock(thread_buffers_mutex_);
+    thread_buffers_.push_back(std::make_unique<ThreadBuffer>());
+    thread_buffer_ = thread_buffers_.back().get();
+    thread_buffer_->thread_id = static_cast<uint32_t>(thread_buffers_.size());
+  }
+  return thread_buffer_;
+}
+
+void Profiler::AddEvent(const ProfileEvent& event) {
+  ThreadBuffer* buffer = GetThreadBuffer();
+  uint64_t write_index = buffer->write_index.load(std::memory_order_relaxed);
+  if (write_index - buffer->read_index.load(std::memory_order_acquire) >=
+      ThreadBuffer::kCapacity) {
+    buffer->num_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  ProfileEvent& slot = buffer->events[write_index % ThreadBuffer::kCapacity];
+  slot = event;
+  slot.thread_id = buffer->thread_id;
+  buffer->write_index.store(write_index + 1, std::memory_order_release);
+}
+
+void Profiler::AddGpuEvent(const char* name, uint64_t begin_ns, uint64_t end_ns) {
+  frame_events_.push_back({name, begin_ns, end_ns, kGpuThreadId, 0});
+}
+
+void Profiler::SetCounter(const char* name, double value) {
+  if (!IsEnabled()) return;
+  auto it = std::find_if(frame_counters_.begin(), frame_counters_.end(),
+                         [name](const ProfileCounter& counter) { return counter.name == name; });
+  if (it == frame_counters_.end()) it = frame_counters_.insert(it, {.name = name});
+  it->time_ns = NowNs();
+  it->value = value;
+}
+
+void Profiler::DrainThreadBuffers() {
+  std::lock_guard<std::mutex> lock(thread_buffers_mutex_);
+  num_dropped_events_ = 0;
+  for (const std::unique_ptr<ThreadBuffer>& buffer : thread_buffers_) {
+    uint64_t read_index = buffer->read_index.load(std::memory_order_relaxed);
+    uint64_t write_index = buffer->write_index.load(std::memory_order_acquire);
+    for (; read_index < write_index; ++read_index) {
+      frame_events_.push_back(buffer->events[read_index % ThreadBuffer::kCapacity]);
+    }
+    buffer->read_index.store(read_index, std::memory_order_release);
+    num_dropped_events_ += buffer->num_dropped.load(std::memory_order_relaxed);
+  }
+}
+
+void Profiler::BeginFrame() { frame_begin_ns_ = NowNs(); }
+
+void Profiler::EndFrame() {
+  if (!IsEnabled()) return;
+
+  float frame_time_ms = static_cast<float>(NowNs() - frame_begin_ns_) * 1e-6f;
+  if (frame_times_ms_.size() < kFrameHistorySize) {
+    frame_times_ms_.push_back(frame_time_ms);
+  } else {
+    frame_times_ms_[frame_time_index_] = frame_time_ms;
+  }
+  frame_time_index_ = (frame_time_index_ + 1) % kFrameHistorySize;
+
+  DrainThreadBuffers();
+  if (capture_frames_left_ > 0) {
+    captured_events_.insert(captured_events_.end(), frame_events_.begin(), frame_events_.end());
+    captured_counters_.insert(captured_counters_.end(), frame_counters_.begin(),
+                              frame_counters_.end());
+    --capture_frames_left_;
+  }
+  std::swap(last_frame_events_, frame_events_);
+  frame_events_.clear();
+  std::swap(last_frame_counters_, frame_counters_);
+  frame_counters_.clear();
+}
+
+void Profiler::StartCapture(uint32_t num_frames) {
+  captured_events_.clear();
+  captured_counters_.clear();
+  capture_frames_left_ = num_frames;
+}
+
+bool Profiler::WriteChromeTrace(const std::string& file_name) const {
+  std::ofstream file(file_name);
+  if (!file) {
+    std::cerr << "Cannot open file: " << file_name << std::endl;
+    return false;
+  }
+
+  uint64_t base_ns = ~0ull;
+  for (const ProfileEvent& event : captured_events_) {
+    base_ns = std::min(base_ns, event.begin_ns);
+  }
+  for (const ProfileCounter& counter : captured_counters_) {
+    base_ns = std::min(base_ns, counter.time_ns);
+  }
+
+  file << "{\"traceEvents\":[\n";
+  bool first = true;
+  for (const ProfileEvent& event : captured_events_) {
+    file << (first ? "" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0"
+         << ",\"tid\":" << event.thread_id << ",\"ts\":" << (event.begin_ns - base_ns) / 1000.0
+         << ",\"dur\":" << (event.end_ns - event.begin_ns) / 1000.0 << "}";
+    first = false;
+  }
+  for (const ProfileCounter& counter : captured_counters_) {
+    file << (first ? "" : ",\n") << "{\"name\":\"" << counter.name << "\",\"ph\":\"C\",\"pid\":0"
+         << ",\"ts\":" << (counter.time_ns - base_ns) / 1000.0 << ",\"args\":{\"value\":"
+         << counter.value << "}}";
+    first = false;
+  }
+  file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":"
+       << kGpuThreadId << ",\"args\":{\"name\":\"GPU\"}}\n]}\n";
+  return true;
+}
+
+FrameTimeStats Profiler::GetFrameTimeStats() const {
+  FrameTimeStats stats;
+  if (frame_times_ms_.empty()) return stats;
+
+  std::vector<float> frame_times = frame_times_ms_;
+  for (float frame_time : frame_times) {
+    stats.average_ms += frame_time;
+    stats.max_ms = std::max(stats.max_ms, frame_time);
+  }
+  stats.average_ms /= static_cast<float>(frame_times.size());
+  stats.p50_ms = Percentile(frame_times, 0.50f);
+  stats.p95_ms = Percentile(frame_times, 0.95f);
+  stats.p99_ms = Percentile(frame_times, 0.99f);
+  return stats;
+}
+
+void Profiler::DrawOverlay() {
+  if (!IsEnabled() || !overlay_visible_) return;
+
+  ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
+  if (!ImGui::Begin("Profiler", &overlay_visible_, ImGuiWindowFlags_AlwaysAutoResize)) {
+    ImGui::End();
+    return;
+  }
+
+  FrameTimeStats stats = GetFrameTimeStats();
+  ImGui::Text("Frame: avg %.2f ms  p50 %.2f  p95 %.2f  p99 %.2f  max %.2f", stats.average_ms,
+              stats.p50_ms, stats.p95_ms, stats.p99_ms, stats.max_ms);
+  ImGui::PlotLines(
+      "##frame_times", frame_times_ms_.data(), static_cast<int>(frame_times_ms_.size()),
+      static_cast<int>(frame_time_index_ % std::max<size_t>(1, frame_times_ms_.size())), nullptr,
+      0.f, std::max(stats.max_ms, 1.f), ImVec2(300, 60));
+
+  // Aggregate scopes of the last frame by thread, depth and name, in order of appearance.
+  std::map<std::tuple<uint32_t, uint32_t, const char*>, double> durations_ms;
+  std::vector<std::tuple<uint32_t, uint32_t, const char*>> order;
+  for (const ProfileEvent& event : last_frame_events_) {
+    auto key = std::make_tuple(event.thread_id, event.depth, event.name);
+    auto [it, inserted] = durations_ms.try_emplace(key, 0.0);
+    if (inserted) order.push_back(key);
+    it->second += (event.end_ns - event.begin_ns) * 1e-6;
+  }
+  for (const auto& key : order) {
+    auto [thread_id, depth, name] = key;
+    ImGui::Text("%s%*s%s: %.3f ms", thread_id == kGpuThreadId ? "[GPU] " : "", depth * 2, "",
+                name, durations_ms[key]);
+  }
+  for (const ProfileCounter& counter : last_frame_counters_) {
+    ImGui::Text("%s: %g", counter.name, counter.value);
+  }
+  if (num_dropped_events_ > 0) {
+    ImGui::Text("Dropped events: %llu", static_cast<unsigned long long>(num_dropped_events_));
+  }
+
+  if (IsCapturing()) {
+    ImGui::Text("Capturing... %u frames left", capture_frames_left_);
+  } else if (ImGui::Button("Capture 60 frames")) {
+    StartCapture(60);
+  }
+  if (!captured_events_.empty() && !IsCapturing()) {
+    ImGui::SameLine();
+    if (ImGui::Button("Export trace.json")) {
+      WriteChromeTrace("trace.json");
+    }
+  }
+  ImGui::End();
+}
+
+}  // namespace web_gpu_app
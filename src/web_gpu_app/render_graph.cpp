@@ -0,0 +1,404 @@
+#include "web_gpu_app/render_graph.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "web_gpu_app/profiler.h"
+
+namespace web_gpu_app {
+
+TransientTexturePool::TransientTexturePool(wgpu::Device device, uint32_t max_unused_frames)
+    : device_(device), max_unused_frames_(max_unused_frames) {}
+
+TransientTexturePool::~TransientTexturePool() {}
+
+wgpu::TextureView TransientTexturePool::Acquire(const TransientTextureDescriptor& descriptor,
+                                                uint32_t index) {
+  for (Texture& texture : textures_) {
+    if (texture.descriptor == descriptor && texture.index == index) {
+      texture.last_used_frame = frame_;
+      return texture.view;
+    }
+  }
+
+  PROFILE_SCOPE("TransientTexturePool::Acquire");
+  wgpu::TextureDescriptor texture_descriptor{
+      .usage = descriptor.usage,
+      .size = {descriptor.width, descriptor.height, 1},
+      .format = descriptor.format};
+  Texture& texture = textures_.emplace_back(Texture{.descriptor = descriptor,
+                                                    .index = index,
+                                                    .texture = device_.CreateTexture(
+                                                        &texture_descriptor),
+                                                    .last_used_frame = frame_});
+  texture.view = texture.texture.CreateView();
+  ++stats_.num_created;
+  stats_.num_textures = textures_.size();
+  return texture.view;
+}
+
+void TransientTexturePool::BeginFrame() {
+  ++frame_;
+  // Frames in flight still reference the textures they use: releasing them is safe.
+  stats_.num_evicted += std::erase_if(textures_, [this](const Texture& texture) {
+    return frame_ - texture.last_used_frame > max_unused_frames_;
+  });
+  stats_.num_textures = textures_.size();
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::AddColorAttachment(
+    RenderGraphResource texture) {
+  return AddAttachment({.texture = texture});
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::AddColorAttachment(
+    RenderGraphResource texture, wgpu::Color clear_color) {
+  return AddAttachment({.texture = texture, .clear = true, .clear_color = clear_color});
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SetDepthAttachment(
+    RenderGraphResource texture) {
+  return AddAttachment({.texture = texture, .depth = true});
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SetDepthAttachment(
+    RenderGraphResource texture, float clear_depth) {
+  return AddAttachment(
+      {.texture = texture, .depth = true, .clear = true, .clear_depth = clear_depth});
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SetReadOnlyDepthAttachment(
+    RenderGraphResource texture) {
+  return AddAttachment({.texture = texture, .depth = true, .read_only = true});
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Read(RenderGraphResource resource) {
+  return AddAccess(resource, false);
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Write(RenderGraphResource resource) {
+  return AddAccess(resource, true);
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SetSideEffects() {
+  graph_->pass_infos_[pass_].side_effects = true;
+  return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::AddAttachment(
+    const RenderGraphAttachment& attachment) {
+  // The attachments and accesses of a pass are contiguous.
+  assert(pass_ + 1 == graph_->pass_infos_.size());
+  graph_->attachments_.push_back(attachment);
+  ++graph_->pass_infos_[pass_].num_attachments;
+  return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::AddAccess(RenderGraphResource resource,
+                                                              bool write) {
+  assert(pass_ + 1 == graph_->pass_infos_.size());
+  graph_->accesses_.push_back({.resource = resource, .write = write});
+  ++graph_->pass_infos_[pass_].num_accesses;
+  return *this;
+}
+
+RenderGraph::RenderGraph() {}
+
+RenderGraph::~RenderGraph() {}
+
+void RenderGraph::Reset() {
+  resources_.clear();
+  views_.clear();
+  pass_infos_.clear();
+  render_callbacks_.clear();
+  encoder_callbacks_.clear();
+  attachments_.clear();
+  accesses_.clear();
+  stats_ = {};
+  compiled_ = false;
+}
+
+RenderGraphResource RenderGraph::AddResource(const RenderGraphResourceInfo& resource) {
+  resources_.push_back(resource);
+  views_.emplace_back();
+  return static_cast<RenderGraphResource>(resources_.size() - 1);
+}
+
+RenderGraphResource RenderGraph::CreateTexture(const char* name,
+                                               const TransientTextureDescriptor& descriptor) {
+  return AddResource({.name = name, .descriptor = descriptor});
+}
+
+RenderGraphResource RenderGraph::ImportTexture(const char* name, wgpu::TextureView view) {
+  RenderGraphResource texture = AddResource({.name = name, .imported = true});
+  views_[texture] = view;
+  return texture;
+}
+
+RenderGraphResource RenderGraph::ImportBuffer(const char* name) {
+  return AddResource({.name = name, .imported = true, .buffer = true});
+}
+
+uint32_t RenderGraph::AddPass(const char* name, bool render) {
+  pass_infos_.push_back({.name = name,
+                         .render = render,
+                         .first_attachment = static_cast<uint32_t>(attachments_.size()),
+                         .first_access = static_cast<uint32_t>(accesses_.size())});
+  return static_cast<uint32_t>(pass_infos_.size() - 1);
+}
+
+RenderGraph::PassBuilder RenderGraph::AddRenderPass(const char* name, RenderCallback callback) {
+  const uint32_t pass = AddPass(name, true);
+  render_callbacks_.push_back(std::move(callback));
+  encoder_callbacks_.emplace_back();
+  return PassBuilder(this, pass);
+}
+
+RenderGraph::PassBuilder RenderGraph::AddEncoderPass(const char* name, EncoderCallback callback) {
+  const uint32_t pass = AddPass(name, false);
+  render_callbacks_.emplace_back();
+  encoder_callbacks_.push_back(std::move(callback));
+  return PassBuilder(this, pass);
+}
+
+bool RenderGraph::CheckResource(const RenderGraphPassInfo& pass, RenderGraphResource resource,
+                                bool allow_buffer, std::string* error) const {
+  if (resource >= resources_.size()) {
+    if (error) *error = std::string(pass.name) + " accesses an unknown resource";
+    return false;
+  }
+  if (resources_[resource].buffer && !allow_buffer) {
+    if (error) {
+      *error = std::string(pass.name) + " uses buffer " + resources_[resource].name +
+               " as an attachment";
+    }
+    return false;
+  }
+  return true;
+}
+
+bool RenderGraph::Compile(std::string* error) {
+  PROFILE_SCOPE("RenderGraph::Compile");
+  compiled_ = false;
+  stats_ = {.num_passes = static_cast<uint32_t>(pass_infos_.size())};
+  for (const RenderGraphPassInfo& pass : pass_infos_) {
+    if (pass.render && pass.num_attachments == 0) {
+      if (error) *error = std::string(pass.name) + " has no attachment";
+      return false;
+    }
+    uint32_t num_depth_attachments = 0;
+    for (const RenderGraphAttachment& attachment : GetAttachments(pass)) {
+      if (!CheckResource(pass, attachment.texture, false, error)) return false;
+      num_depth_attachments += attachment.depth;
+    }
+    if (num_depth_attachments > 1) {
+      if (error) *error = std::string(pass.name) + " has several depth attachments";
+      return false;
+    }
+    for (const RenderGraphAccess& access : GetAccesses(pass)) {
+      if (!CheckResource(pass, access.resource, true, error)) return false;
+    }
+  }
+
+  CullPasses();
+
+  // Forward over the kept passes: "live_" now tells whether the contents are defined.
+  for (RenderGraphResourceInfo& resource : resources_) {
+    resource.first_pass = kNoPass;
+    resource.last_pass = kNoPass;
+  }
+  for (size_t i = 0; i < resources_.size(); ++i) live_[i] = resources_[i].imported;
+  auto touch = [this](RenderGraphResource resource, uint32_t pass, wgpu::TextureUsage usage) {
+    RenderGraphResourceInfo& info = resources_[resource];
+    if (info.first_pass == kNoPass) info.first_pass = pass;
+    info.last_pass = pass;
+    if (!info.imported && !info.buffer) info.descriptor.usage |= usage;
+  };
+  for (uint32_t p = 0; p < pass_infos_.size(); ++p) {
+    const RenderGraphPassInfo& pass = pass_infos_[p];
+    if (pass.culled) continue;
+    for (const RenderGraphAccess& access : GetAccesses(pass)) {
+      if (!access.write && !live_[access.resource]) {
+        if (error) {
+          *error = std::string(pass.name) + " reads " + resources_[access.resource].name +
+                   " before any pass writes it";
+        }
+        return false;
+      }
+      touch(access.resource, p,
+            access.write ? wgpu::TextureUsage::StorageBinding : wgpu::TextureUsage::TextureBinding);
+    }
+    for (RenderGraphAttachment& attachment :
+         std::span(attachments_).subspan(pass.first_attachment, pass.num_attachments)) {
+      touch(attachment.texture, p, wgpu::TextureUsage::RenderAttachment);
+      if (attachment.read_only) {
+        if (!live_[attachment.texture]) {
+          if (error) {
+            *error = std::string(pass.name) + " tests against " +
+                     resources_[attachment.texture].name + " before any pass writes it";
+          }
+          return false;
+        }
+        attachment.load_op = wgpu::LoadOp::Undefined;
+        continue;
+      }
+      // Undefined contents are cleared, which costs nothing on tiled GPUs unlike a load.
+      attachment.load_op = attachment.clear || !live_[attachment.texture] ? wgpu::LoadOp::Clear
+                                                                         : wgpu::LoadOp::Load;
+    }
+    for (const RenderGraphAttachment& attachment : GetAttachments(pass)) {
+      if (!attachment.read_only) live_[attachment.texture] = true;
+    }
+    for (const RenderGraphAccess& access : GetAccesses(pass)) {
+      if (access.write) live_[access.resource] = true;
+    }
+  }
+
+  AssignPhysicalTextures();
+  compiled_ = true;
+  return true;
+}
+
+void RenderGraph::CullPasses() {
+  // Backward over the passes: "live_" tells whether the contents are used by a kept pass or are
+  // an output of the frame.
+  live_.resize(resources_.size());
+  for (size_t i = 0; i < resources_.size(); ++i) {
+    live_[i] = resources_[i].imported && !resources_[i].buffer;
+  }
+  for (uint32_t p = static_cast<uint32_t>(pass_infos_.size()); p-- > 0;) {
+    RenderGraphPassInfo& pass = pass_infos_[p];
+    std::span<RenderGraphAttachment> attachments =
+        std::span(attachments_).subspan(pass.first_attachment, pass.num_attachments);
+    bool kept = pass.side_effects;
+    for (const RenderGraphAttachment& attachment : attachments) {
+      kept |= !attachment.read_only && live_[attachment.texture];
+    }
+    for (const RenderGraphAccess& access : GetAccesses(pass)) {
+      kept |= access.write && live_[access.resource];
+    }
+    pass.culled = !kept;
+    if (!kept) {
+      ++stats_.num_culled_passes;
+      continue;
+    }
+
+    for (RenderGraphAttachment& attachment : attachments) {
+      if (attachment.read_only) {
+        attachment.store_op = wgpu::StoreOp::Undefined;
+        continue;
+      }
+      attachment.store_op = live_[attachment.texture] ? wgpu::StoreOp::Store
+                                                      : wgpu::StoreOp::Discard;
+      stats_.num_discarded_attachments += attachment.store_op == wgpu::StoreOp::Discard;
+    }
+    // The pass's writes replace the contents that the previous passes wrote, except for what it
+    // reads, including the attachments that it loads.
+    for (const RenderGraphAttachment& attachment : attachments) {
+      if (!attachment.read_only) live_[attachment.texture] = false;
+    }
+    for (const RenderGraphAccess& access : GetAccesses(pass)) {
+      if (access.write) live_[access.resource] = false;
+    }
+    for (const RenderGraphAttachment& attachment : attachments) {
+      if (attachment.read_only || !attachment.clear) live_[attachment.texture] = true;
+    }
+    for (const RenderGraphAccess& access : GetAccesses(pass)) {
+      if (!access.write) live_[access.resource] = true;
+    }
+  }
+}
+
+void RenderGraph::AssignPhysicalTextures() {
+  transient_order_.clear();
+  for (uint32_t i = 0; i < resources_.size(); ++i) {
+    const RenderGraphResourceInfo& resource = resources_[i];
+    if (!resource.imported && !resource.buffer && resource.first_pass != kNoPass) {
+      transient_order_.push_back(i);
+    }
+  }
+  // Greedy by first use, which needs the fewest textures for intervals.
+  std::stable_sort(transient_order_.begin(), transient_order_.end(),
+                   [this](uint32_t a, uint32_t b) {
+                     return resources_[a].first_pass < resources_[b].first_pass;
+                   });
+  physical_textures_.clear();
+  for (uint32_t i : transient_order_) {
+    RenderGraphResourceInfo& resource = resources_[i];
+    uint32_t num_matching = 0;
+    PhysicalTexture* free_texture = nullptr;
+    for (PhysicalTexture& texture : physical_textures_) {
+      if (texture.descriptor != resource.descriptor) continue;
+      ++num_matching;
+      if (free_texture == nullptr && texture.last_pass < resource.first_pass) {
+        free_texture = &texture;
+      }
+    }
+    if (free_texture == nullptr) {
+      free_texture = &physical_textures_.emplace_back(
+          PhysicalTexture{.descriptor = resource.descriptor, .index = num_matching});
+    }
+    free_texture->last_pass = resource.last_pass;
+    resource.physical_index = free_texture->index;
+  }
+  stats_.num_transient_textures = static_cast<uint32_t>(transient_order_.size());
+  stats_.num_physical_textures = static_cast<uint32_t>(physical_textures_.size());
+}
+
+void RenderGraph::Execute(wgpu::CommandEncoder encoder, TransientTexturePool* pool,
+                          GpuProfiler* profiler) {
+  if (!compiled_) return;
+  PROFILE_SCOPE("RenderGraph::Execute");
+  for (uint32_t i : transient_order_) {
+    views_[i] = pool->Acquire(resources_[i].descriptor, resources_[i].physical_index);
+  }
+
+  for (uint32_t p = 0; p < pass_infos_.size(); ++p) {
+    const RenderGraphPassInfo& pass = pass_infos_[p];
+    if (pass.culled) continue;
+    if (!pass.render) {
+      encoder_callbacks_[p](encoder);
+      continue;
+    }
+
+    color_attachments_.clear();
+    wgpu::RenderPassDepthStencilAttachment depth_stencil_attachment;
+    bool has_depth = false;
+    for (const RenderGraphAttachment& attachment : GetAttachments(pass)) {
+      if (!attachment.depth) {
+        color_attachments_.push_back({.view = views_[attachment.texture],
+                                      .loadOp = attachment.load_op,
+                                      .storeOp = attachment.store_op,
+                                      .clearValue = attachment.clear_color});
+        continue;
+      }
+      has_depth = true;
+      depth_stencil_attachment.view = views_[attachment.texture];
+      depth_stencil_attachment.depthLoadOp = attachment.load_op;
+      depth_stencil_attachment.depthStoreOp = attachment.store_op;
+      depth_stencil_attachment.depthClearValue = attachment.clear_depth;
+      depth_stencil_attachment.depthReadOnly = attachment.read_only;
+      depth_stencil_attachment.stencilClearValue = 0;
+#ifdef WEBGPU_BACKEND_WGPU
+      depth_stencil_attachment.stencilLoadOp = wgpu::LoadOp::Clear;
+      depth_stencil_attachment.stencilStoreOp = wgpu::StoreOp::Store;
+#else
+      depth_stencil_attachment.stencilLoadOp = wgpu::LoadOp::Undefined;
+      depth_stencil_attachment.stencilStoreOp = wgpu::StoreOp::Undefined;
+#endif
+      depth_stencil_attachment.stencilReadOnly = true;
+    }
+    wgpu::RenderPassDescriptor descriptor{
+        .colorAttachmentCount = color_attachments_.size(),
+        .colorAttachments = color_attachments_.data(),
+        .depthStencilAttachment = has_depth ? &depth_stencil_attachment : nullptr,
+        .timestampWrites = profiler != nullptr ? profiler->BeginPass(pass.name) : nullptr};
+    wgpu::RenderPassEncoder render_pass = encoder.BeginRenderPass(&descriptor);
+    render_callbacks_[p](render_pass);
+    render_pass.End();
+  }
+  // The views of the swap chain must not outlive the frame.
+  std::fill(views_.begin(), views_.end(), nullptr);
+}
+
+}  // namespace web_gpu_app
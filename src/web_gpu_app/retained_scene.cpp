@@ -0,0 +1,204 @@
+#include "web_gpu_app/retained_scene.h"
+
+#include <algorithm>
+
+namespace web_gpu_app {
+
+namespace {
+
+// Sorting the dirty instances costs more than a pass over the flags of all the instances once more
+// than one in this many is dirty.
+constexpr size_t kSortedDirtyRatio = 16;
+
+uint32_t GetSlotIndex(SceneObjectHandle handle) { return static_cast<uint32_t>(handle); }
+
+uint32_t GetGeneration(SceneObjectHandle handle) { return static_cast<uint32_t>(handle >> 32); }
+
+}  // namespace
+
+SceneObjectHandle RetainedScene::AddCube(const Cube& cube) {
+  return Add(SceneObjectKind::kCube, cube.transform, cube.size, cube.color);
+}
+
+SceneObjectHandle RetainedScene::AddSphere(const Sphere& sphere) {
+  return Add(SceneObjectKind::kSphere, sphere.transform, sphere.radius, sphere.color);
+}
+
+SceneObjectHandle RetainedScene::Add(SceneObjectKind kind, const Mat4& transform, float scale,
+                                     const Color& color) {
+  uint32_t slot_index;
+  if (!free_slots_.empty()) {
+    slot_index = free_slots_.back();
+    free_slots_.pop_back();
+  } else {
+    slot_index = static_cast<uint32_t>(slots_.size());
+    // Generations start at 1 so that no handle is 0.
+    slots_.push_back({.generation = 1});
+  }
+  Group& group = groups_[static_cast<size_t>(kind)];
+  const uint32_t instance = static_cast<uint32_t>(group.instances.size());
+  Slot& slot = slots_[slot_index];
+  slot.kind = kind;
+  slot.instance = instance;
+  slot.alive = true;
+
+  group.instances.emplace_back();
+  PackInstance(transform, scale, color, &group.instances.back());
+  group.transforms.push_back(transform);
+  group.scales.push_back(scale);
+  group.slots.push_back(slot_index);
+  group.dirty_flags.push_back(0);
+  MarkDirty(&group, instance);
+  ++stats_.num_edits;
+  return (uint64_t{slot.generation} << 32) | slot_index;
+}
+
+bool RetainedScene::Remove(SceneObjectHandle handle) {
+  Slot* slot = GetSlot(handle);
+  if (slot == nullptr) return false;
+  Group& group = groups_[static_cast<size_t>(slot->kind)];
+  const uint32_t instance = slot->instance;
+  const uint32_t last = static_cast<uint32_t>(group.instances.size()) - 1;
+  if (instance != last) {
+    group.instances[instance] = group.instances[last];
+    group.transforms[instance] = group.transforms[last];
+    group.scales[instance] = group.scales[last];
+    group.slots[instance] = group.slots[last];
+    slots_[group.slots[instance]].instance = instance;
+    MarkDirty(&group, instance);
+  }
+  group.instances.pop_back();
+  group.transforms.pop_back();
+  group.scales.pop_back();
+  group.slots.pop_back();
+  group.dirty_flags.pop_back();
+
+  slot->alive = false;
+  if (++slot->generation == 0) slot->generation = 1;
+  free_slots_.push_back(GetSlotIndex(handle));
+  ++stats_.num_edits;
+  return true;
+}
+
+void RetainedScene::Clear() {
+  for (uint32_t i = 0; i < slots_.size(); ++i) {
+    Slot& slot = slots_[i];
+    if (!slot.alive) continue;
+    slot.alive = false;
+    if (++slot.generation == 0) slot.generation = 1;
+    free_slots_.push_back(i);
+  }
+  for (Group& group : groups_) group = {};
+}
+
+bool RetainedScene::Contains(SceneObjectHandle handle) const { return GetSlot(handle) != nullptr; }
+
+bool RetainedScene::SetTransform(SceneObjectHandle handle, const Mat4& transform) {
+  Slot* slot = GetSlot(handle);
+  if (slot == nullptr) return false;
+  Group& group = groups_[static_cast<size_t>(slot->kind)];
+  group.transforms[slot->instance] = transform;
+  Pack(&group, slot->instance);
+  MarkDirty(&group, slot->instance);
+  ++stats_.num_edits;
+  return true;
+}
+
+bool RetainedScene::SetColor(SceneObjectHandle handle, const Color& color) {
+  Slot* slot = GetSlot(handle);
+  if (slot == nullptr) return false;
+  Group& group = groups_[static_cast<size_t>(slot->kind)];
+  group.instances[slot->instance].color = PackColor(color);
+  MarkDirty(&group, slot->instance);
+  ++stats_.num_edits;
+  return true;
+}
+
+bool RetainedScene::SetScale(SceneObjectHandle handle, float scale) {
+  Slot* slot = GetSlot(handle);
+  if (slot == nullptr) return false;
+  Group& group = groups_[static_cast<size_t>(slot->kind)];
+  group.scales[slot->instance] = scale;
+  Pack(&group, slot->instance);
+  MarkDirty(&group, slot->instance);
+  ++stats_.num_edits;
+  return true;
+}
+
+bool RetainedScene::GetInstanceIndex(SceneObjectHandle handle, SceneObjectKind* kind,
+                                     uint32_t* index) const {
+  const Slot* slot = GetSlot(handle);
+  if (slot == nullptr) return false;
+  *kind = slot->kind;
+  *index = slot->instance;
+  return true;
+}
+
+size_t RetainedScene::size() const {
+  size_t size = 0;
+  for (const Group& group : groups_) size += group.instances.size();
+  return size;
+}
+
+void RetainedScene::TakeDirtyRanges(SceneObjectKind kind, std::vector<DirtyRange>* ranges) {
+  ranges->clear();
+  Group& group = groups_[static_cast<size_t>(kind)];
+  const uint32_t size = static_cast<uint32_t>(group.instances.size());
+  auto append = [&](uint32_t instance) {
+    if (!ranges->empty() && instance <= ranges->back().end + kMaxRangeGap) {
+      ranges->back().end = std::max(ranges->back().end, instance + 1);
+    } else {
+      ranges->push_back({instance, instance + 1});
+    }
+  };
+  if (group.all_dirty) {
+    if (size > 0) ranges->push_back({0, size});
+    std::fill(group.dirty_flags.begin(), group.dirty_flags.end(), 0);
+  } else if (group.dirty.size() * kSortedDirtyRatio < size) {
+    std::sort(group.dirty.begin(), group.dirty.end());
+    for (uint32_t instance : group.dirty) {
+      if (instance >= size) break;
+      append(instance);
+      group.dirty_flags[instance] = 0;
+    }
+  } else {
+    for (uint32_t instance = 0; instance < size; ++instance) {
+      if (group.dirty_flags[instance]) append(instance);
+    }
+    std::fill(group.dirty_flags.begin(), group.dirty_flags.end(), 0);
+  }
+  group.dirty.clear();
+  group.all_dirty = false;
+  for (const DirtyRange& range : *ranges) stats_.num_dirty_instances += range.end - range.begin;
+  stats_.num_dirty_ranges += ranges->size();
+}
+
+void RetainedScene::MarkAllDirty() {
+  for (Group& group : groups_) group.all_dirty = true;
+}
+
+RetainedScene::Slot* RetainedScene::GetSlot(SceneObjectHandle handle) {
+  return const_cast<Slot*>(static_cast<const RetainedScene*>(this)->GetSlot(handle));
+}
+
+const RetainedScene::Slot* RetainedScene::GetSlot(SceneObjectHandle handle) const {
+  const uint32_t index = GetSlotIndex(handle);
+  if (index >= slots_.size()) return nullptr;
+  const Slot& slot = slots_[index];
+  return slot.alive && slot.generation == GetGeneration(handle) ? &slot : nullptr;
+}
+
+void RetainedScene::Pack(Group* group, uint32_t instance) {
+  PackedInstance& packed = group->instances[instance];
+  const uint32_t color = packed.color;
+  PackInstance(group->transforms[instance], group->scales[instance], Color(0.f), &packed);
+  packed.color = color;
+}
+
+void RetainedScene::MarkDirty(Group* group, uint32_t instance) {
+  if (group->all_dirty || group->dirty_flags[instance]) return;
+  group->dirty_flags[instance] = 1;
+  group->dirty.push_back(instance);
+}
+
+}  // namespace web_gpu_app
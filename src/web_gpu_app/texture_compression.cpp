@@ -0,0 +1,437 @@
+#include "web_gpu_app/texture_compression.h"
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+namespace web_gpu_app {
+
+namespace {
+
+// Pixels of a 4x4 block in row-major order.
+using Block = std::array<std::array<uint8_t, 4>, 16>;
+
+float SrgbToLinear(float c) {
+  return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+float LinearToSrgb(float c) {
+  return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+uint8_t ToUnorm8(float value) {
+  return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+int Square(int value) { return value * value; }
+
+Block LoadBlock(std::span<const uint8_t> pixels, uint32_t width, uint32_t height,
+                uint32_t block_x, uint32_t block_y) {
+  Block block;
+  for (uint32_t y = 0; y < 4; ++y) {
+    for (uint32_t x = 0; x < 4; ++x) {
+      const uint32_t source_x = std::min(block_x * 4 + x, width - 1);
+      const uint32_t source_y = std::min(block_y * 4 + y, height - 1);
+      std::memcpy(block[y * 4 + x].data(), &pixels[(size_t{source_y} * width + source_x) * 4],
+                  4);
+    }
+  }
+  return block;
+}
+
+void StoreLittleEndian(uint64_t value, int num_bytes, uint8_t* out) {
+  for (int i = 0; i < num_bytes; ++i) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+void StoreBigEndian(uint64_t value, uint8_t* out) {
+  for (int i = 0; i < 8; ++i) out[i] = static_cast<uint8_t>(value >> (56 - 8 * i));
+}
+
+// BC1
+
+uint16_t ToRgb565(const float color[3]) {
+  const auto quantize = [](float value, int max) {
+    return static_cast<uint16_t>(std::clamp(value, 0.0f, 255.0f) * max / 255.0f + 0.5f);
+  };
+  return static_cast<uint16_t>(quantize(color[0], 31) << 11 | quantize(color[1], 63) << 5 |
+                               quantize(color[2], 31));
+}
+
+std::array<int, 3> FromRgb565(uint16_t color) {
+  const int r = color >> 11;
+  const int g = (color >> 5) & 63;
+  const int b = color & 31;
+  return {r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2};
+}
+
+// Fits the endpoints to the principal axis of the colors, then picks the nearest of the four
+// palette colors for each pixel.
+void EncodeBc1(const Block& block, uint8_t* out) {
+  float mean[3] = {};
+  for (const auto& pixel : block) {
+    for (int c = 0; c < 3; ++c) mean[c] += pixel[c] / 16.0f;
+  }
+  float covariance[3][3] = {};
+  for (const auto& pixel : block) {
+    const float d[3] = {pixel[0] - mean[0], pixel[1] - mean[1], pixel[2] - mean[2]};
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) covariance[i][j] += d[i] * d[j];
+    }
+  }
+  float axis[3] = {1.0f, 1.0f, 1.0f};
+  for (int iteration = 0; iteration < 8; ++iteration) {
+    float next[3] = {};
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) next[i] += covariance[i][j] * axis[j];
+    }
+    const float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+    if (length < 1e-6f) break;
+    for (int i = 0; i < 3; ++i) axis[i] = next[i] / length;
+  }
+  const float axis_length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+  float min_t = 0.0f;
+  float max_t = 0.0f;
+  for (const auto& pixel : block) {
+    float t = 0.0f;
+    for (int c = 0; c < 3; ++c) t += (pixel[c] - mean[c]) * axis[c] / axis_length;
+    min_t = std::min(min_t, t);
+    max_t = std::max(max_t, t);
+  }
+  float end0[3];
+  float end1[3];
+  for (int c = 0; c < 3; ++c) {
+    end0[c] = mean[c] + axis[c] / axis_length * max_t;
+    end1[c] = mean[c] + axis[c] / axis_length * min_t;
+  }
+
+  uint16_t color0 = ToRgb565(end0);
+  uint16_t color1 = ToRgb565(end1);
+  // color0 > color1 selects the four color mode, the only one BC3 supports.
+  if (color0 < color1) std::swap(color0, color1);
+  uint32_t indices = 0;
+  if (color0 != color1) {
+    const std::array<int, 3> c0 = FromRgb565(color0);
+    const std::array<int, 3> c1 = FromRgb565(color1);
+    std::array<int, 3> palette[4] = {c0, c1};
+    for (int c = 0; c < 3; ++c) {
+      palette[2][c] = (2 * c0[c] + c1[c]) / 3;
+      palette[3][c] = (c0[c] + 2 * c1[c]) / 3;
+    }
+    for (int i = 0; i < 16; ++i) {
+      int best_index = 0;
+      int best_error = INT_MAX;
+      for (int index = 0; index < 4; ++index) {
+        int error = 0;
+        for (int c = 0; c < 3; ++c) error += Square(palette[index][c] - block[i][c]);
+        if (error < best_error) {
+          best_error = error;
+          best_index = index;
+        }
+      }
+      indices |= static_cast<uint32_t>(best_index) << (2 * i);
+    }
+  }
+  StoreLittleEndian(color0, 2, out);
+  StoreLittleEndian(color1, 2, out + 2);
+  StoreLittleEndian(indices, 4, out + 4);
+}
+
+// The eight value mode of BC3 alpha, with the endpoints at the alpha range.
+void EncodeBc3Alpha(const Block& block, uint8_t* out) {
+  int alpha0 = 0;
+  int alpha1 = 255;
+  for (const auto& pixel : block) {
+    alpha0 = std::max<int>(alpha0, pixel[3]);
+    alpha1 = std::min<int>(alpha1, pixel[3]);
+  }
+  uint64_t indices = 0;
+  if (alpha0 > alpha1) {
+    int palette[8] = {alpha0, alpha1};
+    for (int i = 2; i < 8; ++i) palette[i] = ((8 - i) * alpha0 + (i - 1) * alpha1) / 7;
+    for (int i = 0; i < 16; ++i) {
+      int best_index = 0;
+      for (int index = 1; index < 8; ++index) {
+        if (std::abs(palette[index] - block[i][3]) <
+            std::abs(palette[best_index] - block[i][3])) {
+          best_index = index;
+        }
+      }
+      indices |= static_cast<uint64_t>(best_index) << (3 * i);
+    }
+  }
+  out[0] = static_cast<uint8_t>(alpha0);
+  out[1] = static_cast<uint8_t>(alpha1);
+  StoreLittleEndian(indices, 6, out + 2);
+}
+
+// ETC1, a valid subset of ETC2 as long as the differential colors do not overflow.
+
+constexpr int kEtc1Modifiers[8][2] = {{2, 8},   {5, 17},  {9, 29},  {13, 42},
+                                      {18, 60}, {24, 80}, {33, 106}, {47, 183}};
+
+bool InSubblock(int x, int y, bool flip, int subblock) {
+  return (flip ? y >= 2 : x >= 2) == (subblock == 1);
+}
+
+// Picks the table with the least error for the pixels of "subblock" around "base". The pixel
+// indices are 0: +a, 1: +b, 2: -a, 3: -b for the table entry {a, b}.
+int FitEtc1Subblock(const Block& block, bool flip, int subblock, const int base[3], int* table,
+                    uint8_t indices[16]) {
+  int best_error = INT_MAX;
+  for (int t = 0; t < 8; ++t) {
+    int table_error = 0;
+    uint8_t table_indices[16] = {};
+    for (int y = 0; y < 4; ++y) {
+      for (int x = 0; x < 4; ++x) {
+        if (!InSubblock(x, y, flip, subblock)) continue;
+        const auto& pixel = block[y * 4 + x];
+        int best_pixel_error = INT_MAX;
+        for (int index = 0; index < 4; ++index) {
+          const int modifier = kEtc1Modifiers[t][index & 1] * (index & 2 ? -1 : 1);
+          int error = 0;
+          for (int c = 0; c < 3; ++c) {
+            error += Square(std::clamp(base[c] + modifier, 0, 255) - pixel[c]);
+          }
+          if (error < best_pixel_error) {
+            best_pixel_error = error;
+            table_indices[y * 4 + x] = static_cast<uint8_t>(index);
+          }
+        }
+        table_error += best_pixel_error;
+      }
+    }
+    if (table_error < best_error) {
+      best_error = table_error;
+      *table = t;
+      for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+          if (InSubblock(x, y, flip, subblock)) indices[y * 4 + x] = table_indices[y * 4 + x];
+        }
+      }
+    }
+  }
+  return best_error;
+}
+
+// Tries both subblock orientations in the individual and in the differential mode.
+void EncodeEtc1(const Block& block, uint8_t* out) {
+  uint64_t best_bits = 0;
+  int best_error = INT_MAX;
+  for (int flip = 0; flip < 2; ++flip) {
+    float average[2][3] = {};
+    for (int y = 0; y < 4; ++y) {
+      for (int x = 0; x < 4; ++x) {
+        const int subblock = InSubblock(x, y, flip, 1) ? 1 : 0;
+        for (int c = 0; c < 3; ++c) average[subblock][c] += block[y * 4 + x][c] / 8.0f;
+      }
+    }
+
+    for (int differential = 0; differential < 2; ++differential) {
+      const int max = differential ? 31 : 15;
+      int quantized[2][3];
+      int base[2][3];
+      for (int s = 0; s < 2; ++s) {
+        for (int c = 0; c < 3; ++c) {
+          quantized[s][c] = static_cast<int>(average[s][c] * max / 255.0f + 0.5f);
+          base[s][c] = differential ? quantized[s][c] << 3 | quantized[s][c] >> 2
+                                    : quantized[s][c] * 17;
+        }
+      }
+      int delta[3];
+      bool fits = true;
+      for (int c = 0; c < 3; ++c) {
+        delta[c] = quantized[1][c] - quantized[0][c];
+        if (delta[c] < -4 || delta[c] > 3) fits = false;
+      }
+      if (differential && !fits) continue;
+
+      int tables[2] = {};
+      uint8_t indices[16] = {};
+      const int error = FitEtc1Subblock(block, flip, 0, base[0], &tables[0], indices) +
+                        FitEtc1Subblock(block, flip, 1, base[1], &tables[1], indices);
+      if (error >= best_error) continue;
+      best_error = error;
+
+      // Per channel: 5 bits of base color and 3 of delta, or twice 4 bits of base color.
+      uint64_t bits = 0;
+      for (int c = 0; c < 3; ++c) {
+        const int shift = 56 - 8 * c;
+        if (differential) {
+          bits |= uint64_t(quantized[0][c]) << (shift + 3) | uint64_t(delta[c] & 7) << shift;
+        } else {
+          bits |= uint64_t(quantized[0][c]) << (shift + 4) | uint64_t(quantized[1][c]) << shift;
+        }
+      }
+      bits |= uint64_t(tables[0]) << 37 | uint64_t(tables[1]) << 34 |
+              uint64_t(differential) << 33 | uint64_t(flip) << 32;
+      // The pixels are numbered in column-major order, their index split in two bit planes.
+      for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+          const int i = x * 4 + y;
+          const uint64_t index = indices[y * 4 + x];
+          bits |= (index >> 1) << (16 + i) | (index & 1) << i;
+        }
+      }
+      best_bits = bits;
+    }
+  }
+  StoreBigEndian(best_bits, out);
+}
+
+// EAC
+
+constexpr int kEacModifiers[16][8] = {
+    {-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12},
+    {-2, -5, -8, -13, 1, 4, 7, 12}, {-2, -4, -6, -13, 1, 3, 5, 12},
+    {-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10},
+    {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10},
+    {-2, -6, -8, -10, 1, 5, 7, 9},  {-2, -5, -8, -10, 1, 4, 7, 9},
+    {-2, -4, -8, -10, 1, 3, 7, 9},  {-2, -5, -7, -10, 1, 4, 6, 9},
+    {-3, -4, -7, -10, 2, 3, 6, 9},  {-1, -2, -3, -10, 0, 1, 2, 9},
+    {-4, -6, -8, -9, 3, 5, 7, 8},   {-3, -5, -7, -9, 2, 4, 6, 8}};
+
+// For each table, searches the multipliers and base values next to the ones spanning the alpha
+// range of the block.
+void EncodeEacAlpha(const Block& block, uint8_t* out) {
+  int min_alpha = 255;
+  int max_alpha = 0;
+  for (const auto& pixel : block) {
+    min_alpha = std::min<int>(min_alpha, pixel[3]);
+    max_alpha = std::max<int>(max_alpha, pixel[3]);
+  }
+
+  uint64_t best_bits = 0;
+  int best_error = INT_MAX;
+  for (int t = 0; t < 16 && best_error > 0; ++t) {
+    const int low = kEacModifiers[t][3];
+    const int high = kEacModifiers[t][7];
+    const int estimated_multiplier = std::clamp(
+        static_cast<int>(std::lround(float(max_alpha - min_alpha) / (high - low))), 1, 15);
+    for (int multiplier = std::max(estimated_multiplier - 1, 1);
+         multiplier <= std::min(estimated_multiplier + 1, 15); ++multiplier) {
+      const int estimated_base = static_cast<int>(
+          std::lround((min_alpha + max_alpha - (low + high) * multiplier) / 2.0f));
+      for (int base = std::max(estimated_base - 1, 0); base <= std::min(estimated_base + 1, 255);
+           ++base) {
+        int palette[8];
+        for (int i = 0; i < 8; ++i) {
+          palette[i] = std::clamp(base + kEacModifiers[t][i] * multiplier, 0, 255);
+        }
+        int error = 0;
+        uint64_t bits = uint64_t(base) << 56 | uint64_t(multiplier) << 52 | uint64_t(t) << 48;
+        for (int y = 0; y < 4; ++y) {
+          for (int x = 0; x < 4; ++x) {
+            const int alpha = block[y * 4 + x][3];
+            int best_index = 0;
+            for (int index = 1; index < 8; ++index) {
+              if (std::abs(palette[index] - alpha) < std::abs(palette[best_index] - alpha)) {
+                best_index = index;
+              }
+            }
+            error += Square(palette[best_index] - alpha);
+            bits |= uint64_t(best_index) << (45 - 3 * (x * 4 + y));
+          }
+        }
+        if (error < best_error) {
+          best_error = error;
+          best_bits = bits;
+        }
+      }
+    }
+  }
+  StoreBigEndian(best_bits, out);
+}
+
+}  // namespace
+
+std::vector<std::vector<uint8_t>> GenerateMipChain(std::span<const uint8_t> pixels,
+                                                   uint32_t width, uint32_t height, bool srgb) {
+  std::array<float, 256> to_linear;
+  for (int i = 0; i < 256; ++i) to_linear[i] = srgb ? SrgbToLinear(i / 255.0f) : i / 255.0f;
+
+  std::vector<std::vector<uint8_t>> levels;
+  levels.emplace_back(pixels.begin(), pixels.end());
+  const uint32_t num_levels = GetNumMipLevels(width, height);
+  for (uint32_t level = 1; level < num_levels; ++level) {
+    const std::vector<uint8_t>& source = levels.back();
+    const uint32_t level_width = std::max(width >> 1, 1u);
+    const uint32_t level_height = std::max(height >> 1, 1u);
+    std::vector<uint8_t> destination(size_t{level_width} * level_height * 4);
+    for (uint32_t y = 0; y < level_height; ++y) {
+      for (uint32_t x = 0; x < level_width; ++x) {
+        float sum[4] = {};
+        for (uint32_t dy = 0; dy < 2; ++dy) {
+          for (uint32_t dx = 0; dx < 2; ++dx) {
+            const uint32_t source_x = std::min(2 * x + dx, width - 1);
+            const uint32_t source_y = std::min(2 * y + dy, height - 1);
+            const uint8_t* pixel = &source[(size_t{source_y} * width + source_x) * 4];
+            for (int c = 0; c < 3; ++c) sum[c] += to_linear[pixel[c]];
+            sum[3] += pixel[3] / 255.0f;
+          }
+        }
+        uint8_t* pixel = &destination[(size_t{y} * level_width + x) * 4];
+        for (int c = 0; c < 3; ++c) {
+          pixel[c] = ToUnorm8(srgb ? LinearToSrgb(sum[c] / 4.0f) : sum[c] / 4.0f);
+        }
+        pixel[3] = ToUnorm8(sum[3] / 4.0f);
+      }
+    }
+    levels.push_back(std::move(destination));
+    width = level_width;
+    height = level_height;
+  }
+  return levels;
+}
+
+bool IsOpaque(std::span<const uint8_t> pixels) {
+  for (size_t i = 3; i < pixels.size(); i += 4) {
+    if (pixels[i] != 255) return false;
+  }
+  return true;
+}
+
+std::vector<uint8_t> CompressImage(std::span<const uint8_t> pixels, uint32_t width,
+                                   uint32_t height, TextureFileFormat format,
+                                   ThreadPool* thread_pool) {
+  if (format == TextureFileFormat::kRgba8) return {pixels.begin(), pixels.end()};
+  const TextureFormatInfo info = GetTextureFormatInfo(format);
+  const uint32_t blocks_x = (width + 3) / 4;
+  const uint32_t blocks_y = (height + 3) / 4;
+  std::vector<uint8_t> data(size_t{blocks_x} * blocks_y * info.bytes_per_block);
+  auto compress_rows = [&](size_t begin, size_t end, size_t) {
+    for (uint32_t block_y = static_cast<uint32_t>(begin); block_y < end; ++block_y) {
+      for (uint32_t block_x = 0; block_x < blocks_x; ++block_x) {
+        const Block block = LoadBlock(pixels, width, height, block_x, block_y);
+        uint8_t* out = &data[(size_t{block_y} * blocks_x + block_x) * info.bytes_per_block];
+        switch (format) {
+          case TextureFileFormat::kBc1:
+            EncodeBc1(block, out);
+            break;
+          case TextureFileFormat::kBc3:
+            EncodeBc3Alpha(block, out);
+            EncodeBc1(block, out + 8);
+            break;
+          case TextureFileFormat::kEtc2Rgb8:
+            EncodeEtc1(block, out);
+            break;
+          case TextureFileFormat::kEtc2Rgba8:
+            EncodeEacAlpha(block, out);
+            EncodeEtc1(block, out + 8);
+            break;
+          case TextureFileFormat::kRgba8:
+            break;
+        }
+      }
+    }
+  };
+  if (thread_pool != nullptr) {
+    thread_pool->ParallelFor(blocks_y, 4, compress_rows);
+  } else {
+    compress_rows(0, blocks_y, 0);
+  }
+  return data;
+}
+
+}  // namespace web_gpu_app
@@ -0,0 +1,237 @@
+#include "web_gpu_app/texture_file.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "web_gpu_app/utils.h"
+#include "web_gpu_app/web_gpu_utils.h"
+
+namespace web_gpu_app {
+
+static_assert(std::endian::native == std::endian::little, "Texture files are little-endian");
+static_assert(sizeof(TextureFileVariant) == 24, "TextureFileVariant must be tightly packed");
+
+namespace {
+
+constexpr size_t kPageSize = 4096;
+
+void WritePadding(std::ofstream& file, uint64_t offset) {
+  static const char kZeros[kTextureFileAlignment] = {};
+  file.write(kZeros, AlignUp(offset, kTextureFileAlignment) - offset);
+}
+
+bool SetError(const std::string& message, std::string* error) {
+  if (error != nullptr) *error = message;
+  return false;
+}
+
+bool IsValidFormat(TextureFileFormat format) {
+  return static_cast<uint32_t>(format) <= static_cast<uint32_t>(TextureFileFormat::kEtc2Rgba8);
+}
+
+uint64_t GetVariantSize(TextureFileFormat format, uint32_t width, uint32_t height,
+                        uint32_t num_mip_levels) {
+  uint64_t size = 0;
+  for (uint32_t level = 0; level < num_mip_levels; ++level) {
+    size += GetMipLevelSize(format, width, height, level);
+  }
+  return size;
+}
+
+}  // namespace
+
+TextureFormatInfo GetTextureFormatInfo(TextureFileFormat format) {
+  switch (format) {
+    case TextureFileFormat::kRgba8:
+      return {.block_size = 1, .bytes_per_block = 4};
+    case TextureFileFormat::kBc1:
+    case TextureFileFormat::kEtc2Rgb8:
+      return {.block_size = 4, .bytes_per_block = 8};
+    case TextureFileFormat::kBc3:
+    case TextureFileFormat::kEtc2Rgba8:
+      return {.block_size = 4, .bytes_per_block = 16};
+  }
+  return {};
+}
+
+const char* GetTextureFormatName(TextureFileFormat format) {
+  switch (format) {
+    case TextureFileFormat::kRgba8:
+      return "rgba8";
+    case TextureFileFormat::kBc1:
+      return "bc1";
+    case TextureFileFormat::kBc3:
+      return "bc3";
+    case TextureFileFormat::kEtc2Rgb8:
+      return "etc2_rgb8";
+    case TextureFileFormat::kEtc2Rgba8:
+      return "etc2_rgba8";
+  }
+  return "unknown";
+}
+
+uint32_t GetNumMipLevels(uint32_t width, uint32_t height) {
+  return std::bit_width(std::max({width, height, 1u}));
+}
+
+uint64_t GetMipLevelSize(TextureFileFormat format, uint32_t width, uint32_t height,
+                         uint32_t level) {
+  const TextureFormatInfo info = GetTextureFormatInfo(format);
+  const uint64_t level_width = std::max(width >> level, 1u);
+  const uint64_t level_height = std::max(height >> level, 1u);
+  const uint64_t blocks_x = (level_width + info.block_size - 1) / info.block_size;
+  const uint64_t blocks_y = (level_height + info.block_size - 1) / info.block_size;
+  return blocks_x * blocks_y * info.bytes_per_block;
+}
+
+bool WriteTextureFile(const std::string& file_name, uint32_t width, uint32_t height, bool srgb,
+                      std::span<const TextureVariant> variants) {
+  if (variants.empty() || variants.size() > kMaxTextureFileVariants) {
+    std::cerr << "Invalid number of texture variants for " << file_name << ": "
+              << variants.size() << std::endl;
+    return false;
+  }
+  TextureFileHeader header;
+  header.width = width;
+  header.height = height;
+  header.num_mip_levels = static_cast<uint32_t>(variants[0].levels.size());
+  header.num_variants = static_cast<uint32_t>(variants.size());
+  header.srgb = srgb ? 1 : 0;
+  if (width == 0 || height == 0 || header.num_mip_levels == 0 ||
+      header.num_mip_levels > GetNumMipLevels(width, height)) {
+    std::cerr << "Invalid texture size or mip levels for " << file_name << std::endl;
+    return false;
+  }
+
+  std::vector<TextureFileVariant> table(variants.size());
+  uint64_t offset = AlignUp(sizeof(header) + table.size() * sizeof(TextureFileVariant),
+                            kTextureFileAlignment);
+  for (size_t i = 0; i < variants.size(); ++i) {
+    const TextureVariant& variant = variants[i];
+    if (variant.levels.size() != header.num_mip_levels) {
+      std::cerr << "Texture variants have different mip levels in " << file_name << std::endl;
+      return false;
+    }
+    for (uint32_t level = 0; level < header.num_mip_levels; ++level) {
+      if (variant.levels[level].size() !=
+          GetMipLevelSize(variant.format, width, height, level)) {
+        std::cerr << "Invalid size of mip level " << level << " of "
+                  << GetTextureFormatName(variant.format) << " in " << file_name << std::endl;
+        return false;
+      }
+    }
+    table[i].format = variant.format;
+    table[i].data_offset = offset;
+    table[i].data_size = GetVariantSize(variant.format, width, height, header.num_mip_levels);
+    offset = AlignUp(offset + table[i].data_size, kTextureFileAlignment);
+  }
+
+  std::ofstream file(file_name, std::ios::binary);
+  if (!file) {
+    std::cerr << "Cannot open file: " << file_name << std::endl;
+    return false;
+  }
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(table.data()),
+             table.size() * sizeof(TextureFileVariant));
+  WritePadding(file, sizeof(header) + table.size() * sizeof(TextureFileVariant));
+  for (size_t i = 0; i < variants.size(); ++i) {
+    for (const std::vector<uint8_t>& level : variants[i].levels) {
+      file.write(reinterpret_cast<const char*>(level.data()), level.size());
+    }
+    WritePadding(file, table[i].data_offset + table[i].data_size);
+  }
+  if (!file) {
+    std::cerr << "Cannot write file: " << file_name << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool TextureFile::Open(const std::string& file_name, std::string* error) {
+  MappedFile file;
+  if (!file.Open(file_name)) return SetError("Cannot open file: " + file_name, error);
+  return Open(std::move(file), error);
+}
+
+bool TextureFile::Open(MappedFile file, std::string* error) {
+  Close();
+  std::span<const uint8_t> data = file.GetData();
+  TextureFileHeader header;
+  if (data.size() < sizeof(header)) return SetError("Truncated texture file header", error);
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  if (header.magic != kTextureFileMagic) return SetError("Not a texture file", error);
+  if (header.version != kTextureFileVersion) {
+    return SetError("Unsupported texture file version " + std::to_string(header.version), error);
+  }
+  // Textures too large for kMaxTextureMipLevels levels are rejected, which also keeps their sizes
+  // from overflowing.
+  if (header.width == 0 || header.height == 0 ||
+      GetNumMipLevels(header.width, header.height) > kMaxTextureMipLevels ||
+      header.num_mip_levels == 0 ||
+      header.num_mip_levels > GetNumMipLevels(header.width, header.height)) {
+    return SetError("Invalid texture size or mip levels", error);
+  }
+  if (header.num_variants == 0 || header.num_variants > kMaxTextureFileVariants) {
+    return SetError("Invalid number of texture variants", error);
+  }
+
+  const uint64_t table_size = header.num_variants * sizeof(TextureFileVariant);
+  if (sizeof(header) + table_size > data.size()) return SetError("Truncated texture file", error);
+  std::vector<TextureFileVariant> variants(header.num_variants);
+  std::memcpy(variants.data(), data.data() + sizeof(header), table_size);
+  for (const TextureFileVariant& variant : variants) {
+    if (!IsValidFormat(variant.format)) return SetError("Unknown texture format", error);
+    if (variant.data_size != GetVariantSize(variant.format, header.width, header.height,
+                                            header.num_mip_levels) ||
+        variant.data_offset % kTextureFileAlignment != 0 ||
+        variant.data_offset < sizeof(header) + table_size ||
+        !IsRangeInBounds(variant.data_offset, variant.data_size, data.size())) {
+      return SetError("Texture file data out of bounds", error);
+    }
+  }
+
+  header_ = header;
+  variants_ = std::move(variants);
+  file_ = std::move(file);
+  return true;
+}
+
+void TextureFile::Close() {
+  file_.Close();
+  header_ = {};
+  variants_.clear();
+}
+
+const TextureFileVariant* TextureFile::FindVariant(TextureFileFormat format) const {
+  for (const TextureFileVariant& variant : variants_) {
+    if (variant.format == format) return &variant;
+  }
+  return nullptr;
+}
+
+std::span<const uint8_t> TextureFile::GetMipLevel(const TextureFileVariant& variant,
+                                                  uint32_t level) const {
+  uint64_t offset = variant.data_offset;
+  for (uint32_t i = 0; i < level; ++i) {
+    offset += GetMipLevelSize(variant.format, header_.width, header_.height, i);
+  }
+  return file_.GetData().subspan(
+      offset, GetMipLevelSize(variant.format, header_.width, header_.height, level));
+}
+
+void TextureFile::Prefetch() const {
+  std::span<const uint8_t> data = file_.GetData();
+  if (!file_.IsMapped()) return;
+  uint8_t sum = 0;
+  for (size_t i = 0; i < data.size(); i += kPageSize) sum += data[i];
+  // Keeps the reads from being optimized away.
+  volatile uint8_t sink = sum;
+  static_cast<void>(sink);
+}
+
+}  // namespace web_gpu_app
@@ -0,0 +1,408 @@
+#include "web_gpu_app/texture_manager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "web_gpu_app/profiler.h"
+#include "web_gpu_app/web_gpu_utils.h"
+
+namespace web_gpu_app {
+
+namespace {
+
+constexpr uint32_t kInitialArrayLayers = 4;
+constexpr uint32_t kWorkgroupSize = 8;
+
+// Averages 2x2 texels of the previous level into each texel of the next one. Odd sizes clamp
+// the last row and column.
+const char* downsample_shader_code = R"(
+@group(0) @binding(0) var source : texture_2d<f32>;
+@group(0) @binding(1) var destination : texture_storage_2d<rgba8unorm, write>;
+
+fn srgb_to_linear(c : vec3f) -> vec3f {
+    return select(pow((c + 0.055) / 1.055, vec3f(2.4)), c / 12.92, c <= vec3f(0.04045));
+}
+fn linear_to_srgb(c : vec3f) -> vec3f {
+    return select(1.055 * pow(c, vec3f(1.0 / 2.4)) - 0.055, c * 12.92, c <= vec3f(0.0031308));
+}
+fn average(id : vec2u, srgb : bool) -> vec4f {
+    let last = textureDimensions(source) - 1;
+    var sum = vec4f(0);
+    for (var i = 0u; i < 4u; i++) {
+        let texel = textureLoad(source, min(id * 2 + vec2u(i & 1, i >> 1), last), 0);
+        sum += select(texel, vec4f(srgb_to_linear(texel.rgb), texel.a), srgb);
+    }
+    return sum / 4;
+}
+@compute @workgroup_size(8, 8)
+fn downsample(@builtin(global_invocation_id) id : vec3u) {
+    if (any(id.xy >= textureDimensions(destination))) {
+        return;
+    }
+    textureStore(destination, id.xy, average(id.xy, false));
+}
+@compute @workgroup_size(8, 8)
+fn downsample_srgb(@builtin(global_invocation_id) id : vec3u) {
+    if (any(id.xy >= textureDimensions(destination))) {
+        return;
+    }
+    let color = average(id.xy, true);
+    textureStore(destination, id.xy, vec4f(linear_to_srgb(color.rgb), color.a));
+}
+)";
+
+wgpu::TextureFormat ToTextureFormat(TextureFileFormat format) {
+  switch (format) {
+    case TextureFileFormat::kRgba8:
+      return wgpu::TextureFormat::RGBA8Unorm;
+    case TextureFileFormat::kBc1:
+      return wgpu::TextureFormat::BC1RGBAUnorm;
+    case TextureFileFormat::kBc3:
+      return wgpu::TextureFormat::BC3RGBAUnorm;
+    case TextureFileFormat::kEtc2Rgb8:
+      return wgpu::TextureFormat::ETC2RGB8Unorm;
+    case TextureFileFormat::kEtc2Rgba8:
+      return wgpu::TextureFormat::ETC2RGBA8Unorm;
+  }
+  return wgpu::TextureFormat::Undefined;
+}
+
+uint32_t GetLevelSize(uint32_t size, uint32_t level) { return std::max(size >> level, 1u); }
+
+// Size of a mip level in whole blocks, as copies of compressed textures require.
+wgpu::Extent3D GetPhysicalSize(TextureFileFormat format, uint32_t width, uint32_t height,
+                               uint32_t level, uint32_t num_layers = 1) {
+  const uint32_t block_size = GetTextureFormatInfo(format).block_size;
+  return {static_cast<uint32_t>(AlignUp(GetLevelSize(width, level), block_size)),
+          static_cast<uint32_t>(AlignUp(GetLevelSize(height, level), block_size)), num_layers};
+}
+
+bool SetError(const std::string& message, std::string* error) {
+  if (error != nullptr) *error = message;
+  return false;
+}
+
+}  // namespace
+
+TextureManager::TextureManager(wgpu::Device device, PipelineCache* pipeline_cache)
+    : device_(device), pipeline_cache_(pipeline_cache) {
+  wgpu::SupportedLimits limits;
+  device_.GetLimits(&limits);
+  max_array_layers_ = limits.limits.maxTextureArrayLayers;
+  max_texture_size_ = limits.limits.maxTextureDimension2D;
+
+  wgpu::SamplerDescriptor sampler_descriptor{.addressModeU = wgpu::AddressMode::Repeat,
+                                             .addressModeV = wgpu::AddressMode::Repeat,
+                                             .magFilter = wgpu::FilterMode::Linear,
+                                             .minFilter = wgpu::FilterMode::Linear,
+                                             .mipmapFilter = wgpu::MipmapFilterMode::Linear,
+                                             .maxAnisotropy = 8};
+  sampler_ = device_.CreateSampler(&sampler_descriptor);
+
+  // Mips of the textures added before the pipelines are created wait in "pending_mips_".
+  wgpu::ShaderModule shader_module = pipeline_cache_->GetShaderModule(downsample_shader_code);
+  wgpu::ComputePipelineDescriptor descriptor{
+      .compute = {.module = shader_module, .entryPoint = "downsample"}};
+  pipeline_cache_->GetComputePipeline(
+      descriptor, [this](wgpu::ComputePipeline pipeline) { downsample_pipeline_ = pipeline; });
+  descriptor.compute.entryPoint = "downsample_srgb";
+  pipeline_cache_->GetComputePipeline(descriptor, [this](wgpu::ComputePipeline pipeline) {
+    downsample_srgb_pipeline_ = pipeline;
+  });
+}
+
+TextureManager::~TextureManager() {}
+
+bool TextureManager::SupportsFormat(TextureFileFormat format) const {
+  switch (format) {
+    case TextureFileFormat::kRgba8:
+      return true;
+    case TextureFileFormat::kBc1:
+    case TextureFileFormat::kBc3:
+      return device_.HasFeature(wgpu::FeatureName::TextureCompressionBC);
+    case TextureFileFormat::kEtc2Rgb8:
+    case TextureFileFormat::kEtc2Rgba8:
+      return device_.HasFeature(wgpu::FeatureName::TextureCompressionETC2);
+  }
+  return false;
+}
+
+TextureHandle TextureManager::Add(std::span<const uint8_t> pixels, uint32_t width,
+                                  uint32_t height, bool srgb) {
+  if (pixels.size() != size_t{width} * height * 4) {
+    std::cerr << "Invalid RGBA8 texture data size: " << pixels.size() << std::endl;
+    return 0;
+  }
+  const ArrayKey key{.width = width,
+                     .height = height,
+                     .num_mip_levels = GetNumMipLevels(width, height),
+                     .format = TextureFileFormat::kRgba8};
+  const LevelData level{.data = pixels, .level = 0};
+  return AddTexture(key, srgb, {&level, 1});
+}
+
+TextureHandle TextureManager::Add(const TextureFile& file, std::string* error) {
+  // Smallest first.
+  constexpr TextureFileFormat kPreferredFormats[] = {
+      TextureFileFormat::kBc1, TextureFileFormat::kEtc2Rgb8, TextureFileFormat::kBc3,
+      TextureFileFormat::kEtc2Rgba8, TextureFileFormat::kRgba8};
+  const TextureFileHeader& header = file.GetHeader();
+  for (TextureFileFormat format : kPreferredFormats) {
+    const TextureFileVariant* variant = file.FindVariant(format);
+    if (variant == nullptr || !SupportsFormat(format)) continue;
+    // Level 0 of compressed textures is made of whole blocks.
+    const uint32_t block_size = GetTextureFormatInfo(format).block_size;
+    if (header.width % block_size != 0 || header.height % block_size != 0) continue;
+
+    std::vector<LevelData> levels(header.num_mip_levels);
+    for (uint32_t level = 0; level < header.num_mip_levels; ++level) {
+      levels[level] = {.data = file.GetMipLevel(*variant, level), .level = level};
+    }
+    const ArrayKey key{.width = header.width,
+                       .height = header.height,
+                       .num_mip_levels = header.num_mip_levels,
+                       .format = format};
+    TextureHandle handle = AddTexture(key, header.srgb != 0, levels);
+    if (handle == 0) SetError("Unsupported texture size", error);
+    return handle;
+  }
+  SetError("No texture format of the file is supported by the device", error);
+  return 0;
+}
+
+TextureHandle TextureManager::AddTexture(const ArrayKey& key, bool srgb,
+                                         std::span<const LevelData> levels) {
+  if (key.width == 0 || key.height == 0 || key.width > max_texture_size_ ||
+      key.height > max_texture_size_) {
+    std::cerr << "Unsupported texture size: " << key.width << "x" << key.height << std::endl;
+    return 0;
+  }
+  PROFILE_SCOPE("TextureManager::Add");
+  const auto [array_id, layer] = AllocateLayer(key);
+  const TextureArray& array = arrays_.at(array_id);
+  Upload(array, layer, levels);
+
+  const TextureHandle handle = next_handle_++;
+  Texture& texture = textures_[handle];
+  texture.info = {.width = key.width,
+                  .height = key.height,
+                  .num_mip_levels = key.num_mip_levels,
+                  .format = ToTextureFormat(key.format),
+                  .array = array_id,
+                  .layer = layer,
+                  .gpu_bytes = array.layer_bytes};
+  texture.srgb = srgb;
+  if (levels.size() < key.num_mip_levels) {
+    pending_mips_.push_back(handle);
+  } else {
+    recorded_.push_back(handle);
+  }
+  ++stats_.num_textures;
+  stats_.texture_bytes += array.layer_bytes;
+  return handle;
+}
+
+void TextureManager::Remove(TextureHandle handle) {
+  auto it = textures_.find(handle);
+  if (it == textures_.end()) return;
+  const TextureInfo& info = it->second.info;
+  arrays_.at(info.array).free_layers.push_back(info.layer);
+  --stats_.num_textures;
+  stats_.texture_bytes -= info.gpu_bytes;
+  textures_.erase(it);
+  std::erase(pending_mips_, handle);
+  std::erase(recorded_, handle);
+}
+
+const TextureInfo* TextureManager::GetInfo(TextureHandle handle) const {
+  auto it = textures_.find(handle);
+  return it != textures_.end() ? &it->second.info : nullptr;
+}
+
+bool TextureManager::IsReady(TextureHandle handle) const {
+  auto it = textures_.find(handle);
+  return it != textures_.end() && it->second.ready;
+}
+
+wgpu::TextureView TextureManager::GetArrayView(uint32_t array) const {
+  auto it = arrays_.find(array);
+  return it != arrays_.end() ? it->second.view : nullptr;
+}
+
+uint64_t TextureManager::GetArrayGeneration(uint32_t array) const {
+  auto it = arrays_.find(array);
+  return it != arrays_.end() ? it->second.generation : 0;
+}
+
+std::pair<uint32_t, uint32_t> TextureManager::AllocateLayer(const ArrayKey& key) {
+  for (auto& [id, array] : arrays_) {
+    if (array.key != key) continue;
+    if (!array.free_layers.empty()) {
+      const uint32_t layer = array.free_layers.back();
+      array.free_layers.pop_back();
+      return {id, layer};
+    }
+    if (array.num_layers < array.capacity || array.capacity < max_array_layers_) {
+      if (array.num_layers == array.capacity) GrowArray(&array);
+      return {id, array.num_layers++};
+    }
+  }
+
+  const uint32_t id = next_array_++;
+  TextureArray& array = arrays_[id];
+  array.key = key;
+  array.capacity = std::min(kInitialArrayLayers, max_array_layers_);
+  array.texture = CreateArrayTexture(key, array.capacity);
+  wgpu::TextureViewDescriptor view_descriptor{.dimension = wgpu::TextureViewDimension::e2DArray};
+  array.view = array.texture.CreateView(&view_descriptor);
+  for (uint32_t level = 0; level < key.num_mip_levels; ++level) {
+    array.layer_bytes += GetMipLevelSize(key.format, key.width, key.height, level);
+  }
+  ++stats_.num_arrays;
+  stats_.allocated_bytes += array.capacity * array.layer_bytes;
+  return {id, array.num_layers++};
+}
+
+wgpu::Texture TextureManager::CreateArrayTexture(const ArrayKey& key, uint32_t capacity) {
+  wgpu::TextureUsage usage = wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::CopyDst |
+                             wgpu::TextureUsage::CopySrc;
+  // The downsample shader writes the mips of RGBA8 textures.
+  if (key.format == TextureFileFormat::kRgba8) usage = usage | wgpu::TextureUsage::StorageBinding;
+  wgpu::TextureDescriptor descriptor{.usage = usage,
+                                     .dimension = wgpu::TextureDimension::e2D,
+                                     .size = {key.width, key.height, capacity},
+                                     .format = ToTextureFormat(key.format),
+                                     .mipLevelCount = key.num_mip_levels};
+  return device_.CreateTexture(&descriptor);
+}
+
+void TextureManager::GrowArray(TextureArray* array) {
+  PROFILE_SCOPE("TextureManager::GrowArray");
+  const ArrayKey& key = array->key;
+  const uint32_t capacity = std::min(array->capacity * 2, max_array_layers_);
+  wgpu::Texture texture = CreateArrayTexture(key, capacity);
+  wgpu::CommandEncoder encoder = GetEncoder();
+  for (uint32_t level = 0; level < key.num_mip_levels; ++level) {
+    wgpu::ImageCopyTexture source{.texture = array->texture, .mipLevel = level};
+    wgpu::ImageCopyTexture destination{.texture = texture, .mipLevel = level};
+    wgpu::Extent3D copy_size =
+        GetPhysicalSize(key.format, key.width, key.height, level, array->num_layers);
+    encoder.CopyTextureToTexture(&source, &destination, &copy_size);
+  }
+  stats_.allocated_bytes += (capacity - array->capacity) * array->layer_bytes;
+  ++stats_.num_array_grows;
+  array->texture = texture;
+  wgpu::TextureViewDescriptor view_descriptor{.dimension = wgpu::TextureViewDimension::e2DArray};
+  array->view = texture.CreateView(&view_descriptor);
+  array->capacity = capacity;
+  ++array->generation;
+}
+
+void TextureManager::Upload(const TextureArray& array, uint32_t layer,
+                            std::span<const LevelData> levels) {
+  const ArrayKey& key = array.key;
+  const TextureFormatInfo info = GetTextureFormatInfo(key.format);
+  struct LevelLayout {
+    uint64_t offset = 0;
+    uint32_t row_size = 0;
+    // Texture copies require rows aligned to 256 bytes.
+    uint32_t padded_row_size = 0;
+    uint32_t num_rows = 0;
+  };
+  std::vector<LevelLayout> layouts(levels.size());
+  uint64_t size = 0;
+  for (size_t i = 0; i < levels.size(); ++i) {
+    const wgpu::Extent3D extent = GetPhysicalSize(key.format, key.width, key.height,
+                                                  levels[i].level);
+    LevelLayout& layout = layouts[i];
+    layout.offset = size;
+    layout.row_size = extent.width / info.block_size * info.bytes_per_block;
+    layout.padded_row_size = static_cast<uint32_t>(AlignUp(layout.row_size, 256));
+    layout.num_rows = extent.height / info.block_size;
+    size += uint64_t{layout.padded_row_size} * layout.num_rows;
+  }
+
+  wgpu::BufferDescriptor buffer_descriptor{
+      .usage = wgpu::BufferUsage::CopySrc, .size = size, .mappedAtCreation = true};
+  wgpu::Buffer staging_buffer = device_.CreateBuffer(&buffer_descriptor);
+  uint8_t* mapped = static_cast<uint8_t*>(staging_buffer.GetMappedRange());
+  for (size_t i = 0; i < levels.size(); ++i) {
+    const LevelLayout& layout = layouts[i];
+    for (uint32_t row = 0; row < layout.num_rows; ++row) {
+      std::memcpy(mapped + layout.offset + uint64_t{row} * layout.padded_row_size,
+                  levels[i].data.data() + uint64_t{row} * layout.row_size, layout.row_size);
+    }
+  }
+  staging_buffer.Unmap();
+
+  wgpu::CommandEncoder encoder = GetEncoder();
+  for (size_t i = 0; i < levels.size(); ++i) {
+    const LevelLayout& layout = layouts[i];
+    wgpu::ImageCopyBuffer source{.layout = {.offset = layout.offset,
+                                            .bytesPerRow = layout.padded_row_size,
+                                            .rowsPerImage = layout.num_rows},
+                                 .buffer = staging_buffer};
+    wgpu::ImageCopyTexture destination{
+        .texture = array.texture, .mipLevel = levels[i].level, .origin = {0, 0, layer}};
+    wgpu::Extent3D copy_size = GetPhysicalSize(key.format, key.width, key.height,
+                                               levels[i].level);
+    encoder.CopyBufferToTexture(&source, &destination, &copy_size);
+  }
+  stats_.uploaded_bytes += size;
+}
+
+void TextureManager::GenerateMips() {
+  if (pending_mips_.empty() || !downsample_pipeline_ || !downsample_srgb_pipeline_) return;
+  PROFILE_SCOPE("TextureManager::GenerateMips");
+  wgpu::ComputePassEncoder pass = GetEncoder().BeginComputePass();
+  for (TextureHandle handle : pending_mips_) {
+    const Texture& texture = textures_.at(handle);
+    const TextureInfo& info = texture.info;
+    const TextureArray& array = arrays_.at(info.array);
+    auto level_view = [&](uint32_t level) {
+      wgpu::TextureViewDescriptor descriptor{.dimension = wgpu::TextureViewDimension::e2D,
+                                             .baseMipLevel = level,
+                                             .mipLevelCount = 1,
+                                             .baseArrayLayer = info.layer,
+                                             .arrayLayerCount = 1};
+      return array.texture.CreateView(&descriptor);
+    };
+    wgpu::ComputePipeline pipeline =
+        texture.srgb ? downsample_srgb_pipeline_ : downsample_pipeline_;
+    pass.SetPipeline(pipeline);
+    // Each level reads the previous one: a dispatch per level, which the pass orders.
+    for (uint32_t level = 1; level < info.num_mip_levels; ++level) {
+      wgpu::BindGroupEntry entries[] = {{.binding = 0, .textureView = level_view(level - 1)},
+                                        {.binding = 1, .textureView = level_view(level)}};
+      wgpu::BindGroupDescriptor bind_group_descriptor{.layout = pipeline.GetBindGroupLayout(0),
+                                                      .entryCount = std::size(entries),
+                                                      .entries = entries};
+      pass.SetBindGroup(0, device_.CreateBindGroup(&bind_group_descriptor));
+      pass.DispatchWorkgroups(
+          (GetLevelSize(info.width, level) + kWorkgroupSize - 1) / kWorkgroupSize,
+          (GetLevelSize(info.height, level) + kWorkgroupSize - 1) / kWorkgroupSize);
+      ++stats_.num_mip_dispatches;
+    }
+    recorded_.push_back(handle);
+  }
+  pass.End();
+  pending_mips_.clear();
+}
+
+wgpu::CommandBuffer TextureManager::FinishUploads() {
+  GenerateMips();
+  if (!encoder_) return nullptr;
+  for (TextureHandle handle : recorded_) textures_.at(handle).ready = true;
+  recorded_.clear();
+  wgpu::CommandBuffer commands = encoder_.Finish();
+  encoder_ = nullptr;
+  return commands;
+}
+
+wgpu::CommandEncoder TextureManager::GetEncoder() {
+  if (!encoder_) encoder_ = device_.CreateCommandEncoder();
+  return encoder_;
+}
+
+}  // namespace web_gpu_app
@@ -0,0 +1,6 @@
+// Implementations of the header-only third party libraries, compiled once.
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tinyobj/tiny_obj_loader.h>
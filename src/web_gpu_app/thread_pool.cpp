@@ -0,0 +1,107 @@
+#include "web_gpu_app/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+#if defined(__EMSCRIPTEN_PTHREADS__) && !defined(WEB_GPU_APP_PTHREAD_POOL_SIZE)
+#define WEB_GPU_APP_PTHREAD_POOL_SIZE 8
+#endif
+
+namespace web_gpu_app {
+
+ThreadPool::ThreadPool(uint32_t num_threads) {
+  for (uint32_t i = 0; i < num_threads; ++i) {
+    threads_.emplace_back(&ThreadPool::WorkerMain, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+uint32_t ThreadPool::GetDefaultNumThreads() {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+  return 0;
+#else
+  // Leave one core to the main thread.
+  uint32_t num_cores = std::thread::hardware_concurrency();
+  uint32_t num_threads = num_cores > 1 ? num_cores - 1 : 0;
+#if defined(__EMSCRIPTEN_PTHREADS__)
+  // Workers are created up front: a thread started beyond the pool only runs once the main thread
+  // yields to the browser, which ParallelFor never does. The renderer's pool, half as many for the
+  // AssetLoader and App's update thread have to fit in it.
+  constexpr uint32_t kMaxNumThreads = (WEB_GPU_APP_PTHREAD_POOL_SIZE - 1) * 2 / 3;
+  num_threads = std::min(num_threads, kMaxNumThreads);
+#endif
+  return num_threads;
+#endif
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  if (threads_.empty()) {
+    task();
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  condition_.notify_one();
+}
+
+void ThreadPool::WorkerMain() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) return;
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+size_t ThreadPool::ParallelFor(
+    size_t count, size_t min_chunk_size,
+    const std::function<void(size_t begin, size_t end, size_t chunk_index)>& function) {
+  if (count == 0) return 0;
+  const size_t max_chunks = threads_.size() + 1;
+  const size_t requested_chunks =
+      std::clamp<size_t>(count / std::max<size_t>(min_chunk_size, 1), 1, max_chunks);
+  const size_t chunk_size = (count + requested_chunks - 1) / requested_chunks;
+  // Rounding the chunk size up can leave fewer chunks than requested, but none empty.
+  const size_t num_chunks = (count + chunk_size - 1) / chunk_size;
+  if (num_chunks == 1) {
+    function(0, count, 0);
+    return 1;
+  }
+
+  // Only changed under "done_mutex", and notified before unlocking it: the caller cannot return
+  // and destroy them while a worker still uses them.
+  size_t num_pending = num_chunks - 1;
+  std::mutex done_mutex;
+  std::condition_variable done_condition;
+  for (size_t chunk = 1; chunk < num_chunks; ++chunk) {
+    Submit([&, chunk] {
+      function(chunk * chunk_size, std::min(count, (chunk + 1) * chunk_size), chunk);
+      std::lock_guard<std::mutex> lock(done_mutex);
+      if (--num_pending == 0) done_condition.notify_one();
+    });
+  }
+  function(0, chunk_size, 0);
+
+  std::unique_lock<std::mutex> lock(done_mutex);
+  done_condition.wait(lock, [&] { return num_pending == 0; });
+  return num_chunks;
+}
+
+}  // namespace web_gpu_app
@@ -2,36 +2,116 @@
 
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_wgpu.h"
+#include "web_gpu_app/profiler.h"
 #include "web_gpu_app/utils.h"
 
 namespace web_gpu_app {
 
-Ui::Ui(GLFWwindow* window, wgpu::Device device) {
+namespace {
+
+// Everything the backend reads to render "draw_data", or 0 if its user callbacks could render
+// anything.
+uint64_t HashDrawData(const ImDrawData& draw_data) {
+  uint64_t hash = kFnvOffsetBasis;
+  HashValue(draw_data.DisplayPos, &hash);
+  HashValue(draw_data.DisplaySize, &hash);
+  HashValue(draw_data.FramebufferScale, &hash);
+  HashValue(draw_data.CmdListsCount, &hash);
+  for (int i = 0; i < draw_data.CmdListsCount; ++i) {
+    const ImDrawList* list = draw_data.CmdLists[i];
+    HashValue(list->VtxBuffer.Size, &hash);
+    HashWords(list->VtxBuffer.Data, list->VtxBuffer.Size * sizeof(ImDrawVert), &hash);
+    HashValue(list->IdxBuffer.Size, &hash);
+    HashWords(list->IdxBuffer.Data, list->IdxBuffer.Size * sizeof(ImDrawIdx), &hash);
+    HashValue(list->CmdBuffer.Size, &hash);
+    for (const ImDrawCmd& command : list->CmdBuffer) {
+      if (command.UserCallback != nullptr) return 0;
+      HashValue(command.ClipRect, &hash);
+      HashValue(command.TextureId, &hash);
+      HashValue(command.VtxOffset, &hash);
+      HashValue(command.IdxOffset, &hash);
+      HashValue(command.ElemCount, &hash);
+    }
+  }
+  return hash != 0 ? hash : 1;
+}
+
+uint64_t GetDrawDataBytes(const ImDrawData& draw_data) {
+  return uint64_t{static_cast<uint32_t>(draw_data.TotalVtxCount)} * sizeof(ImDrawVert) +
+         uint64_t{static_cast<uint32_t>(draw_data.TotalIdxCount)} * sizeof(ImDrawIdx);
+}
+
+}  // namespace
+
+Ui::Ui(GLFWwindow* window, wgpu::Device device, uint32_t num_frames_in_flight)
+    : window_(window) {
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
   ImGui::GetIO().IniFilename = nullptr;
-  ImGui_ImplGlfw_InitForOther(window, true);
-  ImGui_ImplWGPU_Init(device.Get(), /*num_frames_in_flight=*/3, WGPUTextureFormat_BGRA8Unorm,
-                      WGPUTextureFormat_Depth24Plus);
+  if (window_ != nullptr) {
+    ImGui_ImplGlfw_InitForOther(window_, true);
+  }
+  ImGui_ImplWGPU_Init(device.Get(), static_cast<int>(num_frames_in_flight),
+                      WGPUTextureFormat_BGRA8Unorm, WGPUTextureFormat_Depth24Plus);
   SetThemeDark();
 }
 
 Ui::~Ui() {
   ImGui_ImplWGPU_Shutdown();
-  ImGui_ImplGlfw_Shutdown();
+  if (window_ != nullptr) {
+    ImGui_ImplGlfw_Shutdown();
+  }
   ImGui::DestroyContext();
 }
 
 void Ui::BeginUiFrame() {
+  PROFILE_SCOPE("Ui::BeginUiFrame");
   ImGui_ImplWGPU_NewFrame();
-  ImGui_ImplGlfw_NewFrame();
+  if (window_ != nullptr) {
+    ImGui_ImplGlfw_NewFrame();
+  } else {
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(static_cast<float>(display_width_),
+                            static_cast<float>(display_height_));
+    io.DeltaTime = 1.f / 60.f;
+  }
   ImGui::NewFrame();
 }
 
-void Ui::EndUiFrame(wgpu::RenderPassEncoder render_pass) {
+void Ui::SetDisplaySize(int width, int height) {
+  display_width_ = width;
+  display_height_ = height;
+}
+
+bool Ui::EndUiFrame(bool cacheable) {
+  PROFILE_SCOPE("Ui::EndUiFrame");
   ImGui::EndFrame();
   ImGui::Render();
-  ImGui_ImplWGPU_RenderDrawData(ImGui::GetDrawData(), render_pass.Get());
+  ++stats_.num_frames;
+  stats_.last_frame_bytes = 0;
+  if (!cacheable) {
+    draw_data_hash_ = 0;
+    return false;
+  }
+  draw_data_hash_ = HashDrawData(*ImGui::GetDrawData());
+  const bool cached = draw_data_hash_ != 0 && draw_data_hash_ == cached_hash_;
+  stats_.num_cache_hits += cached;
+  return cached;
+}
+
+void Ui::RenderDrawData(wgpu::RenderPassEncoder render_pass) {
+  PROFILE_SCOPE("Ui::RenderDrawData");
+  ImDrawData* draw_data = ImGui::GetDrawData();
+  ImGui_ImplWGPU_RenderDrawData(draw_data, render_pass.Get());
+  stats_.last_frame_bytes = GetDrawDataBytes(*draw_data);
+  stats_.bytes_uploaded += stats_.last_frame_bytes;
+  // The cache texture was not updated.
+  cached_hash_ = 0;
+}
+
+void Ui::RenderToCache(wgpu::RenderPassEncoder render_pass) {
+  RenderDrawData(render_pass);
+  cached_hash_ = draw_data_hash_;
 }
 
 void Ui::SetThemeDark() {
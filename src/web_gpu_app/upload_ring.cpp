@@ -0,0 +1,146 @@
+#include "web_gpu_app/upload_ring.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <chrono>
+
+#include "web_gpu_app/web_gpu_utils.h"
+
+namespace web_gpu_app {
+
+UploadRingAllocator::UploadRingAllocator(uint32_t num_slots, uint64_t slot_size)
+    : slots_(num_slots), slot_size_(AlignUp(slot_size, 256)), current_slot_(num_slots - 1) {
+  assert(num_slots > 0);
+}
+
+bool UploadRingAllocator::IsNextSlotAvailable() const {
+  const Slot& next_slot = slots_[(current_slot_ + 1) % slots_.size()];
+  return next_slot.fence <= completed_fence_;
+}
+
+bool UploadRingAllocator::BeginFrame() {
+  assert(!in_frame_ && IsNextSlotAvailable());
+  in_frame_ = true;
+  current_slot_ = (current_slot_ + 1) % slots_.size();
+  head_ = 0;
+  Slot& slot = slots_[current_slot_];
+  if (slot.size == slot_size_) return false;
+  slot.size = slot_size_;
+  return true;
+}
+
+uint64_t UploadRingAllocator::Allocate(uint64_t size, uint64_t alignment) {
+  assert(in_frame_);
+  uint64_t offset = AlignUp(head_, alignment);
+  if (offset + size > slots_[current_slot_].size) {
+    ++num_overflows_;
+    slot_size_ = std::max(slot_size_, std::bit_ceil(offset + size));
+    return kInvalidOffset;
+  }
+  head_ = offset + size;
+  high_water_mark_ = std::max(high_water_mark_, head_);
+  return offset;
+}
+
+uint64_t UploadRingAllocator::EndFrame() {
+  assert(in_frame_);
+  in_frame_ = false;
+  slots_[current_slot_].fence = next_fence_;
+  return next_fence_++;
+}
+
+void UploadRingAllocator::SignalFence(uint64_t fence) {
+  completed_fence_ = std::max(completed_fence_, fence);
+}
+
+UploadRing::UploadRing(wgpu::Device device, uint32_t num_frames_in_flight,
+                       uint64_t initial_slot_size)
+    : device_(device),
+      allocator_(num_frames_in_flight, initial_slot_size),
+      slots_(num_frames_in_flight),
+      fence_state_(std::make_shared<FenceState>()) {}
+
+UploadRing::~UploadRing() {}
+
+void UploadRing::ProcessCompletedFences() {
+  allocator_.SignalFence(fence_state_->completed_fence.load(std::memory_order_acquire));
+}
+
+void UploadRing::WaitForNextSlot() {
+  ProcessCompletedFences();
+  if (allocator_.IsNextSlotAvailable()) return;
+  ++stats_.num_fence_stalls;
+#if !defined(__EMSCRIPTEN__)
+  const auto start = std::chrono::steady_clock::now();
+  WaitUntil(device_, [this] {
+    ProcessCompletedFences();
+    return allocator_.IsNextSlotAvailable();
+  });
+  stats_.fence_wait_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+#else
+  // The browser main thread cannot block. Queue::WriteBuffer is ordered after previously
+  // submitted work, so reusing the slot is still correct; we only lose the CPU throttling.
+  allocator_.SignalFence(~0ull);
+#endif
+}
+
+void UploadRing::BeginFrame() {
+  WaitForNextSlot();
+  if (allocator_.BeginFrame()) {
+    Slot& slot = slots_[allocator_.GetCurrentSlot()];
+    slot.buffer = CreateBuffer(device_, kUsage, allocator_.GetSlotSize());
+    slot.shadow.resize(allocator_.GetSlotSize());
+  }
+  flushed_bytes_ = 0;
+}
+
+UploadAllocation UploadRing::Allocate(uint64_t size, uint64_t alignment) {
+  ++stats_.num_allocations;
+  uint64_t offset = allocator_.Allocate(size, alignment);
+  if (offset == UploadRingAllocator::kInvalidOffset) {
+    // Out of space for this frame: fall back to a dedicated buffer, the slots grow on next reuse.
+    ++stats_.num_overflows;
+    wgpu::BufferDescriptor descriptor{.usage = kUsage,
+                                      .size = AlignUp(size, 4),
+                                      .mappedAtCreation = true};
+    wgpu::Buffer buffer = device_.CreateBuffer(&descriptor);
+    overflow_buffers_.push_back(buffer);
+    stats_.bytes_uploaded += size;
+    return {buffer, 0, size, buffer.GetMappedRange()};
+  }
+
+  Slot& slot = slots_[allocator_.GetCurrentSlot()];
+  stats_.high_water_mark = allocator_.GetHighWaterMark();
+  return {slot.buffer, offset, size, slot.shadow.data() + offset};
+}
+
+void UploadRing::Flush() {
+  for (wgpu::Buffer& buffer : overflow_buffers_) {
+    buffer.Unmap();
+  }
+  overflow_buffers_.clear();
+
+  uint64_t used_bytes = AlignUp(allocator_.GetUsedBytes(), 4);
+  if (used_bytes <= flushed_bytes_) return;
+  Slot& slot = slots_[allocator_.GetCurrentSlot()];
+  device_.GetQueue().WriteBuffer(slot.buffer, flushed_bytes_, slot.shadow.data() + flushed_bytes_,
+                                 used_bytes - flushed_bytes_);
+  stats_.bytes_uploaded += used_bytes - flushed_bytes_;
+  ++stats_.num_copies;
+  flushed_bytes_ = used_bytes;
+}
+
+void UploadRing::EndFrame() {
+  uint64_t fence = allocator_.EndFrame();
+  std::weak_ptr<FenceState> fence_state = fence_state_;
+  OnSubmittedWorkDone(device_.GetQueue(), [fence_state, fence] {
+    if (std::shared_ptr<FenceState> state = fence_state.lock()) {
+      state->completed_fence.store(fence, std::memory_order_release);
+    }
+  });
+}
+
+}  // namespace web_gpu_app
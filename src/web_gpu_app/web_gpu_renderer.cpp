@@ -4,10 +4,20 @@
 #include <imgui.h>
 #include <webgpu/webgpu_cpp.h>
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <limits>
 
+#include "web_gpu_app/mesh_lod.h"
+#include "web_gpu_app/profiler.h"
 #include "web_gpu_app/utils.h"
+#include "web_gpu_app/web_gpu_utils.h"
 
 #if defined(__EMSCRIPTEN__)
 #include <emscripten/emscripten.h>
@@ -22,6 +32,8 @@ namespace web_gpu_app {
 GLFWwindow* WebGpuRenderer::g_window_;
 std::function<void(std::unique_ptr<WebGpuRenderer>)> WebGpuRenderer::g_create_callback_;
 wgpu::Instance WebGpuRenderer::g_instance_;
+HeadlessOptions WebGpuRenderer::g_headless_options_;
+PresentOptions WebGpuRenderer::g_present_options_;
 
 namespace {
 void OnDeviceError(WGPUErrorType type, const char* message, void* userdata) {
@@ -48,19 +60,299 @@ fn fragment_main() -> @location(0) vec4f {
 }
 )";
 
+// Draws the cached UI texture over the frame. The UI was blended into transparent black, which
+// premultiplied its colors by their alpha.
+const char* ui_composite_shader_code = R"(
+@group(0) @binding(0) var ui_texture : texture_2d<f32>;
+
+@vertex
+fn vertex_main(@builtin(vertex_index) i : u32) -> @builtin(position) vec4f {
+    const pos = array(vec2f(-1, -1), vec2f(3, -1), vec2f(-1, 3));
+    return vec4f(pos[i], 0, 1);
+}
+@fragment
+fn fragment_main(@builtin(position) position : vec4f) -> @location(0) vec4f {
+    return textureLoad(ui_texture, vec2i(position.xy), 0);
+}
+)";
+
+const Color kDefaultMeshColor = Color(0.8f, 0.8f, 0.8f, 1.f);
+// Bounding spheres of the cube and sphere geometries, which instances scale by their size.
+const BoundingSphere kCubeBounds = {.center = Vec3(0.f), .radius = 0.8660254f};
+const BoundingSphere kSphereBounds = {.center = Vec3(0.f), .radius = 1.f};
+// Two triangles of a quad, whose corners the impostor vertex shader derives from the index.
+const uint32_t kImpostorIndices[] = {0, 1, 2, 2, 1, 3};
+constexpr size_t kImpostorPipelineIndex = 4;
+// Number of opaque instanced pipelines, followed by as many translucent ones.
+constexpr size_t kNumOpaquePipelines = 5;
+// Sort key pass of the instances, which are all drawn in the main pass.
+constexpr uint32_t kMainDrawPass = 0;
+const wgpu::BlendState kTranslucentBlendState = {
+    .color = {.operation = wgpu::BlendOperation::Add,
+              .srcFactor = wgpu::BlendFactor::SrcAlpha,
+              .dstFactor = wgpu::BlendFactor::OneMinusSrcAlpha},
+    .alpha = {.operation = wgpu::BlendOperation::Add,
+              .srcFactor = wgpu::BlendFactor::One,
+              .dstFactor = wgpu::BlendFactor::OneMinusSrcAlpha}};
+
+// Uniforms struct of the instanced shader.
+struct Uniforms {
+  Mat4 view_projection;
+  Mat4 view;
+  Mat4 projection;
+};
+
+const char* instanced_shader_code = R"(
+struct Uniforms {
+    view_projection : mat4x4f,
+    view : mat4x4f,
+    projection : mat4x4f,
+}
+@group(0) @binding(0) var<uniform> uniforms : Uniforms;
+@group(1) @binding(0) var texture_array : texture_2d_array<f32>;
+@group(1) @binding(1) var texture_sampler : sampler;
+
+struct VertexInput {
+    @location(0) position : vec3f,
+    @location(1) normal : vec3f,
+}
+// Unorm16 positions, which the model matrix maps back to object space, and snorm16 octahedral
+// normals.
+struct QuantizedVertexInput {
+    @location(0) position : vec4f,
+    @location(1) normal : vec2f,
+}
+struct InstanceInput {
+    @location(2) model_0 : vec3f,
+    @location(3) model_1 : vec3f,
+    @location(4) model_2 : vec3f,
+    @location(5) model_3 : vec3f,
+    @location(6) color : vec4f,
+    @location(7) texture_layer : u32,
+}
+struct VertexOutput {
+    @builtin(position) position : vec4f,
+    @location(0) normal : vec3f,
+    @location(1) color : vec4f,
+    // World space offset from the instance's origin.
+    @location(2) texture_position : vec3f,
+    @location(3) @interpolate(flat) texture_layer : u32,
+}
+fn transform_vertex(position : vec3f, normal : vec3f, instance : InstanceInput) -> VertexOutput {
+    let model = mat4x4f(vec4f(instance.model_0, 0), vec4f(instance.model_1, 0),
+                        vec4f(instance.model_2, 0), vec4f(instance.model_3, 1));
+    let world_position = model * vec4f(position, 1);
+    var out : VertexOutput;
+    out.position = uniforms.view_projection * world_position;
+    out.normal = (model * vec4f(normal, 0)).xyz;
+    out.color = instance.color;
+    out.texture_position = world_position.xyz - instance.model_3;
+    out.texture_layer = instance.texture_layer;
+    return out;
+}
+fn decode_octahedral(encoded : vec2f) -> vec3f {
+    var normal = vec3f(encoded, 1 - abs(encoded.x) - abs(encoded.y));
+    let fold = max(-normal.z, 0);
+    normal.x += select(fold, -fold, normal.x >= 0);
+    normal.y += select(fold, -fold, normal.y >= 0);
+    return normalize(normal);
+}
+@vertex
+fn vertex_main(vertex : VertexInput, instance : InstanceInput) -> VertexOutput {
+    return transform_vertex(vertex.position, vertex.normal, instance);
+}
+@vertex
+fn vertex_main_quantized(vertex : QuantizedVertexInput, instance : InstanceInput) ->
+    VertexOutput {
+    return transform_vertex(vertex.position.xyz, decode_octahedral(vertex.normal), instance);
+}
+fn shade(color : vec4f, normal : vec3f) -> vec4f {
+    let light = normalize(vec3f(0.4, 0.8, 0.6));
+    let diffuse = 0.3 + 0.7 * max(dot(normal, light), 0.0);
+    return vec4f(color.rgb * diffuse, color.a);
+}
+@fragment
+fn fragment_main(in : VertexOutput) -> @location(0) vec4f {
+    return shade(in.color, normalize(in.normal));
+}
+// Meshes have no texture coordinates: the texture is projected along the three axes and blended
+// by the normal, repeating every world unit.
+@fragment
+fn fragment_main_textured(in : VertexOutput) -> @location(0) vec4f {
+    let normal = normalize(in.normal);
+    let weights = abs(normal) / (abs(normal.x) + abs(normal.y) + abs(normal.z));
+    let p = in.texture_position;
+    let layer = in.texture_layer;
+    let albedo = textureSample(texture_array, texture_sampler, p.yz, layer) * weights.x +
+                 textureSample(texture_array, texture_sampler, p.xz, layer) * weights.y +
+                 textureSample(texture_array, texture_sampler, p.xy, layer) * weights.z;
+    return shade(in.color * albedo, normal);
+}
+
+// Spheres ray cast on a quad instead of tessellated. The instance's model maps the unit sphere to
+// the sphere, assumed to be seen through a perspective projection.
+struct ImpostorInstanceInput {
+    @location(2) model_0 : vec3f,
+    @location(3) model_1 : vec3f,
+    @location(4) model_2 : vec3f,
+    @location(5) model_3 : vec3f,
+    @location(6) color : vec4f,
+}
+struct ImpostorOutput {
+    @builtin(position) position : vec4f,
+    // View space position on the quad, and center and radius of the sphere.
+    @location(0) view_position : vec3f,
+    @location(1) @interpolate(flat) center : vec3f,
+    @location(2) @interpolate(flat) radius : f32,
+    @location(3) @interpolate(flat) color : vec4f,
+}
+struct ImpostorFragmentOutput {
+    @location(0) color : vec4f,
+    @builtin(frag_depth) depth : f32,
+}
+@vertex
+fn vertex_main_impostor(@builtin(vertex_index) index : u32, instance : ImpostorInstanceInput) ->
+    ImpostorOutput {
+    var out : ImpostorOutput;
+    out.center = (uniforms.view * vec4f(instance.model_3, 1)).xyz;
+    out.radius = sqrt(max(dot(instance.model_0, instance.model_0),
+                          max(dot(instance.model_1, instance.model_1),
+                              dot(instance.model_2, instance.model_2))));
+    out.color = instance.color;
+    let distance_squared = dot(out.center, out.center);
+    let radius_squared = out.radius * out.radius;
+    if (distance_squared <= radius_squared) {
+        // The eye is inside the sphere: nothing to see, the quad is clipped.
+        out.position = vec4f(0, 0, 2, 1);
+        return out;
+    }
+    // Quad facing the eye through the center, as large as the silhouette's cone at the center.
+    let axis = out.center / sqrt(distance_squared);
+    let helper = select(vec3f(0, 1, 0), vec3f(1, 0, 0), abs(axis.y) > 0.9);
+    let right = normalize(cross(axis, helper));
+    let up = cross(right, axis);
+    let half_size = out.radius * sqrt(distance_squared / (distance_squared - radius_squared));
+    let corner = vec2f(f32(index & 1), f32(index >> 1)) * 2 - 1;
+    out.view_position = out.center + (right * corner.x + up * corner.y) * half_size;
+    out.position = uniforms.projection * vec4f(out.view_position, 1);
+    return out;
+}
+@fragment
+fn fragment_main_impostor(in : ImpostorOutput) -> ImpostorFragmentOutput {
+    let direction = normalize(in.view_position);
+    let closest = in.center - direction * dot(direction, in.center);
+    let discriminant = in.radius * in.radius - dot(closest, closest);
+    if (discriminant < 0) {
+        discard;
+    }
+    let hit = direction * (dot(direction, in.center) - sqrt(discriminant));
+    // The view matrix is rigid: its transpose rotates the normal back to world space.
+    let view_rotation = mat3x3f(uniforms.view[0].xyz, uniforms.view[1].xyz, uniforms.view[2].xyz);
+    let normal = transpose(view_rotation) * ((hit - in.center) / in.radius);
+    let clip_position = uniforms.projection * vec4f(hit, 1);
+    var out : ImpostorFragmentOutput;
+    out.color = shade(in.color, normal);
+    out.depth = clip_position.z / clip_position.w;
+    return out;
+}
+)";
+
+size_t GetInstancedPipelineIndex(bool quantized, bool textured) {
+  return (quantized ? 2 : 0) + (textured ? 1 : 0);
+}
+
+// Bounds of the mesh in the space of its packed instances, whose model also dequantizes the
+// positions. Meshes without bounds are never culled.
+BoundingSphere GetInstanceBounds(const GpuGeometry& geometry, const BoundingSphere* bounds) {
+  if (bounds == nullptr) return {.center = Vec3(0.f), .radius = std::numeric_limits<float>::max()};
+  if (!geometry.quantized) return *bounds;
+  const float inverse_scale = 1.f / geometry.position_scale;
+  return {.center = (bounds->center - geometry.position_offset) * inverse_scale,
+          .radius = bounds->radius * inverse_scale};
+}
+
+bool IsTranslucent(const Color& color) { return color.a < 1.f; }
+
+// Moves the indices of the translucent objects from "opaque" to "translucent". When not "indexed",
+// every object is drawn and "opaque" is only filled if some of them are translucent.
+template <typename Objects>
+void SplitTranslucent(const Objects& objects, bool indexed, ThreadPool* thread_pool,
+                      std::vector<uint32_t>* opaque, std::vector<uint32_t>* translucent) {
+  translucent->clear();
+  if (indexed) {
+    size_t num_opaque = 0;
+    for (uint32_t index : *opaque) {
+      if (IsTranslucent(objects[index].color)) {
+        translucent->push_back(index);
+      } else {
+        (*opaque)[num_opaque++] = index;
+      }
+    }
+    opaque->resize(num_opaque);
+    return;
+  }
+
+  // Usually none is: looks for one in parallel before splitting.
+  std::atomic<bool> any_translucent = false;
+  thread_pool->ParallelFor(objects.size(), 64 * 1024, [&](size_t begin, size_t end, size_t) {
+    for (size_t i = begin; i < end && !any_translucent.load(std::memory_order_relaxed); ++i) {
+      if (IsTranslucent(objects[i].color)) any_translucent.store(true, std::memory_order_relaxed);
+    }
+  });
+  if (!any_translucent) return;
+  opaque->clear();
+  for (uint32_t i = 0; i < objects.size(); ++i) {
+    (IsTranslucent(objects[i].color) ? translucent : opaque)->push_back(i);
+  }
+}
+
+// Distance from the eye along the view direction.
+float GetViewDepth(const Mat4& view, const Mat4& transform) {
+  return -(view[0].z * transform[3].x + view[1].z * transform[3].y + view[2].z * transform[3].z +
+           view[3].z);
+}
+
 }  // namespace
 
-void GetDevice(wgpu::Instance instance, void (*callback)(wgpu::Device)) {
+void GetDevice(wgpu::Instance instance, void (*callback)(wgpu::Device),
+               const wgpu::RequestAdapterOptions* options) {
   instance.RequestAdapter(
-      nullptr,
+      options,
       [](WGPURequestAdapterStatus status, WGPUAdapter c_adapter, const char* message,
          void* userdata) {
         if (status != WGPURequestAdapterStatus_Success) {
           exit(0);
         }
         wgpu::Adapter adapter = wgpu::Adapter::Acquire(c_adapter);
+        std::vector<wgpu::FeatureName> required_features;
+        // Compressed formats are optional, the TextureManager falls back to RGBA8.
+        for (wgpu::FeatureName feature :
+             {wgpu::FeatureName::TextureCompressionBC, wgpu::FeatureName::TextureCompressionETC2}) {
+          if (adapter.HasFeature(feature)) required_features.push_back(feature);
+        }
+        // GPU pass timings are only wanted when the profiler was enabled before the device.
+        const bool timestamp_queries =
+            Profiler::IsEnabled() && adapter.HasFeature(wgpu::FeatureName::TimestampQuery);
+        if (timestamp_queries) required_features.push_back(wgpu::FeatureName::TimestampQuery);
+        wgpu::DeviceDescriptor device_descriptor{
+            .requiredFeatureCount = required_features.size(),
+            .requiredFeatures = required_features.data()};
+#if !defined(__EMSCRIPTEN__)
+        wgpu::DawnCacheDeviceDescriptor cache_descriptor;
+        BlobCache::Get().InitDeviceDescriptor(&cache_descriptor);
+        device_descriptor.nextInChain = &cache_descriptor;
+
+        // Dawn only exposes timestamp queries with unsafe APIs allowed.
+        const char* enabled_toggles[] = {"allow_unsafe_apis"};
+        wgpu::DawnTogglesDescriptor toggles_descriptor;
+        if (timestamp_queries) {
+          toggles_descriptor.enabledToggleCount = std::size(enabled_toggles);
+          toggles_descriptor.enabledToggles = enabled_toggles;
+          cache_descriptor.nextInChain = &toggles_descriptor;
+        }
+#endif
         adapter.RequestDevice(
-            nullptr,
+            &device_descriptor,
             [](WGPURequestDeviceStatus status, WGPUDevice c_device, const char* message,
                void* userdata) {
               wgpu::Device device = wgpu::Device::Acquire(c_device);
@@ -72,34 +364,182 @@ void GetDevice(wgpu::Instance instance, void (*callback)(wgpu::Device)) {
 }
 
 void WebGpuRenderer::Create(GLFWwindow* window,
-                            std::function<void(std::unique_ptr<WebGpuRenderer>)> callback) {
+                            std::function<void(std::unique_ptr<WebGpuRenderer>)> callback,
+                            const PresentOptions& present_options) {
   g_window_ = window;
+  g_present_options_ = present_options;
   g_create_callback_ = std::move(callback);
   g_instance_ = wgpu::CreateInstance();
   web_gpu_app::GetDevice(g_instance_, [](wgpu::Device device) {
-    g_create_callback_(std::make_unique<WebGpuRenderer>(g_instance_, device, g_window_));
+    g_create_callback_(
+        std::make_unique<WebGpuRenderer>(g_instance_, device, g_window_, g_present_options_));
   });
 }
 
-WebGpuRenderer::WebGpuRenderer(wgpu::Instance instance, wgpu::Device device, GLFWwindow* window)
-    : instance_(instance), device_(device), window_(window) {
+void WebGpuRenderer::CreateHeadless(const HeadlessOptions& options,
+                                    std::function<void(std::unique_ptr<WebGpuRenderer>)> callback) {
+  g_headless_options_ = options;
+  g_create_callback_ = std::move(callback);
+  g_instance_ = wgpu::CreateInstance();
+  wgpu::RequestAdapterOptions adapter_options = GetAdapterOptions(options.backend);
+  web_gpu_app::GetDevice(
+      g_instance_,
+      [](wgpu::Device device) {
+        g_create_callback_(
+            std::make_unique<WebGpuRenderer>(g_instance_, device, g_headless_options_));
+      },
+      &adapter_options);
+}
+
+wgpu::RequestAdapterOptions WebGpuRenderer::GetAdapterOptions(HeadlessBackend backend) {
+  wgpu::RequestAdapterOptions options;
+  switch (backend) {
+    case HeadlessBackend::kDefault:
+      break;
+    case HeadlessBackend::kNull:
+      options.backendType = wgpu::BackendType::Null;
+      break;
+    case HeadlessBackend::kSwiftShader:
+      options.backendType = wgpu::BackendType::Vulkan;
+      options.forceFallbackAdapter = true;
+      break;
+  }
+  return options;
+}
+
+WebGpuRenderer::WebGpuRenderer(wgpu::Instance instance, wgpu::Device device, GLFWwindow* window,
+                               const PresentOptions& present_options)
+    : instance_(instance),
+      device_(device),
+      window_(window),
+      present_mode_(present_options.present_mode),
+      frames_in_flight_(std::max(present_options.frames_in_flight, 1u)) {
 #if !defined(__EMSCRIPTEN__)
   device_.SetUncapturedErrorCallback(OnDeviceError, nullptr);
   device_.SetDeviceLostCallback(OnDeviceLost, device.Get());
 #endif
 
-  shader_code_ = shader_code;
   glfwGetFramebufferSize(window_, &width_, &height_);
   surface_ = CreateSurface(instance_, window);
   swap_chain_ = CreateSwapChain(surface_, device_, width_, height_);
-  depth_texture_ = CreateDepthTexture(device_, depth_texture_format_, width_, height_);
-  depth_texture_view_ = CreateDepthTextureView(depth_texture_, depth_texture_format_);
-  render_pipeline_ = CreateRenderPipeline(device_, shader_code_.c_str());
-  ui_ = std::make_unique<Ui>(window_, device_);
+  Initialize();
+}
+
+WebGpuRenderer::WebGpuRenderer(wgpu::Instance instance, wgpu::Device device,
+                               const HeadlessOptions& options)
+    : instance_(instance),
+      device_(device),
+      frames_in_flight_(std::max(options.frames_in_flight, 1u)),
+      width_(options.width),
+      height_(options.height) {
+#if !defined(__EMSCRIPTEN__)
+  device_.SetUncapturedErrorCallback(OnDeviceError, nullptr);
+  device_.SetDeviceLostCallback(OnDeviceLost, device.Get());
+#endif
+
+  color_texture_ = CreateColorTexture(device_, color_texture_format_, width_, height_);
+  color_texture_view_ = color_texture_.CreateView();
+  Initialize();
+  // Offscreen frames are expected to be complete, e.g. for screenshots.
+  pipeline_cache_->WaitIdle();
+}
+
+void WebGpuRenderer::Initialize() {
+  shader_code_ = shader_code;
+  instanced_shader_code_ = instanced_shader_code;
+  ui_composite_shader_code_ = ui_composite_shader_code;
+  transient_textures_ = std::make_unique<TransientTexturePool>(device_);
+  cube_geometry_ = CreateGpuGeometry(device_, CreateCubeGeometry());
+  sphere_geometry_ = CreateGpuGeometry(device_, CreateSphereGeometry());
+  impostor_geometry_.index_buffer = CreateBuffer(device_, wgpu::BufferUsage::Index,
+                                                 sizeof(kImpostorIndices), kImpostorIndices);
+  impostor_geometry_.index_count = std::size(kImpostorIndices);
+  impostor_geometry_.lods = {{.first_index = 0, .num_indices = impostor_geometry_.index_count}};
+
+  // Pipelines are created asynchronously, nothing is drawn with them until they are ready.
+  pipeline_cache_ = std::make_unique<PipelineCache>(device_);
+  bind_group_cache_ = std::make_unique<BindGroupCache>(device_);
+  CreateLayouts();
+  CreateRenderPipeline(shader_code_.c_str(),
+                       [this](wgpu::RenderPipeline pipeline) { render_pipeline_ = pipeline; });
+  for (bool translucent : {false, true}) {
+    const size_t first_index = translucent ? kNumOpaquePipelines : 0;
+    for (bool quantized : {false, true}) {
+      for (bool textured : {false, true}) {
+        const size_t index = first_index + GetInstancedPipelineIndex(quantized, textured);
+        CreateInstancedRenderPipeline(instanced_shader_code_.c_str(), quantized, textured,
+                                      translucent, [this, index](wgpu::RenderPipeline pipeline) {
+                                        instanced_pipelines_[index] = pipeline;
+                                      });
+      }
+    }
+    CreateImpostorRenderPipeline(
+        instanced_shader_code_.c_str(), translucent,
+        [this, index = first_index + kImpostorPipelineIndex](wgpu::RenderPipeline pipeline) {
+          instanced_pipelines_[index] = pipeline;
+        });
+  }
+  CreateUiCompositePipeline(ui_composite_shader_code_.c_str(),
+                            [this](wgpu::RenderPipeline pipeline) {
+                              ui_composite_pipeline_ = pipeline;
+                            });
+  texture_manager_ = std::make_unique<TextureManager>(device_, pipeline_cache_.get());
+  gpu_culling_ = std::make_unique<GpuCulling>(device_, pipeline_cache_.get());
+
+  upload_ring_ = std::make_unique<UploadRing>(device_, frames_in_flight_);
+  mesh_cache_ = std::make_unique<MeshCache>(device_);
+  gpu_profiler_ = std::make_unique<GpuProfiler>(device_);
+  thread_pool_ = std::make_unique<ThreadPool>();
+  ui_ = std::make_unique<Ui>(window_, device_, frames_in_flight_);
+  ui_->SetDisplaySize(width_, height_);
 }
 
 WebGpuRenderer::~WebGpuRenderer() {}
 
+void WebGpuRenderer::CreateLayouts() {
+  wgpu::SupportedLimits limits;
+  device_.GetLimits(&limits);
+  uniform_offset_alignment_ = limits.limits.minUniformBufferOffsetAlignment;
+
+  wgpu::BindGroupLayoutEntry frame_entry{
+      .binding = 0,
+      .visibility = wgpu::ShaderStage::Vertex | wgpu::ShaderStage::Fragment,
+      .buffer = {.type = wgpu::BufferBindingType::Uniform,
+                 .hasDynamicOffset = true,
+                 .minBindingSize = sizeof(Uniforms)}};
+  wgpu::BindGroupLayoutDescriptor frame_descriptor{.entryCount = 1, .entries = &frame_entry};
+  frame_bind_group_layout_ = pipeline_cache_->GetBindGroupLayout(frame_descriptor);
+
+  wgpu::BindGroupLayoutEntry texture_entries[] = {
+      {.binding = 0,
+       .visibility = wgpu::ShaderStage::Fragment,
+       .texture = {.sampleType = wgpu::TextureSampleType::Float,
+                   .viewDimension = wgpu::TextureViewDimension::e2DArray}},
+      {.binding = 1,
+       .visibility = wgpu::ShaderStage::Fragment,
+       .sampler = {.type = wgpu::SamplerBindingType::Filtering}},
+  };
+  wgpu::BindGroupLayoutDescriptor texture_descriptor{.entryCount = std::size(texture_entries),
+                                                     .entries = texture_entries};
+  texture_bind_group_layout_ = pipeline_cache_->GetBindGroupLayout(texture_descriptor);
+
+  // Every group of a pipeline's layout must be bound to draw with it: untextured pipelines leave
+  // group 1 out.
+  const wgpu::BindGroupLayout layouts[] = {frame_bind_group_layout_, texture_bind_group_layout_};
+  instanced_pipeline_layout_ = pipeline_cache_->GetPipelineLayout(std::span(layouts, 1));
+  textured_pipeline_layout_ = pipeline_cache_->GetPipelineLayout(layouts);
+
+  wgpu::BindGroupLayoutEntry ui_entry{
+      .binding = 0,
+      .visibility = wgpu::ShaderStage::Fragment,
+      .texture = {.sampleType = wgpu::TextureSampleType::Float,
+                  .viewDimension = wgpu::TextureViewDimension::e2D}};
+  wgpu::BindGroupLayoutDescriptor ui_descriptor{.entryCount = 1, .entries = &ui_entry};
+  ui_bind_group_layout_ = pipeline_cache_->GetBindGroupLayout(ui_descriptor);
+  ui_composite_pipeline_layout_ =
+      pipeline_cache_->GetPipelineLayout(std::span(&ui_bind_group_layout_, 1));
+}
+
 wgpu::Surface WebGpuRenderer::CreateSurface(const wgpu::Instance& instance, GLFWwindow* window) {
   wgpu::Surface surface;
 #if defined(__EMSCRIPTEN__)
@@ -115,49 +555,36 @@ wgpu::Surface WebGpuRenderer::CreateSurface(const wgpu::Instance& instance, GLFW
 
 wgpu::SwapChain WebGpuRenderer::CreateSwapChain(wgpu::Surface surface, wgpu::Device device,
                                                 uint32_t width, uint32_t height) {
+#if defined(__EMSCRIPTEN__)
+  const wgpu::PresentMode present_mode = wgpu::PresentMode::Fifo;
+#else
+  const wgpu::PresentMode present_mode = present_mode_;
+#endif
   wgpu::SwapChainDescriptor descriptor{.usage = wgpu::TextureUsage::RenderAttachment,
                                        .format = wgpu::TextureFormat::BGRA8Unorm,
                                        .width = width,
                                        .height = height,
-                                       .presentMode = wgpu::PresentMode::Fifo};
+                                       .presentMode = present_mode};
   return device.CreateSwapChain(surface, &descriptor);
 }
 
-wgpu::Texture WebGpuRenderer::CreateDepthTexture(wgpu::Device device,
-                                                 wgpu::TextureFormat depth_texture_format,
+wgpu::Texture WebGpuRenderer::CreateColorTexture(wgpu::Device device,
+                                                 wgpu::TextureFormat color_texture_format,
                                                  uint32_t width, uint32_t height) {
-  wgpu::TextureDescriptor depthTextureDesc;
-  depthTextureDesc.dimension = wgpu::TextureDimension::e2D;
-  depthTextureDesc.format = depth_texture_format;
-  depthTextureDesc.mipLevelCount = 1;
-  depthTextureDesc.sampleCount = 1;
-  depthTextureDesc.size = {static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1};
-  depthTextureDesc.usage = wgpu::TextureUsage::RenderAttachment;
-  depthTextureDesc.viewFormatCount = 1;
-  depthTextureDesc.viewFormats = &depth_texture_format;
-  return device.CreateTexture(&depthTextureDesc);
-}
-
-wgpu::TextureView WebGpuRenderer::CreateDepthTextureView(wgpu::Texture depth_texture,
-                                                         wgpu::TextureFormat depth_texture_format) {
-  wgpu::TextureViewDescriptor depth_texture_view_descriptor;
-  depth_texture_view_descriptor.aspect = wgpu::TextureAspect::DepthOnly;
-  depth_texture_view_descriptor.baseArrayLayer = 0;
-  depth_texture_view_descriptor.arrayLayerCount = 1;
-  depth_texture_view_descriptor.baseMipLevel = 0;
-  depth_texture_view_descriptor.mipLevelCount = 1;
-  depth_texture_view_descriptor.dimension = wgpu::TextureViewDimension::e2D;
-  depth_texture_view_descriptor.format = depth_texture_format;
-  return depth_texture.CreateView(&depth_texture_view_descriptor);
-}
-
-wgpu::RenderPipeline WebGpuRenderer::CreateRenderPipeline(wgpu::Device device,
-                                                          const char* shader_code) {
-  wgpu::ShaderModuleWGSLDescriptor wgsl_descriptor{};
-  wgsl_descriptor.code = shader_code;
-
-  wgpu::ShaderModuleDescriptor shader_module_descriptor{.nextInChain = &wgsl_descriptor};
-  wgpu::ShaderModule shader_module = device.CreateShaderModule(&shader_module_descriptor);
+  wgpu::TextureDescriptor color_texture_descriptor;
+  color_texture_descriptor.dimension = wgpu::TextureDimension::e2D;
+  color_texture_descriptor.format = color_texture_format;
+  color_texture_descriptor.mipLevelCount = 1;
+  color_texture_descriptor.sampleCount = 1;
+  color_texture_descriptor.size = {width, height, 1};
+  color_texture_descriptor.usage =
+      wgpu::TextureUsage::RenderAttachment | wgpu::TextureUsage::CopySrc;
+  return device.CreateTexture(&color_texture_descriptor);
+}
+
+void WebGpuRenderer::CreateRenderPipeline(const char* shader_code,
+                                          PipelineCache::Callback callback) {
+  wgpu::ShaderModule shader_module = pipeline_cache_->GetShaderModule(shader_code);
 
   wgpu::ColorTargetState color_target_state{.format = wgpu::TextureFormat::BGRA8Unorm};
 
@@ -181,60 +608,857 @@ wgpu::RenderPipeline WebGpuRenderer::CreateRenderPipeline(wgpu::Device device,
   descriptor.multisample.mask = ~0u;
   descriptor.multisample.alphaToCoverageEnabled = false;
 
-  return device.CreateRenderPipeline(&descriptor);
+  pipeline_cache_->GetRenderPipeline(descriptor, std::move(callback));
 }
 
-void WebGpuRenderer::BeginFrame() { ui_->BeginUiFrame(); }
+void WebGpuRenderer::CreateInstancedRenderPipeline(const char* shader_code, bool quantized,
+                                                   bool textured, bool translucent,
+                                                   PipelineCache::Callback callback) {
+  wgpu::ShaderModule shader_module = pipeline_cache_->GetShaderModule(shader_code);
 
-void WebGpuRenderer::EndFrame(const Renderables&) {
-  wgpu::RenderPassColorAttachment attachment{.view = swap_chain_.GetCurrentTextureView(),
-                                             .loadOp = wgpu::LoadOp::Clear,
-                                             .storeOp = wgpu::StoreOp::Store};
+  wgpu::VertexAttribute vertex_attributes[] = {
+      {.format = wgpu::VertexFormat::Float32x3,
+       .offset = offsetof(Vertex, position),
+       .shaderLocation = 0},
+      {.format = wgpu::VertexFormat::Float32x3,
+       .offset = offsetof(Vertex, normal),
+       .shaderLocation = 1},
+  };
+  wgpu::VertexAttribute quantized_vertex_attributes[] = {
+      {.format = wgpu::VertexFormat::Unorm16x4,
+       .offset = offsetof(QuantizedVertex, position),
+       .shaderLocation = 0},
+      {.format = wgpu::VertexFormat::Snorm16x2,
+       .offset = offsetof(QuantizedVertex, normal),
+       .shaderLocation = 1},
+  };
+  wgpu::VertexAttribute instance_attributes[] = {
+      {.format = wgpu::VertexFormat::Float32x3, .offset = 0, .shaderLocation = 2},
+      {.format = wgpu::VertexFormat::Float32x3, .offset = 12, .shaderLocation = 3},
+      {.format = wgpu::VertexFormat::Float32x3, .offset = 24, .shaderLocation = 4},
+      {.format = wgpu::VertexFormat::Float32x3, .offset = 36, .shaderLocation = 5},
+      {.format = wgpu::VertexFormat::Unorm8x4,
+       .offset = offsetof(PackedInstance, color),
+       .shaderLocation = 6},
+      {.format = wgpu::VertexFormat::Uint32,
+       .offset = offsetof(PackedInstance, texture_layer),
+       .shaderLocation = 7},
+  };
+  wgpu::VertexBufferLayout vertex_buffer_layouts[] = {
+      {.arrayStride = quantized ? sizeof(QuantizedVertex) : sizeof(Vertex),
+       .stepMode = wgpu::VertexStepMode::Vertex,
+       .attributeCount = std::size(vertex_attributes),
+       .attributes = quantized ? quantized_vertex_attributes : vertex_attributes},
+      {.arrayStride = sizeof(PackedInstance),
+       .stepMode = wgpu::VertexStepMode::Instance,
+       .attributeCount = std::size(instance_attributes),
+       .attributes = instance_attributes},
+  };
 
-  wgpu::RenderPassDepthStencilAttachment depthStencilAttachment;
-  depthStencilAttachment.view = depth_texture_view_;
-  depthStencilAttachment.depthClearValue = 1.0f;
-  depthStencilAttachment.depthLoadOp = wgpu::LoadOp::Clear;
-  depthStencilAttachment.depthStoreOp = wgpu::StoreOp::Store;
-  depthStencilAttachment.depthReadOnly = false;
-  depthStencilAttachment.stencilClearValue = 0;
-#ifdef WEBGPU_BACKEND_WGPU
-  depthStencilAttachment.stencilLoadOp = wgpu::LoadOp::Clear;
-  depthStencilAttachment.stencilStoreOp = wgpu::StoreOp::Store;
-#else
-  depthStencilAttachment.stencilLoadOp = wgpu::LoadOp::Undefined;
-  depthStencilAttachment.stencilStoreOp = wgpu::StoreOp::Undefined;
-#endif
-  depthStencilAttachment.stencilReadOnly = true;
+  wgpu::ColorTargetState color_target_state{
+      .format = wgpu::TextureFormat::BGRA8Unorm,
+      .blend = translucent ? &kTranslucentBlendState : nullptr};
 
-  wgpu::RenderPassDescriptor renderpass{.colorAttachmentCount = 1,
-                                        .colorAttachments = &attachment,
-                                        .depthStencilAttachment = &depthStencilAttachment};
+  wgpu::FragmentState fragmentState{.module = shader_module,
+                                    .entryPoint =
+                                        textured ? "fragment_main_textured" : "fragment_main",
+                                    .targetCount = 1,
+                                    .targets = &color_target_state};
 
-  wgpu::CommandEncoder encoder = device_.CreateCommandEncoder();
-  wgpu::RenderPassEncoder pass = encoder.BeginRenderPass(&renderpass);
-  pass.SetPipeline(render_pipeline_);
-  pass.Draw(3);
+  wgpu::DepthStencilState depth_stencil_state;
+  depth_stencil_state.depthCompare = wgpu::CompareFunction::Less;
+  depth_stencil_state.depthWriteEnabled = !translucent;
+  depth_stencil_state.format = wgpu::TextureFormat::Depth24Plus;
+  depth_stencil_state.stencilReadMask = 0;
+  depth_stencil_state.stencilWriteMask = 0;
 
-  ui_->EndUiFrame(pass);
-  pass.End();
+  wgpu::RenderPipelineDescriptor descriptor{
+      .layout = textured ? textured_pipeline_layout_ : instanced_pipeline_layout_,
+      .vertex = {.module = shader_module,
+                 .entryPoint = quantized ? "vertex_main_quantized" : "vertex_main",
+                 .bufferCount = std::size(vertex_buffer_layouts),
+                 .buffers = vertex_buffer_layouts},
+      .fragment = &fragmentState};
+
+  descriptor.depthStencil = &depth_stencil_state;
+  descriptor.multisample.count = 1;
+  descriptor.multisample.mask = ~0u;
+  descriptor.multisample.alphaToCoverageEnabled = false;
+
+  pipeline_cache_->GetRenderPipeline(descriptor, std::move(callback));
+}
+
+void WebGpuRenderer::CreateImpostorRenderPipeline(const char* shader_code, bool translucent,
+                                                  PipelineCache::Callback callback) {
+  wgpu::ShaderModule shader_module = pipeline_cache_->GetShaderModule(shader_code);
+
+  // No vertices: the instances are in the first buffer.
+  wgpu::VertexAttribute instance_attributes[] = {
+      {.format = wgpu::VertexFormat::Float32x3, .offset = 0, .shaderLocation = 2},
+      {.format = wgpu::VertexFormat::Float32x3, .offset = 12, .shaderLocation = 3},
+      {.format = wgpu::VertexFormat::Float32x3, .offset = 24, .shaderLocation = 4},
+      {.format = wgpu::VertexFormat::Float32x3, .offset = 36, .shaderLocation = 5},
+      {.format = wgpu::VertexFormat::Unorm8x4,
+       .offset = offsetof(PackedInstance, color),
+       .shaderLocation = 6},
+  };
+  wgpu::VertexBufferLayout instance_buffer_layout{.arrayStride = sizeof(PackedInstance),
+                                                  .stepMode = wgpu::VertexStepMode::Instance,
+                                                  .attributeCount = std::size(instance_attributes),
+                                                  .attributes = instance_attributes};
+
+  wgpu::ColorTargetState color_target_state{
+      .format = wgpu::TextureFormat::BGRA8Unorm,
+      .blend = translucent ? &kTranslucentBlendState : nullptr};
+
+  wgpu::FragmentState fragmentState{.module = shader_module,
+                                    .entryPoint = "fragment_main_impostor",
+                                    .targetCount = 1,
+                                    .targets = &color_target_state};
+
+  wgpu::DepthStencilState depth_stencil_state;
+  depth_stencil_state.depthCompare = wgpu::CompareFunction::Less;
+  depth_stencil_state.depthWriteEnabled = !translucent;
+  depth_stencil_state.format = wgpu::TextureFormat::Depth24Plus;
+  depth_stencil_state.stencilReadMask = 0;
+  depth_stencil_state.stencilWriteMask = 0;
+
+  wgpu::RenderPipelineDescriptor descriptor{
+      .layout = instanced_pipeline_layout_,
+      .vertex = {.module = shader_module,
+                 .entryPoint = "vertex_main_impostor",
+                 .bufferCount = 1,
+                 .buffers = &instance_buffer_layout},
+      .fragment = &fragmentState};
+
+  descriptor.depthStencil = &depth_stencil_state;
+  descriptor.multisample.count = 1;
+  descriptor.multisample.mask = ~0u;
+  descriptor.multisample.alphaToCoverageEnabled = false;
+
+  pipeline_cache_->GetRenderPipeline(descriptor, std::move(callback));
+}
+
+void WebGpuRenderer::CreateUiCompositePipeline(const char* shader_code,
+                                               PipelineCache::Callback callback) {
+  wgpu::ShaderModule shader_module = pipeline_cache_->GetShaderModule(shader_code);
+
+  wgpu::BlendState blend_state{
+      .color = {.operation = wgpu::BlendOperation::Add,
+                .srcFactor = wgpu::BlendFactor::One,
+                .dstFactor = wgpu::BlendFactor::OneMinusSrcAlpha},
+      .alpha = {.operation = wgpu::BlendOperation::Add,
+                .srcFactor = wgpu::BlendFactor::One,
+                .dstFactor = wgpu::BlendFactor::OneMinusSrcAlpha}};
+  wgpu::ColorTargetState color_target_state{.format = wgpu::TextureFormat::BGRA8Unorm,
+                                            .blend = &blend_state};
+
+  wgpu::FragmentState fragmentState{.module = shader_module,
+                                    .entryPoint = "fragment_main",
+                                    .targetCount = 1,
+                                    .targets = &color_target_state};
+
+  // Drawn in the main pass, over everything.
+  wgpu::DepthStencilState depth_stencil_state;
+  depth_stencil_state.depthCompare = wgpu::CompareFunction::Always;
+  depth_stencil_state.depthWriteEnabled = false;
+  depth_stencil_state.format = wgpu::TextureFormat::Depth24Plus;
+  depth_stencil_state.stencilReadMask = 0;
+  depth_stencil_state.stencilWriteMask = 0;
+
+  wgpu::RenderPipelineDescriptor descriptor{
+      .layout = ui_composite_pipeline_layout_,
+      .vertex = {.module = shader_module, .entryPoint = "vertex_main"},
+      .fragment = &fragmentState};
+
+  descriptor.depthStencil = &depth_stencil_state;
+  descriptor.multisample.count = 1;
+  descriptor.multisample.mask = ~0u;
+  descriptor.multisample.alphaToCoverageEnabled = false;
+
+  pipeline_cache_->GetRenderPipeline(descriptor, std::move(callback));
+}
+
+void WebGpuRenderer::UpdateUniforms(const Camera& camera) {
+  Uniforms uniforms{.view_projection = camera.projection * camera.view,
+                    .view = camera.view,
+                    .projection = camera.projection};
+  // Bound at offset 0 of the upload buffer with the allocation's offset as dynamic offset: the
+  // bind group of each buffer of the ring is created once and reused by the frames using it.
+  UploadAllocation allocation =
+      upload_ring_->Upload(std::span<const Uniforms>(&uniforms, 1), uniform_offset_alignment_);
+  wgpu::BindGroupEntry entry{.binding = 0, .buffer = allocation.buffer, .size = sizeof(Uniforms)};
+  uniform_bind_group_ = bind_group_cache_->Get(frame_bind_group_layout_, std::span(&entry, 1));
+  uniform_offset_ = static_cast<uint32_t>(allocation.offset);
+}
+
+void WebGpuRenderer::CollectMeshItems(const Renderables& renderables) {
+  mesh_items_.clear();
+  for (Mesh& mesh : renderables.meshes) {
+    if (mesh.attrib == nullptr) continue;
+    MeshHandle handle = mesh_cache_->Add(*mesh.attrib, mesh.mesh);
+    mesh_items_.push_back(
+        {handle, &mesh.transform, mesh.scale, kDefaultMeshColor, mesh.lod, &mesh.lod});
+  }
+  for (CachedMesh& mesh : renderables.cached_meshes) {
+    if (!mesh_cache_->Contains(mesh.handle)) continue;
+    MeshItem item{mesh.handle, &mesh.transform, mesh.scale, mesh.color, mesh.lod, &mesh.lod};
+    if (mesh.texture != 0 && texture_manager_->IsReady(mesh.texture)) {
+      const TextureInfo* texture = texture_manager_->GetInfo(mesh.texture);
+      item.texture_array = texture->array;
+      item.texture_layer = texture->layer;
+    }
+    mesh_items_.push_back(item);
+  }
+  // Group identical meshes so that each of them is drawn with a single instanced draw per texture
+  // array.
+  std::sort(mesh_items_.begin(), mesh_items_.end(), [](const MeshItem& a, const MeshItem& b) {
+    return a.handle != b.handle ? a.handle < b.handle : a.texture_array < b.texture_array;
+  });
+}
+
+void WebGpuRenderer::CullInstances(const Renderables& renderables) {
+  const Frustum frustum =
+      ExtractFrustum(renderables.camera.projection * renderables.camera.view);
+  auto cull = [&](std::vector<uint32_t>* visible) {
+    CullSpheres(frustum, cull_bounds_, visible, thread_pool_.get());
+    render_stats_.culled_instances += cull_bounds_.size() - visible->size();
+    cull_bounds_.clear();
+  };
+
+  AppendBounds(renderables.cubes, &cull_bounds_);
+  cull(&visible_cubes_);
+  AppendBounds(renderables.spheres, &cull_bounds_);
+  cull(&visible_spheres_);
+
+  for (const MeshItem& item : mesh_items_) {
+    const BoundingSphere* bounds = mesh_cache_->GetBounds(item.handle);
+    if (bounds == nullptr) {
+      cull_bounds_.push_back(Vec3((*item.transform)[3]), std::numeric_limits<float>::max());
+      continue;
+    }
+    Vec3 center = Vec3(*item.transform * Vec4(bounds->center * item.scale, 1.f));
+    cull_bounds_.push_back(center,
+                           bounds->radius * std::abs(item.scale) * GetMaxScale(*item.transform));
+  }
+  cull(&visible_mesh_items_);
+  // Compacting in place keeps the items sorted by handle.
+  for (size_t i = 0; i < visible_mesh_items_.size(); ++i) {
+    mesh_items_[i] = mesh_items_[visible_mesh_items_[i]];
+  }
+  mesh_items_.resize(visible_mesh_items_.size());
+}
+
+void WebGpuRenderer::SelectLods(const Camera& camera) {
+  const LodProjection projection = ComputeLodProjection(camera, height_);
+  for (size_t begin = 0; begin < mesh_items_.size();) {
+    const MeshHandle handle = mesh_items_[begin].handle;
+    const GpuGeometry* geometry = mesh_cache_->Get(handle);
+    const BoundingSphere* bounds = mesh_cache_->GetBounds(handle);
+    size_t end = begin;
+    for (; end < mesh_items_.size() && mesh_items_[end].handle == handle; ++end) {
+      MeshItem& item = mesh_items_[end];
+      if (geometry->lods.size() > 1) {
+        const float scale = std::abs(item.scale) * GetMaxScale(*item.transform);
+        const Vec3 center = Vec3(*item.transform * Vec4(bounds->center * item.scale, 1.f));
+        const float pixels_per_unit =
+            scale * GetPixelsPerUnit(projection, center, bounds->radius * scale);
+        item.lod = SelectLod(geometry->lods, pixels_per_unit, item.lod, lod_settings_.pixel_error,
+                             lod_settings_.hysteresis);
+      } else {
+        item.lod = 0;
+      }
+      *item.previous_lod = item.lod;
+    }
+    begin = end;
+  }
+  // Instances of the same mesh, texture array and LOD are drawn together.
+  std::sort(mesh_items_.begin(), mesh_items_.end(), [](const MeshItem& a, const MeshItem& b) {
+    if (a.handle != b.handle) return a.handle < b.handle;
+    return a.texture_array != b.texture_array ? a.texture_array < b.texture_array : a.lod < b.lod;
+  });
+}
+
+void WebGpuRenderer::CollectTranslucentObjects(const Renderables& renderables, bool culled) {
+  translucent_objects_.clear();
+  SplitTranslucent(renderables.cubes, culled, thread_pool_.get(), &visible_cubes_,
+                   &translucent_cubes_);
+  SplitTranslucent(renderables.spheres, culled, thread_pool_.get(), &visible_spheres_,
+                   &translucent_spheres_);
+  for (uint32_t index : translucent_cubes_) {
+    const Cube& cube = renderables.cubes[index];
+    translucent_objects_.push_back(
+        {.geometry = &cube_geometry_, .transform = &cube.transform, .scale = cube.size,
+         .color = cube.color});
+  }
+  const GpuGeometry* sphere_geometry =
+      sphere_impostors_enabled_ && instanced_pipelines_[kImpostorPipelineIndex]
+          ? &impostor_geometry_
+          : &sphere_geometry_;
+  for (uint32_t index : translucent_spheres_) {
+    const Sphere& sphere = renderables.spheres[index];
+    translucent_objects_.push_back(
+        {.geometry = sphere_geometry, .transform = &sphere.transform, .scale = sphere.radius,
+         .color = sphere.color});
+  }
+  // Compacting in place keeps the opaque items sorted.
+  size_t num_opaque = 0;
+  for (const MeshItem& item : mesh_items_) {
+    if (!IsTranslucent(item.color)) {
+      mesh_items_[num_opaque++] = item;
+      continue;
+    }
+    translucent_objects_.push_back({.geometry = mesh_cache_->Get(item.handle),
+                                    .transform = item.transform,
+                                    .scale = item.scale,
+                                    .color = item.color,
+                                    .lod = item.lod,
+                                    .texture_array = item.texture_array,
+                                    .texture_layer = item.texture_layer});
+  }
+  mesh_items_.resize(num_opaque);
+}
+
+void WebGpuRenderer::PackTranslucentObjects(const Camera& camera, uint32_t first_instance,
+                                            std::span<PackedInstance> instances) {
+  if (translucent_objects_.empty()) return;
+  const uint64_t begin_ns = Profiler::NowNs();
+  {
+    PROFILE_SCOPE("SortTranslucent");
+    translucent_items_.resize(translucent_objects_.size());
+    for (uint32_t i = 0; i < translucent_objects_.size(); ++i) {
+      const TranslucentObject& object = translucent_objects_[i];
+      const DrawState state{
+          .pipeline = static_cast<uint32_t>(
+              GetPipelineIndex(object.geometry, object.texture_array, true)),
+          .bind_group = object.texture_array};
+      const float depth = GetViewDepth(camera.view, *object.transform);
+      translucent_items_[i] = {MakeTranslucentDrawKey(kMainDrawPass, state, depth), i};
+    }
+    RadixSortDrawItems(translucent_items_, &draw_sort_scratch_, thread_pool_.get());
+  }
+  render_stats_.sort_ns += Profiler::NowNs() - begin_ns;
+
+  uint32_t num_packed = first_instance;
+  for (size_t begin = 0; begin < translucent_items_.size();) {
+    const TranslucentObject& first = translucent_objects_[translucent_items_[begin].index];
+    size_t end = begin;
+    for (; end < translucent_items_.size(); ++end) {
+      const TranslucentObject& object = translucent_objects_[translucent_items_[end].index];
+      if (object.geometry != first.geometry || object.lod != first.lod ||
+          object.texture_array != first.texture_array) {
+        break;
+      }
+      PackedInstance* instance = &instances[num_packed + end - begin];
+      if (object.geometry->quantized) {
+        PackQuantizedInstance(*object.transform, object.scale, object.geometry->position_offset,
+                              object.geometry->position_scale, object.color, instance);
+      } else {
+        PackInstance(*object.transform, object.scale, object.color, instance);
+      }
+      instance->texture_layer = object.texture_layer;
+    }
+    const MeshLod& range =
+        first.geometry->lods[std::min<size_t>(first.lod, first.geometry->lods.size() - 1)];
+    instance_batches_.push_back({.geometry = first.geometry,
+                                 .first_instance = num_packed,
+                                 .num_instances = static_cast<uint32_t>(end - begin),
+                                 .first_index = range.first_index,
+                                 .index_count = range.num_indices,
+                                 .texture_array = first.texture_array,
+                                 .translucent = true,
+                                 .key = translucent_items_[begin].key});
+    num_packed += static_cast<uint32_t>(end - begin);
+    begin = end;
+  }
+  render_stats_.translucent_instances = static_cast<uint32_t>(translucent_objects_.size());
+}
+
+void WebGpuRenderer::UploadInstances(const Renderables& renderables) {
+  instance_batches_.clear();
+  gpu_cull_batches_.clear();
+  num_opaque_instances_ = 0;
+  gpu_culled_ = culling_enabled_ && gpu_culling_enabled_ && gpu_culling_->IsReady();
+  const bool cpu_culled = culling_enabled_ && !gpu_culled_;
+  CollectMeshItems(renderables);
+  if (cpu_culled) {
+    PROFILE_SCOPE("CullInstances");
+    CullInstances(renderables);
+  }
+  if (lod_settings_.enabled) {
+    PROFILE_SCOPE("SelectLods");
+    SelectLods(renderables.camera);
+  } else {
+    for (MeshItem& item : mesh_items_) item.lod = *item.previous_lod = 0;
+  }
+  CollectTranslucentObjects(renderables, cpu_culled);
+  // Only the opaque cubes and spheres are listed when some are translucent.
+  const bool cubes_indexed = cpu_culled || !translucent_cubes_.empty();
+  const bool spheres_indexed = cpu_culled || !translucent_spheres_.empty();
+  const size_t num_instances =
+      (cubes_indexed ? visible_cubes_.size() : renderables.cubes.size()) +
+      (spheres_indexed ? visible_spheres_.size() : renderables.spheres.size()) +
+      mesh_items_.size() + translucent_objects_.size();
+  if (num_instances == 0) return;
+
+  const uint64_t num_bytes = num_instances * sizeof(PackedInstance);
+  // The culling pass binds the instances as a storage buffer.
+  instance_allocation_ = upload_ring_->Allocate(
+      num_bytes, gpu_culled_ ? GpuCulling::kStorageOffsetAlignment : sizeof(float));
+  std::span<PackedInstance> instances(static_cast<PackedInstance*>(instance_allocation_.data),
+                                      num_instances);
+  uint32_t num_packed = 0;
+  const GpuGeometry* sphere_geometry =
+      sphere_impostors_enabled_ && instanced_pipelines_[kImpostorPipelineIndex]
+          ? &impostor_geometry_
+          : &sphere_geometry_;
+  auto add_batch = [&](const GpuGeometry* geometry, const BoundingSphere& bounds,
+                       size_t num_batch_instances, uint32_t lod = 0, uint32_t texture_array = 0) {
+    if (num_batch_instances == 0) return;
+    const MeshLod& range = geometry->lods[std::min<size_t>(lod, geometry->lods.size() - 1)];
+    instance_batches_.push_back({geometry, num_packed, static_cast<uint32_t>(num_batch_instances),
+                                 range.first_index, range.num_indices, texture_array});
+    if (gpu_culled_) {
+      gpu_cull_batches_.push_back({.first_instance = num_packed,
+                                   .num_instances = static_cast<uint32_t>(num_batch_instances),
+                                   .first_index = range.first_index,
+                                   .index_count = range.num_indices,
+                                   .bounds = bounds});
+    }
+    num_packed += static_cast<uint32_t>(num_batch_instances);
+  };
+  add_batch(&cube_geometry_, kCubeBounds,
+            cubes_indexed ? PackCubes(renderables.cubes, visible_cubes_, instances)
+                          : PackCubes(renderables.cubes, instances));
+  add_batch(sphere_geometry, kSphereBounds,
+            spheres_indexed
+                ? PackSpheres(renderables.spheres, visible_spheres_, instances.subspan(num_packed))
+                : PackSpheres(renderables.spheres, instances.subspan(num_packed)));
+
+  for (size_t begin = 0; begin < mesh_items_.size();) {
+    const MeshItem& first = mesh_items_[begin];
+    const GpuGeometry* geometry = mesh_cache_->Get(first.handle);
+    size_t end = begin;
+    for (; end < mesh_items_.size() && mesh_items_[end].handle == first.handle &&
+           mesh_items_[end].texture_array == first.texture_array &&
+           mesh_items_[end].lod == first.lod;
+         ++end) {
+      const MeshItem& item = mesh_items_[end];
+      PackedInstance* instance = &instances[num_packed + end - begin];
+      if (geometry->quantized) {
+        PackQuantizedInstance(*item.transform, item.scale, geometry->position_offset,
+                              geometry->position_scale, item.color, instance);
+      } else {
+        PackInstance(*item.transform, item.scale, item.color, instance);
+      }
+      instance->texture_layer = item.texture_layer;
+    }
+    add_batch(geometry, GetInstanceBounds(*geometry, mesh_cache_->GetBounds(first.handle)),
+              end - begin, first.lod, first.texture_array);
+    begin = end;
+  }
+  num_opaque_instances_ = num_packed;
+  PackTranslucentObjects(renderables.camera, num_packed, instances);
+  render_stats_.instance_bytes += num_bytes;
+}
+
+void WebGpuRenderer::UploadRetainedScene(RetainedScene* scene) {
+  retained_batches_.clear();
+  // The buffers may hold another scene's instances.
+  const bool new_scene = scene != retained_scene_;
+  retained_scene_ = scene;
+  if (scene == nullptr) return;
+  const GpuGeometry* geometries[kNumSceneObjectKinds] = {
+      &cube_geometry_, sphere_impostors_enabled_ && instanced_pipelines_[kImpostorPipelineIndex]
+                           ? &impostor_geometry_
+                           : &sphere_geometry_};
+  wgpu::Queue queue = device_.GetQueue();
+  for (size_t kind = 0; kind < kNumSceneObjectKinds; ++kind) {
+    const std::span<const PackedInstance> instances =
+        scene->GetInstances(static_cast<SceneObjectKind>(kind));
+    const uint32_t num_instances = static_cast<uint32_t>(instances.size());
+    RetainedBuffer& retained_buffer = retained_buffers_[kind];
+    scene->TakeDirtyRanges(static_cast<SceneObjectKind>(kind), &dirty_ranges_);
+    bool upload_all = new_scene;
+    if (num_instances > retained_buffer.capacity) {
+      retained_buffer.capacity = std::bit_ceil(std::max<uint64_t>(num_instances, 1024));
+      retained_buffer.buffer = CreateBuffer(device_, wgpu::BufferUsage::Vertex,
+                                            retained_buffer.capacity * sizeof(PackedInstance));
+      upload_all = true;
+    }
+    if (upload_all) dirty_ranges_.assign(1, {0, num_instances});
+    // Ordered before the frame's commands, and after the previous frames' which read the ranges.
+    for (const DirtyRange& range : dirty_ranges_) {
+      if (range.begin == range.end) continue;
+      const uint64_t num_bytes = uint64_t{range.end - range.begin} * sizeof(PackedInstance);
+      queue.WriteBuffer(retained_buffer.buffer, uint64_t{range.begin} * sizeof(PackedInstance),
+                        &instances[range.begin], num_bytes);
+      render_stats_.retained_instance_bytes += num_bytes;
+      ++render_stats_.retained_writes;
+    }
+    if (num_instances == 0) continue;
+    const GpuGeometry* geometry = geometries[kind];
+    retained_batches_.push_back({.geometry = geometry,
+                                 .num_instances = num_instances,
+                                 .first_index = geometry->lods[0].first_index,
+                                 .index_count = geometry->lods[0].num_indices,
+                                 .instance_buffer = retained_buffer.buffer});
+  }
+}
+
+size_t WebGpuRenderer::GetPipelineIndex(const GpuGeometry* geometry, uint32_t texture_array,
+                                        bool translucent) const {
+  const size_t index = geometry == &impostor_geometry_
+                           ? kImpostorPipelineIndex
+                           : GetInstancedPipelineIndex(geometry->quantized, texture_array != 0);
+  return index + (translucent ? kNumOpaquePipelines : 0);
+}
+
+void WebGpuRenderer::SortDraws() {
+  const uint64_t begin_ns = Profiler::NowNs();
+  draw_items_.clear();
+  auto add_item = [&](const InstanceBatch& batch, uint32_t index) {
+    if (batch.translucent) {
+      draw_items_.push_back({batch.key, index});
+      return;
+    }
+    // Opaque batches are kept in their order within a state, which groups the same geometries.
+    const DrawState state{
+        .pipeline = static_cast<uint32_t>(
+            GetPipelineIndex(batch.geometry, batch.texture_array, false)),
+        .bind_group = batch.texture_array,
+        .geometry = index};
+    draw_items_.push_back({MakeOpaqueDrawKey(kMainDrawPass, state, 0.f), index});
+  };
+  for (size_t i = 0; i < instance_batches_.size(); ++i) {
+    add_item(instance_batches_[i], static_cast<uint32_t>(i));
+  }
+  for (size_t i = 0; i < retained_batches_.size(); ++i) {
+    add_item(retained_batches_[i], static_cast<uint32_t>(instance_batches_.size() + i));
+  }
+  RadixSortDrawItems(draw_items_, &draw_sort_scratch_, thread_pool_.get());
+  render_stats_.sort_ns += Profiler::NowNs() - begin_ns;
+}
+
+void WebGpuRenderer::DrawInstances(wgpu::RenderPassEncoder pass) {
+  if (draw_items_.empty()) return;
+
+  // Bound once: the instanced pipelines share the layout of group 0, and of group 1 when textured.
+  pass.SetBindGroup(0, uniform_bind_group_, 1, &uniform_offset_);
+  size_t current_pipeline = instanced_pipelines_.size();
+  uint32_t current_texture_array = 0;
+  struct VertexBufferBinding {
+    WGPUBuffer buffer = nullptr;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+  };
+  VertexBufferBinding current_vertex_buffers[2];
+  WGPUBuffer current_index_buffer = nullptr;
+  auto set_vertex_buffer = [&](uint32_t slot, const wgpu::Buffer& buffer, uint64_t offset,
+                               uint64_t size) {
+    VertexBufferBinding& current = current_vertex_buffers[slot];
+    if (current.buffer == buffer.Get() && current.offset == offset && current.size == size) return;
+    pass.SetVertexBuffer(slot, buffer, offset, size);
+    current = {buffer.Get(), offset, size};
+    ++render_stats_.buffer_switches;
+  };
+  // Sets the pipeline, texture and vertex buffers of "batch" but the instances. Returns false if
+  // its pipeline is not ready.
+  auto bind_batch = [&](const InstanceBatch& batch) {
+    const bool impostor = batch.geometry == &impostor_geometry_;
+    const bool quantized = batch.geometry->quantized;
+    size_t index = GetPipelineIndex(batch.geometry, batch.texture_array, batch.translucent);
+    // Textured meshes are drawn untextured until their pipeline is ready.
+    if (!instanced_pipelines_[index]) {
+      index = GetInstancedPipelineIndex(quantized, false) +
+              (batch.translucent ? kNumOpaquePipelines : 0);
+    }
+    const wgpu::RenderPipeline& pipeline = instanced_pipelines_[index];
+    if (!pipeline) return false;
+    if (index != current_pipeline) {
+      pass.SetPipeline(pipeline);
+      current_pipeline = index;
+      ++render_stats_.pipeline_switches;
+    }
+    if (index % kNumOpaquePipelines == GetInstancedPipelineIndex(quantized, true) &&
+        batch.texture_array != current_texture_array) {
+      pass.SetBindGroup(1, GetTextureBindGroup(batch.texture_array));
+      current_texture_array = batch.texture_array;
+      ++render_stats_.bind_group_switches;
+    }
+    if (!impostor) {
+      set_vertex_buffer(0, batch.geometry->vertex_buffer, 0, WGPU_WHOLE_SIZE);
+    }
+    if (batch.geometry->index_buffer.Get() != current_index_buffer) {
+      pass.SetIndexBuffer(batch.geometry->index_buffer, wgpu::IndexFormat::Uint32);
+      current_index_buffer = batch.geometry->index_buffer.Get();
+      ++render_stats_.buffer_switches;
+    }
+    return true;
+  };
+  for (const DrawItem& item : draw_items_) {
+    const bool retained = item.index >= instance_batches_.size();
+    const InstanceBatch& batch = retained ? retained_batches_[item.index - instance_batches_.size()]
+                                          : instance_batches_[item.index];
+    if (!bind_batch(batch)) continue;
+    // Impostors have no vertices and read the instances from the first buffer.
+    const uint32_t instance_slot = batch.geometry == &impostor_geometry_ ? 0 : 1;
+    if (retained) {
+      set_vertex_buffer(instance_slot, batch.instance_buffer, 0,
+                        uint64_t{batch.num_instances} * sizeof(PackedInstance));
+      pass.DrawIndexed(batch.index_count, batch.num_instances, batch.first_index, 0, 0);
+    } else if (gpu_culled_ && !batch.translucent) {
+      // The instance count is only known to the culling pass, whose batches are the opaque ones.
+      set_vertex_buffer(instance_slot, gpu_culling_->GetInstanceBuffer(),
+                        uint64_t{batch.first_instance} * sizeof(PackedInstance),
+                        uint64_t{batch.num_instances} * sizeof(PackedInstance));
+      pass.DrawIndexedIndirect(gpu_culling_->GetDrawBuffer(),
+                               uint64_t{item.index} * sizeof(DrawIndexedIndirectArgs));
+    } else {
+      set_vertex_buffer(instance_slot, instance_allocation_.buffer, instance_allocation_.offset,
+                        instance_allocation_.size);
+      pass.DrawIndexed(batch.index_count, batch.num_instances, batch.first_index, 0,
+                       batch.first_instance);
+    }
+    ++render_stats_.draw_calls;
+    render_stats_.instances += batch.num_instances;
+    render_stats_.vertices += uint64_t{batch.index_count} * batch.num_instances;
+    render_stats_.triangles += uint64_t{batch.index_count / 3} * batch.num_instances;
+    render_stats_.full_detail_triangles +=
+        uint64_t{batch.geometry->lods[0].num_indices / 3} * batch.num_instances;
+  }
+}
+
+wgpu::BindGroup WebGpuRenderer::GetTextureBindGroup(uint32_t texture_array) {
+  // The view changes when the array grows, which keys a new bind group.
+  wgpu::BindGroupEntry entries[] = {
+      {.binding = 0, .textureView = texture_manager_->GetArrayView(texture_array)},
+      {.binding = 1, .sampler = texture_manager_->GetSampler()}};
+  return bind_group_cache_->Get(texture_bind_group_layout_, entries);
+}
+
+void WebGpuRenderer::BuildRenderGraph(const Renderables& renderables,
+                                      wgpu::TextureView color_view) {
+  render_graph_.Reset();
+  const RenderGraphResource color = render_graph_.ImportTexture("Color", color_view);
+  const RenderGraphResource depth = render_graph_.CreateTexture(
+      "Depth", {.width = static_cast<uint32_t>(width_),
+                .height = static_cast<uint32_t>(height_),
+                .format = depth_texture_format_});
+  RenderGraphResource culled_instances = 0;
+  if (gpu_culled_) {
+    culled_instances = render_graph_.ImportBuffer("Culled instances");
+    render_graph_
+        .AddEncoderPass("GPU culling",
+                        [this, &renderables](wgpu::CommandEncoder encoder) {
+                          const Camera& camera = renderables.camera;
+                          // The translucent instances that follow are drawn without culling.
+                          UploadAllocation opaque_instances = instance_allocation_;
+                          opaque_instances.size = num_opaque_instances_ * sizeof(PackedInstance);
+                          gpu_culling_->Cull(encoder,
+                                             ExtractFrustum(camera.projection * camera.view),
+                                             opaque_instances, gpu_cull_batches_);
+                        })
+        .Write(culled_instances);
+  }
+
+  // A cached UI is rendered into its own texture when its draw data changed, and that texture is
+  // composited over every frame.
+  const bool ui_cacheable =
+      ui_->IsCachingEnabled() && ui_composite_pipeline_ && width_ > 0 && height_ > 0;
+  RenderGraphResource ui_texture = 0;
+  if (ui_cacheable) {
+    const uint32_t width = static_cast<uint32_t>(width_);
+    const uint32_t height = static_cast<uint32_t>(height_);
+    if (!ui_texture_ || ui_texture_.GetWidth() != width || ui_texture_.GetHeight() != height) {
+      wgpu::TextureDescriptor descriptor{
+          .usage = wgpu::TextureUsage::RenderAttachment | wgpu::TextureUsage::TextureBinding,
+          .size = {width, height, 1},
+          .format = wgpu::TextureFormat::BGRA8Unorm};
+      ui_texture_ = device_.CreateTexture(&descriptor);
+      ui_texture_view_ = ui_texture_.CreateView();
+      ui_->InvalidateCache();
+    }
+    ui_texture = render_graph_.ImportTexture("UI", ui_texture_view_);
+  }
+  if (!ui_->EndUiFrame(ui_cacheable) && ui_cacheable) {
+    // The UI pipeline of the ImGui backend has a depth attachment.
+    const RenderGraphResource ui_depth = render_graph_.CreateTexture(
+        "UI depth", {.width = static_cast<uint32_t>(width_),
+                     .height = static_cast<uint32_t>(height_),
+                     .format = depth_texture_format_});
+    render_graph_
+        .AddRenderPass("UI", [this](wgpu::RenderPassEncoder pass) { ui_->RenderToCache(pass); })
+        .AddColorAttachment(ui_texture, wgpu::Color{})
+        .SetDepthAttachment(ui_depth, 1.f);
+  }
+
+  RenderGraph::PassBuilder main_pass = render_graph_.AddRenderPass(
+      "Main pass", [this, ui_cacheable](wgpu::RenderPassEncoder pass) {
+        {
+          PROFILE_SCOPE("Encode");
+          if (render_pipeline_) {
+            pass.SetPipeline(render_pipeline_);
+            pass.Draw(3);
+            ++render_stats_.draw_calls;
+          }
+          DrawInstances(pass);
+        }
+        if (ui_cacheable) {
+          wgpu::BindGroupEntry entry{.binding = 0, .textureView = ui_texture_view_};
+          pass.SetPipeline(ui_composite_pipeline_);
+          pass.SetBindGroup(0, bind_group_cache_->Get(ui_bind_group_layout_, std::span(&entry, 1)));
+          pass.Draw(3);
+          ++render_stats_.draw_calls;
+        } else {
+          ui_->RenderDrawData(pass);
+        }
+      });
+  main_pass.AddColorAttachment(color, wgpu::Color{}).SetDepthAttachment(depth, 1.f);
+  if (gpu_culled_) main_pass.Read(culled_instances);
+  if (ui_cacheable) main_pass.Read(ui_texture);
+}
+
+void WebGpuRenderer::BeginFrame() {
+  PROFILE_SCOPE("WebGpuRenderer::BeginFrame");
+  upload_ring_->BeginFrame();
+  mesh_cache_->BeginFrame();
+  bind_group_cache_->BeginFrame();
+  transient_textures_->BeginFrame();
+  ui_->BeginUiFrame();
+}
+
+void WebGpuRenderer::EndFrame(const Renderables& renderables) {
+  PROFILE_SCOPE("WebGpuRenderer::EndFrame");
+  render_stats_ = {};
+  const BindGroupCacheStats bind_group_stats = bind_group_cache_->GetStats();
+  // Submitted first so that the textures which became ready can be drawn in this frame.
+  if (wgpu::CommandBuffer texture_commands = texture_manager_->FinishUploads()) {
+    device_.GetQueue().Submit(1, &texture_commands);
+  }
+  UpdateUniforms(renderables.camera);
+  {
+    PROFILE_SCOPE("UploadInstances");
+    UploadInstances(renderables);
+  }
+  {
+    PROFILE_SCOPE("UploadRetainedScene");
+    UploadRetainedScene(renderables.scene);
+  }
+  {
+    PROFILE_SCOPE("SortDraws");
+    SortDraws();
+  }
+
+  wgpu::TextureView color_view =
+      swap_chain_ ? swap_chain_.GetCurrentTextureView() : color_texture_view_;
+  BuildRenderGraph(renderables, color_view);
+  std::string error;
+  if (!render_graph_.Compile(&error)) {
+    std::cerr << "Invalid render graph: " << error << std::endl;
+  }
+  wgpu::CommandEncoder encoder = device_.CreateCommandEncoder();
+  render_graph_.Execute(encoder, transient_textures_.get(), gpu_profiler_.get());
+  Profiler& profiler = Profiler::Get();
+  profiler.SetCounter("Pipeline switches", render_stats_.pipeline_switches);
+  profiler.SetCounter("Bind group switches", render_stats_.bind_group_switches);
+  profiler.SetCounter("Buffer switches", render_stats_.buffer_switches);
+  profiler.SetCounter("Translucent instances", render_stats_.translucent_instances);
+  profiler.SetCounter("Draw sort ms", static_cast<double>(render_stats_.sort_ns) / 1e6);
+  render_stats_.bind_groups_created = static_cast<uint32_t>(
+      bind_group_cache_->GetStats().num_created - bind_group_stats.num_created);
+  render_stats_.bind_groups_reused =
+      static_cast<uint32_t>(bind_group_cache_->GetStats().num_reused - bind_group_stats.num_reused);
+  gpu_profiler_->Resolve(encoder);
   wgpu::CommandBuffer commands = encoder.Finish();
-  device_.GetQueue().Submit(1, &commands);
+  {
+    PROFILE_SCOPE("Submit");
+    upload_ring_->Flush();
+    device_.GetQueue().Submit(1, &commands);
+    upload_ring_->EndFrame();
+    gpu_profiler_->EndFrame();
+  }
 
 #if !defined(__EMSCRIPTEN__)
+  PROFILE_SCOPE("Present");
   device_.Tick();
-  swap_chain_.Present();
+  if (swap_chain_) {
+    swap_chain_.Present();
+  }
 #endif
 }
 
 void WebGpuRenderer::OnResize(int width, int height) {
   width_ = width;
   height_ = height;
-  swap_chain_ = CreateSwapChain(surface_, device_, width_, height_);
-  depth_texture_ = CreateDepthTexture(device_, depth_texture_format_, width_, height_);
-  depth_texture_view_ = CreateDepthTextureView(depth_texture_, depth_texture_format_);
+  if (surface_) {
+    swap_chain_ = CreateSwapChain(surface_, device_, width_, height_);
+  } else {
+    color_texture_ = CreateColorTexture(device_, color_texture_format_, width_, height_);
+    color_texture_view_ = color_texture_.CreateView();
+  }
+  ui_->SetDisplaySize(width_, height_);
 }
 
 void* WebGpuRenderer::GetWindow() const { return window_; }
 
+void WebGpuRenderer::WaitForNextFrame() {
+  PROFILE_SCOPE("WebGpuRenderer::WaitForNextFrame");
+  upload_ring_->WaitForNextSlot();
+}
+
+bool WebGpuRenderer::HasPendingWork() const {
+  return pipeline_cache_->GetStats().num_pending > 0 || texture_manager_->HasPendingUploads();
+}
+
+void WebGpuRenderer::SetPresentMode(wgpu::PresentMode present_mode) {
+  if (present_mode == present_mode_) return;
+  present_mode_ = present_mode;
+  if (surface_) {
+    swap_chain_ = CreateSwapChain(surface_, device_, width_, height_);
+  }
+}
+
+std::vector<uint8_t> WebGpuRenderer::ReadPixels() {
+  if (!color_texture_) return {};
+
+  // Texture to buffer copies require rows aligned to 256 bytes.
+  const uint32_t bytes_per_pixel = 4;
+  const uint32_t row_size = static_cast<uint32_t>(width_) * bytes_per_pixel;
+  const uint32_t padded_row_size = static_cast<uint32_t>(AlignUp(row_size, 256));
+  const uint64_t buffer_size = static_cast<uint64_t>(padded_row_size) * height_;
+  wgpu::BufferDescriptor buffer_descriptor{
+      .usage = wgpu::BufferUsage::MapRead | wgpu::BufferUsage::CopyDst, .size = buffer_size};
+  wgpu::Buffer readback_buffer = device_.CreateBuffer(&buffer_descriptor);
+
+  wgpu::ImageCopyTexture source{.texture = color_texture_};
+  wgpu::ImageCopyBuffer destination{
+      .layout = {.bytesPerRow = padded_row_size, .rowsPerImage = static_cast<uint32_t>(height_)},
+      .buffer = readback_buffer};
+  wgpu::Extent3D copy_size{static_cast<uint32_t>(width_), static_cast<uint32_t>(height_), 1};
+  wgpu::CommandEncoder encoder = device_.CreateCommandEncoder();
+  encoder.CopyTextureToBuffer(&source, &destination, &copy_size);
+  wgpu::CommandBuffer commands = encoder.Finish();
+  device_.GetQueue().Submit(1, &commands);
+
+  bool mapped = false;
+  readback_buffer.MapAsync(
+      wgpu::MapMode::Read, 0, buffer_size,
+      [](WGPUBufferMapAsyncStatus status, void* user_data) {
+        *reinterpret_cast<bool*>(user_data) = true;
+      },
+      &mapped);
+  WaitUntil(device_, [&mapped] { return mapped; });
+
+  std::vector<uint8_t> pixels(static_cast<size_t>(row_size) * height_);
+  const uint8_t* data =
+      static_cast<const uint8_t*>(readback_buffer.GetConstMappedRange(0, buffer_size));
+  if (data == nullptr) return {};
+  for (int row = 0; row < height_; ++row) {
+    std::memcpy(&pixels[row * row_size], data + row * padded_row_size, row_size);
+  }
+  readback_buffer.Unmap();
+  return pixels;
+}
+
 }  // namespace web_gpu_app
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "web_gpu_app/web_gpu_utils.h"
+
+#include <cassert>
+#include <memory>
+
+namespace web_gpu_app {
+
+wgpu::Buffer CreateBuffer(wgpu::Device device, wgpu::BufferUsage usage, uint64_t size,
+                          const void* data) {
+  wgpu::BufferDescriptor descriptor{.usage = usage | wgpu::BufferUsage::CopyDst,
+                                    .size = AlignUp(size, 4)};
+  wgpu::Buffer buffer = device.CreateBuffer(&descriptor);
+  if (data != nullptr) {
+    device.GetQueue().WriteBuffer(buffer, 0, data, size);
+  }
+  return buffer;
+}
+
+GpuGeometry CreateGpuGeometry(wgpu::Device device, const PrimitiveGeometry& geometry) {
+  GpuGeometry gpu_geometry;
+  gpu_geometry.vertex_buffer =
+      CreateBuffer(device, wgpu::BufferUsage::Vertex, geometry.vertices.size() * sizeof(Vertex),
+                   geometry.vertices.data());
+  gpu_geometry.index_buffer =
+      CreateBuffer(device, wgpu::BufferUsage::Index, geometry.indices.size() * sizeof(uint32_t),
+                   geometry.indices.data());
+  gpu_geometry.index_count = static_cast<uint32_t>(geometry.indices.size());
+  gpu_geometry.lods = {{.first_index = 0, .num_indices = gpu_geometry.index_count}};
+  return gpu_geometry;
+}
+
+GpuGeometry CreateGpuGeometry(wgpu::Device device, const QuantizedGeometry& geometry) {
+  GpuGeometry gpu_geometry;
+  gpu_geometry.vertex_buffer =
+      CreateBuffer(device, wgpu::BufferUsage::Vertex,
+                   geometry.vertices.size() * sizeof(QuantizedVertex), geometry.vertices.data());
+  gpu_geometry.index_buffer =
+      CreateBuffer(device, wgpu::BufferUsage::Index, geometry.indices.size() * sizeof(uint32_t),
+                   geometry.indices.data());
+  gpu_geometry.index_count = static_cast<uint32_t>(geometry.indices.size());
+  gpu_geometry.lods = {{.first_index = 0, .num_indices = gpu_geometry.index_count}};
+  gpu_geometry.quantized = true;
+  gpu_geometry.position_offset = geometry.position_offset;
+  gpu_geometry.position_scale = geometry.position_scale;
+  return gpu_geometry;
+}
+
+void OnSubmittedWorkDone(wgpu::Queue queue, std::function<void()> callback) {
+  auto* user_data = new std::function<void()>(std::move(callback));
+  queue.OnSubmittedWorkDone(
+      [](WGPUQueueWorkDoneStatus, void* user_data) {
+        std::unique_ptr<std::function<void()>> callback(
+            reinterpret_cast<std::function<void()>*>(user_data));
+        (*callback)();
+      },
+      user_data);
+}
+
+void WaitUntil(wgpu::Device device, const std::function<bool()>& predicate) {
+#if defined(__EMSCRIPTEN__)
+  assert(predicate());
+#else
+  while (!predicate()) {
+    device.Tick();
+  }
+#endif
+}
+
+}  // namespace web_gpu_app